@@ -46,8 +46,22 @@ u32 read_reg(u32 reg) {
     return *reinterpret_cast<volatile u32*>(g_apic_base.to_ptr() + reg);
 }
 
-void init() {
-    pic::disable();
+void eoi() {
+    write_reg(APICRegisters::EOI, 0);
+}
+
+u32 id() {
+    return read_reg(APICRegisters::ID) >> 24;
+}
+
+bool is_initialized() {
+    return g_apic_base != 0;
+}
+
+static void enable_local_apic() {
+    if (is_initialized()) {
+        return;
+    }
 
     PhysicalAddress base = get_apic_base();
     set_apic_base(base);
@@ -59,6 +73,20 @@ void init() {
     write_reg(APICRegisters::SpuriousInterruptVector, value | SPURIOUS_INTERRUPT_VECTOR | 0x100);
 
     dbgln("APIC initialized at physical address {:#x}, mapped at virtual address {:#x}", base, g_apic_base);
+}
+
+void init_local() {
+    enable_local_apic();
+
+    write_reg(APICRegisters::LVTLint0, LVT_DELIVERY_EXTINT);
+    write_reg(APICRegisters::LVTLint1, LVT_DELIVERY_NMI);
+
+    write_reg(APICRegisters::LVTTimer, LVT_MASKED);
+}
+
+void init() {
+    pic::disable();
+    enable_local_apic();
 
     auto* madt = ACPIParser::find<acpi::MADT>();
     if (!madt) {
@@ -38,12 +38,49 @@ constexpr u32 IA32_APIC_BASE_ENABLE = 0x800;
 
 constexpr u8 SPURIOUS_INTERRUPT_VECTOR = 0xFF;
 
+// The local APIC timer is wired to the IRQ right after the legacy PIC ones
+constexpr u8 TIMER_IRQ = 16;
+
+constexpr u32 LVT_MASKED = 1 << 16;
+
+constexpr u32 LVT_DELIVERY_NMI = 0x400;
+constexpr u32 LVT_DELIVERY_EXTINT = 0x700;
+
+enum class TimerMode : u32 {
+    OneShot = 0 << 17,
+    Periodic = 1 << 17,
+    TSCDeadline = 2 << 17
+};
+
+enum class TimerDivide : u32 {
+    By1 = 0b1011,
+    By2 = 0b0000,
+    By4 = 0b0001,
+    By8 = 0b0010,
+    By16 = 0b0011,
+    By32 = 0b1000,
+    By64 = 0b1001,
+    By128 = 0b1010
+};
+
 void write_reg(APICRegisters reg, u32 value);
 void write_reg(u32 reg, u32 value);
 
 u32 read_reg(APICRegisters reg);
 u32 read_reg(u32 reg);
 
+void eoi();
+
+// Local APIC ID of the current processor, what message signaled interrupts are addressed to
+u32 id();
+
+bool is_initialized();
+
+// Fully switches interrupt delivery over to the APIC, disabling the legacy PIC
 void init();
 
+// Only enables the local APIC of the current processor. External interrupts are still delivered
+// by the PIC through LINT0 (virtual wire mode), which lets us use the APIC timer on its own.
+void init_local();
+
 }
\ No newline at end of file
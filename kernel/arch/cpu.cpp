@@ -45,7 +45,7 @@ CPUFeatures cpu_features() {
     u32 eax, ebx, ecx, edx;
     __get_cpuid(1, &eax, &ebx, &ecx, &edx);
 
-    return static_cast<CPUFeatures>((static_cast<u64>(edx) << 32) | eax);
+    return static_cast<CPUFeatures>((static_cast<u64>(edx) << 32) | ecx);
 }
 
 }
\ No newline at end of file
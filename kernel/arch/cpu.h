@@ -85,7 +85,8 @@ enum {
     MSR_SFMASK         = 0xC0000084,
     MSR_FS_BASE        = 0xC0000100,
     MSR_GS_BASE        = 0xC0000101,
-    MSR_KERNEL_GS_BASE = 0xC0000102
+    MSR_KERNEL_GS_BASE = 0xC0000102,
+    MSR_TSC_DEADLINE   = 0x6E0
 };
 
 // The bits of rflags and eflags are the same
@@ -173,6 +174,13 @@ static inline void write_cr4(FlatPtr value) {
     asm volatile("mov %0, %%cr4" :: "r"(value));
 }
 
+static inline u64 rdtsc() {
+    u32 low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+    return (static_cast<u64>(high) << 32) | low;
+}
+
 static inline void invlpg(FlatPtr address) {
     asm volatile("invlpg (%0)" :: "r"(address) : "memory");
 }
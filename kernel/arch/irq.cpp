@@ -1,18 +1,27 @@
 #include <kernel/arch/irq.h>
 #include <kernel/arch/pic.h>
+#include <kernel/arch/apic.h>
+#include <kernel/arch/interrupts.h>
 #include <kernel/process/scheduler.h>
 
 #include <std/format.h>
 
 namespace kernel {
 
-static IRQHandlerBase* s_irq_handlers[16] = {};
+extern "C" void* _irq_stub_table[];
+
+static IRQHandlerBase* s_irq_handlers[IRQ_COUNT] = {};
+static bool s_allocated_msi_irqs[MSI_IRQ_COUNT] = {};
 
 extern "C" void _irq_handler(arch::InterruptRegisters* regs) {
     u8 irq = regs->intno - 32;
     IRQHandlerBase* handler = s_irq_handlers[irq];
 
     if (!handler) {
+        if (irq >= PIC_IRQ_COUNT) {
+            return apic::eoi();
+        }
+
         return pic::eoi(irq);
     }
 
@@ -26,7 +35,7 @@ extern "C" void _irq_handler(arch::InterruptRegisters* regs) {
 
 static void register_irq_handler(IRQHandlerBase* handler) {
     u8 irq = handler->irq();
-    if (irq >= 16) {
+    if (irq >= IRQ_COUNT) {
         return;
     }
 
@@ -36,6 +45,12 @@ static void register_irq_handler(IRQHandlerBase* handler) {
         return;
     }
 
+    // Each MSI IRQ is handed out to a single device by `allocate_msi_irq`
+    ASSERT(
+        slot->handler_type() != IRQHandlerType::MSI && handler->handler_type() != IRQHandlerType::MSI,
+        "MSI IRQs can't be shared"
+    );
+
     if (slot->handler_type() == IRQHandlerType::Exclusive) {
         auto* exclusive = static_cast<IRQHandler*>(slot);
         exclusive->set_shared(true);
@@ -54,7 +69,7 @@ static void register_irq_handler(IRQHandlerBase* handler) {
 
 static void unregister_irq_handler(IRQHandlerBase* handler) {
     u8 irq = handler->irq();
-    if (irq >= 16) {
+    if (irq >= IRQ_COUNT) {
         return;
     }
 
@@ -63,7 +78,10 @@ static void unregister_irq_handler(IRQHandlerBase* handler) {
         return;
     }
 
-    if (slot->handler_type() == IRQHandlerType::Exclusive) {
+    if (slot->handler_type() == IRQHandlerType::MSI) {
+        slot = nullptr;
+        return;
+    } else if (slot->handler_type() == IRQHandlerType::Exclusive) {
         static_cast<IRQHandler*>(slot)->set_shared(false);
         slot = nullptr;
 
@@ -122,6 +140,41 @@ void IRQHandler::disable_irq() {
     }
 }
 
+void MSIIRQHandler::eoi() {
+    apic::eoi();
+}
+
+ErrorOr<u8> allocate_msi_irq() {
+    if (!apic::is_initialized()) {
+        return Error(ENODEV);
+    }
+
+    arch::InterruptDisabler disabler;
+    for (u8 i = 0; i < MSI_IRQ_COUNT; i++) {
+        if (s_allocated_msi_irqs[i]) {
+            continue;
+        }
+
+        u8 irq = MSI_IRQ_BASE + i;
+
+        s_allocated_msi_irqs[i] = true;
+        arch::set_interrupt_handler(32 + irq, reinterpret_cast<uintptr_t>(_irq_stub_table[irq]), arch::INTERRUPT_GATE);
+
+        return irq;
+    }
+
+    return Error(ENOSPC);
+}
+
+void free_msi_irq(u8 irq) {
+    if (irq < MSI_IRQ_BASE || irq >= IRQ_COUNT) {
+        return;
+    }
+
+    arch::InterruptDisabler disabler;
+    s_allocated_msi_irqs[irq - MSI_IRQ_BASE] = false;
+}
+
 void SharedIRQHandler::handle_irq() {
     for (auto& handler : m_handlers) {
         handler->handle_irq();
@@ -2,12 +2,23 @@
 
 #include <kernel/common.h>
 #include <std/vector.h>
+#include <std/result.h>
 
 namespace kernel {
 
+// IRQs below `PIC_IRQ_COUNT` are routed through the legacy PIC, the rest are raised by the local APIC
+constexpr u8 PIC_IRQ_COUNT = 16;
+
+// Handed out to devices that signal interrupts by writing a message to the local APIC (MSI-X)
+constexpr u8 MSI_IRQ_BASE = 17;
+constexpr u8 MSI_IRQ_COUNT = 16;
+
+constexpr u8 IRQ_COUNT = MSI_IRQ_BASE + MSI_IRQ_COUNT;
+
 enum class IRQHandlerType : u8 {
     Exclusive = 1,
-    Shared = 2
+    Shared = 2,
+    MSI = 3 // Never shared, so it doesn't need the bookkeeping of `IRQHandler`
 };
 
 class IRQHandlerBase {
@@ -55,6 +66,21 @@ private:
     bool m_enabled = false;
 };
 
+// Message signaled interrupts are never shared and don't go through the PIC, they're acknowledged at the local APIC
+class MSIIRQHandler : public IRQHandlerBase {
+public:
+    MSIIRQHandler(u8 irq) : IRQHandlerBase(irq) {}
+
+    virtual void handle_irq() override = 0;
+    void eoi() override;
+
+    IRQHandlerType handler_type() const override { return IRQHandlerType::MSI; }
+};
+
+// Reserves one of the MSI IRQs and points its vector at the common IRQ handler. Fails if the local APIC isn't up.
+ErrorOr<u8> allocate_msi_irq();
+void free_msi_irq(u8 irq);
+
 class SharedIRQHandler : public IRQHandlerBase {
 public:
     SharedIRQHandler(u8 irq) : IRQHandlerBase(irq) {}
@@ -7,6 +7,8 @@
 
 namespace kernel {
 
+class APICTimer;
+
 enum class InterruptState {
     Disabled = 0,
     Enabled = 1,
@@ -19,6 +21,9 @@ public:
     // For now there is only one instance but where we have SMP we will have multiple instances
     static Processor& instance();
 
+    // Number of processors that are up and running, drivers size their per-CPU queues after this
+    static size_t count() { return 1; }
+
     static bool are_interrupts_initialized();
     static void set_interrupts_initialized();
 
@@ -32,6 +37,9 @@ public:
 
     u32 id() const { return m_id; }
 
+    APICTimer* apic_timer() const { return m_apic_timer; }
+    void set_apic_timer(APICTimer* timer) { m_apic_timer = timer; }
+
     arch::CPUFeatures features() const { return m_features; }
     bool has_feature(arch::CPUFeatures feature) const { return std::has_flag(m_features, feature); }
 
@@ -57,6 +65,8 @@ private:
 
     u32 m_id = 0;
 
+    APICTimer* m_apic_timer = nullptr;
+
     u8 m_max_physical_address_width;
     u8 m_max_virtual_address_width;
     bool m_has_nx = false;
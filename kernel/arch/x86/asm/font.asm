@@ -0,0 +1,10 @@
+; The font the framebuffer console draws with, there's no filesystem to load it from when the kernel starts logging
+
+section .rodata
+
+global _console_font
+global _console_font_end
+
+_console_font:
+    incbin "base/res/fonts/zap-light16.psf"
+_console_font_end:
@@ -95,7 +95,7 @@ define_isr_err 30
 define_isr 31
 
 %assign i 0
-%rep 16
+%rep 33
     define_irq i
     %assign i i+1
 %endrep
@@ -109,7 +109,7 @@ _isr_stub_table:
 
 _irq_stub_table:
 %assign i 0
-%rep 16
+%rep 33
     dd _irq_stub_%+i
     %assign i i+1
 %endrep
\ No newline at end of file
@@ -177,6 +177,15 @@ PhysicalAddress PageDirectory::get_physical_address(VirtualAddress virt) const {
     return entry->get_physical_address();
 }
 
+Optional<PhysicalAddress> PageDirectory::translate(VirtualAddress virt, bool writable) const {
+    PageTableEntry const* entry = this->get_page_table_entry(virt);
+    if (!entry || !entry->is_present() || (writable && !entry->is_writable())) {
+        return {};
+    }
+
+    return PhysicalAddress { entry->get_physical_address() + virt % PAGE_SIZE };
+}
+
 bool PageDirectory::is_mapped(VirtualAddress virt) const {
     u32 pd = get_page_directory_index(virt);
     u32 pt = get_page_table_index(virt);
@@ -4,6 +4,8 @@
 
 #include <kernel/boot/boot_info.h>
 
+#include <std/optional.h>
+
 namespace kernel {
 
 enum class PageFlags : u32 {
@@ -141,6 +143,10 @@ public:
     PageTableEntry const* get_page_table_entry(VirtualAddress virt) const;
     PhysicalAddress get_physical_address(VirtualAddress virt) const;
 
+    // Where `virt` itself lives in physical memory, offset into its page included. Nothing if it isn't mapped, or not
+    // writable when `writable` is set.
+    Optional<PhysicalAddress> translate(VirtualAddress virt, bool writable = false) const;
+
     bool is_mapped(VirtualAddress virt) const;
 
     void clear();
@@ -6,11 +6,19 @@ BITS 64
 USER_STACK_OFFSET   equ 0x00
 KERNEL_STACK_OFFSET equ 0x0C
 
+; Keep in sync with `SyscallFlags` in kernel/process/syscalls.cpp
+SYSCALL_BLOCKING    equ 1 << 0
+SYSCALL_FULL_FRAME  equ 1 << 1
+
 extern _syscall_handler
+extern _fast_syscall_handler
+
+extern _syscall_flags
+extern _syscall_count
 
 global _syscall_interrupt_handler
 _syscall_interrupt_handler:
-    ; Save the user stack and swap it with the kernel stack
+    ; Save the user stack and swap it with the kernel stack. Interrupts are masked by MSR_SFMASK until we're done.
     mov gs:USER_STACK_OFFSET, rsp
     mov rsp, gs:KERNEL_STACK_OFFSET
 
@@ -20,6 +28,50 @@ _syscall_interrupt_handler:
     push USER_CODE_SELECTOR | 3   ; cs
     push rcx                      ; rcx contains the return address
 
+    ; Out of range syscall numbers go through the fast path which rejects them with -ENOSYS
+    cmp rax, [rel _syscall_count]
+    jae .fast
+
+    lea rcx, [rel _syscall_flags]
+    movzx r11d, byte [rcx + rax]
+
+    test r11d, SYSCALL_FULL_FRAME
+    jnz .full
+
+    test r11d, SYSCALL_BLOCKING
+    jz .fast
+
+    sti
+
+.fast:
+    ; rbx, rbp and r12-r15 are callee-saved so we only need to preserve what the handler is allowed to clobber
+    push rdi
+    push rsi
+    push rdx
+    push r8
+    push r9
+    push r10
+    sub rsp, 8                    ; Keep the stack 16-byte aligned for the call
+
+    ; Shuffle rax, rdx, rdi, rbx, rsi into the SysV argument registers
+    mov rcx, rbx
+    mov r8, rsi
+    mov rsi, rdx
+    mov rdx, rdi
+    mov rdi, rax
+    call _fast_syscall_handler
+
+    add rsp, 8
+    pop r10
+    pop r9
+    pop r8
+    pop rdx
+    pop rsi
+    pop rdi
+
+    jmp .return
+
+.full:
     sti
     pushaq
 
@@ -28,6 +80,7 @@ _syscall_interrupt_handler:
 
     popaq
 
+.return:
     pop rcx
     add rsp, 8
     pop r11
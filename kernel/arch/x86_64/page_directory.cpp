@@ -151,6 +151,17 @@ PhysicalAddress PageDirectory::get_physical_address(VirtualAddress va) const {
     return entry->physical_address();
 }
 
+Optional<PhysicalAddress> PageDirectory::translate(VirtualAddress va, bool writable) const {
+    auto* entry = this->get_page_table_entry(va);
+    if (!entry || !entry->is_present() || (writable && !entry->is_writable())) {
+        return {};
+    }
+
+    // Huge pages come back as the page directory entry that maps all 2MB of them
+    size_t page_size = (entry->value() & PageDirectoryEntry::PageSize) ? 2 * MB : PAGE_SIZE;
+    return entry->physical_address().offset(va % page_size);
+}
+
 bool PageDirectory::is_mapped(VirtualAddress va) const {
     auto* entry = this->get_page_table_entry(va);
     return entry && entry->is_present();
@@ -3,6 +3,8 @@
 #include <kernel/common.h>
 #include <kernel/boot/boot_info.h>
 
+#include <std/optional.h>
+
 #define COMMON_PAGE_METHODS                                                                                         \
     u64 value() const { return m_value; }                                                                           \
     void set_value(u64 value) { m_value = value; }                                                                  \
@@ -201,6 +203,10 @@ public:
 
     PhysicalAddress get_physical_address(VirtualAddress virt) const;
 
+    // Where `virt` itself lives in physical memory, offset into its (possibly huge) page included. Nothing if it isn't
+    // mapped, or not writable when `writable` is set.
+    Optional<PhysicalAddress> translate(VirtualAddress virt, bool writable = false) const;
+
     bool is_mapped(VirtualAddress virt) const;
 
     PageTableEntry const* get_page_table_entry(VirtualAddress virt) const;
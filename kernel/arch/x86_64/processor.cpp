@@ -12,6 +12,11 @@ extern "C" void _syscall_handler(arch::Registers* regs) {
     auto* process = Process::current();
     regs->rax = process->handle_syscall(regs);
 }
+
+extern "C" FlatPtr _fast_syscall_handler(FlatPtr syscall, FlatPtr arg1, FlatPtr arg2, FlatPtr arg3, FlatPtr arg4) {
+    auto* process = Process::current();
+    return process->handle_syscall(syscall, arg1, arg2, arg3, arg4);
+}
     
 extern "C" void _syscall_interrupt_handler();
 
@@ -36,6 +41,7 @@ void Processor::init() {
     wmsr(arch::MSR_EFER, efer | 1);
     wmsr(arch::MSR_STAR, (0x28ul << 32) | (0x33ul << 48));
     wmsr(arch::MSR_LSTAR, reinterpret_cast<u64>(&_syscall_interrupt_handler));
+    wmsr(arch::MSR_SFMASK, (1 << 9) | (1 << 10)); // Clear IF and DF on entry, the stub re-enables interrupts when needed
 
     // TODO: Setup swapgs
     wmsr(arch::MSR_GS_BASE, reinterpret_cast<u64>(&processor));
@@ -41,11 +41,12 @@ AC97Device::AC97Device(pci::Address address) : IRQHandler(address.interrupt_line
     m_audio_mixer.write<u16>(PCMVolume, 0);
     m_audio_mixer.write<u16>(MasterVolume, 0);
     
-    m_audio_mixer.write<u16>(SampleRate, m_sample_rate);
     this->reset();
 
     m_descriptors = reinterpret_cast<BufferDescriptor*>(MUST(MM->allocate_dma_region(sizeof(BufferDescriptor) * DESCRIPTOR_COUNT)));
-    m_output_buffer = reinterpret_cast<u8*>(MUST(MM->allocate_dma_region(OUTPUT_BUFFER_SIZE)));
+
+    // Every period has to be physically contiguous and mixing is simpler if the periods follow each other
+    m_output_buffer = reinterpret_cast<i16*>(MUST(MM->allocate_contiguous_dma_region(OUTPUT_BUFFER_SIZE)));
 
     u16 extended_capabilities = m_audio_mixer.read<u16>(ExtendedCapabilities);
     if (extended_capabilities & 0x1) {
@@ -57,6 +58,11 @@ AC97Device::AC97Device(pci::Address address) : IRQHandler(address.interrupt_line
     }
 
     m_audio_mixer.write<u16>(ExtendedCapabilities, extended_capabilities);
+
+    // Only takes with variable rate enabled, the mixer converts to whatever the codec ends up running at
+    m_audio_mixer.write<u16>(SampleRate, m_sample_rate);
+    m_sample_rate = m_audio_mixer.read<u16>(SampleRate);
+
     this->enable_irq();
     
     dbgln("AC97 Device ({}:{}:{}):", address.bus(), address.device(), address.function());
@@ -70,7 +76,7 @@ AC97Device::AC97Device(pci::Address address) : IRQHandler(address.interrupt_line
 
 void AC97Device::reset() {
     m_audio_output.write<u8>(TransferControl, 2); // Reset = 1
-    while (m_audio_output.read<u8>(TransferControl) & 1) {
+    while (m_audio_output.read<u8>(TransferControl) & 2) {
         io::wait(50); // Wait for reset to complete
     }
 
@@ -78,96 +84,92 @@ void AC97Device::reset() {
     m_current_descriptor = 0;
 }
 
-void AC97Device::handle_irq() {
-    TransferStatusInfo status = m_audio_output.read<u16>(TransferStatus);
-    if (!status.ioc) {
-        return;
-    }
+ErrorOr<void> AC97Device::start_output() {
+    this->reset();
 
-    m_audio_output.write<u16>(TransferStatus, 0x1C); // Clear the interrupt bits by setting them to 1
+    m_period_frames = std::min<size_t>(m_sample_rate * m_latency / 1000, MAX_PERIOD_FRAMES);
+    memset(m_output_buffer, 0, DESCRIPTOR_COUNT * m_period_frames * FRAME_SIZE);
 
-    // Check if the DMA caught up
-    u8 index = m_audio_output.read<u8>(ProcessedEntries);
-    u8 end = m_audio_output.read<u8>(EntryCount);
+    for (size_t i = 0; i < DESCRIPTOR_COUNT; i++) {
+        BufferDescriptor& descriptor = m_descriptors[i];
 
-    if (index == end) {
-        this->reset();
+        descriptor.address = static_cast<u32>(MM->get_physical_address(this->period(i)));
+        descriptor.samples = m_period_frames * 2;
+        descriptor.last_entry = 0;
+        descriptor.interrupt_on_completion = 1;
     }
 
-    m_irq_blocker.set_value(true);
+    m_periods_played = 0;
+
+    m_audio_output.write<u32>(BufferDescriptorList, static_cast<u32>(MM->get_physical_address(m_descriptors)));
+
+    // The last valid entry is kept right behind the current one so the DMA engine never runs out and stops
+    m_audio_output.write<u8>(EntryCount, DESCRIPTOR_COUNT - 1);
+
+    TransferControlInfo control = m_audio_output.read<u8>(TransferControl);
+    control.controller_status = control.ioc_ie = control.fifo_error_ie = 1;
+
+    m_dma_enabled = true;
+    m_audio_output.write<u8>(TransferControl, control.value);
+
+    return {};
 }
 
-ErrorOr<size_t> AC97Device::read(void*, size_t, size_t) {
-    return Error(ENOTSUP);
+void AC97Device::stop_output() {
+    this->reset();
 }
 
-ErrorOr<size_t> AC97Device::write(const void* buffer, size_t count, size_t) {
-    size_t offset = 0;
-    ssize_t remaining = count;
+ErrorOr<void> AC97Device::set_latency(u32 milliseconds) {
+    if (milliseconds < MIN_LATENCY || milliseconds > MAX_LATENCY) {
+        return Error(EINVAL);
+    }
 
-    while (remaining > 0) {
-        this->write_single(buffer, std::min(static_cast<size_t>(remaining), PAGE_SIZE), offset);
+    m_latency = milliseconds;
+    return {};
+}
 
-        offset += PAGE_SIZE;
-        remaining -= PAGE_SIZE;
+u64 AC97Device::frames_played() const {
+    arch::InterruptDisabler disabler;
+    if (!m_dma_enabled) {
+        return 0;
     }
 
-    return count;
+    // Samples (not frames) left in the period that is playing
+    size_t remaining = m_audio_output.read<u16>(TransferedSamples) / 2;
+    return m_periods_played * m_period_frames + (m_period_frames - std::min(remaining, m_period_frames));
 }
 
-void AC97Device::write_single(const void* buffer, size_t count, size_t offset) {
-    {
-        arch::InterruptDisabler disabler;
-        do {
-            TransferStatusInfo status = m_audio_output.read<u16>(TransferStatus);
-
-            u8 index = m_audio_output.read<u8>(ProcessedEntries);
-            u8 end = m_audio_output.read<u8>(EntryCount);
-
-            u8 buffers = end - index;
-            if (index > end)
-                buffers = DESCRIPTOR_COUNT - index + end;
-            if (!status.controller_status)
-                buffers++;
-
-            if (buffers > OUTPUT_BUFFER_PAGES) {
-                m_current_descriptor = index + 1;
-                break;
-            }
-
-            if (buffers < OUTPUT_BUFFER_PAGES) {
-                break;
-            }
-        
-            m_irq_blocker.set_value(false);
-            m_irq_blocker.wait();
-        } while (m_dma_enabled);
+void AC97Device::handle_irq() {
+    TransferStatusInfo status = m_audio_output.read<u16>(TransferStatus);
+    if (!status.ioc && !status.last_buffer_entry && !status.fifo_error) {
+        return;
     }
 
-    u8* output = m_output_buffer + m_current_page * PAGE_SIZE;
-    memcpy(output, reinterpret_cast<const u8*>(buffer) + offset, count);
+    m_audio_output.write<u16>(TransferStatus, 0x1C); // Clear the interrupt bits by setting them to 1
+    if (!m_dma_enabled) {
+        return;
+    }
 
-    u16 samples = count / sizeof(u16);
-    BufferDescriptor& descriptor = m_descriptors[m_current_descriptor];
+    u8 index = m_audio_output.read<u8>(ProcessedEntries);
+    while (m_current_descriptor != index) {
+        // Played periods turn into silence so that if the mixer falls behind the ring doesn't repeat itself
+        memset(this->period(m_current_descriptor), 0, m_period_frames * FRAME_SIZE);
 
-    descriptor.address = static_cast<u32>(MM->get_physical_address(output));
-    descriptor.samples = samples;
-    descriptor.last_entry = 0;
-    descriptor.interrupt_on_completion = 1;
+        m_current_descriptor = (m_current_descriptor + 1) % DESCRIPTOR_COUNT;
+        m_periods_played++;
+    }
 
-    m_audio_output.write<u32>(BufferDescriptorList, static_cast<u32>(MM->get_physical_address(&descriptor)));
-    m_audio_output.write<u8>(EntryCount, m_current_descriptor);
+    m_audio_output.write<u8>(EntryCount, (index + DESCRIPTOR_COUNT - 1) % DESCRIPTOR_COUNT);
 
-    if (!m_dma_enabled) {
+    // We only get here if the interrupts were held up for almost a whole ring, pick up where it stopped
+    if (status.controller_status) {
         TransferControlInfo control = m_audio_output.read<u8>(TransferControl);
-        control.controller_status = control.ioc_ie = control.fifo_error_ie = 1;
+        control.controller_status = 1;
 
         m_audio_output.write<u8>(TransferControl, control.value);
-        m_dma_enabled = true;
     }
 
-    m_current_descriptor = (m_current_descriptor + 1) % DESCRIPTOR_COUNT;
-    m_current_page = (m_current_page + 1) % OUTPUT_BUFFER_PAGES;
+    m_period_queue.wake_all();
 }
 
 ErrorOr<void> AC97Device::set_sample_rate(u16 sample_rate) {
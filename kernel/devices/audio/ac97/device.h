@@ -2,7 +2,6 @@
 
 #include <kernel/devices/audio/device.h>
 #include <kernel/arch/irq.h>
-#include <kernel/process/blocker.h>
 #include <kernel/pci/pci.h>
 #include <kernel/arch/io.h>
 
@@ -15,10 +14,17 @@ public:
     static constexpr u16 MIN_SAMPLE_RATE = 8000;
     static constexpr u16 MAX_SAMPLE_RATE = 48000;
 
+    // One buffer descriptor per period, the hardware plays them round and round
     static constexpr size_t DESCRIPTOR_COUNT = 32;
 
-    static constexpr size_t OUTPUT_BUFFER_PAGES = 16;
-    static constexpr size_t OUTPUT_BUFFER_SIZE = PAGE_SIZE * OUTPUT_BUFFER_PAGES;
+    static constexpr u32 DEFAULT_LATENCY = 10;
+    static constexpr u32 MIN_LATENCY = 2;
+    static constexpr u32 MAX_LATENCY = 50;
+
+    static constexpr size_t FRAME_SIZE = sizeof(i16) * 2;
+    static constexpr size_t MAX_PERIOD_FRAMES = MAX_SAMPLE_RATE * MAX_LATENCY / 1000;
+
+    static constexpr size_t OUTPUT_BUFFER_SIZE = DESCRIPTOR_COUNT * MAX_PERIOD_FRAMES * FRAME_SIZE;
 
     enum AudioMixerRegisters : u16 {
         Reset = 0x00,
@@ -106,19 +112,24 @@ public:
     io::Port audio_bus() { return m_audio_bus; }
     io::Port audio_output() { return m_audio_output; }
 
-    ErrorOr<size_t> read(void* buffer, size_t size, size_t offset) override;
-    ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) override;
-
-    bool can_read(fs::FileDescriptor const&) const override { return false; }
-    bool can_write(fs::FileDescriptor const&) const override { return true; }
-
     void reset();
 
-    void write_single(const void* data, size_t count, size_t offset);
-
     ErrorOr<void> set_sample_rate(u16 sample_rate) override;
     u16 sample_rate() const override { return m_sample_rate; }
 
+    size_t period_count() const override { return DESCRIPTOR_COUNT; }
+    size_t period_frames() const override { return m_period_frames; }
+    i16* period(size_t index) override { return m_output_buffer + index * m_period_frames * 2; }
+
+    u64 periods_played() const override { return m_periods_played; }
+    u64 frames_played() const override;
+
+    ErrorOr<void> start_output() override;
+    void stop_output() override;
+
+    ErrorOr<void> set_latency(u32 milliseconds) override;
+    u32 latency() const override { return m_latency; }
+
 private:
     friend class Device;
 
@@ -134,16 +145,17 @@ private:
     u16 m_sample_rate = DEFAULT_SAMPLE_RATE;
 
     BufferDescriptor* m_descriptors;
-    u8* m_output_buffer;
-    
+    i16* m_output_buffer;
+
+    u32 m_latency = DEFAULT_LATENCY;
+    size_t m_period_frames = 0;
+
+    u64 m_periods_played = 0;
     u8 m_current_descriptor = 0;
-    u8 m_current_page = 0;
 
-    bool m_dma_enabled = false;    
+    bool m_dma_enabled = false;
     bool m_variable_rate = false;
     bool m_double_rate = false;
-
-    BooleanBlocker m_irq_blocker;
 };
 
 }
\ No newline at end of file
@@ -1,25 +1,48 @@
 #include <kernel/devices/audio/device.h>
 #include <kernel/devices/audio/manager.h>
+#include <kernel/devices/audio/mixer.h>
+#include <kernel/devices/audio/stream.h>
 #include <kernel/process/process.h>
 #include <kernel/posix/sys/ioctl.h>
+#include <kernel/fs/fd.h>
 
 namespace kernel {
 
 AudioDevice::AudioDevice() : CharacterDevice(DeviceMajor::Audio, AudioManager::generate_device_minor()) {}
 
+AudioDevice::~AudioDevice() = default;
+
+AudioMixer& AudioDevice::mixer() {
+    if (!m_mixer) {
+        m_mixer = AudioMixer::create(*this);
+    }
+
+    return *m_mixer;
+}
+
+RefPtr<fs::FileDescriptor> AudioDevice::open(int options) {
+    auto stream = AudioStream::create(*this);
+    if (stream.is_err()) {
+        return nullptr;
+    }
+
+    return fs::FileDescriptor::create(stream.release_value(), options);
+}
+
 ErrorOr<int> AudioDevice::ioctl(unsigned request, unsigned arg) {
     auto* process = Process::current();
     switch (request) {
         // FIXME: Support the rest (SOUNDCARD_SET_VOLUME, SOUNDCARD_GET_VOLUME)
-        case SOUNDCARD_GET_SAMPLE_RATE: {
+        // The sample rate and channels are per stream, `AudioStream` handles those before passing the rest on to us
+        case SOUNDCARD_GET_LATENCY: {
             int* argp = reinterpret_cast<int*>(arg);
             process->validate_write(argp, sizeof(int));
 
-            *argp = this->sample_rate();
+            *argp = this->latency();
             return 0;
         }
-        case SOUNDCARD_SET_SAMPLE_RATE: {
-            TRY(this->set_sample_rate(static_cast<u16>(arg)));
+        case SOUNDCARD_SET_LATENCY: {
+            TRY(this->mixer().set_latency(arg));
             return 0;
         }
         default:
@@ -27,4 +50,4 @@ ErrorOr<int> AudioDevice::ioctl(unsigned request, unsigned arg) {
     }
 }
 
-}
\ No newline at end of file
+}
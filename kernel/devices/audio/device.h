@@ -1,28 +1,65 @@
 #pragma once
 
 #include <kernel/devices/character_device.h>
+#include <kernel/process/wait_queue.h>
 
 #include <std/vector.h>
+#include <std/memory.h>
 
 namespace kernel {
 
+class AudioMixer;
+
+// A sound card plays from a ring of periods that `AudioMixer` keeps filled a few periods ahead of the hardware. Every
+// open of the device is a stream of the mixer, see `AudioStream`.
 class AudioDevice : public CharacterDevice {
 public:
-    virtual ~AudioDevice() = default;
+    // Out of line, `AudioMixer` is incomplete here
+    virtual ~AudioDevice();
 
     virtual ErrorOr<void> set_sample_rate(u16 sample_rate) = 0;
     virtual u16 sample_rate() const = 0;
 
-    virtual ErrorOr<size_t> read(void* buffer, size_t size, size_t offset) override = 0;
-    virtual ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) override = 0;
+    // The ring the mixer renders into, `period_count()` periods of `period_frames()` 16-bit stereo frames each
+    virtual size_t period_count() const = 0;
+    virtual size_t period_frames() const = 0;
+    virtual i16* period(size_t index) = 0;
+
+    // Both since the last `start_output`, period `n` is at index `n % period_count()` of the ring
+    virtual u64 periods_played() const = 0;
+    virtual u64 frames_played() const = 0;
+
+    // Starts playing the ring over and over from period 0, which has to be silence to begin with
+    virtual ErrorOr<void> start_output() = 0;
+    virtual void stop_output() = 0;
+
+    // The period in milliseconds, only takes effect with the next `start_output`
+    virtual ErrorOr<void> set_latency(u32 milliseconds) = 0;
+    virtual u32 latency() const = 0;
+
+    // Woken every time the device is done with a period
+    WaitQueue& period_queue() { return m_period_queue; }
 
-    virtual bool can_read(fs::FileDescriptor const&) const override = 0;
-    virtual bool can_write(fs::FileDescriptor const&) const override = 0;
+    AudioMixer& mixer();
+
+    RefPtr<fs::FileDescriptor> open(int options) override;
+
+    // Only reachable through the device itself, everything is played through the streams
+    ErrorOr<size_t> read(void*, size_t, size_t) override { return Error(ENOTSUP); }
+    ErrorOr<size_t> write(const void*, size_t, size_t) override { return Error(ENOTSUP); }
+
+    bool can_read(fs::FileDescriptor const&) const override { return false; }
+    bool can_write(fs::FileDescriptor const&) const override { return false; }
 
     ErrorOr<int> ioctl(unsigned request, unsigned arg) override;
 
 protected:
     AudioDevice();
+
+    WaitQueue m_period_queue;
+
+private:
+    OwnPtr<AudioMixer> m_mixer;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,126 @@
+#include <kernel/devices/audio/mixer.h>
+#include <kernel/devices/audio/device.h>
+#include <kernel/devices/audio/stream.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/process/process.h>
+#include <kernel/process/scheduler.h>
+#include <kernel/sync/lock.h>
+
+#include <std/cstring.h>
+#include <std/utility.h>
+
+namespace kernel {
+
+OwnPtr<AudioMixer> AudioMixer::create(AudioDevice& device) {
+    auto mixer = OwnPtr<AudioMixer>(new AudioMixer(device));
+
+    auto* process = Process::create_kernel_process("Audio Mixer", [mixer = mixer.ptr()]() { mixer->run(); });
+    Scheduler::add_process(process);
+
+    return mixer;
+}
+
+AudioMixer::AudioMixer(AudioDevice& device) : m_device(device) {}
+
+ErrorOr<void> AudioMixer::add_stream(AudioStream* stream) {
+    ScopedLock lock(m_lock);
+    if (m_streams.empty()) {
+        TRY(m_device.start_output());
+        m_mixed = 0;
+    }
+
+    m_streams.append(stream);
+    return {};
+}
+
+void AudioMixer::remove_stream(AudioStream* stream) {
+    ScopedLock lock(m_lock);
+
+    m_streams.remove(stream);
+    if (m_streams.empty()) {
+        m_device.stop_output();
+    }
+}
+
+ErrorOr<void> AudioMixer::set_latency(u32 milliseconds) {
+    ScopedLock lock(m_lock);
+
+    TRY(m_device.set_latency(milliseconds));
+    if (m_streams.empty()) {
+        return {};
+    }
+
+    // The ring gets carved up differently so whatever was mixed ahead is lost, but that's only a couple of periods
+    m_device.stop_output();
+    TRY(m_device.start_output());
+
+    m_mixed = 0;
+    return {};
+}
+
+size_t AudioMixer::delay() {
+    ScopedLock lock(m_lock);
+    if (m_streams.empty()) {
+        return 0;
+    }
+
+    u64 mixed = m_mixed * m_device.period_frames();
+    u64 played = m_device.frames_played();
+
+    return mixed > played ? mixed - played : 0;
+}
+
+void AudioMixer::run() {
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        m_device.period_queue().add(&blocker);
+    }
+
+    while (true) {
+        blocker.reset();
+        {
+            ScopedLock lock(m_lock);
+            if (!m_streams.empty()) {
+                this->mix_ahead();
+            }
+        }
+
+        blocker.wait();
+    }
+}
+
+void AudioMixer::mix_ahead() {
+    u64 played = m_device.periods_played();
+
+    // The period that is playing right now is out of reach, if we fell behind that far we just skip ahead
+    m_mixed = std::max(m_mixed, played + 1);
+    if (m_mixed > played + LEAD_PERIODS) {
+        return;
+    }
+
+    size_t frames = m_device.period_frames();
+    u32 rate = m_device.sample_rate();
+
+    m_accumulator.resize(frames * 2);
+    i32* accumulator = m_accumulator.data();
+
+    for (; m_mixed <= played + LEAD_PERIODS; m_mixed++) {
+        memset(accumulator, 0, frames * 2 * sizeof(i32));
+        for (auto* stream : m_streams) {
+            stream->render(accumulator, frames, rate);
+        }
+
+        i16* output = m_device.period(m_mixed % m_device.period_count());
+        for (size_t i = 0; i < frames * 2; i++) {
+            output[i] = static_cast<i16>(std::min(std::max(accumulator[i], -32768), 32767));
+        }
+    }
+
+    // Whatever was consumed made room in the rings
+    for (auto* stream : m_streams) {
+        stream->notify_consumed();
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/vector.h>
+#include <std/memory.h>
+#include <std/result.h>
+
+namespace kernel {
+
+class AudioDevice;
+class AudioStream;
+
+// Mixes every stream of a device into the periods it is about to play. A kernel thread does that whenever the device
+// finishes a period, staying `LEAD_PERIODS` ahead of the hardware, so the latency is about that many periods.
+class AudioMixer {
+public:
+    static constexpr size_t LEAD_PERIODS = 2;
+
+    static OwnPtr<AudioMixer> create(AudioDevice&);
+
+    // The device only plays while there are streams
+    ErrorOr<void> add_stream(AudioStream*);
+    void remove_stream(AudioStream*);
+
+    ErrorOr<void> set_latency(u32 milliseconds);
+
+    // Frames (at the device rate) that were mixed but not yet played
+    size_t delay();
+
+private:
+    AudioMixer(AudioDevice&);
+
+    void run();
+    void mix_ahead();
+
+    AudioDevice& m_device;
+
+    Mutex m_lock;
+    Vector<AudioStream*> m_streams;
+
+    // Periods mixed since the device started playing
+    u64 m_mixed = 0;
+
+    Vector<i32> m_accumulator;
+};
+
+}
@@ -0,0 +1,183 @@
+#include <kernel/devices/audio/stream.h>
+#include <kernel/devices/audio/device.h>
+#include <kernel/devices/audio/mixer.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/memory/manager.h>
+#include <kernel/process/process.h>
+#include <kernel/posix/sys/mman.h>
+
+#include <std/cstring.h>
+#include <std/utility.h>
+#include <std/atomic.h>
+
+namespace kernel {
+
+ErrorOr<RefPtr<AudioStream>> AudioStream::create(AudioDevice& device) {
+    size_t size = std::align_up(sizeof(soundcard_ring) + RING_FRAMES * sizeof(i16) * 2, PAGE_SIZE);
+
+    auto* ring = reinterpret_cast<soundcard_ring*>(TRY(MM->allocate_kernel_region(size)));
+    memset(ring, 0, size);
+
+    ring->frame_count = RING_FRAMES;
+
+    auto stream = RefPtr<AudioStream>(new AudioStream(device, ring, size));
+    TRY(device.mixer().add_stream(stream.ptr()));
+
+    return stream;
+}
+
+AudioStream::AudioStream(
+    AudioDevice& device, soundcard_ring* ring, size_t size
+) : m_device(device), m_ring(ring), m_ring_size(size) {}
+
+AudioStream::~AudioStream() {
+    m_device.mixer().remove_stream(this);
+
+    // A client that still has the ring mapped holds references of its own, the pages go away once it unmaps them
+    MUST(MM->free_kernel_region(m_ring, m_ring_size));
+}
+
+u64 AudioStream::available() const {
+    u64 write_position = m_ring->write_position;
+    if (write_position < m_read_position) {
+        return 0;
+    }
+
+    return std::min<u64>(write_position - m_read_position, RING_FRAMES);
+}
+
+ErrorOr<size_t> AudioStream::write(const void* buffer, size_t size, size_t) {
+    auto* frames = reinterpret_cast<i16 const(*)[2]>(buffer);
+    size_t count = size / sizeof(*frames);
+
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        this->wait_queue().add(&blocker);
+    }
+
+    size_t written = 0;
+    while (written < count) {
+        blocker.reset();
+
+        size_t space = RING_FRAMES - this->available();
+        if (!space) {
+            blocker.wait();
+            continue;
+        }
+
+        u64 position = m_ring->write_position;
+        size_t chunk = std::min(space, count - written);
+
+        for (size_t i = 0; i < chunk; i++) {
+            auto& frame = m_ring->frames[(position + i) % RING_FRAMES];
+
+            frame[0] = frames[written + i][0];
+            frame[1] = frames[written + i][1];
+        }
+
+        // The mixer must not see the new position before the frames
+        std::atomic_thread_fence(std::MemoryOrder::Release);
+        m_ring->write_position = position + chunk;
+
+        written += chunk;
+    }
+
+    arch::InterruptDisabler disabler;
+    this->wait_queue().remove(&blocker);
+
+    return written * sizeof(*frames);
+}
+
+void AudioStream::render(i32* accumulator, size_t frames, u32 rate) {
+    u64 end = m_read_position + this->available();
+    std::atomic_thread_fence(std::MemoryOrder::Acquire);
+
+    // How far to advance per output frame, in 32.32 fixed point. Exactly 1.0 if the rates match, which makes this a
+    // plain copy since `m_phase` then stays at zero.
+    u64 step = (static_cast<u64>(m_sample_rate) << 32) / rate;
+
+    auto* ring = m_ring->frames;
+    for (size_t i = 0; i < frames; i++) {
+        if (m_read_position >= end) {
+            break;
+        }
+
+        auto& current = ring[m_read_position % RING_FRAMES];
+        if (!m_phase) {
+            accumulator[i * 2] += current[0];
+            accumulator[i * 2 + 1] += current[1];
+        } else {
+            // Interpolating needs the next frame as well, wait for it rather than making one up
+            if (m_read_position + 1 >= end) {
+                break;
+            }
+
+            auto& next = ring[(m_read_position + 1) % RING_FRAMES];
+            for (size_t channel = 0; channel < 2; channel++) {
+                i64 delta = static_cast<i64>(next[channel] - current[channel]) * m_phase;
+                accumulator[i * 2 + channel] += current[channel] + static_cast<i32>(delta >> 32);
+            }
+        }
+
+        u64 position = m_phase + step;
+
+        m_read_position += position >> 32;
+        m_phase = static_cast<u32>(position);
+    }
+
+    m_ring->read_position = m_read_position;
+}
+
+ErrorOr<int> AudioStream::ioctl(unsigned request, unsigned arg) {
+    auto* process = Process::current();
+    switch (request) {
+        case SOUNDCARD_GET_SAMPLE_RATE: {
+            int* argp = reinterpret_cast<int*>(arg);
+            process->validate_write(argp, sizeof(int));
+
+            *argp = m_sample_rate;
+            return 0;
+        }
+        case SOUNDCARD_SET_SAMPLE_RATE: {
+            if (arg < MIN_SAMPLE_RATE || arg > MAX_SAMPLE_RATE) {
+                return Error(EINVAL);
+            }
+
+            m_sample_rate = arg;
+            return 0;
+        }
+        case SOUNDCARD_GET_CHANNELS: {
+            int* argp = reinterpret_cast<int*>(arg);
+            process->validate_write(argp, sizeof(int));
+
+            *argp = 2;
+            return 0;
+        }
+        case SOUNDCARD_MAP_RING: {
+            soundcard_ring** argp = reinterpret_cast<soundcard_ring**>(arg);
+            process->validate_write(argp, sizeof(soundcard_ring*));
+
+            *argp = reinterpret_cast<soundcard_ring*>(TRY(process->share_kernel_region(
+                VirtualAddress { m_ring }, m_ring_size, PROT_READ | PROT_WRITE
+            )));
+
+            return 0;
+        }
+        case SOUNDCARD_GET_POSITION: {
+            soundcard_position* position = reinterpret_cast<soundcard_position*>(arg);
+            process->validate_write(position, sizeof(soundcard_position));
+
+            position->stream_frames = m_read_position;
+            position->device_frames = m_device.frames_played();
+            position->delay = m_device.mixer().delay();
+            position->period = m_device.period_frames();
+
+            return 0;
+        }
+        default:
+            return m_device.ioctl(request, arg);
+    }
+}
+
+}
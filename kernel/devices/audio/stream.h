@@ -0,0 +1,64 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/fs/file.h>
+#include <kernel/posix/sys/ioctl.h>
+
+#include <std/memory.h>
+#include <std/result.h>
+
+namespace kernel {
+
+class AudioDevice;
+
+// What opening a sound card gives you. The client either maps the ring (SOUNDCARD_MAP_RING) and fills it in place or
+// writes to the stream, the mixer picks the frames up from there and converts them to the sample rate of the device.
+class AudioStream : public fs::File {
+public:
+    static constexpr u32 DEFAULT_SAMPLE_RATE = 44100;
+
+    static constexpr u32 MIN_SAMPLE_RATE = 8000;
+    static constexpr u32 MAX_SAMPLE_RATE = 192000;
+
+    // About 370ms at 44.1kHz
+    static constexpr u32 RING_FRAMES = 16384;
+
+    static ErrorOr<RefPtr<AudioStream>> create(AudioDevice&);
+    ~AudioStream() override;
+
+    ErrorOr<size_t> read(void*, size_t, size_t) override { return Error(ENOTSUP); }
+    ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) override;
+
+    size_t size() const override { return 0; }
+
+    bool can_read(fs::FileDescriptor const&) const override { return false; }
+    bool can_write(fs::FileDescriptor const&) const override { return this->available() < RING_FRAMES; }
+
+    ErrorOr<int> ioctl(unsigned request, unsigned arg) override;
+
+    // Called by the mixer, adds what the stream has for `frames` frames at `rate` to `accumulator`
+    void render(i32* accumulator, size_t frames, u32 rate);
+    void notify_consumed() { this->notify_readiness(); }
+
+private:
+    AudioStream(AudioDevice&, soundcard_ring*, size_t size);
+
+    // Frames between the read and write positions. The client can scribble over the ring header at any time, so this
+    // never trusts it to be more than the ring holds.
+    u64 available() const;
+
+    AudioDevice& m_device;
+
+    soundcard_ring* m_ring;
+    size_t m_ring_size;
+
+    // Our own copy, what's in the ring header is only published for the client
+    u64 m_read_position = 0;
+
+    u32 m_sample_rate = DEFAULT_SAMPLE_RATE;
+
+    // How far past `m_read_position` (towards the frame after it) we are, as a 0.32 fixed point fraction
+    u32 m_phase = 0;
+};
+
+}
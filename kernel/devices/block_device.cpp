@@ -1,8 +1,119 @@
 #include <kernel/devices/block_device.h>
+#include <kernel/process/process.h>
+#include <kernel/posix/sys/ioctl.h>
 #include <std/string.h>
+#include <std/vector.h>
 
 namespace kernel {
 
+// Splits `iov` into consecutive runs of at most `chunk_size` bytes and calls `callback` with each of them
+template<typename Callback>
+static ErrorOr<void> for_each_iovec_chunk(const iovec* iov, int iovcnt, size_t chunk_size, Callback&& callback) {
+    Vector<iovec> chunk;
+    size_t chunk_length = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        u8* base = reinterpret_cast<u8*>(iov[i].iov_base);
+        size_t remaining = iov[i].iov_len;
+
+        while (remaining) {
+            size_t length = std::min(remaining, chunk_size - chunk_length);
+            chunk.append({ base, length });
+
+            base += length;
+            remaining -= length;
+            chunk_length += length;
+
+            if (chunk_length == chunk_size) {
+                TRY(callback(chunk, chunk_length));
+
+                chunk.clear();
+                chunk_length = 0;
+            }
+        }
+    }
+
+    if (chunk_length) {
+        TRY(callback(chunk, chunk_length));
+    }
+
+    return {};
+}
+
+static size_t iovec_length(const iovec* iov, int iovcnt) {
+    size_t length = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        length += iov[i].iov_len;
+    }
+
+    return length;
+}
+
+ErrorOr<size_t> BlockDevice::readv(const iovec* iov, int iovcnt, size_t offset) {
+    size_t block_size = this->block_size();
+    size_t size = iovec_length(iov, iovcnt);
+
+    if (offset % block_size || size % block_size) {
+        return File::readv(iov, iovcnt, offset);
+    }
+
+    size_t block = offset / block_size;
+    TRY(for_each_iovec_chunk(iov, iovcnt, this->max_io_block_count() * block_size, [&](Vector<iovec> const& chunk, size_t length) -> ErrorOr<void> {
+        size_t count = length / block_size;
+        TRY(this->read_blocks_vectored(chunk.data(), chunk.size(), count, block));
+
+        block += count;
+        return {};
+    }));
+
+    return size;
+}
+
+ErrorOr<size_t> BlockDevice::writev(const iovec* iov, int iovcnt, size_t offset) {
+    size_t block_size = this->block_size();
+    size_t size = iovec_length(iov, iovcnt);
+
+    if (offset % block_size || size % block_size) {
+        return File::writev(iov, iovcnt, offset);
+    }
+
+    size_t block = offset / block_size;
+    TRY(for_each_iovec_chunk(iov, iovcnt, this->max_io_block_count() * block_size, [&](Vector<iovec> const& chunk, size_t length) -> ErrorOr<void> {
+        size_t count = length / block_size;
+        TRY(this->write_blocks_vectored(chunk.data(), chunk.size(), count, block));
+
+        block += count;
+        return {};
+    }));
+
+    return size;
+}
+
+ErrorOr<bool> BlockDevice::read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    Vector<u8> buffer(count * this->block_size());
+    TRY(this->read_blocks(buffer.data(), count, block));
+
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(iov[i].iov_base, buffer.data() + offset, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    return true;
+}
+
+ErrorOr<bool> BlockDevice::write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    Vector<u8> buffer(count * this->block_size());
+
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(buffer.data() + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    return this->write_blocks(buffer.data(), count, block);
+}
+
 ErrorOr<size_t> BlockDevice::read(void* buffer, size_t size, size_t offset) {
     size_t block_size = this->block_size();
 
@@ -65,4 +176,25 @@ ErrorOr<bool> BlockDevice::write_block(const void* buffer, size_t block) {
     return this->write_blocks(buffer, 1, block);
 }
 
+ErrorOr<int> BlockDevice::ioctl(unsigned request, unsigned arg) {
+    switch (request) {
+        case STORAGE_FLUSH:
+            TRY(this->flush());
+            return 0;
+        case STORAGE_DISCARD: {
+            auto* discard = reinterpret_cast<storage_discard*>(arg);
+            Process::current()->validate_read(discard, sizeof(storage_discard));
+
+            if (discard->count > m_max_addressable_block || discard->block > m_max_addressable_block - discard->count) {
+                return Error(EINVAL);
+            }
+
+            TRY(this->discard(discard->count, discard->block));
+            return 0;
+        }
+        default:
+            return Error(ENOTTY);
+    }
+}
+
 }
\ No newline at end of file
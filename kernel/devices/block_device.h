@@ -12,6 +12,10 @@ public:
     ErrorOr<size_t> read(void* buffer, size_t size, size_t offset) override;
     ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) override;
 
+    // Block aligned requests are turned into as few device requests as possible, everything else falls back to `File`
+    ErrorOr<size_t> readv(const iovec* iov, int iovcnt, size_t offset) override;
+    ErrorOr<size_t> writev(const iovec* iov, int iovcnt, size_t offset) override;
+
     ErrorOr<bool> read_block(void* buffer, size_t block);
     ErrorOr<bool> write_block(const void* buffer, size_t block);
 
@@ -24,6 +28,19 @@ public:
     virtual ErrorOr<bool> read_blocks(void* buffer, size_t count, size_t block) = 0;
     virtual ErrorOr<bool> write_blocks(const void* buffer, size_t count, size_t block) = 0;
 
+    // Scatter/gather variants of the above, the iovecs must add up to exactly `count` blocks.
+    // Devices without native support go through a bounce buffer.
+    virtual ErrorOr<bool> read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block);
+    virtual ErrorOr<bool> write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block);
+
+    // Makes sure everything written so far made it to stable storage. Devices without a volatile cache have nothing to do.
+    virtual ErrorOr<void> flush() { return {}; }
+
+    // Tells the device that the contents of the given blocks are no longer needed
+    virtual ErrorOr<void> discard(size_t, size_t) { return Error(EOPNOTSUPP); }
+
+    ErrorOr<int> ioctl(unsigned request, unsigned arg) override;
+
     bool is_block_device() const final override { return true; }
 
 protected:
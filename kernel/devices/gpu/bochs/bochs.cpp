@@ -7,6 +7,7 @@
 #include <kernel/serial.h>
 #include <kernel/pci/pci.h>
 #include <kernel/arch/io.h>
+#include <kernel/time/manager.h>
 
 namespace kernel {
 
@@ -26,7 +27,40 @@ ErrorOr<void*> BochsGPUConnector::map_framebuffer(Process* process) {
     return process->allocate_with_physical_region(address, size, PROT_READ | PROT_WRITE);
 }
 
-ErrorOr<void> BochsGPUConnector::flush() {
+ErrorOr<void> BochsGPUConnector::flush(Vector<Rect> const&) {
+    return {};
+}
+
+ErrorOr<Vector<void*>> BochsGPUConnector::map_buffers(Process* process, size_t count) {
+    if (!count || count > MAX_BUFFERS) {
+        return Error(EINVAL);
+    }
+
+    if (count > m_device->buffer_count()) {
+        TRY(m_device->set_buffer_count(count));
+    }
+
+    // The buffers aren't page aligned on their own, so they are all mapped in one go
+    size_t size = m_device->size();
+    auto* region = reinterpret_cast<u8*>(TRY(process->allocate_with_physical_region(
+        m_device->physical_address(), std::align_up(size * count, PAGE_SIZE), PROT_READ | PROT_WRITE
+    )));
+
+    Vector<void*> buffers;
+    for (size_t i = 0; i < count; i++) {
+        buffers.append(region + i * size);
+    }
+
+    return buffers;
+}
+
+ErrorOr<void> BochsGPUConnector::page_flip(size_t buffer, Vector<Rect> const&) {
+    // The display reads straight from VRAM, so there's nothing to transfer
+    if (buffer >= m_device->buffer_count()) {
+        return Error(EINVAL);
+    }
+
+    m_device->show_buffer(buffer);
     return {};
 }
 
@@ -40,6 +74,7 @@ RefPtr<GPUDevice> BochsGPUDevice::create(pci::Device pci_device) {
 
 BochsGPUDevice::BochsGPUDevice(pci::Address address) {
     m_physical_address = PhysicalAddress { address.bar(0) & 0xfffffff0 };
+    m_vram_size = address.bar_size(0);
 
     this->set_resolution(DEFAULT_WIDTH, DEFAULT_HEIGHT, 32);
     m_connectors.append(BochsGPUConnector::create(this));
@@ -64,7 +99,7 @@ void BochsGPUDevice::set_resolution(i32 width, i32 height, i32 bpp) {
     this->write_register(XRes, width);
     this->write_register(YRes, height);
     this->write_register(VirtWidth, width);
-    this->write_register(VirtWidth, height * 2);
+    this->write_register(VirtHeight, height * m_buffer_count);
     this->write_register(BPP, bpp);
     this->write_register(Enable, VBE_ENABLED | VBE_LFB_ENABLED);
     this->write_register(Bank, 0);
@@ -74,4 +109,33 @@ void BochsGPUDevice::set_resolution(i32 width, i32 height, i32 bpp) {
     m_bpp = bpp;
 }
 
+ErrorOr<void> BochsGPUDevice::set_buffer_count(size_t count) {
+    if (count * this->size() > m_vram_size || count * m_height > 0xFFFF) {
+        return Error(ENOMEM);
+    }
+
+    m_buffer_count = count;
+    this->write_register(VirtHeight, m_height * count);
+
+    return {};
+}
+
+void BochsGPUDevice::wait_for_vertical_retrace() {
+    // Cards without the legacy VGA ports (bochs-display) read back all ones here, a frame is the most we ever wait
+    Duration deadline = TimeManager::query_time(CLOCK_MONOTONIC) + Duration::from_milliseconds(20);
+    while (!(io::read<u8>(VGA_INPUT_STATUS) & VGA_VERTICAL_RETRACE)) {
+        if (TimeManager::query_time(CLOCK_MONOTONIC) > deadline) {
+            break;
+        }
+    }
+}
+
+void BochsGPUDevice::show_buffer(size_t buffer) {
+    ASSERT(buffer < m_buffer_count, "Buffer index out of range");
+
+    // The new offset takes effect with the next frame, by then the old buffer has been scanned out for the last time
+    this->wait_for_vertical_retrace();
+    this->write_register(YOffset, m_height * buffer);
+}
+
 }
\ No newline at end of file
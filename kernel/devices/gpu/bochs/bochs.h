@@ -24,6 +24,10 @@ constexpr u16 VBE_DISABLED = 0x00;
 constexpr u16 VBE_ENABLED = 0x01;
 constexpr u16 VBE_LFB_ENABLED = 0x40;
 
+// VGA Input Status #1, bit 3 is set while the display is in vertical retrace
+constexpr u16 VGA_INPUT_STATUS = 0x03DA;
+constexpr u8 VGA_VERTICAL_RETRACE = 0x08;
+
 class BochsGPUDevice;
 
 class BochsGPUConnector : public GPUConnector {
@@ -34,7 +38,11 @@ public:
 
     ErrorOr<Resolution> get_resolution() const override;
     ErrorOr<void*> map_framebuffer(Process*) override;
-    ErrorOr<void> flush() override;
+    ErrorOr<void> flush(Vector<Rect> const& rects) override;
+
+    // Buffers are stacked below each other in VRAM, flipping just moves the Y offset the display starts at
+    ErrorOr<Vector<void*>> map_buffers(Process*, size_t count) override;
+    ErrorOr<void> page_flip(size_t buffer, Vector<Rect> const& rects) override;
 
 private:
     BochsGPUConnector(BochsGPUDevice* device) : GPUConnector(0), m_device(device) {}
@@ -83,13 +91,25 @@ public:
     u16 read_register(u16 index);
 
     void set_resolution(i32 width, i32 height, i32 bpp);
+
+    // How many screens worth of VRAM the display can be panned across, limited by the size of VRAM
+    size_t buffer_count() const { return m_buffer_count; }
+    ErrorOr<void> set_buffer_count(size_t count);
+
+    // Starts scanning out from the given buffer, during the next vertical retrace if the card tells us about those
+    void show_buffer(size_t buffer);
     
 private:
     friend class Device;
 
     BochsGPUDevice(pci::Address);
 
+    void wait_for_vertical_retrace();
+
     PhysicalAddress m_physical_address;
+    size_t m_vram_size;
+
+    size_t m_buffer_count = 1;
 
     i32 m_height;
     i32 m_width;
@@ -0,0 +1,101 @@
+#include <kernel/devices/gpu/connector.h>
+
+namespace kernel {
+
+static GPUConnector::Rect bounding_box(GPUConnector::Rect const& a, GPUConnector::Rect const& b) {
+    int x = std::min(a.x, b.x);
+    int y = std::min(a.y, b.y);
+
+    return { x, y, std::max(a.right(), b.right()) - x, std::max(a.bottom(), b.bottom()) - y };
+}
+
+static bool intersects(GPUConnector::Rect const& a, GPUConnector::Rect const& b) {
+    return a.x < b.right() && b.x < a.right() && a.y < b.bottom() && b.y < a.bottom();
+}
+
+Vector<GPUConnector::Rect> GPUConnector::merge_damage(Rect const* rects, size_t count, Resolution const& resolution) {
+    Vector<Rect> merged;
+    if (!count) {
+        merged.append({ 0, 0, resolution.width, resolution.height });
+        return merged;
+    }
+
+    bool collapsed = false;
+    for (size_t i = 0; i < count; i++) {
+        Rect const& rect = rects[i];
+
+        // In 64 bits since `right()` and `bottom()` of a rectangle straight from userspace can overflow
+        i64 left = std::max<i64>(rect.x, 0);
+        i64 top = std::max<i64>(rect.y, 0);
+        i64 right = std::min<i64>(static_cast<i64>(rect.x) + rect.width, resolution.width);
+        i64 bottom = std::min<i64>(static_cast<i64>(rect.y) + rect.height, resolution.height);
+
+        if (right <= left || bottom <= top) {
+            continue;
+        }
+
+        Rect clipped = {
+            static_cast<int>(left), static_cast<int>(top), static_cast<int>(right - left), static_cast<int>(bottom - top)
+        };
+
+        // Everything ends up in one box anyway, no point in merging the rest one by one
+        if (collapsed) {
+            merged[0] = bounding_box(merged[0], clipped);
+            continue;
+        }
+
+        // Merging can make the result touch rectangles it didn't before, so keep going until nothing changes
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t j = 0; j < merged.size(); j++) {
+                Rect box = bounding_box(clipped, merged[j]);
+                if (!intersects(clipped, merged[j]) && box.area() > clipped.area() + merged[j].area()) {
+                    continue;
+                }
+
+                clipped = box;
+                merged.remove(merged.begin() + j);
+
+                changed = true;
+                break;
+            }
+        }
+
+        merged.append(clipped);
+        if (merged.size() > MAX_DAMAGE_RECTS) {
+            Rect box = merged[0];
+            for (auto& other : merged) {
+                box = bounding_box(box, other);
+            }
+
+            merged.clear();
+            merged.append(box);
+
+            collapsed = true;
+        }
+    }
+
+    return merged;
+}
+
+ErrorOr<Vector<void*>> GPUConnector::map_buffers(Process* process, size_t count) {
+    if (count != 1) {
+        return Error(ENOTSUP);
+    }
+
+    Vector<void*> buffers;
+    buffers.append(TRY(this->map_framebuffer(process)));
+
+    return buffers;
+}
+
+ErrorOr<void> GPUConnector::page_flip(size_t buffer, Vector<Rect> const& rects) {
+    if (buffer != 0) {
+        return Error(EINVAL);
+    }
+
+    return this->flush(rects);
+}
+
+}
\ No newline at end of file
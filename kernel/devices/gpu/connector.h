@@ -2,8 +2,10 @@
 
 #include <kernel/common.h>
 #include <kernel/process/process.h>
+#include <kernel/posix/sys/ioctl.h>
 
 #include <std/result.h>
+#include <std/vector.h>
 
 namespace kernel {
 
@@ -16,13 +18,50 @@ public:
         int bpp;
     };
 
+    // A region of the framebuffer in pixels
+    struct Rect {
+        int x;
+        int y;
+        int width;
+        int height;
+
+        int right() const { return x + width; }
+        int bottom() const { return y + height; }
+        size_t area() const { return static_cast<size_t>(width) * height; }
+
+        bool is_empty() const { return width <= 0 || height <= 0; }
+    };
+
+    // Damage that would take more rectangles than this is flushed as its bounding box instead
+    static constexpr size_t MAX_DAMAGE_RECTS = 16;
+
+    // Most rectangles a single flush or page flip may pass in
+    static constexpr size_t MAX_RECTS = GPU_CONNECTOR_MAX_RECTS;
+
+    // Including the framebuffer itself
+    static constexpr size_t MAX_BUFFERS = GPU_CONNECTOR_MAX_BUFFERS;
+
+    // Clips `rects` to the screen, drops empty ones and merges overlapping ones as well as those whose bounding box
+    // costs no more than they do apart (e.g. sharing an edge). An empty list stands for the whole screen.
+    static Vector<Rect> merge_damage(Rect const* rects, size_t count, Resolution const&);
+
     virtual ~GPUConnector() = default;
 
     u32 id() const { return m_id; }
 
     virtual ErrorOr<Resolution> get_resolution() const = 0;
     virtual ErrorOr<void*> map_framebuffer(Process*) = 0;
-    virtual ErrorOr<void> flush() = 0;
+
+    // Pushes the given regions of the buffer on screen to the display, `rects` have already been merged by `merge_damage`
+    virtual ErrorOr<void> flush(Vector<Rect> const& rects) = 0;
+
+    // Makes sure there are `count` buffers to render into and maps all of them into the process. The first one is the
+    // framebuffer `map_framebuffer` hands out, which is on screen until the first page flip.
+    virtual ErrorOr<Vector<void*>> map_buffers(Process*, size_t count);
+
+    // Puts `buffer` on screen as a whole, `rects` are what changed in it since it was last shown. Returns once the
+    // buffer that was on screen before can be drawn into without showing up on the display.
+    virtual ErrorOr<void> page_flip(size_t buffer, Vector<Rect> const& rects);
 
 protected:
     GPUConnector(u32 id) : m_id(id) {}
@@ -0,0 +1,271 @@
+#include <kernel/devices/gpu/console.h>
+#include <kernel/boot/boot_info.h>
+#include <kernel/memory/manager.h>
+
+#include <std/cstring.h>
+#include <std/utility.h>
+
+extern "C" u8 _console_font[];
+extern "C" u8 _console_font_end[];
+
+namespace kernel {
+
+static FramebufferConsole* s_instance = nullptr;
+
+struct PSF1Header {
+    u16 magic;
+    u8 mode;
+    u8 charsize;
+};
+
+struct PSF2Header {
+    u32 magic;
+    u32 version;
+    u32 headersize;
+    u32 flags;
+    u32 glyph_count;
+    u32 glyph_size;
+    u32 height;
+    u32 width;
+};
+
+static constexpr u16 PSF1_MAGIC = 0x0436;
+static constexpr u32 PSF2_MAGIC = 0x864ab572;
+
+// The usual VGA palette, bright colors are only used for bold text
+static constexpr u32 s_colors[8] = {
+    0x000000, 0xAA0000, 0x00AA00, 0xAA5500, 0x0000AA, 0xAA00AA, 0x00AAAA, 0xAAAAAA
+};
+
+static constexpr u32 s_bright_colors[8] = {
+    0x555555, 0xFF5555, 0x55FF55, 0xFFFF55, 0x5555FF, 0xFF55FF, 0x55FFFF, 0xFFFFFF
+};
+
+FramebufferConsole* FramebufferConsole::instance() {
+    return s_instance;
+}
+
+void FramebufferConsole::initialize() {
+    auto& info = g_boot_info->framebuffer;
+    if (!info.address || info.bpp != 32) {
+        return;
+    }
+
+    auto result = MM->map_physical_region(PhysicalAddress { info.address }, info.pitch * info.height);
+    if (result.is_err()) {
+        return;
+    }
+
+    auto* console = new FramebufferConsole(reinterpret_cast<u8*>(result.value()), info.width, info.height, info.pitch);
+    if (!console->load_font(_console_font, _console_font_end - _console_font)) {
+        delete console;
+        return;
+    }
+
+    for (u32 row = 0; row < console->m_rows; row++) {
+        console->clear_row(row);
+    }
+
+    s_instance = console;
+}
+
+FramebufferConsole::FramebufferConsole(
+    u8* framebuffer, u32 width, u32 height, u32 pitch
+) : m_framebuffer(framebuffer), m_width(width), m_height(height), m_pitch(pitch) {}
+
+bool FramebufferConsole::load_font(u8 const* data, size_t size) {
+    if (size >= sizeof(PSF2Header) && reinterpret_cast<PSF2Header const*>(data)->magic == PSF2_MAGIC) {
+        auto* header = reinterpret_cast<PSF2Header const*>(data);
+
+        m_glyph_count = header->glyph_count;
+        m_glyph_size = header->glyph_size;
+        m_glyph_width = header->width;
+        m_glyph_height = header->height;
+        m_font = data + header->headersize;
+    } else if (size >= sizeof(PSF1Header) && reinterpret_cast<PSF1Header const*>(data)->magic == PSF1_MAGIC) {
+        auto* header = reinterpret_cast<PSF1Header const*>(data);
+
+        m_glyph_count = (header->mode & 1) ? 512 : 256;
+        m_glyph_size = header->charsize;
+        m_glyph_width = 8;
+        m_glyph_height = header->charsize;
+        m_font = data + sizeof(PSF1Header);
+    } else {
+        return false;
+    }
+
+    // We only ever draw single bytes so the rest of a bigger font would just be wasted memory
+    m_glyph_count = std::min(m_glyph_count, 256u);
+    if (!m_glyph_width || !m_glyph_height || m_font + m_glyph_count * m_glyph_size > data + size) {
+        return false;
+    }
+
+    m_columns = m_width / m_glyph_width;
+    m_rows = m_height / m_glyph_height;
+    if (!m_columns || !m_rows) {
+        return false;
+    }
+
+    size_t pixels = m_glyph_width * m_glyph_height;
+    m_glyph_cache = new u32[m_glyph_count * pixels];
+
+    size_t stride = (m_glyph_width + 7) / 8;
+    for (u32 i = 0; i < m_glyph_count; i++) {
+        u8 const* glyph = m_font + i * m_glyph_size;
+        u32* pixel = m_glyph_cache + i * pixels;
+
+        for (u32 y = 0; y < m_glyph_height; y++) {
+            u8 const* bits = glyph + y * stride;
+            for (u32 x = 0; x < m_glyph_width; x++) {
+                bool set = bits[x / 8] & (0x80 >> (x % 8));
+                *pixel++ = set ? DEFAULT_FOREGROUND : DEFAULT_BACKGROUND;
+            }
+        }
+    }
+
+    return true;
+}
+
+void FramebufferConsole::write(const char* str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        this->putc(str[i]);
+    }
+}
+
+void FramebufferConsole::putc(char c) {
+    switch (m_state) {
+        case State::Normal:
+            break;
+        case State::Escape:
+            if (c == '[') {
+                m_state = State::CSI;
+                m_parameter_count = 0;
+                m_parameters[0] = 0;
+            } else {
+                m_state = State::Normal;
+            }
+
+            return;
+        case State::CSI:
+            if (c >= '0' && c <= '9') {
+                if (!m_parameter_count) {
+                    m_parameter_count = 1;
+                }
+
+                u32& parameter = m_parameters[m_parameter_count - 1];
+                parameter = parameter * 10 + (c - '0');
+            } else if (c == ';') {
+                if (m_parameter_count < 4) {
+                    m_parameters[m_parameter_count++] = 0;
+                }
+            } else {
+                // Anything but colors (cursor movement and such) is dropped, the log is just a stream of lines
+                if (c == 'm') {
+                    this->handle_sgr();
+                }
+
+                m_state = State::Normal;
+            }
+
+            return;
+    }
+
+    switch (c) {
+        case '\033':
+            m_state = State::Escape;
+            return;
+        case '\n':
+            this->new_line();
+            return;
+        case '\r':
+            m_column = 0;
+            return;
+        case '\t':
+            m_column = std::min((m_column + 8) & ~7u, m_columns - 1);
+            return;
+        default:
+            break;
+    }
+
+    if (m_column >= m_columns) {
+        this->new_line();
+    }
+
+    this->draw_glyph(m_column, m_row, static_cast<u8>(c));
+    m_column++;
+}
+
+void FramebufferConsole::handle_sgr() {
+    if (!m_parameter_count) {
+        m_parameters[m_parameter_count++] = 0;
+    }
+
+    bool bold = false;
+    for (u32 i = 0; i < m_parameter_count; i++) {
+        u32 parameter = m_parameters[i];
+        if (parameter == 0) {
+            m_foreground = DEFAULT_FOREGROUND;
+            m_background = DEFAULT_BACKGROUND;
+        } else if (parameter == 1) {
+            bold = true;
+        } else if (parameter >= 30 && parameter <= 37) {
+            m_foreground = bold ? s_bright_colors[parameter - 30] : s_colors[parameter - 30];
+        } else if (parameter == 39) {
+            m_foreground = DEFAULT_FOREGROUND;
+        } else if (parameter >= 40 && parameter <= 47) {
+            m_background = s_colors[parameter - 40];
+        } else if (parameter == 49) {
+            m_background = DEFAULT_BACKGROUND;
+        }
+    }
+}
+
+void FramebufferConsole::new_line() {
+    m_column = 0;
+    m_row = (m_row + 1) % m_rows;
+
+    this->clear_row(m_row);
+}
+
+void FramebufferConsole::clear_row(u32 row) {
+    for (u32 y = row * m_glyph_height; y < (row + 1) * m_glyph_height; y++) {
+        u32* line = this->scanline(y);
+        for (u32 x = 0; x < m_columns * m_glyph_width; x++) {
+            line[x] = DEFAULT_BACKGROUND;
+        }
+    }
+}
+
+void FramebufferConsole::draw_glyph(u32 column, u32 row, u8 c) {
+    if (c >= m_glyph_count) {
+        c = '?';
+    }
+
+    u32 x = column * m_glyph_width;
+    u32 y = row * m_glyph_height;
+
+    if (m_foreground == DEFAULT_FOREGROUND && m_background == DEFAULT_BACKGROUND) {
+        u32 const* pixels = m_glyph_cache + c * m_glyph_width * m_glyph_height;
+        for (u32 i = 0; i < m_glyph_height; i++) {
+            memcpy(this->scanline(y + i) + x, pixels, m_glyph_width * sizeof(u32));
+            pixels += m_glyph_width;
+        }
+
+        return;
+    }
+
+    // Colored text is rare enough (mostly panics) to not be worth caching
+    u8 const* glyph = m_font + c * m_glyph_size;
+    size_t stride = (m_glyph_width + 7) / 8;
+
+    for (u32 i = 0; i < m_glyph_height; i++) {
+        u8 const* bits = glyph + i * stride;
+        u32* line = this->scanline(y + i) + x;
+
+        for (u32 j = 0; j < m_glyph_width; j++) {
+            line[j] = (bits[j / 8] & (0x80 >> (j % 8))) ? m_foreground : m_background;
+        }
+    }
+}
+
+}
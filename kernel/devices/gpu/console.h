@@ -0,0 +1,75 @@
+#pragma once
+
+#include <kernel/common.h>
+
+namespace kernel {
+
+// Renders the kernel log onto the boot framebuffer so that early boot and panic messages can be seen without a serial
+// port. Text wraps around to the top instead of scrolling because reading the framebuffer back is painfully slow.
+class FramebufferConsole {
+public:
+    // Needs the memory manager, does nothing if the bootloader didn't set up a 32 bpp framebuffer
+    static void initialize();
+    static FramebufferConsole* instance();
+
+    // Whoever maps a framebuffer into userspace owns the display, the console only takes it back on a panic
+    bool is_enabled() const { return m_enabled; }
+    void set_enabled(bool enabled) { m_enabled = enabled; }
+
+    void write(const char* str, size_t len);
+
+private:
+    static constexpr u32 DEFAULT_FOREGROUND = 0xAAAAAA;
+    static constexpr u32 DEFAULT_BACKGROUND = 0x000000;
+
+    enum class State {
+        Normal,
+        Escape,
+        CSI,
+    };
+
+    FramebufferConsole(u8* framebuffer, u32 width, u32 height, u32 pitch);
+
+    bool load_font(u8 const* data, size_t size);
+
+    void putc(char c);
+    void handle_sgr();
+
+    void new_line();
+    void clear_row(u32 row);
+    void draw_glyph(u32 column, u32 row, u8 c);
+
+    u32* scanline(u32 y) const { return reinterpret_cast<u32*>(m_framebuffer + y * m_pitch); }
+
+    u8* m_framebuffer;
+    u32 m_width;
+    u32 m_height;
+    u32 m_pitch;
+
+    u8 const* m_font = nullptr;
+    u32 m_glyph_count = 0;
+    u32 m_glyph_size = 0;
+    u32 m_glyph_width = 0;
+    u32 m_glyph_height = 0;
+
+    // Every glyph already expanded into pixels in the default colors so drawing a cell is a copy per row
+    u32* m_glyph_cache = nullptr;
+
+    u32 m_columns = 0;
+    u32 m_rows = 0;
+
+    u32 m_column = 0;
+    u32 m_row = 0;
+
+    u32 m_foreground = DEFAULT_FOREGROUND;
+    u32 m_background = DEFAULT_BACKGROUND;
+
+    State m_state = State::Normal;
+
+    u32 m_parameters[4] = {};
+    u32 m_parameter_count = 0;
+
+    bool m_enabled = true;
+};
+
+}
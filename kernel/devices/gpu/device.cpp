@@ -1,9 +1,20 @@
 #include <kernel/devices/gpu/device.h>
+#include <kernel/devices/gpu/console.h>
 #include <kernel/process/process.h>
 #include <kernel/posix/sys/ioctl.h>
 
 namespace kernel {
 
+static_assert(sizeof(gpu_rect) == sizeof(GPUConnector::Rect));
+
+// Once userspace draws to the display itself the kernel log would only scribble over it
+static void release_console() {
+    auto* console = FramebufferConsole::instance();
+    if (console) {
+        console->set_enabled(false);
+    }
+}
+
 ErrorOr<GPUConnector*> GPUDevice::get_connector(int id) const {
     if (id < 0 || id >= static_cast<int>(m_connectors.size())) {
         return Error(EINVAL);
@@ -47,6 +58,8 @@ ErrorOr<int> GPUDevice::ioctl(unsigned request, unsigned arg) {
             auto connector = TRY(get_connector(map_fb->id));
             map_fb->framebuffer = TRY(connector->map_framebuffer(process));
 
+            release_console();
+
             return 0;
         }
         case GPU_CONNECTOR_FLUSH: {
@@ -54,7 +67,61 @@ ErrorOr<int> GPUDevice::ioctl(unsigned request, unsigned arg) {
             process->validate_read(flush, sizeof(gpu_connector_flush));
 
             auto connector = TRY(get_connector(flush->id));
-            TRY(connector->flush());
+            if (flush->count < 0) {
+                return Error(EINVAL);
+            }
+
+            size_t count = flush->count;
+            if (count > GPUConnector::MAX_RECTS) {
+                return Error(EINVAL);
+            } else if (count) {
+                process->validate_read(flush->rects, sizeof(gpu_rect) * count);
+            }
+
+            auto resolution = TRY(connector->get_resolution());
+            auto* rects = reinterpret_cast<GPUConnector::Rect const*>(flush->rects);
+
+            TRY(connector->flush(GPUConnector::merge_damage(rects, count, resolution)));
+
+            return 0;
+        }
+        case GPU_CONNECTOR_MAP_BUFFERS: {
+            gpu_connector_map_buffers* map = reinterpret_cast<gpu_connector_map_buffers*>(arg);
+            process->validate_write(map, sizeof(gpu_connector_map_buffers));
+
+            auto connector = TRY(get_connector(map->id));
+            if (map->count <= 0 || map->count > GPU_CONNECTOR_MAX_BUFFERS) {
+                return Error(EINVAL);
+            }
+
+            auto buffers = TRY(connector->map_buffers(process, map->count));
+            for (size_t i = 0; i < buffers.size(); i++) {
+                map->buffers[i] = buffers[i];
+            }
+
+            release_console();
+            return 0;
+        }
+        case GPU_CONNECTOR_PAGE_FLIP: {
+            gpu_connector_page_flip* flip = reinterpret_cast<gpu_connector_page_flip*>(arg);
+            process->validate_read(flip, sizeof(gpu_connector_page_flip));
+
+            auto connector = TRY(get_connector(flip->id));
+            if (flip->buffer < 0 || flip->count < 0) {
+                return Error(EINVAL);
+            }
+
+            size_t count = flip->count;
+            if (count > GPUConnector::MAX_RECTS) {
+                return Error(EINVAL);
+            } else if (count) {
+                process->validate_read(flip->rects, sizeof(gpu_rect) * count);
+            }
+
+            auto resolution = TRY(connector->get_resolution());
+            auto* rects = reinterpret_cast<GPUConnector::Rect const*>(flip->rects);
+
+            TRY(connector->page_flip(flip->buffer, GPUConnector::merge_damage(rects, count, resolution)));
 
             return 0;
         }
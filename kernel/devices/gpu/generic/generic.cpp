@@ -22,7 +22,7 @@ ErrorOr<void*> GenericGPUConnector::map_framebuffer(Process* process) {
     return process->allocate_with_physical_region(address, size, PROT_READ | PROT_WRITE);
 }
 
-ErrorOr<void> GenericGPUConnector::flush() {
+ErrorOr<void> GenericGPUConnector::flush(Vector<Rect> const&) {
     return {};
 }
 
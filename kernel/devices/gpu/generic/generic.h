@@ -16,7 +16,7 @@ public:
 
     ErrorOr<Resolution> get_resolution() const override;
     ErrorOr<void*> map_framebuffer(Process*) override;
-    ErrorOr<void> flush() override;
+    ErrorOr<void> flush(Vector<Rect> const& rects) override;
 
 private:
     GenericGPUConnector(GenericGPUDevice* device) : GPUConnector(0), m_device(device) {}
@@ -1,6 +1,7 @@
 #include <kernel/devices/gpu/virtio/connector.h>
 #include <kernel/devices/gpu/virtio/device.h>
 #include <kernel/memory/manager.h>
+#include <kernel/sync/lock.h>
 
 namespace kernel {
 
@@ -11,18 +12,26 @@ VirtIOGPUConnector::VirtIOGPUConnector(
 ) : GPUConnector(id), m_device(device), m_rect(rect) {}
 
 ErrorOr<void> VirtIOGPUConnector::initialize() {
-    m_resource_id = TRY(m_device->create_resource_2d(GPUFormat::B8G8R8X8, m_rect.width, m_rect.height));
-    size_t size = m_rect.width * m_rect.height * sizeof(u32);
-
+    size_t size = this->framebuffer_size();
     m_framebuffer = TRY(MM->allocate_kernel_region(size));
 
-    TRY(m_device->attach_resource_backing(m_resource_id, VirtualAddress { m_framebuffer }, size));
-    TRY(m_device->set_resource_scanout(m_id, m_resource_id, m_rect));
+    for (auto& resource : m_resources) {
+        resource = TRY(m_device->create_resource_2d(GPUFormat::B8G8R8X8, m_rect.width, m_rect.height));
+        TRY(m_device->attach_resource_backing(resource, VirtualAddress { m_framebuffer }, size));
+    }
+
+    m_device->set_resource_scanout(m_id, m_resources[m_front], m_rect);
 
     u32* fb = reinterpret_cast<u32*>(m_framebuffer);
     memset(fb, 0x41, m_rect.width * m_rect.height * sizeof(u32));
 
-    TRY(this->flush());
+    // Neither resource has seen anything yet
+    Rect screen = { 0, 0, static_cast<int>(m_rect.width), static_cast<int>(m_rect.height) };
+    m_back_damage.append(screen);
+
+    m_buffers.append({ m_framebuffer, 0 });
+
+    TRY(this->flush({ screen }));
     return {};
 }
 
@@ -36,17 +45,143 @@ ErrorOr<GPUConnector::Resolution> VirtIOGPUConnector::get_resolution() const {
 }
 
 ErrorOr<void*> VirtIOGPUConnector::map_framebuffer(Process* process) {
-    size_t size = m_rect.width * m_rect.height * sizeof(u32);
     return process->allocate_from_kernel_region(
-        VirtualAddress { m_framebuffer }, size, PROT_READ | PROT_WRITE
+        VirtualAddress { m_framebuffer }, this->framebuffer_size(), PROT_READ | PROT_WRITE
     );
 }
 
-ErrorOr<void> VirtIOGPUConnector::flush() {
-    TRY(m_device->transfer_to_host_2d(m_resource_id, m_rect, 0));
-    TRY(m_device->resource_flush(m_resource_id, m_rect));
+ErrorOr<Vector<void*>> VirtIOGPUConnector::map_buffers(Process* process, size_t count) {
+    if (!count || count > MAX_BUFFERS) {
+        return Error(EINVAL);
+    }
+
+    ScopedLock lock(m_lock);
+
+    size_t size = this->framebuffer_size();
+    while (m_buffers.size() < count) {
+        Buffer buffer;
+
+        buffer.framebuffer = TRY(MM->allocate_kernel_region(size));
+        memset(buffer.framebuffer, 0, size);
+
+        buffer.resource = TRY(m_device->create_resource_2d(GPUFormat::B8G8R8X8, m_rect.width, m_rect.height));
+        TRY(m_device->attach_resource_backing(buffer.resource, VirtualAddress { buffer.framebuffer }, size));
+
+        // The first flip to it transfers only what the client says changed, so the host has to start out in sync
+        m_device->transfer_to_host_2d(buffer.resource, { 0, 0, m_rect.width, m_rect.height }, 0);
+
+        m_buffers.append(buffer);
+    }
+
+    Vector<void*> buffers;
+    for (size_t i = 0; i < count; i++) {
+        buffers.append(TRY(process->allocate_from_kernel_region(
+            VirtualAddress { m_buffers[i].framebuffer }, size, PROT_READ | PROT_WRITE
+        )));
+    }
+
+    return buffers;
+}
+
+static GPURect to_gpu_rect(GPUConnector::Rect const& rect) {
+    return { static_cast<u32>(rect.x), static_cast<u32>(rect.y), static_cast<u32>(rect.width), static_cast<u32>(rect.height) };
+}
+
+ErrorOr<void> VirtIOGPUConnector::flush(Vector<Rect> const& rects) {
+    if (rects.empty()) {
+        return {};
+    }
+
+    ScopedLock lock(m_lock);
+    this->present(m_current_buffer, rects);
 
     return {};
 }
 
+ErrorOr<void> VirtIOGPUConnector::page_flip(size_t buffer, Vector<Rect> const& rects) {
+    u64 fence = 0;
+    {
+        ScopedLock lock(m_lock);
+        if (buffer >= m_buffers.size()) {
+            return Error(EINVAL);
+        }
+
+        fence = this->present(buffer, rects);
+    }
+
+    // Once the device is done, the buffer that was on screen is no longer transferred from and can be drawn into again
+    m_device->wait_for_fence(fence);
+    return {};
+}
+
+u64 VirtIOGPUConnector::present(size_t index, Vector<Rect> const& rects) {
+    bool switching = m_current_buffer != index;
+
+    u64 fence = 0;
+    if (index == 0) {
+        fence = this->present_framebuffer(rects, switching);
+    } else {
+        auto& buffer = m_buffers[index];
+
+        // Nothing scans this resource out unless it's already on screen, in which case this is a plain flush
+        for (auto& rect : rects) {
+            GPURect region = to_gpu_rect(rect);
+
+            size_t offset = (region.y * m_rect.width + region.x) * sizeof(u32);
+            m_device->transfer_to_host_2d(buffer.resource, region, offset);
+        }
+
+        if (switching) {
+            fence = m_device->set_resource_scanout(m_id, buffer.resource, m_rect);
+            fence = m_device->resource_flush(buffer.resource, { 0, 0, m_rect.width, m_rect.height });
+        } else {
+            for (auto& rect : rects) {
+                fence = m_device->resource_flush(buffer.resource, to_gpu_rect(rect));
+            }
+        }
+    }
+
+    m_current_buffer = index;
+    return fence;
+}
+
+u64 VirtIOGPUConnector::present_framebuffer(Vector<Rect> const& rects, bool switching) {
+    if (rects.empty() && !switching) {
+        return 0;
+    }
+
+    // The back resource has to catch up on what only went to the front one last time
+    Vector<Rect> damage = move(m_back_damage);
+    damage.extend(rects);
+
+    auto resolution = MUST(this->get_resolution());
+    damage = GPUConnector::merge_damage(damage.data(), damage.size(), resolution);
+
+    u32 back = m_resources[m_front ^ 1];
+
+    // The device works through the control queue in order, so the transfers are done by the time it flips
+    for (auto& rect : damage) {
+        GPURect region = to_gpu_rect(rect);
+
+        // The offset is where the rectangle starts in the backing, which is laid out just like the resource
+        size_t offset = (region.y * m_rect.width + region.x) * sizeof(u32);
+        m_device->transfer_to_host_2d(back, region, offset);
+    }
+
+    u64 fence = m_device->set_resource_scanout(m_id, back, m_rect);
+    if (switching) {
+        // Another buffer was on screen, so everything differs from what the display shows right now
+        fence = m_device->resource_flush(back, { 0, 0, m_rect.width, m_rect.height });
+    } else {
+        for (auto& rect : rects) {
+            fence = m_device->resource_flush(back, to_gpu_rect(rect));
+        }
+    }
+
+    m_front ^= 1;
+    m_back_damage = rects;
+
+    return fence;
+}
+
 }
\ No newline at end of file
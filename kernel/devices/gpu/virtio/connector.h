@@ -2,11 +2,13 @@
 
 #include <kernel/devices/gpu/virtio/virtio.h>
 #include <kernel/devices/gpu/device.h>
+#include <kernel/sync/mutex.h>
 
 namespace kernel {
 
 class VirtIOGPUDevice;
 
+// Flushes are queued without waiting for the device, see `VirtIOGPUDevice::submit`
 class VirtIOGPUConnector : public GPUConnector {
 public:
     static RefPtr<VirtIOGPUConnector> create(VirtIOGPUDevice* device, u32 id, virtio::GPURect rect) {
@@ -17,16 +19,45 @@ public:
 
     ErrorOr<Resolution> get_resolution() const override;
     ErrorOr<void*> map_framebuffer(Process* process) override;
-    ErrorOr<void> flush() override;
+    ErrorOr<void> flush(Vector<Rect> const& rects) override;
+
+    ErrorOr<Vector<void*>> map_buffers(Process*, size_t count) override;
+    ErrorOr<void> page_flip(size_t buffer, Vector<Rect> const& rects) override;
 
 private:
     VirtIOGPUConnector(VirtIOGPUDevice* device, u32 id, virtio::GPURect rect);
 
+    // Every buffer past the first has a resource of its own, which is only transferred to while it's off screen
+    struct Buffer {
+        void* framebuffer = nullptr;
+        u32 resource = 0;
+    };
+
+    size_t framebuffer_size() const { return m_rect.width * m_rect.height * sizeof(u32); }
+
+    // Brings the buffer up to date on the host and scans it out, returns the fence of the last command this queued.
+    // A buffer that wasn't on screen before is flushed in full, no matter what `rects` says.
+    u64 present(size_t buffer, Vector<Rect> const& rects);
+    u64 present_framebuffer(Vector<Rect> const& rects, bool switching);
+
     VirtIOGPUDevice* m_device;
     virtio::GPURect m_rect;
 
-    u32 m_resource_id = 0;
+    // Both resources share the same backing, each flush updates the one that isn't being scanned out and then flips
+    // over to it so the display never shows a half transferred frame
+    Mutex m_lock;
+
+    u32 m_resources[2] = {};
+    size_t m_front = 0;
+
+    // What changed since the back resource was last brought up to date, it only went to the front one
+    Vector<Rect> m_back_damage;
+
     void* m_framebuffer = nullptr;
+
+    // The first entry stands for `m_framebuffer`
+    Vector<Buffer> m_buffers;
+    size_t m_current_buffer = 0;
 };
 
 }
\ No newline at end of file
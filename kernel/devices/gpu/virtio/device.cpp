@@ -5,10 +5,11 @@
 #include <kernel/devices/device.h>
 #include <kernel/pci/pci.h>
 #include <kernel/memory/manager.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/sync/lock.h>
 
 #include <std/format.h>
 
-
 namespace kernel {
 
 using namespace virtio;
@@ -47,13 +48,30 @@ ErrorOr<void> VirtIOGPUDevice::initialize() {
     this->post_init();
 
     m_command_buffer = reinterpret_cast<u8*>(TRY(MM->allocate_kernel_region(10 * PAGE_SIZE)));
+
+    static_assert(PAGE_SIZE % SLOT_SIZE == 0, "Command slots must not cross pages");
+    m_slot_buffer = reinterpret_cast<u8*>(TRY(MM->allocate_kernel_region(COMMAND_SLOTS * SLOT_SIZE)));
+
+    for (size_t i = 0; i < COMMAND_SLOTS; i++) {
+        auto& slot = m_slots[i];
+
+        slot.buffer = m_slot_buffer + i * SLOT_SIZE;
+        slot.address = MM->get_physical_address(slot.buffer);
+    }
+
+    m_descriptor_slots.resize(this->queue(0).size());
+    for (auto& slot : m_descriptor_slots) {
+        slot = NO_COMMAND;
+    }
+
     m_device_config = get_config(Configuration::Device);
 
     m_num_scanouts = m_device_config->read<u32>(GPUDeviceConfig::Scanouts);
 
-    GPUDisplayInfo* display_info = TRY(this->get_display_info());
+    // Setting up the connectors sends commands of their own, which would overwrite the response in the command buffer
+    GPUDisplayInfo display_info = *TRY(this->get_display_info());
     for (u32 i = 0; i < m_num_scanouts; i++) {
-        auto& mode = display_info->modes[i];
+        auto& mode = display_info.modes[i];
         m_scanouts[i] = { i, mode.rect };
 
         auto connector = VirtIOGPUConnector::create(this, i, mode.rect);
@@ -62,6 +80,8 @@ ErrorOr<void> VirtIOGPUDevice::initialize() {
         m_connectors.append(connector);
     }
 
+    m_initialized = true;
+
     dbgln();
     dbgln("GPU VirtIO Device:");
     dbgln(" - Number of scanouts: {}", m_num_scanouts);
@@ -81,21 +101,205 @@ void VirtIOGPUDevice::populate_header(GPUControlHeader& header, GPUControlType t
 
 void VirtIOGPUDevice::send_command(size_t request, size_t response) {
     auto& queue = this->queue(0);
-    auto chain = queue.create_chain();
-
     PhysicalAddress address = MM->get_physical_address(m_command_buffer);
 
-    chain.add_buffer(address, request, false);
-    chain.add_buffer(address.offset(request), response, true);
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        m_wait_queue.add(&blocker);
+    }
+
+    bool submitted = false;
+    while (true) {
+        blocker.reset();
+        {
+            arch::InterruptDisabler disabler;
+            this->complete_commands();
+
+            // Slots never take up more than two descriptors each, so this only waits for some of them to finish
+            if (!submitted && queue.free_descriptors() >= 2) {
+                auto chain = queue.create_chain();
+
+                chain.add_buffer(address, request, false);
+                chain.add_buffer(address.offset(request), response, true);
+
+                m_descriptor_slots[chain.start()] = SYNCHRONOUS_COMMAND;
+                m_command_done = false;
+
+                chain.submit();
+                MUST(this->notify(0));
+
+                submitted = true;
+            }
+
+            if (submitted && m_command_done) {
+                break;
+            }
+        }
+
+        if (m_initialized) {
+            blocker.wait();
+        }
+    }
+
+    arch::InterruptDisabler disabler;
+    m_wait_queue.remove(&blocker);
+}
+
+Optional<u64> VirtIOGPUDevice::try_submit(void const* request, size_t size) {
+    auto& queue = this->queue(0);
+    this->complete_commands();
+
+    for (size_t i = 0; i < COMMAND_SLOTS && queue.free_descriptors() >= 2; i++) {
+        auto& slot = m_slots[i];
+        if (slot.fence) {
+            continue;
+        }
+
+        u64 fence = m_next_fence++;
+        memcpy(slot.buffer, request, size);
 
-    chain.submit();
-    MUST(this->notify(0));
+        // The device only answers once the command is done, fences are what callers wait on
+        auto* header = reinterpret_cast<GPUControlHeader*>(slot.buffer);
+        header->flags |= VIRTIO_GPU_FLAG_FENCE;
+        header->fence_id = fence;
 
-    while (!queue.has_available_data()) {}
-    queue.drain();
+        slot.request_size = size;
+        slot.fence = fence;
+
+        auto chain = queue.create_chain(true);
+
+        chain.add_buffer(slot.address, size, false);
+        chain.add_buffer(slot.address.offset(size), sizeof(GPUControlHeader), true);
+
+        m_descriptor_slots[chain.start()] = i;
+
+        chain.submit();
+        if (queue.should_notify()) {
+            MUST(this->notify(0));
+        }
+
+        return fence;
+    }
+
+    return {};
+}
+
+u64 VirtIOGPUDevice::submit(void const* request, size_t size) {
+    ASSERT(size + sizeof(GPUControlHeader) <= SLOT_SIZE, "GPU command doesn't fit a slot");
+    {
+        arch::InterruptDisabler disabler;
+
+        auto fence = this->try_submit(request, size);
+        if (fence.has_value()) {
+            return fence.value();
+        }
+    }
+
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        m_wait_queue.add(&blocker);
+    }
+
+    Optional<u64> fence;
+    while (true) {
+        blocker.reset();
+        {
+            arch::InterruptDisabler disabler;
+
+            fence = this->try_submit(request, size);
+            if (fence.has_value()) {
+                break;
+            }
+        }
+
+        blocker.wait();
+    }
+
+    arch::InterruptDisabler disabler;
+    m_wait_queue.remove(&blocker);
+
+    return fence.value();
 }
 
-void VirtIOGPUDevice::handle_queue_irq(virtio::Queue&) {}
+void VirtIOGPUDevice::complete_commands() {
+    auto& queue = this->queue(0);
+    bool completed = false;
+
+    while (queue.has_available_data()) {
+        auto chain = queue.dequeue();
+
+        u8 index = m_descriptor_slots[chain.start()];
+        m_descriptor_slots[chain.start()] = NO_COMMAND;
+
+        chain.release();
+        if (index == SYNCHRONOUS_COMMAND) {
+            m_command_done = true;
+            completed = true;
+
+            continue;
+        } else if (index == NO_COMMAND) {
+            continue;
+        }
+
+        auto& slot = m_slots[index];
+        auto* response = reinterpret_cast<GPUControlHeader*>(slot.buffer + slot.request_size);
+        if (response->type != GPUControlType::RespOKNoData) {
+            auto* request = reinterpret_cast<GPUControlHeader*>(slot.buffer);
+            dbgln("VirtIO GPU: Command {:#x} failed with response type {:#x}", request->type, response->type);
+        }
+
+        slot.fence = 0;
+        completed = true;
+    }
+
+    if (completed) {
+        m_wait_queue.wake_all();
+    }
+}
+
+bool VirtIOGPUDevice::is_fence_signaled(u64 fence) const {
+    // Slots are reused out of order, so the fence is only signaled once nothing up to it is still in flight
+    for (auto& slot : m_slots) {
+        if (slot.fence && slot.fence <= fence) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void VirtIOGPUDevice::wait_for_fence(u64 fence) {
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        m_wait_queue.add(&blocker);
+    }
+
+    while (true) {
+        blocker.reset();
+        {
+            arch::InterruptDisabler disabler;
+            this->complete_commands();
+
+            if (this->is_fence_signaled(fence)) {
+                break;
+            }
+        }
+
+        blocker.wait();
+    }
+
+    arch::InterruptDisabler disabler;
+    m_wait_queue.remove(&blocker);
+}
+
+void VirtIOGPUDevice::handle_queue_irq(virtio::Queue& queue) {
+    if (queue.index() == 0) {
+        this->complete_commands();
+    }
+}
 
 void VirtIOGPUDevice::handle_config_change() {
     u32 events = m_device_config->read<u32>(GPUDeviceConfig::EventsRead);
@@ -105,6 +309,7 @@ void VirtIOGPUDevice::handle_config_change() {
 }
 
 ErrorOr<GPUDisplayInfo*> VirtIOGPUDevice::get_display_info() {
+    ScopedLock lock(m_command_lock);
     auto buffer = this->get_command_buffer();
 
     auto* request = buffer.read<GPUControlHeader>();
@@ -122,6 +327,7 @@ ErrorOr<GPUDisplayInfo*> VirtIOGPUDevice::get_display_info() {
 }
 
 ErrorOr<GPUGetEDIDResponse*> VirtIOGPUDevice::get_edid(u32 scanout_id) {
+    ScopedLock lock(m_command_lock);
     auto buffer = this->get_command_buffer();
 
     auto* request = buffer.read<GPUGetEDID>();
@@ -140,6 +346,7 @@ ErrorOr<GPUGetEDIDResponse*> VirtIOGPUDevice::get_edid(u32 scanout_id) {
 }
 
 ErrorOr<u32> VirtIOGPUDevice::create_resource_2d(GPUFormat format, u32 width, u32 height) {
+    ScopedLock lock(m_command_lock);
     auto buffer = this->get_command_buffer();
 
     auto* request = buffer.read<GPUResourceCreate2D>();
@@ -162,6 +369,7 @@ ErrorOr<u32> VirtIOGPUDevice::create_resource_2d(GPUFormat format, u32 width, u3
 }
 
 ErrorOr<void> VirtIOGPUDevice::attach_resource_backing(u32 resource_id, VirtualAddress address, size_t size) {
+    ScopedLock lock(m_command_lock);
     auto buffer = this->get_command_buffer();
 
     auto* request = buffer.read<GPUResourceAttachBacking>();
@@ -192,66 +400,38 @@ ErrorOr<void> VirtIOGPUDevice::attach_resource_backing(u32 resource_id, VirtualA
     return {};
 }
 
-ErrorOr<void> VirtIOGPUDevice::set_resource_scanout(u32 scanout_id, u32 resource_id, GPURect rect) {
-    auto buffer = this->get_command_buffer();
-
-    auto* request = buffer.read<GPUSetScanout>();
-    this->populate_header(request->header, GPUControlType::SetScanout);
-
-    request->scanout_id = scanout_id;
-    request->resource_id = resource_id;
-    request->rect = rect;
+u64 VirtIOGPUDevice::set_resource_scanout(u32 scanout_id, u32 resource_id, GPURect rect) {
+    GPUSetScanout request;
+    this->populate_header(request.header, GPUControlType::SetScanout);
 
-    this->send_command(sizeof(GPUSetScanout), sizeof(GPUControlHeader));
+    request.scanout_id = scanout_id;
+    request.resource_id = resource_id;
+    request.rect = rect;
 
-    auto* response = buffer.read<GPUControlHeader>();
-    if (response->type != GPUControlType::RespOKNoData) {
-        dbgln("set_resource_scanout: Failed with response type {:#x}", response->type);
-        return Error(EIO);
-    }
-
-    return {};
+    return this->submit(&request, sizeof(request));
 }
 
-ErrorOr<void> VirtIOGPUDevice::transfer_to_host_2d(u32 resource_id, GPURect rect, u32 offset) {
-    auto buffer = this->get_command_buffer();
-
-    auto* request = buffer.read<GPUTransferToHost2D>();
-    this->populate_header(request->header, GPUControlType::TransferToHost2D);
+u64 VirtIOGPUDevice::transfer_to_host_2d(u32 resource_id, GPURect rect, u32 offset) {
+    GPUTransferToHost2D request;
+    this->populate_header(request.header, GPUControlType::TransferToHost2D);
 
-    request->resource_id = resource_id;
-    request->rect = rect;
-    request->offset = offset;
-
-    this->send_command(sizeof(GPUTransferToHost2D), sizeof(GPUControlHeader));
-
-    auto* response = buffer.read<GPUControlHeader>();
-    if (response->type != GPUControlType::RespOKNoData) {
-        dbgln("transfer_to_host_2d: Failed with response type {:#x}", response->type);
-        return Error(EIO);
-    }
+    request.resource_id = resource_id;
+    request.rect = rect;
+    request.offset = offset;
+    request.padding = 0;
 
-    return {};
+    return this->submit(&request, sizeof(request));
 }
 
-ErrorOr<void> VirtIOGPUDevice::resource_flush(u32 resource_id, GPURect rect) {
-    auto buffer = this->get_command_buffer();
-
-    auto* request = buffer.read<GPUResourceFlush>();
-    this->populate_header(request->header, GPUControlType::ResourceFlush);
-
-    request->resource_id = resource_id;
-    request->rect = rect;
-
-    this->send_command(sizeof(GPUResourceFlush), sizeof(GPUControlHeader));
+u64 VirtIOGPUDevice::resource_flush(u32 resource_id, GPURect rect) {
+    GPUResourceFlush request;
+    this->populate_header(request.header, GPUControlType::ResourceFlush);
 
-    auto* response = buffer.read<GPUControlHeader>();
-    if (response->type != GPUControlType::RespOKNoData) {
-        dbgln("resource_flush: Failed with response type {:#x}", response->type);
-        return Error(EIO);
-    }
+    request.resource_id = resource_id;
+    request.rect = rect;
+    request.padding = 0;
 
-    return {};
+    return this->submit(&request, sizeof(request));
 }
 
-}
+}
\ No newline at end of file
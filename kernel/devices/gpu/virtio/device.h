@@ -5,8 +5,11 @@
 #include <kernel/devices/block_device.h>
 #include <kernel/devices/gpu/virtio/virtio.h>
 #include <kernel/devices/gpu/device.h>
+#include <kernel/process/wait_queue.h>
+#include <kernel/sync/mutex.h>
 
 #include <std/bytes_buffer.h>
+#include <std/optional.h>
 
 namespace kernel {
 
@@ -17,8 +20,16 @@ public:
         virtio::GPURect rect = {};
     };
 
+    // Small commands that may be in flight at once, each one owns a slot for its request and response
+    static constexpr size_t COMMAND_SLOTS = 32;
+    static constexpr size_t SLOT_SIZE = 128;
+
     static RefPtr<GPUDevice> create(pci::Device);
-    
+
+    // Every queued command carries a fence, fences are handed out in increasing order
+    bool is_fence_signaled(u64 fence) const;
+    void wait_for_fence(u64 fence);
+
 private:
     friend class kernel::Device;
     friend class VirtIOGPUConnector;
@@ -34,21 +45,59 @@ private:
         return m_resource_id++;
     }
 
+    // Both point into the command buffer, so the response is only valid until the next command
     ErrorOr<virtio::GPUDisplayInfo*> get_display_info();
     ErrorOr<virtio::GPUGetEDIDResponse*> get_edid(u32 scanout_id); 
 
     ErrorOr<u32> create_resource_2d(virtio::GPUFormat format, u32 width, u32 height);
     ErrorOr<void> attach_resource_backing(u32 resource_id, VirtualAddress address, size_t size);
-    ErrorOr<void> set_resource_scanout(u32 scanout_id, u32 resource_id, virtio::GPURect rect);
-    ErrorOr<void> transfer_to_host_2d(u32 resource_id, virtio::GPURect rect, u32 offset);
-    ErrorOr<void> resource_flush(u32 resource_id, virtio::GPURect rect);
+
+    // These only queue the command and return its fence, a failure is only logged once the device answers
+    u64 set_resource_scanout(u32 scanout_id, u32 resource_id, virtio::GPURect rect);
+    u64 transfer_to_host_2d(u32 resource_id, virtio::GPURect rect, u32 offset);
+    u64 resource_flush(u32 resource_id, virtio::GPURect rect);
 
     void populate_header(virtio::GPUControlHeader& header, virtio::GPUControlType type, u32 flags = 0);
 
+    // Sends a command from the shared command buffer and waits until it's done, for commands whose request or response
+    // don't fit a slot (e.g. the backing of a whole framebuffer). `m_command_lock` has to be held from filling in the
+    // request until the response has been read.
     void send_command(size_t request, size_t response);
     std::BytesBuffer get_command_buffer() { return std::BytesBuffer(m_command_buffer, 10 * PAGE_SIZE); }
 
+    // Copies `request` into a free slot (waiting for one if needed) and queues it without waiting for the response
+    u64 submit(void const* request, size_t size);
+    Optional<u64> try_submit(void const* request, size_t size);
+
+    // Releases every command the device is done with and wakes up whoever waits for them. Interrupts must be disabled.
+    void complete_commands();
+
+    struct CommandSlot {
+        u8* buffer = nullptr; // The request followed by the response, within a single page
+        PhysicalAddress address;
+
+        size_t request_size = 0;
+        u64 fence = 0; // Zero while the slot is free
+    };
+
+    // What the chain starting at a descriptor belongs to
+    static constexpr u8 NO_COMMAND = 0xFF;
+    static constexpr u8 SYNCHRONOUS_COMMAND = 0xFE;
+
     u8* m_command_buffer = nullptr;
+    bool m_command_done = false;
+    Mutex m_command_lock;
+
+    // Until then the command queue is polled, interrupts can't be relied upon during setup
+    bool m_initialized = false;
+
+    u8* m_slot_buffer = nullptr;
+    CommandSlot m_slots[COMMAND_SLOTS];
+    Vector<u8> m_descriptor_slots;
+
+    u64 m_next_fence = 1;
+    WaitQueue m_wait_queue;
+
     u32 m_resource_id = 1;
     
     virtio::Configuration* m_device_config = nullptr;
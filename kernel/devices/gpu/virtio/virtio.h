@@ -62,6 +62,9 @@ enum GPUDeviceConfig {
     Scanouts = 0x08,
 };
 
+// The device signals completion of the command only once the fence in its header is reached
+#define VIRTIO_GPU_FLAG_FENCE (1 << 0)
+
 struct GPUControlHeader {
     u32 type;
     u32 flags;
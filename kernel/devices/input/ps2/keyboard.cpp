@@ -80,6 +80,7 @@ void PS2KeyboardDevice::handle_irq() {
     }
     
     m_key_buffer.append(event);
+    this->notify_readiness();
 }
 
 ErrorOr<size_t> PS2KeyboardDevice::read(void* buffer, size_t size, size_t) {
@@ -39,6 +39,7 @@ void PS2MouseDevice::update_mouse_state() {
     }
 
     m_state_buffer.push(state);
+    this->notify_readiness();
 }
 
 void PS2MouseDevice::handle_irq() {
@@ -0,0 +1,61 @@
+#include <kernel/devices/kmsg.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/fs/fd.h>
+#include <kernel/log.h>
+
+#include <std/string.h>
+
+namespace kernel {
+
+static size_t append(const void* buffer, size_t size) {
+    // Appending happens with interrupts off, so the user buffer is copied before it gets anywhere near the log
+    String message(StringView(reinterpret_cast<const char*>(buffer), size));
+    log::write(message.data(), message.size());
+
+    return size;
+}
+
+class KernelLogReader : public fs::File, public WaitQueue::Entry {
+public:
+    KernelLogReader() : m_sequence(log::tail()) {
+        arch::InterruptDisabler disabler;
+        log::wait_queue().add(this);
+    }
+
+    ~KernelLogReader() override {
+        arch::InterruptDisabler disabler;
+        log::wait_queue().remove(this);
+    }
+
+    ErrorOr<size_t> read(void* buffer, size_t size, size_t) override {
+        return log::read(m_sequence, buffer, size);
+    }
+
+    ErrorOr<size_t> write(const void* buffer, size_t size, size_t) override {
+        return append(buffer, size);
+    }
+
+    size_t size() const override { return 0; }
+
+    bool can_read(fs::FileDescriptor const&) const override { return m_sequence < log::head(); }
+    bool can_write(fs::FileDescriptor const&) const override { return true; }
+
+    void wake() override { this->notify_readiness(); }
+
+private:
+    u64 m_sequence;
+};
+
+KernelLogDevice* KernelLogDevice::create() {
+    return Device::create<KernelLogDevice>().take();
+}
+
+RefPtr<fs::FileDescriptor> KernelLogDevice::open(int options) {
+    return fs::FileDescriptor::create(RefPtr<KernelLogReader>(new KernelLogReader()), options);
+}
+
+ErrorOr<size_t> KernelLogDevice::write(const void* buffer, size_t size, size_t) {
+    return append(buffer, size);
+}
+
+}
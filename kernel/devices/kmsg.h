@@ -0,0 +1,29 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/devices/character_device.h>
+
+namespace kernel {
+
+// `/dev/kmsg`, every open gets its own reader that starts at the oldest message the kernel log still has. A reader that
+// falls so far behind that the log wraps past it gets EPIPE once and then continues from the oldest message again.
+class KernelLogDevice : public CharacterDevice {
+public:
+    static KernelLogDevice* create();
+
+    RefPtr<fs::FileDescriptor> open(int options) override;
+
+    // Only reachable through the device itself (not an open reader), which has nothing to read
+    ErrorOr<size_t> read(void*, size_t, size_t) override { return 0; }
+    ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) override;
+
+    bool can_read(fs::FileDescriptor const&) const override { return false; }
+    bool can_write(fs::FileDescriptor const&) const override { return true; }
+
+private:
+    friend class Device;
+
+    KernelLogDevice() : CharacterDevice(DeviceMajor::Generic, 4) {}
+};
+
+}
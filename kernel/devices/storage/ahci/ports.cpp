@@ -234,6 +234,16 @@ int AHCIPort::prepare_for(ata::Command command, u64 lba, u16 sectors) {
 }
 
 ErrorOr<void> AHCIPort::read_sectors(u64 lba, u16 sectors, u8* buffer) {
+    iovec iov = { buffer, sectors * SECTOR_SIZE };
+    return this->read_sectors(lba, sectors, &iov, 1);
+}
+
+ErrorOr<void> AHCIPort::write_sectors(u64 lba, u16 sectors, const u8* buffer) {
+    iovec iov = { const_cast<u8*>(buffer), sectors * SECTOR_SIZE };
+    return this->write_sectors(lba, sectors, &iov, 1);
+}
+
+ErrorOr<void> AHCIPort::read_sectors(u64 lba, u16 sectors, const iovec* iov, size_t iovcnt) {
     int slot = this->prepare_for(ata::ReadDMAExt, lba, sectors);
     if (slot < 0) {
         return Error(EBUSY);
@@ -243,18 +253,26 @@ ErrorOr<void> AHCIPort::read_sectors(u64 lba, u16 sectors, u8* buffer) {
     this->issue_command(slot);
 
     // FIXME: Check for errors
-    // FIXME: Don't hardcode the 512 sector size
-    memcpy(buffer, m_prdt_buffer, sectors * 512);
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(iov[i].iov_base, m_prdt_buffer + offset, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
     return {};
 }
 
-ErrorOr<void> AHCIPort::write_sectors(u64 lba, u16 sectors, const u8* buffer) {
+ErrorOr<void> AHCIPort::write_sectors(u64 lba, u16 sectors, const iovec* iov, size_t iovcnt) {
     int slot = this->prepare_for(ata::WriteDMAExt, lba, sectors);
     if (slot < 0) {
         return Error(EBUSY);
     }
 
-    memcpy(m_prdt_buffer, buffer, sectors * SECTOR_SIZE);
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(m_prdt_buffer + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
 
     this->wait_while_busy();
     this->issue_command(slot);
@@ -3,6 +3,7 @@
 #include <kernel/common.h>
 #include <kernel/devices/storage/ahci/ahci.h>
 #include <kernel/devices/storage/ata.h>
+#include <kernel/posix/sys/uio.h>
 #include <kernel/process/blocker.h>
 
 #include <std/memory.h>
@@ -43,6 +44,10 @@ public:
 
     ErrorOr<void> read_sectors(u64 lba, u16 count, u8* buffer);
     ErrorOr<void> write_sectors(u64 lba, u16 count, const u8* buffer);
+
+    // Issues a single command and scatters/gathers the data directly to/from the given iovecs
+    ErrorOr<void> read_sectors(u64 lba, u16 count, const iovec* iov, size_t iovcnt);
+    ErrorOr<void> write_sectors(u64 lba, u16 count, const iovec* iov, size_t iovcnt);
     
 private:
     friend AHCIController;
@@ -24,5 +24,23 @@ ErrorOr<bool> SATADevice::write_blocks(const void* buffer, size_t count, size_t
     return true;
 }
 
+ErrorOr<bool> SATADevice::read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    TRY(m_port->read_sectors(block, count, iov, iovcnt));
+    return true;
+}
+
+ErrorOr<bool> SATADevice::write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    TRY(m_port->write_sectors(block, count, iov, iovcnt));
+    return true;
+}
+
 
 }
\ No newline at end of file
@@ -16,6 +16,9 @@ public:
     ErrorOr<bool> read_blocks(void* buffer, size_t count, size_t block) override;
     ErrorOr<bool> write_blocks(const void* buffer, size_t count, size_t block) override;
 
+    ErrorOr<bool> read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+
     Type type() const override { return SATA; }
 
 private:
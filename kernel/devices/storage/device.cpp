@@ -32,4 +32,24 @@ ErrorOr<bool> StorageDevicePartition::write_blocks(const void* buffer, size_t co
     return m_device->write_blocks(buffer, count, block + m_partition.offset);
 }
 
+ErrorOr<bool> StorageDevicePartition::read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    return m_device->read_blocks_vectored(iov, iovcnt, count, block + m_partition.offset);
+}
+
+ErrorOr<bool> StorageDevicePartition::write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    return m_device->write_blocks_vectored(iov, iovcnt, count, block + m_partition.offset);
+}
+
+ErrorOr<void> StorageDevicePartition::flush() {
+    return m_device->flush();
+}
+
+ErrorOr<void> StorageDevicePartition::discard(size_t count, size_t block) {
+    if (block + count > m_partition.size) {
+        return Error(EINVAL);
+    }
+
+    return m_device->discard(count, block + m_partition.offset);
+}
+
 }
\ No newline at end of file
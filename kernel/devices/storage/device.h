@@ -15,6 +15,8 @@ public:
         PATAPI,
         SATA,
         SATAPI,
+        VirtIO,
+        NVMe,
     };
 
     virtual ~StorageDevice() = default;
@@ -51,6 +53,12 @@ public:
     ErrorOr<bool> read_blocks(void* buffer, size_t count, size_t block) override;
     ErrorOr<bool> write_blocks(const void* buffer, size_t count, size_t block) override;
 
+    ErrorOr<bool> read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+
+    ErrorOr<void> flush() override;
+    ErrorOr<void> discard(size_t count, size_t block) override;
+
     bool can_read(fs::FileDescriptor const&) const override { return true; }
     bool can_write(fs::FileDescriptor const&) const override { return true; }
 
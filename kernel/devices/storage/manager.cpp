@@ -5,6 +5,8 @@
 
 #include <kernel/devices/storage/ahci/controller.h>
 #include <kernel/devices/storage/ide/controller.h>
+#include <kernel/devices/storage/nvme/controller.h>
+#include <kernel/devices/storage/virtio/controller.h>
 
 #include <std/format.h>
 
@@ -17,6 +19,8 @@ static u32 s_partition_device_minor = 0;
 
 static constexpr StringView s_pata_device_prefix = "hd";
 static constexpr StringView s_sata_device_prefix = "sd";
+static constexpr StringView s_virtio_device_prefix = "vd";
+static constexpr StringView s_nvme_device_prefix = "nv";
 
 StorageManager* StorageManager::instance() {
     return &s_instance;
@@ -55,16 +59,23 @@ void StorageManager::enumerate_controllers() {
         }
 
         RefPtr<StorageController> controller;
-        switch (device.subclass_id()) {
-            case pci::DeviceSubclass::SATAController:
-                // TODO: Check prog_if
-                controller = AHCIController::create(device);
-                break;
-            case pci::DeviceSubclass::IDEController:
-                controller = IDEController::create(device);
-                break;
-            default:
-                return;
+        if (device.is_virtio_device()) {
+            controller = VirtIOBlockController::create(device);
+        } else {
+            switch (device.subclass_id()) {
+                case pci::DeviceSubclass::SATAController:
+                    // TODO: Check prog_if
+                    controller = AHCIController::create(device);
+                    break;
+                case pci::DeviceSubclass::IDEController:
+                    controller = IDEController::create(device);
+                    break;
+                case pci::DeviceSubclass::NVMController:
+                    controller = NVMeController::create(device);
+                    break;
+                default:
+                    return;
+            }
         }
         
         if (controller) {
@@ -107,6 +118,10 @@ StorageManager::BootDevice StorageManager::parse_boot_device(StringView device)
         type = StorageDevice::PATA;
     } else if (device.startswith(s_sata_device_prefix)) {
         type = StorageDevice::SATA;
+    } else if (device.startswith(s_virtio_device_prefix)) {
+        type = StorageDevice::VirtIO;
+    } else if (device.startswith(s_nvme_device_prefix)) {
+        type = StorageDevice::NVMe;
     } else {
         return {};
     }
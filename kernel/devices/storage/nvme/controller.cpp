@@ -0,0 +1,381 @@
+#include <kernel/devices/storage/nvme/controller.h>
+#include <kernel/devices/storage/nvme/namespace.h>
+#include <kernel/memory/manager.h>
+#include <kernel/arch/processor.h>
+#include <kernel/time/manager.h>
+
+#include <std/format.h>
+
+namespace kernel {
+
+using namespace nvme;
+
+static String identify_string(u8 const* data, size_t length) {
+    while (length > 0 && (data[length - 1] == ' ' || data[length - 1] == '\0')) {
+        length--;
+    }
+
+    return String(StringView(reinterpret_cast<char const*>(data), length));
+}
+
+RefPtr<StorageController> NVMeController::create(pci::Device device) {
+    if (device.class_id() != pci::DeviceClass::MassStorageController || device.subclass_id() != pci::DeviceSubclass::NVMController) {
+        return nullptr;
+    }
+
+    auto* controller = new NVMeController(device);
+
+    auto result = controller->initialize();
+    if (result.is_err()) {
+        dbgln("NVMeController: Failed to initialize the controller: {}", result.error().code());
+
+        controller->disable_irq();
+        delete controller;
+
+        return nullptr;
+    }
+
+    return RefPtr<StorageController>(controller);
+}
+
+NVMeController::NVMeController(pci::Device device) : IRQHandler(device.interrupt_line()), m_device(device) {}
+
+ErrorOr<void> NVMeController::initialize() {
+    size_t size = m_device.bar_size(0);
+    m_registers = reinterpret_cast<Registers volatile*>(TRY(MM->map_physical_region(m_device.bar_address(0), size)));
+
+    m_device.enable_bus_mastering();
+
+    u64 capabilities = m_registers->capabilities;
+    m_doorbell_stride = 4 << ((capabilities >> Capabilities::DoorbellStrideShift) & 0xF);
+    m_timeout_ms = std::max<u32>(((capabilities >> Capabilities::TimeoutShift) & 0xFF) * 500, 500);
+
+    // We only ever use 4KB pages, which every controller has to support unless its minimum is larger than that
+    if ((capabilities >> Capabilities::MinPageSizeShift) & 0xF) {
+        return Error(ENOTSUP);
+    }
+
+    u16 max_entries = (capabilities & Capabilities::MaxQueueEntriesMask) + 1;
+
+    m_registers->configuration = m_registers->configuration & ~Configuration::Enable;
+    TRY(this->wait_for_ready(false));
+
+    u16 admin_depth = std::min(ADMIN_QUEUE_DEPTH, max_entries);
+    m_admin_queue = TRY(NVMeQueue::create(0, admin_depth, this->doorbells(0), m_doorbell_stride, {}));
+
+    m_registers->admin_queue_attributes = ((admin_depth - 1) << 16) | (admin_depth - 1);
+    m_registers->admin_submission_queue = m_admin_queue->submission_queue_address();
+    m_registers->admin_completion_queue = m_admin_queue->completion_queue_address();
+
+    m_registers->configuration = Configuration::Enable | (6 << SubmissionEntrySizeShift) | (4 << CompletionEntrySizeShift);
+    TRY(this->wait_for_ready(true));
+
+    m_identify_buffer = reinterpret_cast<u8*>(TRY(MM->allocate_dma_region(PAGE_SIZE)));
+
+    TRY(this->identify());
+    TRY(this->create_io_queues());
+    TRY(this->enumerate_namespaces());
+
+    return {};
+}
+
+ErrorOr<void> NVMeController::wait_for_ready(bool ready) {
+    Duration deadline = TimeManager::query_time(CLOCK_MONOTONIC) + Duration::from_milliseconds(m_timeout_ms);
+    while (bool(m_registers->status & Status::Ready) != ready) {
+        if (m_registers->status & Status::FatalStatus) {
+            return Error(EIO);
+        } else if (TimeManager::query_time(CLOCK_MONOTONIC) > deadline) {
+            return Error(ETIMEDOUT);
+        }
+    }
+
+    return {};
+}
+
+ErrorOr<void> NVMeController::identify(IdentifyType type, u32 namespace_id) {
+    Command command = {};
+
+    command.opcode = to_underlying(AdminOpcode::Identify);
+    command.namespace_id = namespace_id;
+    command.cdw10 = to_underlying(type);
+
+    TRY(m_admin_queue->submit_and_poll(command, { MM->get_physical_address(m_identify_buffer) }));
+    return {};
+}
+
+ErrorOr<void> NVMeController::identify() {
+    TRY(this->identify(IdentifyType::Controller, 0));
+    u8* data = m_identify_buffer;
+
+    // In units of the minimum page size, zero means there is no limit
+    u8 mdts = data[IdentifyController::MaxDataTransferSize];
+    if (mdts) {
+        m_max_transfer_size = std::min(MAX_TRANSFER_SIZE, PAGE_SIZE << mdts);
+    }
+
+    m_volatile_write_cache = data[IdentifyController::VolatileWriteCache] & 1;
+
+    u16 optional_commands = *reinterpret_cast<u16*>(data + IdentifyController::OptionalCommands);
+    m_supports_deallocate = optional_commands & SupportsDatasetManagement;
+
+    dbgln();
+    dbgln("NVMe Controller ({}:{}:{}):", m_device.address().bus(), m_device.address().device(), m_device.address().function());
+    dbgln(" - Model: {}", identify_string(data + IdentifyController::ModelNumber, 40));
+    dbgln(" - Serial: {}", identify_string(data + IdentifyController::SerialNumber, 20));
+    dbgln(" - Max transfer size: {} bytes", m_max_transfer_size);
+    dbgln(" - Volatile write cache: {}", m_volatile_write_cache);
+    dbgln(" - Supports deallocate: {}", m_supports_deallocate);
+
+    return {};
+}
+
+ErrorOr<void> NVMeController::create_io_queues() {
+    u16 wanted = std::min(Processor::count(), MAX_IO_QUEUES);
+
+    Command command = {};
+
+    command.opcode = to_underlying(AdminOpcode::SetFeatures);
+    command.cdw10 = to_underlying(Feature::NumberOfQueues);
+    command.cdw11 = ((wanted - 1) << 16) | (wanted - 1);
+
+    auto completion = TRY(m_admin_queue->submit_and_poll(command));
+
+    // Both counts are zero based, we need a submission and a completion queue per CPU
+    u16 allocated = std::min(completion.result & 0xFFFF, completion.result >> 16) + 1;
+    u16 count = std::min(wanted, allocated);
+
+    // Vector 0 belongs to the admin queue, which we only ever poll. Without enough vectors everything goes through
+    // the interrupt pin instead.
+    Vector<u8> irqs;
+    if (auto msix = pci::MSIX::create(m_device); !msix.is_err() && msix.value()->vectors() > count) {
+        m_msix = msix.release_value();
+        for (u16 i = 0; i < count; i++) {
+            auto irq = allocate_msi_irq();
+            if (irq.is_err()) {
+                break;
+            }
+
+            irqs.append(irq.value());
+        }
+
+        if (irqs.size() != count) {
+            for (auto irq : irqs) {
+                free_msi_irq(irq);
+            }
+
+            irqs.clear();
+            m_msix = nullptr;
+        }
+    }
+
+    u16 max_entries = (m_registers->capabilities & Capabilities::MaxQueueEntriesMask) + 1;
+    u16 depth = std::min(IO_QUEUE_DEPTH, max_entries);
+
+    for (u16 i = 0; i < count; i++) {
+        u16 id = i + 1;
+        u16 vector = m_msix ? id : 0;
+
+        Optional<u8> irq;
+        if (m_msix) {
+            irq = irqs[i];
+        }
+
+        auto queue = this->create_io_queue(id, depth, vector, irq);
+        if (queue.is_err()) {
+            // The queues give back their own IRQ, the ones that never got that far are still ours
+            for (size_t j = i + 1; j < irqs.size(); j++) {
+                free_msi_irq(irqs[j]);
+            }
+
+            return queue.error();
+        }
+
+        m_io_queues.append(queue.release_value());
+    }
+
+    if (m_msix) {
+        m_msix->mask(0);
+        m_msix->enable();
+    } else {
+        m_device.enable_interrupts();
+        this->enable_irq();
+    }
+
+    dbgln(" - I/O queues: {} of depth {} ({})", count, depth, m_msix ? "MSI-X" : "pin based interrupts");
+    return {};
+}
+
+ErrorOr<OwnPtr<NVMeQueue>> NVMeController::create_io_queue(u16 id, u16 depth, u16 vector, Optional<u8> irq) {
+    auto queue = TRY(NVMeQueue::create(id, depth, this->doorbells(id), m_doorbell_stride, irq));
+
+    Command create = {};
+
+    create.opcode = to_underlying(AdminOpcode::CreateIOCompletionQueue);
+    create.prp1 = queue->completion_queue_address();
+    create.cdw10 = ((depth - 1) << 16) | id;
+    create.cdw11 = (vector << 16) | QueueFlags::InterruptsEnabled | QueueFlags::PhysicallyContiguous;
+
+    TRY(m_admin_queue->submit_and_poll(create));
+
+    create = {};
+
+    create.opcode = to_underlying(AdminOpcode::CreateIOSubmissionQueue);
+    create.prp1 = queue->submission_queue_address();
+    create.cdw10 = ((depth - 1) << 16) | id;
+    create.cdw11 = (id << 16) | QueueFlags::PhysicallyContiguous;
+
+    TRY(m_admin_queue->submit_and_poll(create));
+
+    if (m_msix) {
+        m_msix->set_vector(vector, irq.value());
+    }
+
+    return queue;
+}
+
+ErrorOr<void> NVMeController::enumerate_namespaces() {
+    TRY(this->identify(IdentifyType::ActiveNamespaces, 0));
+
+    Vector<u32> ids;
+    auto* list = reinterpret_cast<u32*>(m_identify_buffer);
+
+    for (size_t i = 0; i < PAGE_SIZE / sizeof(u32) && list[i]; i++) {
+        ids.append(list[i]);
+    }
+
+    for (u32 id : ids) {
+        TRY(this->identify(IdentifyType::Namespace, id));
+        auto* info = reinterpret_cast<IdentifyNamespace*>(m_identify_buffer);
+
+        auto& format = info->lba_formats[info->formatted_lba_size & 0xF];
+        size_t block_size = 1ul << format.data_size;
+
+        if (format.metadata_size || block_size < 512 || block_size > PAGE_SIZE || !info->size) {
+            dbgln(" - Skipping namespace {} (block size {}, {} bytes of metadata)", id, block_size, format.metadata_size);
+            continue;
+        }
+
+        dbgln(" - Namespace {}: {} blocks of {} bytes", id, info->size, block_size);
+        m_namespaces.append(NVMeNamespace::create(this, id, info->size, block_size));
+    }
+
+    return {};
+}
+
+RefPtr<StorageDevice> NVMeController::device(size_t index) const {
+    if (index >= m_namespaces.size()) {
+        return nullptr;
+    }
+
+    return m_namespaces[index];
+}
+
+NVMeQueue& NVMeController::io_queue() {
+    return *m_io_queues[Processor::instance().id() % m_io_queues.size()];
+}
+
+bool NVMeController::build_prps(
+    Vector<PhysicalAddress>& pages, PinnedPages& pins, iovec const* iov, size_t iovcnt, bool writable
+) const {
+    bool at_page_boundary = true;
+
+    for (size_t i = 0; i < iovcnt; i++) {
+        FlatPtr address = reinterpret_cast<FlatPtr>(iov[i].iov_base);
+        size_t remaining = iov[i].iov_len;
+
+        if (address % 4) {
+            return false;
+        }
+
+        while (remaining > 0) {
+            size_t offset = address % PAGE_SIZE;
+            size_t length = std::min(remaining, PAGE_SIZE - offset);
+
+            // Only the very first entry may start in the middle of a page, and everything but the last has to go on
+            // until the end of one
+            if (!pages.empty() && (offset || !at_page_boundary)) {
+                return false;
+            }
+
+            auto physical = pins.pin(reinterpret_cast<void const*>(address), writable);
+            if (!physical.has_value() || pages.size() > NVMeQueue::MAX_PRP_ENTRIES) {
+                return false;
+            }
+
+            pages.append(physical.value());
+            at_page_boundary = (offset + length) == PAGE_SIZE;
+
+            address += length;
+            remaining -= length;
+        }
+    }
+
+    return true;
+}
+
+ErrorOr<void> NVMeController::read(u32 namespace_id, u64 block, u16 count, Vector<PhysicalAddress> const& pages) {
+    Command command = {};
+
+    command.opcode = to_underlying(IOOpcode::Read);
+    command.namespace_id = namespace_id;
+    command.cdw10 = block & 0xFFFFFFFF;
+    command.cdw11 = block >> 32;
+    command.cdw12 = count - 1;
+
+    TRY(this->io_queue().submit(command, pages));
+    return {};
+}
+
+ErrorOr<void> NVMeController::write(u32 namespace_id, u64 block, u16 count, Vector<PhysicalAddress> const& pages) {
+    Command command = {};
+
+    command.opcode = to_underlying(IOOpcode::Write);
+    command.namespace_id = namespace_id;
+    command.cdw10 = block & 0xFFFFFFFF;
+    command.cdw11 = block >> 32;
+    command.cdw12 = count - 1;
+
+    TRY(this->io_queue().submit(command, pages));
+    return {};
+}
+
+ErrorOr<void> NVMeController::flush(u32 namespace_id) {
+    // Without a volatile write cache everything we wrote is already on stable storage
+    if (!m_volatile_write_cache) {
+        return {};
+    }
+
+    Command command = {};
+
+    command.opcode = to_underlying(IOOpcode::Flush);
+    command.namespace_id = namespace_id;
+
+    TRY(this->io_queue().submit(command));
+    return {};
+}
+
+ErrorOr<void> NVMeController::deallocate(u32 namespace_id, u64 block, u32 count) {
+    if (!m_supports_deallocate) {
+        return Error(EOPNOTSUPP);
+    }
+
+    DatasetRange range = { 0, count, block };
+    Command command = {};
+
+    command.opcode = to_underlying(IOOpcode::DatasetManagement);
+    command.namespace_id = namespace_id;
+    command.cdw10 = 0; // A single range
+    command.cdw11 = DEALLOCATE;
+
+    TRY(this->io_queue().submit_with_payload(command, &range, sizeof(range)));
+    return {};
+}
+
+void NVMeController::handle_irq() {
+    m_admin_queue->process_completions();
+    for (auto& queue : m_io_queues) {
+        queue->process_completions();
+    }
+}
+
+}
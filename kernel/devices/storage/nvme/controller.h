@@ -0,0 +1,97 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/arch/irq.h>
+#include <kernel/pci/pci.h>
+#include <kernel/pci/msix.h>
+#include <kernel/posix/sys/uio.h>
+#include <kernel/devices/storage/controller.h>
+#include <kernel/devices/storage/nvme/nvme.h>
+#include <kernel/devices/storage/nvme/queue.h>
+#include <kernel/memory/manager.h>
+
+#include <std/memory.h>
+#include <std/vector.h>
+
+namespace kernel {
+
+class NVMeNamespace;
+
+class NVMeController : public StorageController, public IRQHandler {
+public:
+    static constexpr u16 ADMIN_QUEUE_DEPTH = 32;
+    static constexpr u16 IO_QUEUE_DEPTH = 256;
+
+    // We don't set up more I/O queues than this, even if there are more CPUs
+    static constexpr size_t MAX_IO_QUEUES = 16;
+
+    // Upper bound for the data of a single command, a whole PRP list's worth of pages
+    static constexpr size_t MAX_TRANSFER_SIZE = NVMeQueue::MAX_PRP_ENTRIES * PAGE_SIZE;
+
+    static RefPtr<StorageController> create(pci::Device);
+
+    RefPtr<StorageDevice> device(size_t index) const override;
+    size_t devices() const override { return m_namespaces.size(); }
+
+    size_t max_transfer_size() const { return m_max_transfer_size; }
+
+    bool has_volatile_write_cache() const { return m_volatile_write_cache; }
+    bool supports_deallocate() const { return m_supports_deallocate; }
+
+    // Turns the iovecs into PRP entries, fails if a page isn't mapped (writable, if `writable` is set) or the buffers
+    // don't line up with page boundaries the way PRPs need them to. The pages stay pinned by `pins`, which has to
+    // outlive the command.
+    bool build_prps(
+        Vector<PhysicalAddress>& pages, PinnedPages& pins, iovec const* iov, size_t iovcnt, bool writable
+    ) const;
+
+    ErrorOr<void> read(u32 namespace_id, u64 block, u16 count, Vector<PhysicalAddress> const& pages);
+    ErrorOr<void> write(u32 namespace_id, u64 block, u16 count, Vector<PhysicalAddress> const& pages);
+
+    ErrorOr<void> flush(u32 namespace_id);
+    ErrorOr<void> deallocate(u32 namespace_id, u64 block, u32 count);
+
+private:
+    NVMeController(pci::Device);
+
+    ErrorOr<void> initialize();
+    ErrorOr<void> wait_for_ready(bool ready);
+
+    ErrorOr<void> identify();
+    ErrorOr<void> create_io_queues();
+    ErrorOr<OwnPtr<NVMeQueue>> create_io_queue(u16 id, u16 depth, u16 vector, Optional<u8> irq);
+    ErrorOr<void> enumerate_namespaces();
+
+    ErrorOr<void> identify(nvme::IdentifyType, u32 namespace_id);
+
+    void handle_irq() override;
+
+    u32 volatile* doorbells(u16 queue) const {
+        return reinterpret_cast<u32 volatile*>(reinterpret_cast<u8 volatile*>(m_registers) + nvme::DOORBELL_OFFSET + 2 * queue * m_doorbell_stride);
+    }
+
+    NVMeQueue& io_queue();
+
+    pci::Device m_device;
+    nvme::Registers volatile* m_registers = nullptr;
+
+    size_t m_doorbell_stride = 4;
+    u32 m_timeout_ms = 500;
+
+    OwnPtr<pci::MSIX> m_msix;
+
+    OwnPtr<NVMeQueue> m_admin_queue;
+    Vector<OwnPtr<NVMeQueue>> m_io_queues;
+
+    // A page for whatever Identify returns
+    u8* m_identify_buffer = nullptr;
+
+    size_t m_max_transfer_size = MAX_TRANSFER_SIZE;
+
+    bool m_volatile_write_cache = false;
+    bool m_supports_deallocate = false;
+
+    Vector<RefPtr<NVMeNamespace>> m_namespaces;
+};
+
+}
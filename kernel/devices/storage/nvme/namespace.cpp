@@ -0,0 +1,112 @@
+#include <kernel/devices/storage/nvme/namespace.h>
+
+namespace kernel {
+
+size_t NVMeNamespace::max_io_block_count() const {
+    return m_controller->max_transfer_size() / block_size();
+}
+
+ErrorOr<bool> NVMeNamespace::read_blocks(void* buffer, size_t count, size_t block) {
+    iovec iov = { buffer, count * block_size() };
+    return this->read_blocks_vectored(&iov, 1, count, block);
+}
+
+ErrorOr<bool> NVMeNamespace::write_blocks(const void* buffer, size_t count, size_t block) {
+    iovec iov = { const_cast<void*>(buffer), count * block_size() };
+    return this->write_blocks_vectored(&iov, 1, count, block);
+}
+
+ErrorOr<bool> NVMeNamespace::read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    } else if (!count) {
+        return true;
+    }
+
+    Vector<PhysicalAddress> pages;
+    PinnedPages pins;
+
+    if (m_controller->build_prps(pages, pins, iov, iovcnt, true)) {
+        TRY(m_controller->read(m_id, block, count, pages));
+        return true;
+    }
+
+    // Anything PRPs can't describe (or that isn't mapped in yet) is read into a kernel buffer first
+    Vector<u8> buffer(count * this->block_size());
+    TRY(this->transfer_bounced(buffer, count, block, false));
+
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(iov[i].iov_base, buffer.data() + offset, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    return true;
+}
+
+ErrorOr<bool> NVMeNamespace::write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    } else if (!count) {
+        return true;
+    }
+
+    Vector<PhysicalAddress> pages;
+    PinnedPages pins;
+
+    if (m_controller->build_prps(pages, pins, iov, iovcnt, false)) {
+        TRY(m_controller->write(m_id, block, count, pages));
+        return true;
+    }
+
+    Vector<u8> buffer(count * this->block_size());
+
+    size_t offset = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        memcpy(buffer.data() + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    TRY(this->transfer_bounced(buffer, count, block, true));
+    return true;
+}
+
+ErrorOr<void> NVMeNamespace::transfer_bounced(Vector<u8>& buffer, size_t count, size_t block, bool write) {
+    iovec iov = { buffer.data(), buffer.size() };
+
+    Vector<PhysicalAddress> pages;
+    PinnedPages pins;
+
+    if (!m_controller->build_prps(pages, pins, &iov, 1, !write)) {
+        return Error(EIO);
+    }
+
+    if (write) {
+        return m_controller->write(m_id, block, count, pages);
+    }
+
+    return m_controller->read(m_id, block, count, pages);
+}
+
+ErrorOr<void> NVMeNamespace::flush() {
+    return m_controller->flush(m_id);
+}
+
+ErrorOr<void> NVMeNamespace::discard(size_t count, size_t block) {
+    if (block + count > m_max_addressable_block) {
+        return Error(EINVAL);
+    }
+
+    // A single range covers at most 2^32 - 1 blocks
+    while (count > 0) {
+        u32 blocks = std::min<size_t>(count, 0xFFFFFFFF);
+        TRY(m_controller->deallocate(m_id, block, blocks));
+
+        block += blocks;
+        count -= blocks;
+    }
+
+    return {};
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <kernel/devices/storage/device.h>
+#include <kernel/devices/storage/nvme/controller.h>
+
+#include <std/vector.h>
+
+namespace kernel {
+
+class NVMeNamespace : public StorageDevice {
+public:
+    static RefPtr<NVMeNamespace> create(NVMeController* controller, u32 id, u64 blocks, size_t block_size) {
+        return Device::create<NVMeNamespace>(controller, id, blocks, block_size);
+    }
+
+    u32 id() const { return m_id; }
+
+    size_t max_io_block_count() const override;
+
+    ErrorOr<bool> read_blocks(void* buffer, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks(const void* buffer, size_t count, size_t block) override;
+
+    // The pages behind the iovecs are handed to the controller as they are, unless they can't be described by PRPs
+    ErrorOr<bool> read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+
+    ErrorOr<void> flush() override;
+    ErrorOr<void> discard(size_t count, size_t block) override;
+
+    Type type() const override { return NVMe; }
+
+private:
+    friend class Device;
+
+    // Kernel heap buffers are always mapped and contiguous, which is all PRPs need
+    ErrorOr<void> transfer_bounced(Vector<u8>& buffer, size_t count, size_t block, bool write);
+
+    NVMeNamespace(NVMeController* controller, u32 id, u64 blocks, size_t block_size)
+        : StorageDevice(block_size), m_controller(controller), m_id(id) {
+        m_max_addressable_block = blocks;
+    }
+
+    NVMeController* m_controller;
+    u32 m_id;
+};
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <kernel/common.h>
+
+// https://nvmexpress.org/specifications/ (NVM Express Base Specification 2.0, NVM Command Set Specification 1.0)
+namespace kernel::nvme {
+
+// Section 3.1.4, everything up to the doorbells
+struct Registers {
+    u64 capabilities;
+    u32 version;
+    u32 interrupt_mask_set;
+    u32 interrupt_mask_clear;
+    u32 configuration;
+    u32 reserved;
+    u32 status;
+    u32 subsystem_reset;
+    u32 admin_queue_attributes;
+    u64 admin_submission_queue;
+    u64 admin_completion_queue;
+} PACKED;
+
+// The submission queue tail and completion queue head doorbells of every queue follow each other from here on
+constexpr size_t DOORBELL_OFFSET = 0x1000;
+
+namespace Capabilities {
+    constexpr u64 MaxQueueEntriesMask = 0xFFFF;     // Zero based
+    constexpr u64 TimeoutShift = 24;                // In 500ms units
+    constexpr u64 DoorbellStrideShift = 32;         // Doorbells are (4 << DSTRD) bytes apart
+    constexpr u64 MinPageSizeShift = 48;            // 2 ^ (12 + MPSMIN)
+}
+
+enum Configuration : u32 {
+    Enable = 1 << 0,
+    SubmissionEntrySizeShift = 16, // log2 of the entry size
+    CompletionEntrySizeShift = 20,
+};
+
+enum Status : u32 {
+    Ready = 1 << 0,
+    FatalStatus = 1 << 1,
+};
+
+// Section 5, admin commands
+enum class AdminOpcode : u8 {
+    DeleteIOSubmissionQueue = 0x00,
+    CreateIOSubmissionQueue = 0x01,
+    DeleteIOCompletionQueue = 0x04,
+    CreateIOCompletionQueue = 0x05,
+    Identify = 0x06,
+    SetFeatures = 0x09,
+};
+
+// NVM Command Set, section 3
+enum class IOOpcode : u8 {
+    Flush = 0x00,
+    Write = 0x01,
+    Read = 0x02,
+    DatasetManagement = 0x09,
+};
+
+enum class IdentifyType : u32 {
+    Namespace = 0x00,
+    Controller = 0x01,
+    ActiveNamespaces = 0x02,
+};
+
+enum class Feature : u32 {
+    NumberOfQueues = 0x07,
+};
+
+enum QueueFlags : u32 {
+    PhysicallyContiguous = 1 << 0,
+    InterruptsEnabled = 1 << 1, // Completion queues only
+};
+
+// Dataset Management, cdw11
+constexpr u32 DEALLOCATE = 1 << 2;
+
+// Section 4.2
+struct Command {
+    u8 opcode;
+    u8 flags;
+    u16 command_id;
+    u32 namespace_id;
+    u64 reserved;
+    u64 metadata;
+    u64 prp1;
+    u64 prp2;
+    u32 cdw10;
+    u32 cdw11;
+    u32 cdw12;
+    u32 cdw13;
+    u32 cdw14;
+    u32 cdw15;
+} PACKED;
+
+// Section 4.2.3
+struct Completion {
+    u32 result;
+    u32 reserved;
+    u16 submission_queue_head;
+    u16 submission_queue_id;
+    u16 command_id;
+    u16 status; // Bit 0 is the phase tag, the status code starts at bit 1
+
+    u16 status_code() const { return status >> 1; }
+} PACKED;
+
+static_assert(sizeof(Command) == 64);
+static_assert(sizeof(Completion) == 16);
+
+// Identify Controller data structure, only the fields we use
+namespace IdentifyController {
+    constexpr size_t SerialNumber = 4;    // 20 ASCII characters
+    constexpr size_t ModelNumber = 24;    // 40 ASCII characters
+    constexpr size_t MaxDataTransferSize = 77;
+    constexpr size_t OptionalCommands = 520;
+    constexpr size_t VolatileWriteCache = 525;
+}
+
+enum OptionalCommands : u16 {
+    SupportsDatasetManagement = 1 << 2,
+};
+
+// Identify Namespace data structure (NVM Command Set, section 4.1.5.1)
+struct IdentifyNamespace {
+    u64 size;
+    u64 capacity;
+    u64 utilization;
+    u8 features;
+    u8 lba_format_count;
+    u8 formatted_lba_size; // Bits 0-3 index `lba_formats`
+    u8 reserved[101];
+
+    struct {
+        u16 metadata_size;
+        u8 data_size; // log2
+        u8 relative_performance;
+    } PACKED lba_formats[16];
+} PACKED;
+
+// A range of a Dataset Management command
+struct DatasetRange {
+    u32 attributes;
+    u32 blocks;
+    u64 start;
+} PACKED;
+
+}
@@ -0,0 +1,218 @@
+#include <kernel/devices/storage/nvme/queue.h>
+#include <kernel/memory/manager.h>
+#include <kernel/arch/interrupts.h>
+
+#include <std/atomic.h>
+#include <std/format.h>
+
+namespace kernel {
+
+using namespace nvme;
+
+ErrorOr<OwnPtr<NVMeQueue>> NVMeQueue::create(u16 id, u16 depth, u32 volatile* doorbells, size_t stride, Optional<u8> irq) {
+    auto queue = OwnPtr<NVMeQueue>(new NVMeQueue(id, depth, doorbells, stride, irq));
+    TRY(queue->initialize());
+
+    if (irq.has_value()) {
+        queue->register_interrupt_handler();
+    }
+
+    return queue;
+}
+
+NVMeQueue::NVMeQueue(u16 id, u16 depth, u32 volatile* doorbells, size_t stride, Optional<u8> irq)
+    : MSIIRQHandler(irq.value_or(0)), m_id(id), m_depth(depth), m_has_irq(irq.has_value()) {
+    m_submission_doorbell = doorbells;
+    m_completion_doorbell = reinterpret_cast<u32 volatile*>(reinterpret_cast<u8 volatile*>(doorbells) + stride);
+}
+
+NVMeQueue::~NVMeQueue() {
+    if (m_has_irq) {
+        this->unregister_interrupt_handler();
+        free_msi_irq(this->irq());
+    }
+}
+
+ErrorOr<void> NVMeQueue::initialize() {
+    // The controller only knows both queues by their base address
+    size_t submission_size = std::align_up(m_depth * sizeof(Command), PAGE_SIZE);
+    size_t completion_size = std::align_up(m_depth * sizeof(Completion), PAGE_SIZE);
+
+    m_submissions = reinterpret_cast<Command*>(TRY(MM->allocate_contiguous_dma_region(submission_size)));
+    m_completions = reinterpret_cast<Completion volatile*>(TRY(MM->allocate_contiguous_dma_region(completion_size)));
+
+    memset(m_submissions, 0, submission_size);
+    memset(const_cast<Completion*>(m_completions), 0, completion_size);
+
+    m_submission_address = MM->get_physical_address(m_submissions);
+    m_completion_address = MM->get_physical_address(const_cast<Completion*>(m_completions));
+
+    m_requests.resize(m_depth - 1);
+    m_prp_lists = reinterpret_cast<u8*>(TRY(MM->allocate_dma_region(m_requests.size() * PAGE_SIZE)));
+
+    return {};
+}
+
+Optional<u16> NVMeQueue::try_submit(Command& command, Vector<PhysicalAddress> const& pages, void const* payload, size_t size) {
+    for (u16 i = 0; i < m_requests.size(); i++) {
+        auto& request = m_requests[i];
+        if (request.in_use) {
+            continue;
+        }
+
+        request = { true, false, {} };
+
+        u8* list = m_prp_lists + i * PAGE_SIZE;
+        command.command_id = i;
+
+        if (payload) {
+            memcpy(list, payload, size);
+            command.prp1 = MM->get_physical_address(list);
+        } else if (!pages.empty()) {
+            command.prp1 = pages[0];
+            if (pages.size() == 2) {
+                command.prp2 = pages[1];
+            } else if (pages.size() > 2) {
+                // Everything past the first page is listed in the page that belongs to this slot
+                auto* entries = reinterpret_cast<u64*>(list);
+                for (size_t j = 1; j < pages.size(); j++) {
+                    entries[j - 1] = pages[j];
+                }
+
+                command.prp2 = MM->get_physical_address(list);
+            }
+        }
+
+        m_submissions[m_submission_tail] = command;
+        m_submission_tail = (m_submission_tail + 1) % m_depth;
+
+        // The entry has to be visible to the controller before the doorbell tells it to fetch it
+        std::atomic_thread_fence(std::MemoryOrder::Release);
+        *m_submission_doorbell = m_submission_tail;
+
+        return i;
+    }
+
+    return {};
+}
+
+ErrorOr<Completion> NVMeQueue::submit(Command command, Vector<PhysicalAddress> const& pages) {
+    return this->submit(command, pages, nullptr, 0, false);
+}
+
+ErrorOr<Completion> NVMeQueue::submit_and_poll(Command command, Vector<PhysicalAddress> const& pages) {
+    return this->submit(command, pages, nullptr, 0, true);
+}
+
+ErrorOr<Completion> NVMeQueue::submit_with_payload(Command command, void const* data, size_t size) {
+    if (size > PAGE_SIZE) {
+        return Error(EINVAL);
+    }
+
+    return this->submit(command, {}, data, size, false);
+}
+
+ErrorOr<Completion> NVMeQueue::submit(Command& command, Vector<PhysicalAddress> const& pages, void const* payload, size_t size, bool poll) {
+    if (pages.size() > MAX_PRP_ENTRIES + 1) {
+        return Error(EINVAL);
+    }
+
+    if (poll) {
+        arch::InterruptDisabler disabler;
+
+        Optional<u16> slot;
+        while (!slot.has_value()) {
+            this->process_completions();
+            slot = this->try_submit(command, pages, payload, size);
+        }
+
+        while (!m_requests[slot.value()].done) {
+            this->process_completions();
+        }
+
+        return this->finish(slot.value());
+    }
+
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        m_wait_queue.add(&blocker);
+    }
+
+    Optional<u16> slot;
+    while (true) {
+        blocker.reset();
+        {
+            arch::InterruptDisabler disabler;
+            this->process_completions();
+
+            if (!slot.has_value()) {
+                slot = this->try_submit(command, pages, payload, size);
+            }
+
+            if (slot.has_value() && m_requests[slot.value()].done) {
+                break;
+            }
+        }
+
+        blocker.wait();
+    }
+
+    arch::InterruptDisabler disabler;
+    m_wait_queue.remove(&blocker);
+
+    return this->finish(slot.value());
+}
+
+ErrorOr<Completion> NVMeQueue::finish(u16 slot) {
+    auto& request = m_requests[slot];
+    Completion completion = request.completion;
+
+    // Whoever waits for a free slot was only woken up when this one completed, not now that it's actually free
+    request.in_use = false;
+    m_wait_queue.wake_all();
+
+    if (completion.status_code()) {
+        dbgln("NVMe: Command failed on queue {} with status {:#x}", m_id, completion.status_code());
+        return Error(EIO);
+    }
+
+    return completion;
+}
+
+void NVMeQueue::process_completions() {
+    bool completed = false;
+
+    while (true) {
+        auto& entry = m_completions[m_completion_head];
+        if ((entry.status & 1) != m_phase) {
+            break;
+        }
+
+        // The phase tag has to be checked before anything else in the entry is read
+        std::atomic_thread_fence(std::MemoryOrder::Acquire);
+
+        u16 id = entry.command_id;
+        if (id < m_requests.size() && m_requests[id].in_use) {
+            auto& request = m_requests[id];
+
+            request.completion = const_cast<Completion const&>(entry);
+            request.done = true;
+        }
+
+        m_completion_head++;
+        if (m_completion_head == m_depth) {
+            m_completion_head = 0;
+            m_phase ^= 1;
+        }
+
+        completed = true;
+    }
+
+    if (completed) {
+        *m_completion_doorbell = m_completion_head;
+        m_wait_queue.wake_all();
+    }
+}
+
+}
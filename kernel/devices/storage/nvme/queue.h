@@ -0,0 +1,93 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/arch/irq.h>
+#include <kernel/devices/storage/nvme/nvme.h>
+#include <kernel/memory/physical_address.h>
+#include <kernel/process/wait_queue.h>
+
+#include <std/memory.h>
+#include <std/optional.h>
+#include <std/result.h>
+#include <std/vector.h>
+
+namespace kernel {
+
+// A submission queue together with the completion queue it posts to. With MSI-X every queue gets an interrupt of its
+// own, otherwise the controller polls all of them from its pin based handler.
+class NVMeQueue : public MSIIRQHandler {
+public:
+    // Most pages a single command can address, the PRP list of a command takes up a page of its own
+    static constexpr size_t MAX_PRP_ENTRIES = PAGE_SIZE / sizeof(u64);
+
+    // Without an `irq` the queue is only ever polled, `doorbells` points at the submission queue tail doorbell
+    // The queue owns `irq` from then on and gives it back once destroyed, even if creating it fails.
+    static ErrorOr<OwnPtr<NVMeQueue>> create(u16 id, u16 depth, u32 volatile* doorbells, size_t stride, Optional<u8> irq);
+
+    ~NVMeQueue();
+
+    u16 id() const { return m_id; }
+    u16 depth() const { return m_depth; }
+
+    PhysicalAddress submission_queue_address() const { return m_submission_address; }
+    PhysicalAddress completion_queue_address() const { return m_completion_address; }
+
+    // Queues `command` and blocks until the controller is done with it. `pages` is the data as PRP entries expect it:
+    // the first one may start anywhere within its page, the others are whole pages.
+    ErrorOr<nvme::Completion> submit(nvme::Command command, Vector<PhysicalAddress> const& pages = {});
+
+    // Same thing but spins until the command is done, for the admin queue while the controller is being set up
+    ErrorOr<nvme::Completion> submit_and_poll(nvme::Command command, Vector<PhysicalAddress> const& pages = {});
+
+    // Copies `data` into a buffer the command can point at, for small payloads like the ranges of a Dataset Management
+    // command. Only valid until the command is done.
+    ErrorOr<nvme::Completion> submit_with_payload(nvme::Command command, void const* data, size_t size);
+
+    // Marks every command the controller is done with as such. Interrupts must be disabled.
+    void process_completions();
+
+    void handle_irq() override { this->process_completions(); }
+
+private:
+    struct Request {
+        bool in_use = false;
+        bool done = false;
+        nvme::Completion completion = {};
+    };
+
+    NVMeQueue(u16 id, u16 depth, u32 volatile* doorbells, size_t stride, Optional<u8> irq);
+
+    ErrorOr<void> initialize();
+
+    // Picks a free command slot and rings the doorbell, nothing if every slot is taken
+    Optional<u16> try_submit(nvme::Command&, Vector<PhysicalAddress> const& pages, void const* payload, size_t size);
+
+    ErrorOr<nvme::Completion> submit(nvme::Command&, Vector<PhysicalAddress> const& pages, void const* payload, size_t size, bool poll);
+    ErrorOr<nvme::Completion> finish(u16 slot);
+
+    u16 m_id;
+    u16 m_depth;
+
+    bool m_has_irq;
+
+    nvme::Command* m_submissions = nullptr;
+    nvme::Completion volatile* m_completions = nullptr;
+
+    PhysicalAddress m_submission_address;
+    PhysicalAddress m_completion_address;
+
+    u32 volatile* m_submission_doorbell;
+    u32 volatile* m_completion_doorbell;
+
+    u16 m_submission_tail = 0;
+    u16 m_completion_head = 0;
+    u16 m_phase = 1;
+
+    // One less than the depth, so that the submission queue can never fill up. Each slot owns a page for its PRP list.
+    Vector<Request> m_requests;
+    u8* m_prp_lists = nullptr;
+
+    WaitQueue m_wait_queue;
+};
+
+}
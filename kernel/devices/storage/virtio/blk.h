@@ -0,0 +1,53 @@
+#pragma once
+
+#include <kernel/virtio/virtio.h>
+
+namespace kernel::virtio {
+
+// Section 5.2.3
+#define VIRTIO_BLK_F_SIZE_MAX ((u64)1 << 1)
+#define VIRTIO_BLK_F_SEG_MAX  ((u64)1 << 2)
+#define VIRTIO_BLK_F_FLUSH    ((u64)1 << 9)
+#define VIRTIO_BLK_F_MQ       ((u64)1 << 12)
+#define VIRTIO_BLK_F_DISCARD  ((u64)1 << 13)
+
+// Section 5.2.4
+enum class BlockDeviceConfig : u32 {
+    Capacity = 0x00, // u64, in 512 byte sectors
+    SizeMax = 0x08,
+    SegMax = 0x0C,
+    NumQueues = 0x22,
+    MaxDiscardSectors = 0x24,
+    MaxDiscardSegments = 0x28,
+};
+
+// Section 5.2.6
+enum class BlockRequestType : u32 {
+    In = 0,
+    Out = 1,
+    Flush = 4,
+    Discard = 11,
+};
+
+enum class BlockStatus : u8 {
+    Ok = 0,
+    IOError = 1,
+    Unsupported = 2,
+};
+
+// Precedes the data of every request, the device answers with a single status byte after it
+struct BlockRequestHeader {
+    BlockRequestType type;
+    u32 reserved;
+    u64 sector;
+} PACKED;
+
+struct BlockDiscardSegment {
+    u64 sector;
+    u32 sectors;
+    u32 flags;
+} PACKED;
+
+constexpr size_t BLOCK_SECTOR_SIZE = 512;
+
+}
@@ -0,0 +1,405 @@
+#include <kernel/devices/storage/virtio/controller.h>
+#include <kernel/devices/storage/virtio/device.h>
+#include <kernel/memory/manager.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/arch/processor.h>
+#include <kernel/sync/lock.h>
+
+#include <std/format.h>
+
+namespace kernel {
+
+using namespace virtio;
+
+// The header and status come on top of the segments
+static_assert(VirtIOBlockController::MAX_SEGMENTS + 2 <= Queue::MAX_INDIRECT_DESCRIPTORS);
+
+RefPtr<StorageController> VirtIOBlockController::create(pci::Device device) {
+    if (!device.is_virtio_device() || device.device_id() != pci_device_type(DeviceType::BlockDevice)) {
+        return nullptr;
+    }
+
+    auto* controller = new VirtIOBlockController(device);
+
+    auto result = controller->initialize();
+    if (result.is_err()) {
+        dbgln("VirtIOBlockController: Failed to initialize the device: {}", result.error().code());
+
+        controller->disable_irq();
+        delete controller;
+
+        return nullptr;
+    }
+
+    return RefPtr<StorageController>(controller);
+}
+
+VirtIOBlockController::VirtIOBlockController(pci::Device device) : virtio::Device(device) {}
+
+ErrorOr<void> VirtIOBlockController::initialize() {
+    m_device_config = get_config(Configuration::Device);
+
+    u64 features = this->features();
+    u64 accepted = features & (VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_FLUSH | VIRTIO_BLK_F_DISCARD);
+
+    u16 num_queues = 1;
+    if (std::has_flag(features, VIRTIO_BLK_F_MQ)) {
+        num_queues = m_device_config->read<u16>(to_underlying(BlockDeviceConfig::NumQueues));
+        if (num_queues > 1) {
+            accepted |= VIRTIO_BLK_F_MQ;
+        } else {
+            num_queues = 1;
+        }
+    }
+
+    TRY(this->set_accepted_features(accepted));
+    accepted = this->accepted_features();
+
+    u32 capacity_low = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::Capacity));
+    u32 capacity_high = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::Capacity) + 4);
+
+    m_capacity = (static_cast<u64>(capacity_high) << 32) | capacity_low;
+
+    if (std::has_flag(accepted, VIRTIO_BLK_F_SIZE_MAX)) {
+        u32 size_max = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::SizeMax));
+        if (size_max >= BLOCK_SECTOR_SIZE) {
+            m_max_segment_size = std::min<size_t>(size_max, PAGE_SIZE);
+        }
+    }
+
+    if (std::has_flag(accepted, VIRTIO_BLK_F_SEG_MAX)) {
+        u32 seg_max = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::SegMax));
+        if (seg_max) {
+            m_max_segments = std::min<size_t>(seg_max, MAX_SEGMENTS);
+        }
+    }
+
+    m_has_flush = std::has_flag(accepted, VIRTIO_BLK_F_FLUSH);
+    if (std::has_flag(accepted, VIRTIO_BLK_F_DISCARD)) {
+        m_max_discard_sectors = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::MaxDiscardSectors));
+        m_has_discard = m_max_discard_sectors != 0;
+    }
+
+    // Every CPU gets a queue of its own for as long as the device has enough of them
+    size_t queue_count = std::min(std::min<size_t>(num_queues, Processor::count()), MAX_QUEUES);
+    TRY(this->setup_queues(queue_count));
+
+    m_queues.reserve(queue_count);
+    for (size_t i = 0; i < queue_count; i++) {
+        auto queue = OwnPtr<RequestQueue>(new RequestQueue());
+        queue->queue = &this->queue(i);
+
+        // Without indirect descriptors a request takes up one descriptor per segment plus the header and status
+        if (!queue->queue->has_indirect_descriptors()) {
+            m_max_segments = std::min<size_t>(m_max_segments, queue->queue->size() - 2);
+        }
+
+        static_assert(sizeof(RequestBuffer) * REQUEST_SLOTS <= PAGE_SIZE, "Request buffers must fit a single page");
+        queue->buffers = reinterpret_cast<RequestBuffer*>(TRY(MM->allocate_dma_region(PAGE_SIZE)));
+        queue->address = MM->get_physical_address(queue->buffers);
+
+        queue->descriptor_requests.resize(queue->queue->size());
+        for (auto& request : queue->descriptor_requests) {
+            request = NO_REQUEST;
+        }
+
+        m_queues.append(move(queue));
+    }
+
+    if (m_max_segments < 2) {
+        return Error(ENODEV);
+    }
+
+    // A buffer that doesn't start on a page boundary spills over into one more page than its size suggests
+    m_max_transfer_size = std::min((m_max_segments - 1) * m_max_segment_size, MAX_TRANSFER_SIZE);
+    m_max_transfer_size = std::align_down(m_max_transfer_size, BLOCK_SECTOR_SIZE);
+
+    m_bounce_buffer = reinterpret_cast<u8*>(TRY(MM->allocate_dma_region(MAX_TRANSFER_SIZE)));
+    m_device = VirtIOBlockDevice::create(this);
+
+    this->post_init();
+
+    dbgln();
+    dbgln("VirtIO Block Device:");
+    dbgln(" - Capacity: {} sectors", m_capacity);
+    dbgln(" - Request queues: {} (device has {})", queue_count, num_queues);
+    dbgln(" - Max segments: {} of up to {} bytes", m_max_segments, m_max_segment_size);
+    dbgln(" - Supports flush: {}", m_has_flush);
+    dbgln(" - Supports discard: {}", m_has_discard);
+
+    return {};
+}
+
+RefPtr<StorageDevice> VirtIOBlockController::device(size_t index) const {
+    if (index != 0) {
+        return nullptr;
+    }
+
+    return m_device;
+}
+
+VirtIOBlockController::RequestQueue& VirtIOBlockController::request_queue() {
+    return *m_queues[Processor::instance().id() % m_queues.size()];
+}
+
+bool VirtIOBlockController::append_segments(
+    Vector<Segment>& segments, PinnedPages& pins, void const* buffer, size_t size, bool writable
+) const {
+    FlatPtr address = reinterpret_cast<FlatPtr>(buffer);
+    while (size > 0) {
+        // Pages that are yet to be faulted in or copied on write have to go through the bounce buffer
+        auto physical = pins.pin(reinterpret_cast<void const*>(address), writable);
+        if (!physical.has_value()) {
+            return false;
+        }
+
+        size_t offset = address % PAGE_SIZE;
+        size_t length = std::min(std::min(size, PAGE_SIZE - offset), m_max_segment_size);
+
+        if (!segments.empty()) {
+            auto& last = segments.last();
+            if (last.address.offset(last.length) == physical.value() && last.length + length <= m_max_segment_size) {
+                last.length += length;
+
+                address += length;
+                size -= length;
+
+                continue;
+            }
+        }
+
+        if (segments.size() >= m_max_segments) {
+            return false;
+        }
+
+        segments.append({ physical.value(), length });
+
+        address += length;
+        size -= length;
+    }
+
+    return true;
+}
+
+ErrorOr<void> VirtIOBlockController::read(u64 sector, Vector<Segment> const& segments) {
+    return this->submit(BlockRequestType::In, sector, segments);
+}
+
+ErrorOr<void> VirtIOBlockController::write(u64 sector, Vector<Segment> const& segments) {
+    return this->submit(BlockRequestType::Out, sector, segments);
+}
+
+ErrorOr<void> VirtIOBlockController::read_bounced(u64 sector, void* buffer, size_t size) {
+    if (size > m_max_transfer_size) {
+        return Error(EINVAL);
+    }
+
+    ScopedLock lock(m_bounce_lock);
+
+    Vector<Segment> segments;
+    PinnedPages pins;
+
+    bool fits = this->append_segments(segments, pins, m_bounce_buffer, size, true);
+
+    ASSERT(fits, "Bounce buffer must fit a single request");
+
+    TRY(this->submit(BlockRequestType::In, sector, segments));
+    memcpy(buffer, m_bounce_buffer, size);
+
+    return {};
+}
+
+ErrorOr<void> VirtIOBlockController::write_bounced(u64 sector, void const* buffer, size_t size) {
+    if (size > m_max_transfer_size) {
+        return Error(EINVAL);
+    }
+
+    ScopedLock lock(m_bounce_lock);
+
+    Vector<Segment> segments;
+    PinnedPages pins;
+
+    bool fits = this->append_segments(segments, pins, m_bounce_buffer, size, false);
+
+    ASSERT(fits, "Bounce buffer must fit a single request");
+
+    memcpy(m_bounce_buffer, buffer, size);
+    return this->submit(BlockRequestType::Out, sector, segments);
+}
+
+ErrorOr<void> VirtIOBlockController::flush() {
+    // Without VIRTIO_BLK_F_FLUSH the device writes through and there is nothing to wait for
+    if (!m_has_flush) {
+        return {};
+    }
+
+    return this->submit(BlockRequestType::Flush, 0, {});
+}
+
+ErrorOr<void> VirtIOBlockController::discard(u64 sector, u64 sectors) {
+    if (!m_has_discard) {
+        return Error(EOPNOTSUPP);
+    } else if (sector + sectors > m_capacity) {
+        return Error(EINVAL);
+    }
+
+    // Every request describes a single range, its segment lives in the request buffer right after the header
+    while (sectors > 0) {
+        u32 count = std::min<u64>(sectors, m_max_discard_sectors);
+        TRY(this->submit(BlockRequestType::Discard, sector, {}, count));
+
+        sector += count;
+        sectors -= count;
+    }
+
+    return {};
+}
+
+Optional<size_t> VirtIOBlockController::try_submit(
+    RequestQueue& queue, BlockRequestType type, u64 sector, Vector<Segment> const& segments, u32 discard_sectors
+) {
+    bool discard = type == BlockRequestType::Discard;
+    size_t buffers = discard ? 1 : segments.size();
+
+    bool indirect = queue.queue->has_indirect_descriptors() && buffers > 0;
+    if (queue.queue->free_descriptors() < (indirect ? 1 : buffers + 2)) {
+        return {};
+    }
+
+    for (size_t i = 0; i < REQUEST_SLOTS; i++) {
+        auto& request = queue.requests[i];
+        if (request.in_use) {
+            continue;
+        }
+
+        auto& buffer = queue.buffers[i];
+        auto physical_address = [&](void* field) {
+            return queue.address.offset(reinterpret_cast<u8*>(field) - reinterpret_cast<u8*>(queue.buffers));
+        };
+
+        buffer.header.type = type;
+        buffer.header.reserved = 0;
+        buffer.header.sector = discard ? 0 : sector;
+        buffer.status = 0xFF;
+
+        request = { true, false, BlockStatus::Ok };
+
+        auto chain = queue.queue->create_chain(indirect);
+        chain.add_buffer(physical_address(&buffer.header), sizeof(BlockRequestHeader), false);
+
+        if (discard) {
+            buffer.discard = { sector, discard_sectors, 0 };
+            chain.add_buffer(physical_address(&buffer.discard), sizeof(BlockDiscardSegment), false);
+        } else {
+            for (auto& segment : segments) {
+                chain.add_buffer(segment.address, segment.length, type == BlockRequestType::In);
+            }
+        }
+
+        chain.add_buffer(physical_address(&buffer.status), sizeof(u8), true);
+        queue.descriptor_requests[chain.start()] = i;
+
+        chain.submit();
+        if (queue.queue->should_notify()) {
+            MUST(this->notify(queue.queue->index()));
+        }
+
+        return i;
+    }
+
+    return {};
+}
+
+ErrorOr<void> VirtIOBlockController::submit(
+    BlockRequestType type, u64 sector, Vector<Segment> const& segments, u32 discard_sectors
+) {
+    auto& queue = this->request_queue();
+
+    WaitQueueBlocker blocker;
+    {
+        arch::InterruptDisabler disabler;
+        queue.wait_queue.add(&blocker);
+    }
+
+    Optional<size_t> index;
+    while (true) {
+        blocker.reset();
+        {
+            arch::InterruptDisabler disabler;
+            this->complete_requests(queue);
+
+            if (!index.has_value()) {
+                index = this->try_submit(queue, type, sector, segments, discard_sectors);
+            }
+
+            if (index.has_value() && queue.requests[index.value()].done) {
+                break;
+            }
+        }
+
+        blocker.wait();
+    }
+
+    arch::InterruptDisabler disabler;
+    queue.wait_queue.remove(&blocker);
+
+    auto& request = queue.requests[index.value()];
+    auto status = request.status;
+
+    // Whoever waits for a free slot was only woken up when this one completed, not now that it's actually free
+    request.in_use = false;
+    queue.wait_queue.wake_all();
+
+    switch (status) {
+        case BlockStatus::Ok:
+            return {};
+        case BlockStatus::Unsupported:
+            return Error(EOPNOTSUPP);
+        default:
+            return Error(EIO);
+    }
+}
+
+void VirtIOBlockController::complete_requests(RequestQueue& queue) {
+    bool completed = false;
+
+    while (queue.queue->has_available_data()) {
+        auto chain = queue.queue->dequeue();
+
+        u8 index = queue.descriptor_requests[chain.start()];
+        queue.descriptor_requests[chain.start()] = NO_REQUEST;
+
+        chain.release();
+        if (index == NO_REQUEST) {
+            continue;
+        }
+
+        auto& request = queue.requests[index];
+        request.status = static_cast<BlockStatus>(queue.buffers[index].status);
+        request.done = true;
+
+        completed = true;
+    }
+
+    if (completed) {
+        queue.wait_queue.wake_all();
+    }
+}
+
+void VirtIOBlockController::handle_queue_irq(virtio::Queue& queue) {
+    if (queue.index() < m_queues.size()) {
+        this->complete_requests(*m_queues[queue.index()]);
+    }
+}
+
+void VirtIOBlockController::handle_config_change() {
+    u32 capacity_low = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::Capacity));
+    u32 capacity_high = m_device_config->read<u32>(to_underlying(BlockDeviceConfig::Capacity) + 4);
+
+    u64 capacity = (static_cast<u64>(capacity_high) << 32) | capacity_low;
+    if (capacity != m_capacity) {
+        dbgln("VirtIO Block Device: Capacity changed from {} to {} sectors, ignoring", m_capacity, capacity);
+    }
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/virtio/device.h>
+#include <kernel/devices/storage/controller.h>
+#include <kernel/devices/storage/virtio/blk.h>
+#include <kernel/process/wait_queue.h>
+#include <kernel/sync/mutex.h>
+#include <kernel/pci/pci.h>
+#include <kernel/memory/manager.h>
+
+#include <std/memory.h>
+#include <std/optional.h>
+#include <std/vector.h>
+
+namespace kernel {
+
+class VirtIOBlockDevice;
+
+// https://docs.oasis-open.org/virtio/virtio/v1.2/virtio-v1.2.html (section 5.2)
+class VirtIOBlockController : public StorageController, public virtio::Device {
+public:
+    // Requests that may be in flight on a single queue, each one owns a slot for its header and status
+    static constexpr size_t REQUEST_SLOTS = 64;
+
+    // We don't set up more queues than this, even if the device offers them
+    static constexpr size_t MAX_QUEUES = 16;
+
+    // Upper bound for the data of a single request, also the size of the bounce buffer
+    static constexpr size_t MAX_TRANSFER_SIZE = 128 * KB;
+    static constexpr size_t MAX_SEGMENTS = 64;
+
+    struct Segment {
+        PhysicalAddress address;
+        size_t length;
+    };
+
+    static RefPtr<StorageController> create(pci::Device);
+
+    RefPtr<StorageDevice> device(size_t index) const override;
+    size_t devices() const override { return 1; }
+
+    u64 capacity() const { return m_capacity; }
+    size_t max_transfer_size() const { return m_max_transfer_size; }
+
+    // Appends the physical pages behind `buffer`, fails if any of them isn't mapped (writable, if `writable` is set)
+    // or the request would end up with more segments than the device takes. The pages stay pinned by `pins`, which
+    // has to outlive the request.
+    bool append_segments(
+        Vector<Segment>& segments, PinnedPages& pins, void const* buffer, size_t size, bool writable
+    ) const;
+
+    ErrorOr<void> read(u64 sector, Vector<Segment> const& segments);
+    ErrorOr<void> write(u64 sector, Vector<Segment> const& segments);
+
+    // For buffers whose pages can't be handed to the device directly
+    ErrorOr<void> read_bounced(u64 sector, void* buffer, size_t size);
+    ErrorOr<void> write_bounced(u64 sector, void const* buffer, size_t size);
+
+    ErrorOr<void> flush();
+    ErrorOr<void> discard(u64 sector, u64 sectors);
+
+private:
+    struct Request {
+        bool in_use = false;
+        bool done = false;
+        virtio::BlockStatus status = virtio::BlockStatus::Ok;
+    };
+
+    // Everything the device reads or writes besides the data itself
+    struct RequestBuffer {
+        virtio::BlockRequestHeader header;
+        virtio::BlockDiscardSegment discard;
+        u8 status;
+    };
+
+    // One per CPU, so that submitting never has to wait for another CPU
+    struct RequestQueue {
+        virtio::Queue* queue;
+
+        RequestBuffer* buffers;
+        PhysicalAddress address;
+
+        Request requests[REQUEST_SLOTS];
+        Vector<u8> descriptor_requests; // What the chain starting at a descriptor belongs to
+
+        WaitQueue wait_queue;
+    };
+
+    static constexpr u8 NO_REQUEST = 0xFF;
+
+    VirtIOBlockController(pci::Device);
+
+    ErrorOr<void> initialize();
+
+    void handle_queue_irq(virtio::Queue&) override;
+    void handle_config_change() override;
+
+    RequestQueue& request_queue();
+
+    // Queues a request and blocks until the device is done with it. Discards carry no segments, only `discard_sectors`.
+    ErrorOr<void> submit(virtio::BlockRequestType, u64 sector, Vector<Segment> const& segments, u32 discard_sectors = 0);
+    Optional<size_t> try_submit(
+        RequestQueue&, virtio::BlockRequestType, u64 sector, Vector<Segment> const& segments, u32 discard_sectors
+    );
+
+    // Marks every request the device is done with as such. Interrupts must be disabled.
+    void complete_requests(RequestQueue&);
+
+    RefPtr<VirtIOBlockDevice> m_device;
+
+    virtio::Configuration* m_device_config = nullptr;
+    Vector<OwnPtr<RequestQueue>> m_queues;
+
+    u64 m_capacity = 0;
+
+    size_t m_max_segments = MAX_SEGMENTS;
+    size_t m_max_segment_size = PAGE_SIZE;
+    size_t m_max_transfer_size = MAX_TRANSFER_SIZE;
+
+    u32 m_max_discard_sectors = 0;
+
+    bool m_has_flush = false;
+    bool m_has_discard = false;
+
+    Mutex m_bounce_lock;
+    u8* m_bounce_buffer = nullptr;
+};
+
+}
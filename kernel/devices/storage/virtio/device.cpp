@@ -0,0 +1,87 @@
+#include <kernel/devices/storage/virtio/device.h>
+
+namespace kernel {
+
+size_t VirtIOBlockDevice::max_io_block_count() const {
+    return m_controller->max_transfer_size() / block_size();
+}
+
+ErrorOr<bool> VirtIOBlockDevice::read_blocks(void* buffer, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    Vector<VirtIOBlockController::Segment> segments;
+    PinnedPages pins;
+
+    if (!m_controller->append_segments(segments, pins, buffer, count * block_size(), true)) {
+        TRY(m_controller->read_bounced(block, buffer, count * block_size()));
+        return true;
+    }
+
+    TRY(m_controller->read(block, segments));
+    return true;
+}
+
+ErrorOr<bool> VirtIOBlockDevice::write_blocks(const void* buffer, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    Vector<VirtIOBlockController::Segment> segments;
+    PinnedPages pins;
+
+    if (!m_controller->append_segments(segments, pins, buffer, count * block_size(), false)) {
+        TRY(m_controller->write_bounced(block, buffer, count * block_size()));
+        return true;
+    }
+
+    TRY(m_controller->write(block, segments));
+    return true;
+}
+
+ErrorOr<bool> VirtIOBlockDevice::read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    Vector<VirtIOBlockController::Segment> segments;
+    PinnedPages pins;
+
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (!m_controller->append_segments(segments, pins, iov[i].iov_base, iov[i].iov_len, true)) {
+            return BlockDevice::read_blocks_vectored(iov, iovcnt, count, block);
+        }
+    }
+
+    TRY(m_controller->read(block, segments));
+    return true;
+}
+
+ErrorOr<bool> VirtIOBlockDevice::write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) {
+    if (count > this->max_io_block_count()) {
+        return Error(EINVAL);
+    }
+
+    Vector<VirtIOBlockController::Segment> segments;
+    PinnedPages pins;
+
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (!m_controller->append_segments(segments, pins, iov[i].iov_base, iov[i].iov_len, false)) {
+            return BlockDevice::write_blocks_vectored(iov, iovcnt, count, block);
+        }
+    }
+
+    TRY(m_controller->write(block, segments));
+    return true;
+}
+
+ErrorOr<void> VirtIOBlockDevice::flush() {
+    return m_controller->flush();
+}
+
+ErrorOr<void> VirtIOBlockDevice::discard(size_t count, size_t block) {
+    return m_controller->discard(block, count);
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <kernel/devices/storage/device.h>
+#include <kernel/devices/storage/virtio/controller.h>
+
+namespace kernel {
+
+class VirtIOBlockDevice : public StorageDevice {
+public:
+    static RefPtr<VirtIOBlockDevice> create(VirtIOBlockController* controller) {
+        return Device::create<VirtIOBlockDevice>(controller);
+    }
+
+    size_t max_io_block_count() const override;
+
+    ErrorOr<bool> read_blocks(void* buffer, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks(const void* buffer, size_t count, size_t block) override;
+
+    // The pages behind the iovecs are handed to the device as they are, unless one of them can't be
+    ErrorOr<bool> read_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+    ErrorOr<bool> write_blocks_vectored(const iovec* iov, size_t iovcnt, size_t count, size_t block) override;
+
+    ErrorOr<void> flush() override;
+    ErrorOr<void> discard(size_t count, size_t block) override;
+
+    Type type() const override { return VirtIO; }
+
+private:
+    friend class Device;
+
+    VirtIOBlockDevice(VirtIOBlockController* controller) : StorageDevice(virtio::BLOCK_SECTOR_SIZE), m_controller(controller) {
+        m_max_addressable_block = controller->capacity();
+    }
+
+    VirtIOBlockController* m_controller;
+};
+
+}
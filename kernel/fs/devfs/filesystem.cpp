@@ -33,6 +33,7 @@ void init() {
 
     MUST(mknod("null", S_IFCHR, Device::encode(1, 1)));
     MUST(mknod("zero", S_IFCHR, Device::encode(1, 2)));
+    MUST(mknod("kmsg", S_IFCHR, Device::encode(1, 4)));
     MUST(mknod("ptmx", S_IFCHR, Device::encode(99, 0)));
 
     auto* process = Process::create_kernel_process("Device Poller", poll);
@@ -0,0 +1,140 @@
+#include <kernel/fs/epoll.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/posix/poll.h>
+
+namespace kernel::fs {
+
+EPoll::Item::Item(EPoll* epoll, RefPtr<FileDescriptor> descriptor, epoll_event const& event)
+    : epoll(epoll), descriptor(move(descriptor)), event(event) {
+    this->descriptor->file()->wait_queue().add(this);
+}
+
+EPoll::Item::~Item() {
+    descriptor->file()->wait_queue().remove(this);
+}
+
+EPoll::~EPoll() {
+    for (auto& [_, item] : m_items) {
+        delete item;
+    }
+}
+
+void EPoll::on_item_ready(Item* item) {
+    // This can be called from IRQ context, `add` reserves enough space in the ready list so this never allocates
+    if (item->is_ready) {
+        return;
+    }
+
+    item->is_ready = true;
+    m_ready.append(item);
+
+    this->notify_readiness();
+}
+
+ErrorOr<void> EPoll::add(int fd, RefPtr<FileDescriptor> descriptor, epoll_event const& event) {
+    if (m_items.contains(fd)) {
+        return Error(EEXIST);
+    } else if (descriptor->file() == this) {
+        return Error(EINVAL);
+    }
+
+    {
+        arch::InterruptDisabler disabler;
+        m_ready.reserve(m_items.size() + 1);
+    }
+
+    auto* item = new Item(this, move(descriptor), event);
+    m_items.set(fd, item);
+
+    arch::InterruptDisabler disabler;
+    if (item->descriptor->poll(event.events)) {
+        this->on_item_ready(item);
+    }
+
+    return {};
+}
+
+ErrorOr<void> EPoll::modify(int fd, epoll_event const& event) {
+    auto item = m_items.get(fd);
+    if (!item.has_value()) {
+        return Error(ENOENT);
+    }
+
+    arch::InterruptDisabler disabler;
+    item.value()->event = event;
+
+    if (item.value()->descriptor->poll(event.events)) {
+        this->on_item_ready(item.value());
+    }
+
+    return {};
+}
+
+ErrorOr<void> EPoll::remove(int fd) {
+    auto item = m_items.get(fd);
+    if (!item.has_value()) {
+        return Error(ENOENT);
+    }
+
+    {
+        arch::InterruptDisabler disabler;
+        m_ready.remove(item.value());
+    }
+
+    m_items.remove(fd);
+    delete item.value();
+
+    return {};
+}
+
+size_t EPoll::collect_ready_events(epoll_event* events, size_t max_events) {
+    arch::InterruptDisabler disabler;
+
+    size_t count = 0;
+    size_t index = 0;
+
+    while (index < m_ready.size() && count < max_events) {
+        Item* item = m_ready[index];
+
+        u32 revents = item->descriptor->poll(item->event.events);
+        if (revents) {
+            events[count++] = { revents, item->event.data };
+        }
+
+        // Level-triggered items stay on the ready list for as long as they are ready
+        if (!revents || (item->event.events & EPOLLET)) {
+            item->is_ready = false;
+            m_ready.remove(item);
+        } else {
+            index++;
+        }
+    }
+
+    return count;
+}
+
+ErrorOr<size_t> EPoll::wait(epoll_event* events, size_t max_events, int timeout) {
+    if (timeout == 0) {
+        return this->collect_ready_events(events, max_events);
+    }
+
+    WaitQueueBlocker blocker = timeout > 0 ? WaitQueueBlocker(Duration::from_milliseconds(timeout)) : WaitQueueBlocker();
+    this->wait_queue().add(&blocker);
+
+    size_t count = 0;
+    while (true) {
+        blocker.reset();
+
+        count = this->collect_ready_events(events, max_events);
+        if (count || blocker.has_timed_out()) {
+            break;
+        }
+
+        blocker.wait();
+    }
+
+    this->wait_queue().remove(&blocker);
+    return count;
+}
+
+}
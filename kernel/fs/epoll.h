@@ -0,0 +1,63 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/fs/file.h>
+#include <kernel/fs/fd.h>
+#include <kernel/posix/sys/epoll.h>
+
+#include <std/hash_map.h>
+#include <std/vector.h>
+
+namespace kernel::fs {
+
+// An epoll instance. Every watched file gets an entry in its wait queue that moves it onto the ready list when it
+// notifies, so `wait` only ever looks at files that actually changed state. Events are level-triggered unless EPOLLET is set.
+class EPoll : public File {
+public:
+    static RefPtr<EPoll> create() {
+        return RefPtr<EPoll>(new EPoll());
+    }
+
+    ~EPoll() override;
+
+    ErrorOr<size_t> read(void*, size_t, size_t) override { return Error(EINVAL); }
+    ErrorOr<size_t> write(const void*, size_t, size_t) override { return Error(EINVAL); }
+
+    size_t size() const override { return 0; }
+
+    bool can_read(FileDescriptor const&) const override { return !m_ready.empty(); }
+    bool can_write(FileDescriptor const&) const override { return false; }
+
+    bool is_epoll() const override { return true; }
+
+    ErrorOr<void> add(int fd, RefPtr<FileDescriptor>, epoll_event const&);
+    ErrorOr<void> modify(int fd, epoll_event const&);
+    ErrorOr<void> remove(int fd);
+
+    // A negative timeout blocks until at least one event is available
+    ErrorOr<size_t> wait(epoll_event* events, size_t max_events, int timeout);
+
+private:
+    struct Item : public WaitQueue::Entry {
+        Item(EPoll* epoll, RefPtr<FileDescriptor> descriptor, epoll_event const& event);
+        ~Item() override;
+
+        void wake() override { epoll->on_item_ready(this); }
+
+        EPoll* epoll;
+        RefPtr<FileDescriptor> descriptor;
+        epoll_event event;
+
+        bool is_ready = false;
+    };
+
+    EPoll() = default;
+
+    void on_item_ready(Item*);
+    size_t collect_ready_events(epoll_event* events, size_t max_events);
+
+    HashMap<int, Item*> m_items;
+    Vector<Item*> m_ready;
+};
+
+}
@@ -2,6 +2,7 @@
 #include <kernel/serial.h>
 #include <kernel/posix/errno.h>
 #include <kernel/posix/unistd.h>
+#include <kernel/posix/poll.h>
 
 #include <std/format.h>
 
@@ -35,6 +36,44 @@ ErrorOr<size_t> FileDescriptor::write(const void* buffer, size_t size) {
     return nwritten;
 }
 
+ErrorOr<size_t> FileDescriptor::readv(const iovec* iov, int iovcnt) {
+    if (!this->is_readable()) {
+        return Error(EBADF);
+    }
+
+    size_t nread = TRY(m_file->readv(iov, iovcnt, m_offset));
+    m_offset += nread;
+
+    return nread;
+}
+
+ErrorOr<size_t> FileDescriptor::writev(const iovec* iov, int iovcnt) {
+    if (!this->is_writable()) {
+        return Error(EBADF);
+    }
+
+    size_t nwritten = TRY(m_file->writev(iov, iovcnt, m_offset));
+    m_offset += nwritten;
+
+    return nwritten;
+}
+
+ErrorOr<size_t> FileDescriptor::pread(void* buffer, size_t size, size_t offset) {
+    if (!this->is_readable()) {
+        return Error(EBADF);
+    }
+
+    return m_file->read(buffer, size, offset);
+}
+
+ErrorOr<size_t> FileDescriptor::pwrite(const void* buffer, size_t size, size_t offset) {
+    if (!this->is_writable()) {
+        return Error(EBADF);
+    }
+
+    return m_file->write(buffer, size, offset);
+}
+
 bool FileDescriptor::is_readable() const {
     return m_options & O_RDONLY || m_options & O_RDWR;
 }
@@ -43,6 +82,19 @@ bool FileDescriptor::is_writable() const {
     return m_options & O_WRONLY || m_options & O_RDWR;
 }
 
+u32 FileDescriptor::poll(u32 events) const {
+    u32 revents = 0;
+    if ((events & POLLIN) && m_file->can_read(*this)) {
+        revents |= POLLIN;
+    }
+
+    if ((events & POLLOUT) && m_file->can_write(*this)) {
+        revents |= POLLOUT;
+    }
+
+    return revents;
+}
+
 void FileDescriptor::seek(off_t offset, int whence) {
     switch (whence) {
         case SEEK_SET:
@@ -38,10 +38,20 @@ public:
 
     bool is_readable() const;
     bool is_writable() const;
+
+    // Returns the subset of `events` (POLLIN/POLLOUT) the file is currently ready for
+    u32 poll(u32 events) const;
     
     ErrorOr<size_t> read(void* buffer, size_t size);
     ErrorOr<size_t> write(const void* buffer, size_t size);
 
+    ErrorOr<size_t> readv(const iovec* iov, int iovcnt);
+    ErrorOr<size_t> writev(const iovec* iov, int iovcnt);
+
+    // Positional variants that neither use nor update the shared file offset
+    ErrorOr<size_t> pread(void* buffer, size_t size, size_t offset);
+    ErrorOr<size_t> pwrite(const void* buffer, size_t size, size_t offset);
+
     void seek(off_t offset, int whence);
 
     void close();
@@ -6,6 +6,34 @@
 
 namespace kernel::fs {
 
+ErrorOr<size_t> File::readv(const iovec* iov, int iovcnt, size_t offset) {
+    size_t nread = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size_t n = TRY(this->read(iov[i].iov_base, iov[i].iov_len, offset + nread));
+        nread += n;
+
+        if (n < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    return nread;
+}
+
+ErrorOr<size_t> File::writev(const iovec* iov, int iovcnt, size_t offset) {
+    size_t nwritten = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size_t n = TRY(this->write(iov[i].iov_base, iov[i].iov_len, offset + nwritten));
+        nwritten += n;
+
+        if (n < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    return nwritten;
+}
+
 struct stat InodeFile::stat() const {
     return m_inode->stat();
 }
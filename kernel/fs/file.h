@@ -2,6 +2,8 @@
 
 #include <kernel/common.h>
 #include <kernel/posix/sys/stat.h>
+#include <kernel/posix/sys/uio.h>
+#include <kernel/process/wait_queue.h>
 #include <std/result.h>
 #include <std/memory.h>
 
@@ -23,6 +25,10 @@ public:
     virtual ErrorOr<size_t> read(void* buffer, size_t size, size_t offset) = 0;
     virtual ErrorOr<size_t> write(const void* buffer, size_t size, size_t offset) = 0;
 
+    // The default implementations issue one read/write per iovec and stop at the first short transfer
+    virtual ErrorOr<size_t> readv(const iovec* iov, int iovcnt, size_t offset);
+    virtual ErrorOr<size_t> writev(const iovec* iov, int iovcnt, size_t offset);
+
     virtual size_t size() const = 0;
 
     virtual bool can_read(FileDescriptor const&) const = 0;
@@ -34,6 +40,18 @@ public:
     virtual ErrorOr<int> ioctl(unsigned, unsigned) { return Error(ENOTTY); }
 
     virtual ssize_t readdir(void*, size_t) { return -ENOTDIR; }
+
+    virtual bool is_epoll() const { return false; }
+    virtual bool is_socket() const { return false; }
+
+    // Woken whenever `can_read` or `can_write` may have started returning true
+    WaitQueue& wait_queue() { return m_wait_queue; }
+
+protected:
+    void notify_readiness() { m_wait_queue.wake_all(); }
+
+private:
+    WaitQueue m_wait_queue;
 };
 
 class InodeFile : public File {
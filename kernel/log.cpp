@@ -0,0 +1,245 @@
+#include <kernel/log.h>
+#include <kernel/serial.h>
+#include <kernel/arch/processor.h>
+#include <kernel/process/process.h>
+#include <kernel/process/scheduler.h>
+#include <kernel/process/threads.h>
+#include <kernel/devices/gpu/console.h>
+
+#include <std/cstring.h>
+#include <std/utility.h>
+#include <std/format.h>
+
+namespace kernel::log {
+
+static char s_buffer[BUFFER_SIZE];
+
+static u64 s_head = 0;
+static u64 s_drained = 0;
+
+static bool s_draining_asynchronously = false;
+static bool s_panicking = false;
+
+static WaitQueue s_wait_queue;
+
+// Logging has to work from IRQ handlers and before there is a scheduler, so the ring is guarded by turning interrupts
+// off for the few copies that touch it rather than with a lock that could sleep (there is only one CPU for now).
+class Guard {
+public:
+    Guard() : m_state(Processor::instance().interrupt_state()) {
+        Processor::disable_interrupts();
+    }
+
+    ~Guard() {
+        if (m_state == InterruptState::Enabled) {
+            Processor::enable_interrupts();
+        }
+    }
+
+private:
+    InterruptState m_state;
+};
+
+u64 head() {
+    return s_head;
+}
+
+u64 tail() {
+    return s_head > BUFFER_SIZE ? s_head - BUFFER_SIZE : 0;
+}
+
+WaitQueue& wait_queue() {
+    return s_wait_queue;
+}
+
+static void copy_in(const char* str, size_t len) {
+    if (len > BUFFER_SIZE) {
+        str += len - BUFFER_SIZE;
+        s_head += len - BUFFER_SIZE;
+
+        len = BUFFER_SIZE;
+    }
+
+    size_t offset = s_head % BUFFER_SIZE;
+    size_t first = std::min(len, BUFFER_SIZE - offset);
+
+    memcpy(s_buffer + offset, str, first);
+    memcpy(s_buffer, str + first, len - first);
+
+    s_head += len;
+}
+
+// `sequence` has to be within [tail, head]
+static size_t copy_out(u64 sequence, void* buffer, size_t size) {
+    size = std::min<u64>(size, s_head - sequence);
+
+    size_t offset = sequence % BUFFER_SIZE;
+    size_t first = std::min(size, BUFFER_SIZE - offset);
+
+    u8* dst = reinterpret_cast<u8*>(buffer);
+
+    memcpy(dst, s_buffer + offset, first);
+    memcpy(dst + first, s_buffer, size - first);
+
+    return size;
+}
+
+static void write_to_console(const char* str, size_t len) {
+    auto* console = FramebufferConsole::instance();
+    if (console && console->is_enabled()) {
+        console->write(str, len);
+    }
+}
+
+static void write_synchronously(const char* str, size_t len) {
+    if (!serial::is_initialized()) {
+        serial::init();
+    }
+
+    write_to_console(str, len);
+    while (len) {
+        size_t count = serial::try_write(str, len);
+
+        str += count;
+        len -= count;
+    }
+}
+
+// Expects interrupts to be off
+static void drain_synchronously() {
+    s_drained = std::max(s_drained, tail());
+
+    size_t offset = s_drained % BUFFER_SIZE;
+    size_t size = s_head - s_drained;
+    size_t first = std::min(size, BUFFER_SIZE - offset);
+
+    write_synchronously(s_buffer + offset, first);
+    write_synchronously(s_buffer, size - first);
+
+    s_drained = s_head;
+}
+
+void write(const char* str, size_t len) {
+    Guard guard;
+    copy_in(str, len);
+
+    if (!s_draining_asynchronously || s_panicking) {
+        drain_synchronously();
+    }
+
+    s_wait_queue.wake_all();
+}
+
+ErrorOr<size_t> read(u64& sequence, void* buffer, size_t size) {
+    // `buffer` is usually a user buffer which we don't want to touch with interrupts off, so we go through a bounce
+    // buffer and give up on the rest as soon as the writers overtake us.
+    u8 chunk[256];
+
+    u8* dst = reinterpret_cast<u8*>(buffer);
+    size_t total = 0;
+
+    while (total < size) {
+        size_t count = 0;
+        {
+            Guard guard;
+            if (sequence < tail()) {
+                if (total) {
+                    break;
+                }
+
+                sequence = tail();
+                return Error(EPIPE);
+            }
+
+            count = copy_out(sequence, chunk, std::min(size - total, sizeof(chunk)));
+        }
+
+        if (!count) {
+            break;
+        }
+
+        memcpy(dst + total, chunk, count);
+
+        sequence += count;
+        total += count;
+    }
+
+    return total;
+}
+
+static void write_asynchronously(const char* str, size_t len) {
+    write_to_console(str, len);
+
+    // At 38400 baud the FIFO takes about 4ms to empty, no point in spinning on it while other threads could run
+    while (len) {
+        size_t count = serial::try_write(str, len);
+        if (!count) {
+            Thread::current()->sleep(Duration::from_milliseconds(1));
+            continue;
+        }
+
+        str += count;
+        len -= count;
+    }
+}
+
+static void drain() {
+    WaitQueueBlocker blocker;
+    {
+        Guard guard;
+        s_wait_queue.add(&blocker);
+
+        // Set from the thread itself so that anything logged before it first runs is still written out synchronously
+        s_draining_asynchronously = true;
+    }
+
+    char chunk[512];
+    while (true) {
+        blocker.reset();
+
+        u64 dropped = 0;
+        size_t size = 0;
+        {
+            Guard guard;
+            if (s_drained < tail()) {
+                dropped = tail() - s_drained;
+                s_drained = tail();
+            }
+
+            size = copy_out(s_drained, chunk, sizeof(chunk));
+            s_drained += size;
+        }
+
+        if (dropped) {
+            String message = std::format("\n[Kernel Log]: Dropped {} bytes\n", dropped);
+            write_asynchronously(message.data(), message.size());
+        }
+
+        if (!size) {
+            blocker.wait();
+            continue;
+        }
+
+        write_asynchronously(chunk, size);
+    }
+}
+
+void start() {
+    auto* process = Process::create_kernel_process("Kernel Log", drain);
+    Scheduler::add_process(process);
+}
+
+void enter_panic_mode() {
+    Guard guard;
+    s_panicking = true;
+
+    // Whatever userspace had on the screen doesn't matter anymore
+    auto* console = FramebufferConsole::instance();
+    if (console) {
+        console->set_enabled(true);
+    }
+
+    drain_synchronously();
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/process/wait_queue.h>
+
+#include <std/result.h>
+
+// Everything the kernel logs goes into a ring buffer first. Appending never waits on a device, a kernel thread drains
+// the ring to the serial port and the framebuffer console in the background and `/dev/kmsg` readers read it back.
+namespace kernel::log {
+
+constexpr size_t BUFFER_SIZE = 128 * KB;
+
+void write(const char* str, size_t len);
+
+// Bytes are numbered from the start of the boot on, these bound what the ring still has
+u64 head();
+u64 tail();
+
+// Copies what was logged from `sequence` on and advances it. Fails with EPIPE (once) if the writers have overwritten
+// what `sequence` pointed to in the meantime, `sequence` then skips ahead to the oldest byte still there.
+ErrorOr<size_t> read(u64& sequence, void* buffer, size_t size);
+
+// Woken whenever something was appended
+WaitQueue& wait_queue();
+
+// Spawns the thread that drains the ring, until it runs everything is written out synchronously
+void start();
+
+// Writes out whatever hasn't been yet and keeps writing synchronously from here on, for when the kernel is going down
+void enter_panic_mode();
+
+}
@@ -1,6 +1,7 @@
 #include <kernel/common.h>
 #include <kernel/arch/io.h>
 #include <kernel/serial.h>
+#include <kernel/log.h>
 #include <kernel/ctors.h>
 #include <kernel/pci/pci.h>
 #include <kernel/symbols.h>
@@ -27,6 +28,8 @@
 #include <kernel/devices/null.h>
 #include <kernel/devices/zero.h>
 #include <kernel/devices/devctl.h>
+#include <kernel/devices/kmsg.h>
+#include <kernel/devices/gpu/console.h>
 #include <kernel/devices/audio/manager.h>
 #include <kernel/devices/input/mouse.h>
 #include <kernel/devices/gpu/manager.h>
@@ -83,11 +86,14 @@ extern "C" void main(BootInfo const& boot_info) {
     pic::init();
     
     MemoryManager::init();
+    FramebufferConsole::initialize();
+
     ACPIParser::init();
 
     TimeManager::init();
 
     devfs::init();
+    log::start();
 
     Processor::set_interrupts_initialized();
     Processor::enable_interrupts();
@@ -116,6 +122,7 @@ void stage2() {
     NullDevice::create();
     ZeroDevice::create();
     DeviceControl::create();
+    KernelLogDevice::create();
     
     usb::UHCIController::create();
     usb::OHCIController::create();
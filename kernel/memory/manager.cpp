@@ -315,6 +315,26 @@ ErrorOr<void> MemoryManager::free_dma_region(void* ptr, size_t size) {
     return this->free(*m_kernel_region_allocator, ptr, size);
 }
 
+ErrorOr<void*> MemoryManager::allocate_contiguous_dma_region(size_t size, String name) {
+    ScopedLock lock(m_lock);
+
+    size = std::align_up(size, PAGE_SIZE);
+    auto* region = m_kernel_region_allocator->allocate(size, PROT_READ | PROT_WRITE);
+    if (!region) {
+        return Error(ENOMEM);
+    }
+
+    region->set_name(move(name));
+
+    auto* page_directory = m_kernel_region_allocator->page_directory();
+    if (!this->try_allocate_contiguous(page_directory, region, PageFlags::Write | PageFlags::CacheDisable)) {
+        m_kernel_region_allocator->free(region);
+        return Error(ENOMEM);
+    }
+
+    return region->base().to_ptr();
+}
+
 ErrorOr<void*> MemoryManager::map_physical_region(PhysicalAddress address, size_t size) {
     size = std::align_up(size, PAGE_SIZE);
     auto* page_directory = arch::PageDirectory::kernel_page_directory();
@@ -386,6 +406,68 @@ PhysicalAddress MemoryManager::get_physical_address(void* addr) {
     return dir->get_physical_address(VirtualAddress { addr });
 }
 
+Optional<PhysicalAddress> MemoryManager::get_dma_address(void const* ptr, bool writable) {
+    VirtualAddress address { ptr };
+
+    auto physical = arch::PageDirectory::kernel_page_directory()->translate(address, writable);
+    if (physical.has_value()) {
+        return physical;
+    }
+
+    auto* process = Process::current();
+    if (!process) {
+        return {};
+    }
+
+    return process->page_directory()->translate(address, writable);
+}
+
+Optional<PhysicalAddress> MemoryManager::pin_dma_page(void const* ptr, bool writable, bool& pinned) {
+    ScopedLock lock(m_lock);
+
+    pinned = false;
+    auto physical = this->get_dma_address(ptr, writable);
+    if (!physical.has_value()) {
+        return {};
+    }
+
+    PhysicalPage* page = this->get_physical_page(physical->page_base());
+    if (page && page->ref_count) {
+        page->ref_count++;
+        pinned = true;
+    }
+
+    return physical;
+}
+
+void MemoryManager::unpin_page(PhysicalAddress frame) {
+    ScopedLock lock(m_lock);
+
+    PhysicalPage* page = this->get_physical_page(frame);
+    page->ref_count--;
+
+    if (page->ref_count == 0) {
+        MUST(this->free_page_frame(frame.to_ptr()));
+    }
+}
+
+PinnedPages::~PinnedPages() {
+    for (auto& frame : m_frames) {
+        s_mm->unpin_page(frame);
+    }
+}
+
+Optional<PhysicalAddress> PinnedPages::pin(void const* ptr, bool writable) {
+    bool pinned = false;
+
+    auto physical = s_mm->pin_dma_page(ptr, writable, pinned);
+    if (pinned) {
+        m_frames.append(physical->page_base());
+    }
+
+    return physical;
+}
+
 TemporaryMapping::TemporaryMapping(arch::PageDirectory& page_directory, void* ptr, size_t size) : m_size(size) {
     m_ptr = (u8*)MUST(s_mm->map_from_page_directory(&page_directory, ptr, size));
 }
@@ -10,6 +10,8 @@
 #include <kernel/arch/registers.h>
 
 #include <std/result.h>
+#include <std/optional.h>
+#include <std/vector.h>
 
 #define MM kernel::MemoryManager::instance()
 
@@ -99,6 +101,10 @@ public:
     bool is_mapped(void* addr);
     PhysicalAddress get_physical_address(void* addr);
 
+    // For handing memory straight to a device. Looks `ptr` up in the kernel page directory and then in the one of the
+    // current process, pages that are yet to be faulted in (or copied on write, if `writable`) give nothing.
+    Optional<PhysicalAddress> get_dma_address(void const* ptr, bool writable);
+
     ErrorOr<void*> allocate_page_frame();
     ErrorOr<void*> allocate_contiguous_frames(size_t count);
 
@@ -121,6 +127,10 @@ public:
     ErrorOr<void*> allocate_dma_region(size_t size, String name = {});
     ErrorOr<void> free_dma_region(void* ptr, size_t size);
 
+    // Like `allocate_dma_region` but guarantees that the whole region is physically contiguous, for rings that the
+    // hardware only knows by their base address. Freed with `free_dma_region`.
+    ErrorOr<void*> allocate_contiguous_dma_region(size_t size, String name = {});
+
     // Map an already existing physical region into the kernel's address space
     ErrorOr<void*> map_physical_region(PhysicalAddress address, size_t size);
 
@@ -132,6 +142,12 @@ public:
 
     PhysicalPage* get_physical_page(PhysicalAddress address);
 
+    // Like `get_dma_address` but also takes a reference to the frame, which then outlives the mapping until it's given
+    // back with `unpin_page`. `pinned` is left unset for memory whose frames aren't reference counted (e.g. the kernel
+    // image), nothing can free those anyway.
+    Optional<PhysicalAddress> pin_dma_page(void const* ptr, bool writable, bool& pinned);
+    void unpin_page(PhysicalAddress frame);
+
     SpinLock& liballoc_lock() { return m_liballoc_lock; }
     Mutex& lock() { return m_lock; }
 
@@ -153,6 +169,23 @@ private:
     Mutex m_lock;
 };
 
+// Keeps the frames behind memory handed to a device alive until the device is done with it, so that e.g. a process
+// unmapping its buffer in the middle of a transfer can't have them reused underneath the device.
+class PinnedPages {
+public:
+    PinnedPages() = default;
+    ~PinnedPages();
+
+    PinnedPages(PinnedPages const&) = delete;
+    PinnedPages& operator=(PinnedPages const&) = delete;
+
+    // See `MemoryManager::get_dma_address`
+    Optional<PhysicalAddress> pin(void const* ptr, bool writable);
+
+private:
+    Vector<PhysicalAddress> m_frames;
+};
+
 class TemporaryMapping {
 public:
     TemporaryMapping(arch::PageDirectory&, void* ptr, size_t size);
@@ -15,6 +15,9 @@ Region* Region::clone() const {
     region->m_prot = m_prot;
     region->m_file = m_file;
     region->m_name = m_name;
+    region->m_offset = m_offset;
+    region->m_shared = m_shared;
+    region->m_kernel_managed = m_kernel_managed;
 
     return region;
 }
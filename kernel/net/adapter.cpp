@@ -1,44 +1,469 @@
 #include <kernel/net/adapter.h>
 #include <kernel/net/manager.h>
 #include <kernel/net/ethernet.h>
-#include <kernel/arch/interrupts.h>
+#include <kernel/net/checksum.h>
+#include <kernel/net/ip/tcp.h>
+#include <kernel/panic.h>
 
 namespace kernel::net {
 
+void NetworkAdapter::on_packet_receive(RefPtr<PacketBuffer> buffer, size_t size, size_t offset, PacketMetadata const& metadata) {
+    Packet packet { move(buffer), size, offset, metadata };
+    if (!m_receive_queue.try_enqueue(move(packet))) {
+        this->drop_packet();
+        return;
+    }
+
+    NetworkManager::wakeup();
+}
+
 void NetworkAdapter::on_packet_receive(u8 const* data, size_t size) {
-    arch::InterruptDisabler disabler;
+    auto buffer = m_receive_pool ? m_receive_pool->allocate() : nullptr;
+    if (!buffer || size > buffer->capacity()) {
+        this->drop_packet();
+        return;
+    }
 
-    u8* buffer = new u8[size];
-    memcpy(buffer, data, size);
+    memcpy(buffer->data(), data, size);
+    this->on_packet_receive(move(buffer), size);
+}
 
-    Packet packet { buffer, size };
-    m_packets.append(move(packet));
+bool NetworkAdapter::dequeue(Packet& packet) {
+    return m_receive_queue.try_dequeue(packet);
+}
 
+void NetworkAdapter::schedule_poll() {
+    m_poll_scheduled.store(true, std::MemoryOrder::Release);
     NetworkManager::wakeup();
 }
 
-Packet NetworkAdapter::dequeue() {
-    if (m_packets.empty()) {
-        return { nullptr, 0 };
+bool NetworkAdapter::run_poll() {
+    if (!m_poll_scheduled.exchange(false, std::MemoryOrder::Acquire)) {
+        return false;
+    } else if (!this->poll(POLL_BUDGET)) {
+        return false;
     }
 
-    return m_packets.take_first();
+    m_poll_scheduled.store(true, std::MemoryOrder::Relaxed);
+    return true;
 }
 
 void NetworkAdapter::send_packet(u8 const* data, size_t size) {
-    this->send(data, size);
+    PacketFragment fragment { data, size };
+    this->transmit(&fragment, 1, {});
 }
 
 void NetworkAdapter::send(const MACAddress& destination, const ARPPacket& packet) {
-    u8 buffer[sizeof(EthernetFrame) + sizeof(ARPPacket)];
-    auto* frame = reinterpret_cast<EthernetFrame*>(buffer);
+    EthernetFrame frame;
     
+    frame.source = this->mac_address();
+    frame.destination = destination;
+    frame.type = EtherType::ARP;
+
+    PacketFragment fragments[] = {
+        { reinterpret_cast<u8 const*>(&frame), sizeof(EthernetFrame) },
+        { reinterpret_cast<u8 const*>(&packet), sizeof(ARPPacket) }
+    };
+
+    this->transmit(fragments, 2, {});
+}
+
+ErrorOr<void> NetworkAdapter::send_ipv4(IPv4Address destination, u8 protocol, u8 const* payload, size_t size) {
+    PacketFragment fragment { payload, size };
+    return this->send_ipv4(destination, protocol, &fragment, 1);
+}
+
+ErrorOr<void> NetworkAdapter::send_ipv4(
+    IPv4Address destination, u8 protocol, PacketFragment const* fragments, size_t count, PacketMetadata metadata
+) {
+    ASSERT(count < MAX_FRAGMENTS, "Too many fragments for a single frame");
+    ASSERT(!metadata.mss || protocol == IPProtocol::TCP, "Only TCP can be segmented");
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += fragments[i].size;
+    }
+
+    // Each segment has to fit in the MTU on its own, the whole frame only has to fit in the IPv4 length field
+    size_t segments = 1;
+    if (metadata.mss) {
+        if (sizeof(IPv4Packet) + metadata.header_size + metadata.mss > m_mtu || sizeof(IPv4Packet) + size > MAX_GSO_SIZE) {
+            return Error(EMSGSIZE);
+        }
+
+        segments = std::ceil_div(size - metadata.header_size, static_cast<size_t>(metadata.mss));
+    } else if (size + sizeof(IPv4Packet) > MAX_GSO_SIZE) {
+        return Error(EMSGSIZE);
+    }
+
+    // Anything else that doesn't fit the path is fragmented, everything that does is sent with "don't fragment" set
+    // so that routers tell us about smaller links on the way
+    size_t mtu = this->type() == Loopback ? m_mtu : NetworkManager::instance()->path_mtu_cache().lookup(destination, m_mtu);
+    bool needs_fragmentation = !metadata.mss && size + sizeof(IPv4Packet) > mtu;
+
+    // Only the headers are built here, the payload fragments are passed through untouched
+    u8 header[sizeof(EthernetFrame) + sizeof(IPv4Packet)];
+    auto* frame = reinterpret_cast<EthernetFrame*>(header);
+
     frame->source = this->mac_address();
-    frame->destination = destination;
-    frame->type = EtherType::ARP;
+    frame->type = EtherType::IPv4;
+
+    auto* ipv4 = reinterpret_cast<IPv4Packet*>(frame->payload);
+    memset(ipv4, 0, sizeof(IPv4Packet));
+
+    ipv4->version = 4;
+    ipv4->ihl = sizeof(IPv4Packet) / 4;
+    ipv4->length = sizeof(IPv4Packet) + size;
+    ipv4->identification = m_ipv4_identification.fetch_add(segments, std::MemoryOrder::Relaxed);
+    ipv4->flags_and_fragment_offset = needs_fragmentation ? 0 : 0x4000; // Don't fragment
+    ipv4->ttl = 64;
+    ipv4->protocol = protocol;
+    ipv4->source = m_ipv4_address;
+    ipv4->destination = destination;
+    ipv4->checksum = internet_checksum(ipv4, sizeof(IPv4Packet));
+
+    if (needs_fragmentation) {
+        this->send_fragmented(destination, frame, fragments, count, size, metadata, mtu);
+        return {};
+    }
+
+    PacketFragment frame_fragments[MAX_FRAGMENTS];
+    frame_fragments[0] = { header, sizeof(header) };
+
+    for (size_t i = 0; i < count; i++) {
+        frame_fragments[i + 1] = fragments[i];
+    }
+
+    // The caller only knows about its own payload
+    if (metadata.flags & PacketMetadata::NeedsChecksum) {
+        metadata.checksum_start += sizeof(header);
+    }
+
+    if (metadata.mss) {
+        metadata.header_size += sizeof(header);
+    }
+
+    this->send_frame(destination, frame, frame_fragments, count + 1, metadata);
+    return {};
+}
+
+void NetworkAdapter::send_fragmented(
+    IPv4Address destination, EthernetFrame* frame, PacketFragment const* fragments, size_t count, size_t size,
+    PacketMetadata const& metadata, size_t mtu
+) {
+    // The transport checksum covers the whole datagram, so it has to be done before the payload is cut up
+    Vector<u8> payload;
+    payload.resize(size);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(payload.data() + offset, fragments[i].data, fragments[i].size);
+        offset += fragments[i].size;
+    }
+
+    if (metadata.flags & PacketMetadata::NeedsChecksum) {
+        u16 checksum = checksum_finish(checksum_add(0, payload.data() + metadata.checksum_start, size - metadata.checksum_start));
+        if (!checksum) {
+            checksum = 0xFFFF;
+        }
+
+        u8* field = payload.data() + metadata.checksum_start + metadata.checksum_offset;
+        field[0] = checksum >> 8;
+        field[1] = checksum & 0xFF;
+    }
+
+    auto* ipv4 = reinterpret_cast<IPv4Packet*>(frame->payload);
+
+    // Fragment offsets are counted in units of 8 bytes
+    size_t fragment_size = (mtu - sizeof(IPv4Packet)) & ~7ul;
+    TransmitBatch batch(*this);
+
+    for (offset = 0; offset < size; offset += fragment_size) {
+        size_t length = std::min(fragment_size, size - offset);
+        bool more_fragments = offset + length < size;
+
+        ipv4->length = sizeof(IPv4Packet) + length;
+        ipv4->flags_and_fragment_offset = (more_fragments ? 0x2000 : 0) | (offset / 8);
+        ipv4->checksum = 0;
+        ipv4->checksum = internet_checksum(ipv4, sizeof(IPv4Packet));
+
+        PacketFragment frame_fragments[] = {
+            { reinterpret_cast<u8 const*>(frame), sizeof(EthernetFrame) + sizeof(IPv4Packet) },
+            { payload.data() + offset, length }
+        };
+
+        this->send_frame(destination, frame, frame_fragments, 2, {});
+    }
+}
+
+static PendingFrame copy_frame(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += fragments[i].size;
+    }
+
+    PendingFrame pending;
+    pending.data.resize(size);
+    pending.metadata = metadata;
+
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(pending.data.data() + offset, fragments[i].data, fragments[i].size);
+        offset += fragments[i].size;
+    }
+
+    return pending;
+}
+
+void NetworkAdapter::send_frame(
+    IPv4Address destination, EthernetFrame* frame, PacketFragment const* fragments, size_t count, PacketMetadata const& metadata
+) {
+    if (this->resolve(destination, frame->destination)) {
+        this->transmit_with_fallbacks(fragments, count, metadata);
+        return;
+    }
+
+    // The frame has to outlive the caller's buffers while the next hop is being resolved
+    auto pending = copy_frame(fragments, count, metadata);
+    NetworkManager::instance()->arp_cache().enqueue(*this, this->next_hop(destination), move(pending));
+}
+
+IPv4Address NetworkAdapter::next_hop(IPv4Address destination) const {
+    auto route = NetworkManager::instance()->routing_table().lookup(destination);
+    if (!route.has_value() || route->adapter.ptr() != this) {
+        return destination; // Sent through this adapter on purpose, e.g. a reply to where a packet came from
+    }
+
+    return route->next_hop(destination);
+}
+
+bool NetworkAdapter::resolve(IPv4Address destination, MACAddress& mac) {
+    if (this->type() == Loopback) {
+        mac = this->mac_address();
+        return true;
+    }
+
+    // Limited broadcast or the directed broadcast address of our own network
+    bool is_directed_broadcast = !m_ipv4_netmask.is_zero() && (destination & m_ipv4_netmask) == (m_ipv4_address & m_ipv4_netmask) &&
+        (destination.value() | m_ipv4_netmask.value()) == 0xFFFFFFFF;
+    if (destination.is_broadcast() || is_directed_broadcast) {
+        mac = MACAddress::broadcast();
+        return true;
+    }
+
+    return NetworkManager::instance()->arp_cache().lookup(*this, this->next_hop(destination), mac);
+}
 
-    memcpy(&frame->payload[0], &packet, sizeof(ARPPacket));
-    this->send(buffer, sizeof(buffer));
+IPv6Address NetworkAdapter::ipv6_address() const {
+    if (this->type() == Loopback) {
+        return IPv6Address::loopback();
+    }
+
+    return IPv6Address::link_local(m_mac_address);
+}
+
+ErrorOr<void> NetworkAdapter::send_ipv6(
+    IPv6Address destination, u8 next_header, PacketFragment const* fragments, size_t count, u8 hop_limit
+) {
+    if (count >= MAX_FRAGMENTS) {
+        return Error(EINVAL);
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += fragments[i].size;
+    }
+
+    if (size + sizeof(IPv6Packet) > m_mtu) {
+        return Error(EMSGSIZE);
+    }
+
+    u8 header[sizeof(EthernetFrame) + sizeof(IPv6Packet)];
+    auto* frame = reinterpret_cast<EthernetFrame*>(header);
+
+    frame->source = this->mac_address();
+    frame->type = EtherType::IPv6;
+
+    auto* ipv6 = reinterpret_cast<IPv6Packet*>(frame->payload);
+    memset(ipv6, 0, sizeof(IPv6Packet));
+
+    ipv6->version_class_and_flow = 6u << 28;
+    ipv6->payload_length = size;
+    ipv6->next_header = next_header;
+    ipv6->hop_limit = hop_limit;
+    ipv6->source = this->ipv6_address();
+    ipv6->destination = destination;
+
+    PacketFragment frame_fragments[MAX_FRAGMENTS];
+    frame_fragments[0] = { header, sizeof(header) };
+
+    for (size_t i = 0; i < count; i++) {
+        frame_fragments[i + 1] = fragments[i];
+    }
+
+    if (this->resolve(destination, frame->destination)) {
+        this->transmit(frame_fragments, count + 1, {});
+        return {};
+    }
+
+    auto pending = copy_frame(frame_fragments, count + 1, {});
+    NetworkManager::instance()->nd_cache().enqueue(*this, destination, move(pending));
+
+    return {};
+}
+
+bool NetworkAdapter::resolve(IPv6Address destination, MACAddress& mac) {
+    if (this->type() == Loopback) {
+        mac = this->mac_address();
+        return true;
+    } else if (destination.is_multicast()) {
+        mac = destination.multicast_mac();
+        return true;
+    }
+
+    return NetworkManager::instance()->nd_cache().lookup(*this, destination, mac);
+}
+
+void NetworkAdapter::transmit_with_fallbacks(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    if (metadata.mss && !(m_offloads & SegmentationOffload)) {
+        this->segment(fragments, count, metadata);
+    } else if ((metadata.flags & PacketMetadata::NeedsChecksum) && !(m_offloads & ChecksumOffload)) {
+        this->finish_checksum(fragments, count, metadata);
+    } else {
+        this->transmit(fragments, count, metadata);
+    }
+}
+
+size_t NetworkAdapter::split_headers(
+    PacketFragment const* fragments, size_t count, size_t header_size, u8* headers, PacketFragment* payload
+) {
+    size_t copied = 0;
+    size_t payload_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        auto& fragment = fragments[i];
+
+        size_t size = std::min(fragment.size, header_size - copied);
+        memcpy(headers + copied, fragment.data, size);
+        copied += size;
+
+        if (size < fragment.size) {
+            payload[payload_count++] = { fragment.data + size, fragment.size - size };
+        }
+    }
+
+    ASSERT(copied == header_size, "Frame is smaller than its headers");
+    return payload_count;
+}
+
+void NetworkAdapter::finish_checksum(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    size_t header_size = metadata.checksum_start + metadata.checksum_offset + sizeof(u16);
+    ASSERT(header_size <= MAX_HEADER_SIZE, "Checksum field lies outside of the headers");
+
+    // The fragments are read-only, so everything up to the checksum field gets a private copy
+    u8 headers[MAX_HEADER_SIZE];
+    PacketFragment frame[MAX_FRAGMENTS + 1];
+
+    size_t payload_count = split_headers(fragments, count, header_size, headers, frame + 1);
+    frame[0] = { headers, header_size };
+
+    // The field already holds the pseudo header sum, so the sum over the rest of the frame is all that's missing
+    PacketFragment covered[MAX_FRAGMENTS + 1];
+    covered[0] = { headers + metadata.checksum_start, header_size - metadata.checksum_start };
+
+    for (size_t i = 0; i < payload_count; i++) {
+        covered[i + 1] = frame[i + 1];
+    }
+
+    u16 checksum = checksum_finish(checksum_add(0, covered, payload_count + 1));
+
+    // Zero means "no checksum" for UDP, all ones is the same value in ones' complement so TCP doesn't mind either
+    if (!checksum) {
+        checksum = 0xFFFF;
+    }
+
+    u8* field = headers + metadata.checksum_start + metadata.checksum_offset;
+    field[0] = checksum >> 8;
+    field[1] = checksum & 0xFF;
+
+    PacketMetadata finished = metadata;
+    finished.flags &= ~PacketMetadata::NeedsChecksum;
+
+    this->transmit(frame, payload_count + 1, finished);
+}
+
+void NetworkAdapter::segment(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    ASSERT(metadata.header_size <= MAX_HEADER_SIZE, "Headers too large to segment");
+
+    u8 headers[MAX_HEADER_SIZE];
+    PacketFragment payload[MAX_FRAGMENTS];
+
+    size_t header_size = metadata.header_size;
+    size_t payload_count = split_headers(fragments, count, header_size, headers, payload);
+
+    auto* ipv4 = reinterpret_cast<IPv4Packet*>(headers + sizeof(EthernetFrame));
+    auto* tcp = reinterpret_cast<TCPPacket*>(ipv4->payload);
+
+    size_t tcp_header_size = header_size - sizeof(EthernetFrame) - sizeof(IPv4Packet);
+    size_t total = 0;
+    for (size_t i = 0; i < payload_count; i++) {
+        total += payload[i].size;
+    }
+
+    u8 flags = tcp->flags;
+    u32 sequence = tcp->sequence_number;
+    u16 identification = ipv4->identification;
+
+    PacketMetadata segment_metadata;
+    segment_metadata.flags = PacketMetadata::NeedsChecksum;
+    segment_metadata.checksum_start = metadata.checksum_start;
+    segment_metadata.checksum_offset = metadata.checksum_offset;
+
+    // Every segment reaches the device before it's told about any of them
+    TransmitBatch batch(*this);
+
+    size_t index = 0;  // Payload fragment the next segment starts in
+    size_t offset = 0; // and where in that fragment
+
+    for (size_t position = 0, i = 0; position < total; position += metadata.mss, i++) {
+        size_t size = std::min(static_cast<size_t>(metadata.mss), total - position);
+        bool last = position + size == total;
+
+        PacketFragment frame[MAX_FRAGMENTS + 1];
+        frame[0] = { headers, header_size };
+
+        size_t frame_count = 1;
+        for (size_t remaining = size; remaining;) {
+            auto& fragment = payload[index];
+
+            size_t chunk = std::min(fragment.size - offset, remaining);
+            if (chunk) {
+                frame[frame_count++] = { fragment.data + offset, chunk };
+            }
+
+            remaining -= chunk;
+            offset += chunk;
+
+            if (offset == fragment.size) {
+                index++;
+                offset = 0;
+            }
+        }
+
+        ipv4->length = sizeof(IPv4Packet) + tcp_header_size + size;
+        ipv4->identification = static_cast<u16>(identification + i);
+        ipv4->checksum = 0;
+        ipv4->checksum = internet_checksum(ipv4, sizeof(IPv4Packet));
+
+        // FIN and PSH belong to the end of the data, only the last segment keeps them
+        tcp->sequence_number = sequence + position;
+        tcp->flags = last ? flags : static_cast<u8>(flags & ~(TCPFlags::FIN | TCPFlags::PSH));
+        tcp->checksum = checksum_fold(
+            ipv4_pseudo_header_sum(ipv4->source, ipv4->destination, IPProtocol::TCP, tcp_header_size + size)
+        );
+
+        this->transmit_with_fallbacks(frame, frame_count, segment_metadata);
+    }
 }
 
 }
\ No newline at end of file
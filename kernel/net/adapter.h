@@ -2,25 +2,89 @@
 
 #include <kernel/common.h>
 #include <kernel/net/ip/ipv4.h>
+#include <kernel/net/ip/ipv6.h>
 #include <kernel/net/ip/arp.h>
 #include <kernel/net/mac.h>
+#include <kernel/net/packet_buffer.h>
 
 #include <std/vector.h>
+#include <std/memory.h>
+#include <std/atomic.h>
+#include <std/spsc_queue.h>
+#include <std/result.h>
 
 namespace kernel::net {
 
+struct EthernetFrame;
+
+// What a frame still needs done to it (outgoing) or what the device already did (incoming). Offsets are relative to the
+// start of the frame, except for frames handed to `send_ipv4` where they are relative to the IPv4 payload.
+struct PacketMetadata {
+    enum Flags : u8 {
+        // The TCP/UDP checksum field only holds the folded pseudo header sum (covering the whole transport length),
+        // the checksum over everything from `checksum_start` to the end of the frame still has to be stored there
+        NeedsChecksum = 1 << 0,
+
+        // Received frames whose transport checksum the device already verified, or that never left this machine
+        ChecksumValid = 1 << 1,
+    };
+
+    u8 flags = 0;
+
+    u16 checksum_start = 0;
+    u16 checksum_offset = 0; // Relative to `checksum_start`
+
+    // A non-zero `mss` marks a TCP frame larger than the MTU whose payload has to be cut into segments of `mss` bytes,
+    // each one getting a copy of the first `header_size` bytes (generic segmentation offload)
+    u16 header_size = 0;
+    u16 mss = 0;
+};
+
 struct Packet {
-    u8* data;
-    size_t size;
+    RefPtr<PacketBuffer> buffer;
+    size_t size = 0;
+    size_t offset = 0; // Where the frame starts in `buffer`, devices may put their own headers in front of it
+
+    PacketMetadata metadata;
+
+    u8* data() { return buffer->data() + offset; }
 };
 
-class NetworkAdapter {
+// Reference counted intrusively, so that a RefPtr can be made from a plain reference (e.g. to whatever received a frame)
+class NetworkAdapter : public std::RefCounted {
 public:
+    static constexpr size_t DEFAULT_MTU = 1500;
+
+    // Frames that arrive while this many are waiting for the network task are dropped
+    static constexpr size_t RECEIVE_QUEUE_SIZE = 512;
+
+    // Most frames an adapter may receive in a single `poll` before the other adapters get their turn
+    static constexpr size_t POLL_BUDGET = 64;
+
+    // Most fragments a single outgoing frame can be made of
+    static constexpr size_t MAX_FRAGMENTS = 8;
+
+    // Largest frame that may be handed down for segmentation, the IPv4 length field can't describe anything bigger
+    static constexpr size_t MAX_GSO_SIZE = 0xFFFF;
+
+    // Ethernet, IPv4 and TCP headers with all of their options
+    static constexpr size_t MAX_HEADER_SIZE = 14 + 60 + 60;
+
+    // Neighbor discovery messages are only accepted if nothing could have forwarded them (RFC 4861 section 7.1)
+    static constexpr u8 NEIGHBOR_DISCOVERY_HOP_LIMIT = 255;
+
     enum Type {
         Loopback,
         Ethernet
     };
 
+    // Work on outgoing frames the adapter can take off our hands. Anything it can't do is done in software right
+    // before the frame is handed to `transmit`.
+    enum Offload : u32 {
+        ChecksumOffload = 1 << 0,     // TCP and UDP checksums over IPv4, as described by `PacketMetadata::NeedsChecksum`
+        SegmentationOffload = 1 << 1, // TCP over IPv4 (TSO), as described by `PacketMetadata::mss`, needs ChecksumOffload
+    };
+
     virtual ~NetworkAdapter() = default;
 
     virtual Type type() const = 0;
@@ -33,25 +97,134 @@ public:
     void set_ipv4_address(IPv4Address const& address) { m_ipv4_address = address; }
     void set_ipv4_netmask(IPv4Address const& netmask) { m_ipv4_netmask = netmask; }
 
+    // The link-local address derived from the MAC address, ::1 for the loopback adapter
+    IPv6Address ipv6_address() const;
+
     void send_packet(u8 const* data, size_t size);
     void send(const MACAddress& destination, const ARPPacket& packet);
 
-    Packet dequeue();
+    // Wraps `payload` in an IPv4 header and sends it out. Payloads that don't fit the MTU of the path are fragmented,
+    // unless `metadata` asks for them to be segmented.
+    ErrorOr<void> send_ipv4(IPv4Address destination, u8 protocol, u8 const* payload, size_t size);
+    ErrorOr<void> send_ipv4(
+        IPv4Address destination, u8 protocol, PacketFragment const* fragments, size_t count, PacketMetadata metadata = {}
+    );
+
+    // Wraps `fragments` in an IPv6 header, sending to on-link neighbors only. IPv6 is never fragmented by us, payloads
+    // that don't fit the MTU fail with EMSGSIZE.
+    ErrorOr<void> send_ipv6(
+        IPv6Address destination, u8 next_header, PacketFragment const* fragments, size_t count, u8 hop_limit = 64
+    );
+
+    u32 offloads() const { return m_offloads; }
+
+    // Frames sent while a batch is open may be held back and handed to the device together once the outermost batch
+    // is closed. Only adapters that have to ring a doorbell for every handoff care, see `TransmitBatch`.
+    virtual void begin_transmit_batch() {}
+    virtual void end_transmit_batch() {}
+
+    size_t mtu() const { return m_mtu; }
+
+    // Only called by the network task, the consumer side of the receive queue
+    bool dequeue(Packet&);
+
+    // Only called by the network task. Runs `poll` if the adapter asked for it, returns true if it wants another pass.
+    bool run_poll();
+
+    size_t dropped_packets() const { return m_dropped_packets.load(std::MemoryOrder::Relaxed); }
+    void drop_packet() { m_dropped_packets.fetch_add(1, std::MemoryOrder::Relaxed); }
 
 protected:
-    virtual void send(u8 const* data, size_t size) = 0;
+    // Queues a single frame made of `count` fragments. The fragments only have to stay valid until this returns.
+    // `metadata` only ever asks for the offloads the adapter advertised.
+    virtual void transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) = 0;
 
     void set_mac_address(MACAddress const& address) { m_mac_address = address; }
+    void set_mtu(size_t mtu) { m_mtu = mtu; }
+    void set_offloads(u32 offloads) { m_offloads = offloads; }
+
+    // Copies the first `header_size` bytes of a frame into `headers` and points `payload` at the rest of it.
+    // Returns the number of payload fragments.
+    static size_t split_headers(
+        PacketFragment const* fragments, size_t count, size_t header_size, u8* headers, PacketFragment* payload
+    );
 
+    // Hands a received frame to the network task without copying it. The receive queue has a single producer,
+    // so an adapter must not call this from more than one context at a time.
+    void on_packet_receive(RefPtr<PacketBuffer>, size_t size, size_t offset = 0, PacketMetadata const& metadata = {});
+
+    // Copies `data` into a buffer from the receive pool first, for adapters that don't receive into pool buffers
     void on_packet_receive(u8 const* data, size_t size);
 
+    // Adapters that receive by polling (NAPI) mask their receive interrupt when it first fires and call this instead
+    // of receiving right away. The network task then calls `poll` until the adapter is drained.
+    void schedule_poll();
+
+    // Receives at most `budget` frames from the device. Returns true if there may be more left, otherwise the adapter
+    // has unmasked its receive interrupt again.
+    virtual bool poll(size_t) { return false; }
+
+    void set_receive_pool(OwnPtr<PacketBufferPool> pool) { m_receive_pool = move(pool); }
+    PacketBufferPool* receive_pool() { return m_receive_pool.ptr(); }
+
 private:
+    template<typename>
+    friend class NeighborCache;
+
+    // Where frames for `destination` go on this link, according to the routing table
+    IPv4Address next_hop(IPv4Address destination) const;
+
+    // Fills in the MAC address for `destination`, returns false if it has to be resolved through ARP first
+    bool resolve(IPv4Address destination, MACAddress& mac);
+
+    // Same through neighbor discovery, IPv6 destinations are always on the link
+    bool resolve(IPv6Address destination, MACAddress& mac);
+
+    // Sends a frame whose first fragment is `frame` as soon as the next hop towards `destination` is resolved
+    void send_frame(
+        IPv4Address destination, EthernetFrame* frame, PacketFragment const* fragments, size_t count, PacketMetadata const& metadata
+    );
+
+    // Cuts the payload into fragments of at most `mtu` bytes (headers included), `frame` holds the headers to copy
+    void send_fragmented(
+        IPv4Address destination, EthernetFrame* frame, PacketFragment const* fragments, size_t count, size_t size,
+        PacketMetadata const& metadata, size_t mtu
+    );
+
+    // Does whatever `metadata` asks for that the adapter can't do itself, then hands the frame(s) to `transmit`
+    void transmit_with_fallbacks(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata);
+
+    void segment(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata);
+    void finish_checksum(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata);
+
     MACAddress m_mac_address;
 
     IPv4Address m_ipv4_address;
     IPv4Address m_ipv4_netmask;
 
-    Vector<Packet> m_packets; // FIXME: Use a proper queue
+    size_t m_mtu = DEFAULT_MTU;
+    u32 m_offloads = 0;
+    std::Atomic<u16> m_ipv4_identification = 0;
+
+    OwnPtr<PacketBufferPool> m_receive_pool;
+
+    SPSCQueue<Packet, RECEIVE_QUEUE_SIZE> m_receive_queue;
+    std::Atomic<size_t> m_dropped_packets = 0;
+
+    std::Atomic<bool> m_poll_scheduled = false;
+};
+
+// Keeps a transmit batch open on an adapter for as long as it's alive
+class TransmitBatch {
+public:
+    explicit TransmitBatch(NetworkAdapter& adapter) : m_adapter(adapter) { m_adapter.begin_transmit_batch(); }
+    ~TransmitBatch() { m_adapter.end_transmit_batch(); }
+
+    TransmitBatch(const TransmitBatch&) = delete;
+    TransmitBatch& operator=(const TransmitBatch&) = delete;
+
+private:
+    NetworkAdapter& m_adapter;
 };
 
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <kernel/net/adapters/e1000.h>
 #include <kernel/net/ethernet.h>
 #include <kernel/net/ip/arp.h>
+#include <kernel/net/ip/tcp.h>
+#include <kernel/net/checksum.h>
 #include <kernel/memory/manager.h>
+#include <kernel/sync/lock.h>
 #include <kernel/arch/io.h>
 
 #include <std/format.h>
@@ -34,6 +37,8 @@ E1000NetworkAdapter::E1000NetworkAdapter(pci::Address address) : IRQHandler(addr
     this->detect_eeprom();
     this->read_mac_address();
 
+    this->set_offloads(ChecksumOffload | SegmentationOffload);
+
     this->rx_init();
     this->tx_init();
     
@@ -67,8 +72,8 @@ void E1000NetworkAdapter::setup_link() {
 }
 
 void E1000NetworkAdapter::enable_interrupts() {
-    write(InterruptThrottle, 5580);
-    write(InterruptMask, LCS | RXO | RXT0);
+    this->set_interrupt_latency(m_interrupt_latency);
+    write(InterruptMask, TXDW | LCS | RX_INTERRUPTS);
     
     read(InterruptCause);
     m_address.set_interrupt_line(true);   
@@ -91,8 +96,14 @@ void E1000NetworkAdapter::handle_irq() {
         dbgln("E1000: Receiver FIFO Overrun");
     }
 
-    if (status & RXT0) {
-        this->receive();
+    // The receive interrupt stays masked until the network task drained the ring, see `poll`
+    if (status & RX_INTERRUPTS) {
+        write(InterruptMaskClear, RX_INTERRUPTS);
+        this->schedule_poll();
+    }
+
+    if (status & TXDW) {
+        this->reclaim_tx();
     }
 
     write(InterruptCause, 0xffffffff);
@@ -149,14 +160,15 @@ void E1000NetworkAdapter::read_mac_address() {
 }
 
 void E1000NetworkAdapter::rx_init() {
-    m_rx_buffer = reinterpret_cast<u8*>(MUST(MM->allocate_dma_region(NUM_RX_DESCRIPTORS * BUFFER_SIZE)));
+    this->set_receive_pool(MUST(PacketBufferPool::create(RX_POOL_SIZE, RX_BUFFER_SIZE, true)));
     m_rx_descriptors = reinterpret_cast<RxDescriptor*>(MUST(MM->allocate_dma_region(NUM_RX_DESCRIPTORS * sizeof(RxDescriptor))));
 
     for (size_t i = 0; i < NUM_RX_DESCRIPTORS; i++) {
         auto& descriptor = m_rx_descriptors[i];
-        u8* buffer = m_rx_buffer + i * BUFFER_SIZE;
 
-        descriptor.address = MM->get_physical_address(buffer);
+        m_rx_buffers[i] = this->receive_pool()->allocate();
+
+        descriptor.address = m_rx_buffers[i]->physical_address();
         descriptor.status = 0;
     }
 
@@ -176,31 +188,26 @@ void E1000NetworkAdapter::rx_init() {
     ctrl.multicast_promiscuous = 1;
     ctrl.receive_descrptor_threshold_size = ReceiveThresholdSize::Half;
     ctrl.broadcast_accept_mode = 1;
-    ctrl.buffer_size_extension = 1;
-    ctrl.buffer_size = BufferSize::BufferSize8192;
+    ctrl.buffer_size_extension = 0;
+    ctrl.buffer_size = BufferSize::BufferSize2048;
     ctrl.strip_ethernet_crc = 1;
 
     write(ReceiveCtrl, ctrl.value);
 }
 
 void E1000NetworkAdapter::tx_init() {
-    m_tx_buffer = reinterpret_cast<u8*>(MUST(MM->allocate_dma_region(NUM_TX_DESCRIPTORS * BUFFER_SIZE)));
-    m_tx_descriptors = reinterpret_cast<TxDescriptor*>(MUST(MM->allocate_dma_region(NUM_TX_DESCRIPTORS * sizeof(TxDescriptor))));
+    m_tx_descriptors = reinterpret_cast<TxDataDescriptor*>(MUST(MM->allocate_contiguous_dma_region(NUM_TX_DESCRIPTORS * sizeof(TxDataDescriptor))));
+    m_tx_staging = reinterpret_cast<u8*>(MUST(MM->allocate_contiguous_dma_region(TX_STAGING_SIZE)));
+    m_tx_staging_address = MM->get_physical_address(m_tx_staging);
+    m_tx_staging_end = new u32[NUM_TX_DESCRIPTORS];
 
-    for (size_t i = 0; i < NUM_TX_DESCRIPTORS; i++) {
-        auto& descriptor = m_tx_descriptors[i];
-        u8* buffer = m_tx_buffer + i * BUFFER_SIZE;
-
-        descriptor.address = MM->get_physical_address(buffer);
-        descriptor.cmd = 0;
-        descriptor.status = 0;
-    }
+    memset(m_tx_descriptors, 0, NUM_TX_DESCRIPTORS * sizeof(TxDataDescriptor));
 
     PhysicalAddress address = MM->get_physical_address(m_tx_descriptors);
 
     write(TxDescriptorLow, static_cast<u64>(address) & 0xFFFFFFFF);
     write(TxDescriptorHigh, static_cast<u64>(address) >> 32);
-    write(TxDescriptorLength, NUM_TX_DESCRIPTORS * sizeof(TxDescriptor));
+    write(TxDescriptorLength, NUM_TX_DESCRIPTORS * sizeof(TxDataDescriptor));
     write(TxDescriptorHead, 0);
     write(TxDescriptorTail, 0);
 
@@ -221,44 +228,342 @@ void E1000NetworkAdapter::tx_init() {
     write(TransmitIPG, ipg.value);
 }
 
-void E1000NetworkAdapter::send(u8 const* data, size_t size) {
-    this->disable_irq();
+void E1000NetworkAdapter::begin_transmit_batch() {
+    m_tx_lock.lock();
+    m_tx_batch_depth++;
+}
 
-    size_t current = read(TxDescriptorTail);
-    auto& descriptor = m_tx_descriptors[current];
-    
-    memcpy(m_tx_buffer + current * BUFFER_SIZE, data, size);
+void E1000NetworkAdapter::end_transmit_batch() {
+    if (!--m_tx_batch_depth) {
+        this->flush_tx();
+    }
 
-    descriptor.length = size;
-    descriptor.cmd = EOP | IFCS | RS;
-    descriptor.status = 0;
+    m_tx_lock.unlock();
+}
 
-    this->enable_irq();
-    write(TxDescriptorTail, (current + 1) % NUM_TX_DESCRIPTORS);
+bool E1000NetworkAdapter::has_tx_room(size_t descriptors, size_t bytes) const {
+    u32 next = m_tx_next.load(std::MemoryOrder::Relaxed);
+    u32 clean = m_tx_clean.load(std::MemoryOrder::Acquire);
+
+    // One descriptor and one byte always stay unused, otherwise a full ring would look empty
+    size_t free_descriptors = (clean + NUM_TX_DESCRIPTORS - next - 1) % NUM_TX_DESCRIPTORS;
+    size_t free_bytes = (m_tx_staging_tail.load(std::MemoryOrder::Acquire) + TX_STAGING_SIZE - m_tx_staging_head - 1) % TX_STAGING_SIZE;
+
+    return free_descriptors >= descriptors && free_bytes >= bytes;
+}
+
+void E1000NetworkAdapter::wait_for_tx_room(size_t descriptors, size_t bytes) {
+    if (this->has_tx_room(descriptors, bytes)) {
+        return;
+    }
+
+    // Nothing completes unless the NIC knows about everything we've queued so far
+    this->flush_tx();
+
+    WaitQueueBlocker blocker;
+    m_tx_wait_queue.add(&blocker);
 
     while (true) {
-        if (descriptor.status) {
+        blocker.reset();
+
+        // The interrupt may have been throttled, so don't rely on it alone
+        this->disable_irq();
+        this->reclaim_tx();
+        this->enable_irq();
+
+        if (this->has_tx_room(descriptors, bytes)) {
             break;
         }
+
+        blocker.wait();
     }
+
+    m_tx_wait_queue.remove(&blocker);
 }
 
-void E1000NetworkAdapter::receive() {
-    while (true) {
-        u32 current = (read(RxDescriptorTail) + 1) % NUM_RX_DESCRIPTORS;
-        auto& descriptor = m_rx_descriptors[current];
-        if (!(descriptor.status & 0x1)) {
+void E1000NetworkAdapter::write_tx_context(u32 index, PacketMetadata const& metadata, size_t size) {
+    auto& context = *reinterpret_cast<TxContextDescriptor*>(&m_tx_descriptors[index]);
+    memset(&context, 0, sizeof(TxContextDescriptor));
+
+    context.tucss = metadata.checksum_start;
+    context.tucso = metadata.checksum_start + metadata.checksum_offset;
+    context.tucse = 0;
+    context.type = ContextDescriptor;
+    context.command = ContextDEXT | ContextIP;
+
+    if (metadata.mss) {
+        context.ipcss = sizeof(EthernetFrame);
+        context.ipcso = sizeof(EthernetFrame) + 10; // The IPv4 header checksum
+        context.ipcse = metadata.checksum_start - 1;
+
+        context.payload_length = size - metadata.header_size;
+        context.header_length = metadata.header_size;
+        context.mss = metadata.mss;
+        context.command |= ContextTCP | ContextTSE;
+    }
+
+    m_tx_staging_end[index] = NOT_END_OF_FRAME;
+}
+
+void E1000NetworkAdapter::transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    ScopedLock lock(m_tx_lock);
+
+    u8 headers[MAX_HEADER_SIZE];
+    PacketFragment frame[MAX_FRAGMENTS + 1];
+
+    // The NIC fills in the IPv4 length and both checksums of every segment, it expects the first two zeroed and the
+    // TCP checksum seeded with a pseudo header sum that leaves out the length (section 3.5.3)
+    if (metadata.mss) {
+        size_t payload_count = split_headers(fragments, count, metadata.header_size, headers, frame + 1);
+        frame[0] = { headers, metadata.header_size };
+
+        auto* ipv4 = reinterpret_cast<IPv4Packet*>(headers + sizeof(EthernetFrame));
+        ipv4->length = 0;
+        ipv4->checksum = 0;
+
+        u16 seed = checksum_fold(ipv4_pseudo_header_sum(ipv4->source, ipv4->destination, IPProtocol::TCP, 0));
+        u8* field = headers + metadata.checksum_start + metadata.checksum_offset;
+
+        field[0] = seed >> 8;
+        field[1] = seed & 0xFF;
+
+        fragments = frame;
+        count = payload_count + 1;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += fragments[i].size;
+    }
+
+    if (!size || size > TX_STAGING_SIZE / 2) {
+        return;
+    }
+
+    // Besides one descriptor per started chunk of every fragment, a fragment that wraps around the end of the
+    // staging ring needs another one and offloads need a context descriptor
+    this->wait_for_tx_room(count + size / TX_MAX_DESCRIPTOR_SIZE + 2, size);
+
+    u32 next = m_tx_next.load(std::MemoryOrder::Relaxed);
+    u32 last = next;
+
+    u8 command = DEXT | IFCS;
+    u8 options = 0;
+
+    if (metadata.mss || (metadata.flags & PacketMetadata::NeedsChecksum)) {
+        this->write_tx_context(next, metadata, size);
+        next = (next + 1) % NUM_TX_DESCRIPTORS;
+
+        options = TXSM;
+        if (metadata.mss) {
+            command |= TSE;
+            options |= IXSM;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto* data = fragments[i].data;
+        size_t remaining = fragments[i].size;
+
+        while (remaining) {
+            size_t chunk = std::min(std::min(remaining, TX_STAGING_SIZE - m_tx_staging_head), TX_MAX_DESCRIPTOR_SIZE);
+            memcpy(m_tx_staging + m_tx_staging_head, data, chunk);
+
+            auto& descriptor = m_tx_descriptors[next];
+
+            descriptor.address = m_tx_staging_address.offset(m_tx_staging_head);
+            descriptor.length = chunk;
+            descriptor.type = DataDescriptor;
+            descriptor.command = command;
+            descriptor.status = 0;
+            descriptor.options = options;
+            descriptor.special = 0;
+
+            m_tx_staging_end[next] = NOT_END_OF_FRAME;
+            m_tx_staging_head = (m_tx_staging_head + chunk) % TX_STAGING_SIZE;
+
+            last = next;
+            next = (next + 1) % NUM_TX_DESCRIPTORS;
+
+            data += chunk;
+            remaining -= chunk;
+        }
+    }
+
+    // Only the last descriptor of a frame reports back, which is all `reclaim_tx` looks at
+    m_tx_descriptors[last].command = command | EOP | RS;
+    m_tx_staging_end[last] = m_tx_staging_head;
+
+    m_tx_next.store(next, std::MemoryOrder::Release);
+    if (!m_tx_batch_depth) {
+        this->flush_tx();
+    }
+}
+
+void E1000NetworkAdapter::flush_tx() {
+    u32 next = m_tx_next.load(std::MemoryOrder::Relaxed);
+    if (next == m_tx_flushed) {
+        return;
+    }
+
+    m_tx_flushed = next;
+    write(TxDescriptorTail, next);
+}
+
+void E1000NetworkAdapter::reclaim_tx() {
+    u32 clean = m_tx_clean.load(std::MemoryOrder::Relaxed);
+    u32 next = m_tx_next.load(std::MemoryOrder::Acquire);
+
+    u32 reclaimed = clean;
+    size_t staging_tail = m_tx_staging_tail.load(std::MemoryOrder::Relaxed);
+
+    // Frames complete in order, so stop at the first one that's still pending
+    for (u32 i = clean; i != next; i = (i + 1) % NUM_TX_DESCRIPTORS) {
+        auto& descriptor = m_tx_descriptors[i];
+        if (m_tx_staging_end[i] == NOT_END_OF_FRAME) {
+            continue;
+        } else if (!(descriptor.status & DD)) {
             break;
         }
 
-        u8* buffer = m_rx_buffer + current * BUFFER_SIZE;
-        size_t length = descriptor.length;
+        reclaimed = (i + 1) % NUM_TX_DESCRIPTORS;
+        staging_tail = m_tx_staging_end[i];
+    }
 
-        on_packet_receive(buffer, length);
+    if (reclaimed == clean) {
+        return;
+    }
+
+    m_tx_staging_tail.store(staging_tail, std::MemoryOrder::Release);
+    m_tx_clean.store(reclaimed, std::MemoryOrder::Release);
+
+    m_tx_wait_queue.wake_all();
+}
+
+size_t E1000NetworkAdapter::receive(size_t budget) {
+    u32 current = (m_rx_tail + 1) % NUM_RX_DESCRIPTORS;
+    size_t received = 0;
+
+    while (received < budget && (m_rx_descriptors[current].status & RxDD)) {
+        auto& descriptor = m_rx_descriptors[current];
+
+        // The filled buffer goes up the stack as is and the descriptor gets a fresh one. If the pool ran dry,
+        // the frame is dropped and its buffer reused instead.
+        auto buffer = this->receive_pool()->allocate();
+        if (buffer) {
+            on_packet_receive(move(m_rx_buffers[current]), descriptor.length);
+
+            m_rx_buffers[current] = move(buffer);
+            descriptor.address = m_rx_buffers[current]->physical_address();
+        }
 
+        m_rx_bytes += descriptor.length;
         descriptor.status = 0;
-        write(RxDescriptorTail, current);
+
+        m_rx_tail = current;
+        current = (current + 1) % NUM_RX_DESCRIPTORS;
+
+        received++;
+    }
+
+    // A single tail update hands all the refilled descriptors back to the NIC
+    if (received) {
+        write(RxDescriptorTail, m_rx_tail);
+    }
+
+    m_rx_packets += received;
+    return received;
+}
+
+bool E1000NetworkAdapter::poll(size_t budget) {
+    if (this->receive(budget) == budget) {
+        return true;
+    }
+
+    this->update_interrupt_latency();
+    write(InterruptMask, RX_INTERRUPTS);
+
+    // A frame that came in after the ring looked empty may have had its interrupt cause cleared by an unrelated
+    // interrupt in the meantime, so check once more now that the interrupt is unmasked
+    u32 next = (m_rx_tail + 1) % NUM_RX_DESCRIPTORS;
+    if (m_rx_descriptors[next].status & RxDD) {
+        write(InterruptMaskClear, RX_INTERRUPTS);
+        return true;
+    }
+
+    return false;
+}
+
+void E1000NetworkAdapter::update_interrupt_latency() {
+    size_t packets = m_rx_packets;
+    size_t bytes = m_rx_bytes;
+
+    m_rx_packets = 0;
+    m_rx_bytes = 0;
+
+    if (!packets) {
+        return;
+    }
+
+    // Same thresholds as Linux' `e1000_update_itr`
+    auto latency = m_interrupt_latency;
+    size_t average = bytes / packets;
+
+    switch (m_interrupt_latency) {
+        case InterruptLatency::Lowest:
+            if (bytes > 10000) {
+                latency = average > 8000 ? InterruptLatency::Bulk : InterruptLatency::Low;
+            }
+            break;
+        case InterruptLatency::Low:
+            if (bytes > 10000) {
+                if (average > 8000 || packets < 10 || average > 1200) {
+                    latency = InterruptLatency::Bulk;
+                } else if (packets > 35) {
+                    latency = InterruptLatency::Lowest;
+                }
+            } else if (average > 2000) {
+                latency = InterruptLatency::Bulk;
+            } else if (packets <= 2 && bytes < 512) {
+                latency = InterruptLatency::Lowest;
+            }
+            break;
+        case InterruptLatency::Bulk:
+            if (bytes > 25000) {
+                if (packets > 35) {
+                    latency = InterruptLatency::Low;
+                }
+            } else if (bytes < 6000) {
+                latency = InterruptLatency::Low;
+            }
+            break;
+    }
+
+    if (latency != m_interrupt_latency) {
+        this->set_interrupt_latency(latency);
     }
 }
 
-}
\ No newline at end of file
+void E1000NetworkAdapter::set_interrupt_latency(InterruptLatency latency) {
+    // The throttle interval (ITR) is counted in 256 ns units
+    static constexpr u32 throttle_intervals[] = {
+        1'000'000'000 / (70000 * 256), // Lowest: 70000 interrupts per second
+        1'000'000'000 / (20000 * 256), // Low: 20000 interrupts per second
+        1'000'000'000 / (4000 * 256),  // Bulk: 4000 interrupts per second
+    };
+
+    m_interrupt_latency = latency;
+    write(InterruptThrottle, throttle_intervals[to_underlying(latency)]);
+
+    // In bulk mode the receive interrupt is also held back until the link has been quiet for 32 µs (RDTR), but no
+    // longer than 128 µs (RADV), both counted in 1.024 µs units
+    if (latency == InterruptLatency::Bulk) {
+        write(RxDelayTimer, 32);
+        write(RxAbsoluteDelay, 128);
+    } else {
+        write(RxDelayTimer, 0);
+        write(RxAbsoluteDelay, 0);
+    }
+}
+
+}
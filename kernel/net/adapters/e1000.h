@@ -7,9 +7,11 @@
 #include <kernel/net/mac.h>
 #include <kernel/net/adapter.h>
 
-#include <kernel/process/blocker.h>
+#include <kernel/process/wait_queue.h>
+#include <kernel/sync/mutex.h>
 
 #include <std/memory.h>
+#include <std/atomic.h>
 
 namespace kernel::net {
 
@@ -25,6 +27,7 @@ public:
         InterruptCause = 0x00C0,
         InterruptThrottle = 0x00C4,
         InterruptMask = 0x00D0,
+        InterruptMaskClear = 0x00D8,
 
         ReceiveCtrl = 0x0100,
         RxDescriptorLow = 0x2800,
@@ -32,6 +35,8 @@ public:
         RxDescriptorLength = 0x2808,
         RxDescriptorHead = 0x2810,
         RxDescriptorTail = 0x2818,
+        RxDelayTimer = 0x2820,
+        RxAbsoluteDelay = 0x282C,
 
         TransmitCtrl = 0x0400,
         TxDescriptorLow = 0x3800,
@@ -47,21 +52,62 @@ public:
     };
 
     enum InterruptMaskSet : u32 {
+        TXDW = 1 << 0, // Transmit Descriptor Written Back
         LCS = 1 << 2,  // Link Status Change
         RXO = 1 << 6,  // Receiver FIFO Overrun
         RXT0 = 1 << 7, // RX Timer Interrupt
+
+        // Masked while the network task polls the receive ring
+        RX_INTERRUPTS = RXO | RXT0,
+    };
+
+    enum ReceiveStatus : u8 {
+        RxDD = 1 << 0, // Descriptor Done
+    };
+
+    // How long the NIC holds back interrupts, picked from the traffic seen since the last time the receive interrupt
+    // was unmasked (like the "dynamic conservative" mode of Linux' e1000 driver)
+    enum class InterruptLatency : u8 {
+        Lowest, // Few small frames, e.g. interactive traffic
+        Low,
+        Bulk,   // Streams of full sized frames, where fewer interrupts mean more throughput
     };
 
     enum TransmitCommand : u8 {
         EOP = 1 << 0,  // End of Packet
         IFCS = 1 << 1, // Insert FCS
         IC = 1 << 2,   // Insert Checksum
+        TSE = 1 << 2,  // TCP Segmentation Enable (extended descriptors)
         RS = 1 << 3,   // Report Status
         RPS = 1 << 4,  // Report Packet Sent
+        DEXT = 1 << 5, // Descriptor Extension
         VLE = 1 << 6,  // VLAN Packet Enable
         IDE = 1 << 7,  // Interrupt Delay Enable
     };
 
+    // Section 3.3.6
+    enum TransmitContextCommand : u8 {
+        ContextTCP = 1 << 0, // TCP rather than UDP, only matters for segmentation
+        ContextIP = 1 << 1,  // IPv4 rather than IPv6
+        ContextTSE = 1 << 2,
+        ContextRS = 1 << 3,
+        ContextDEXT = 1 << 5,
+    };
+
+    enum TransmitOptions : u8 {
+        IXSM = 1 << 0, // Insert IP Checksum
+        TXSM = 1 << 1, // Insert TCP/UDP Checksum
+    };
+
+    enum TransmitDescriptorType : u8 {
+        ContextDescriptor = 0,
+        DataDescriptor = 1,
+    };
+
+    enum TransmitStatus : u8 {
+        DD = 1 << 0, // Descriptor Done
+    };
+
     enum BufferSize {
         BufferSize2048 = 0b00,
         BufferSize1024 = 0b01,
@@ -176,13 +222,54 @@ public:
         u16 special;
     } PACKED;
 
+    // Section 3.3.6. Tells the NIC where the checksums of the data descriptors that follow go and how to segment them.
+    struct TxContextDescriptor {
+        u8 ipcss;
+        u8 ipcso;
+        u16 ipcse;
+        u8 tucss;
+        u8 tucso;
+        u16 tucse; // Zero means up to the end of the frame
+        u32 payload_length : 20;
+        u32 type : 4;
+        u32 command : 8;
+        u8 status;
+        u8 header_length;
+        u16 mss;
+    } PACKED;
+
+    // Section 3.3.7
+    struct TxDataDescriptor {
+        u64 address;
+        u32 length : 20;
+        u32 type : 4;
+        u32 command : 8;
+        u8 status;
+        u8 options;
+        u16 special;
+    } PACKED;
+
     static constexpr u16 VENDOR_ID = 0x8086;
     static constexpr u16 DEVICE_ID = 0x100E;
 
-    static constexpr size_t BUFFER_SIZE = 8192;
+    // Receive buffers come from a pool and are handed up the stack as is, a full sized frame fits into 2 KiB
+    static constexpr size_t RX_BUFFER_SIZE = 2048;
+    static constexpr size_t RX_POOL_SIZE = 1024;
+
+    static constexpr size_t NUM_RX_DESCRIPTORS = 256;
+
+    // TDLEN is 20 bits wide and has to be a multiple of 128 bytes (section 13.4.38), this is as large as the ring gets
+    static constexpr size_t NUM_TX_DESCRIPTORS = ((1 << 20) - 128) / 16;
+
+    // Outgoing fragments are copied into this ring of DMA memory in the order they are queued and are released again
+    // in that same order once the NIC reports their frames as sent
+    static constexpr size_t TX_STAGING_SIZE = 2 * MB;
+
+    // Larger data descriptors run into errata on some parts of the family
+    static constexpr size_t TX_MAX_DESCRIPTOR_SIZE = 4096;
 
-    static constexpr size_t NUM_RX_DESCRIPTORS = 32;
-    static constexpr size_t NUM_TX_DESCRIPTORS = 8;
+    // Enough to refill the whole ring even while the receive queue is full
+    static_assert(RX_POOL_SIZE > NUM_RX_DESCRIPTORS + RECEIVE_QUEUE_SIZE);
 
     static RefPtr<NetworkAdapter> create(pci::Device);
 
@@ -199,7 +286,8 @@ public:
     void setup_link();
     void enable_interrupts();
 
-    void send(u8 const* data, size_t size) override;
+    void begin_transmit_batch() override;
+    void end_transmit_batch() override;
 
 private:
     E1000NetworkAdapter(pci::Address address);
@@ -209,7 +297,27 @@ private:
 
     void handle_irq() override;
 
-    void receive();
+    // Hands up to `budget` received frames up the stack, returns how many there were
+    size_t receive(size_t budget);
+
+    bool poll(size_t budget) override;
+
+    void update_interrupt_latency();
+    void set_interrupt_latency(InterruptLatency);
+
+    void transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) override;
+
+    // Queues a context descriptor for the frame `metadata` describes, `size` is the size of the whole frame
+    void write_tx_context(u32 index, PacketMetadata const& metadata, size_t size);
+
+    bool has_tx_room(size_t descriptors, size_t bytes) const;
+    void wait_for_tx_room(size_t descriptors, size_t bytes);
+
+    // Hands every queued descriptor to the NIC with a single tail write
+    void flush_tx();
+
+    // Releases the descriptors and staging space of every frame the NIC is done with, only ever runs with the IRQ masked
+    void reclaim_tx();
 
     pci::Address m_address;
 
@@ -218,11 +326,38 @@ private:
 
     bool m_has_eeprom = false;
 
-    u8* m_rx_buffer;
-    u8* m_tx_buffer;
+    RefPtr<PacketBuffer> m_rx_buffers[NUM_RX_DESCRIPTORS];
+    u32 m_rx_tail = NUM_RX_DESCRIPTORS - 1;
+
+    InterruptLatency m_interrupt_latency = InterruptLatency::Low;
+
+    // Received since the receive interrupt was last unmasked
+    size_t m_rx_packets = 0;
+    size_t m_rx_bytes = 0;
 
     RxDescriptor* m_rx_descriptors;
-    TxDescriptor* m_tx_descriptors;
+    TxDataDescriptor* m_tx_descriptors;
+
+    // Senders are serialized by `m_tx_lock` and are the only ones moving `m_tx_next` and the staging head forward,
+    // the IRQ handler is the only one moving `m_tx_clean` and the staging tail after them.
+    Mutex m_tx_lock;
+    WaitQueue m_tx_wait_queue;
+
+    std::Atomic<u32> m_tx_next = 0;
+    std::Atomic<u32> m_tx_clean = 0;
+    u32 m_tx_flushed = 0; // Last value written to the tail register
+
+    size_t m_tx_batch_depth = 0;
+
+    u8* m_tx_staging;
+    PhysicalAddress m_tx_staging_address;
+
+    size_t m_tx_staging_head = 0;
+    std::Atomic<size_t> m_tx_staging_tail = 0;
+
+    // Where the staging head was after the frame ending at a given descriptor, every other descriptor holds `NOT_END_OF_FRAME`
+    static constexpr u32 NOT_END_OF_FRAME = 0xFFFFFFFF;
+    u32* m_tx_staging_end;
 };
 
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include <kernel/net/adapters/loopback.h>
+#include <kernel/net/ethernet.h>
+#include <kernel/sync/lock.h>
 
 namespace kernel::net {
 
@@ -11,10 +13,42 @@ LoopbackAdapter::LoopbackAdapter() {
 
     set_ipv4_address({ 127, 0, 0, 1 });
     set_ipv4_netmask({ 255, 0, 0, 0 });
+
+    set_mtu(LOOPBACK_MTU);
+
+    // Nothing can get corrupted on the way, so checksums are never computed. Segmentation is still left to the
+    // software fallback as the receive buffers only hold a single MTU sized frame.
+    set_offloads(ChecksumOffload);
+    set_receive_pool(MUST(PacketBufferPool::create(POOL_SIZE, LOOPBACK_MTU + sizeof(EthernetFrame), false)));
 }
 
-void LoopbackAdapter::send(u8 const* data, size_t size) {
-    on_packet_receive(data, size);
+void LoopbackAdapter::transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    ScopedLock lock(m_lock);
+
+    // The fragments are gathered straight into the buffer that gets handed to the receive side
+    auto buffer = this->receive_pool()->allocate();
+    if (!buffer) {
+        this->drop_packet();
+        return;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (size + fragments[i].size > buffer->capacity()) {
+            this->drop_packet();
+            return;
+        }
+
+        memcpy(buffer->data() + size, fragments[i].data, fragments[i].size);
+        size += fragments[i].size;
+    }
+
+    PacketMetadata received;
+    if (metadata.flags & PacketMetadata::NeedsChecksum) {
+        received.flags = PacketMetadata::ChecksumValid;
+    }
+
+    on_packet_receive(move(buffer), size, 0, received);
 }
 
 }
\ No newline at end of file
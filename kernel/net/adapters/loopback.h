@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kernel/net/adapter.h>
+#include <kernel/sync/mutex.h>
 
 #include <std/memory.h>
 
@@ -8,14 +9,21 @@ namespace kernel::net {
 
 class LoopbackAdapter : public NetworkAdapter {
 public:
+    // Nothing goes over the wire, so fewer and larger segments are strictly better
+    static constexpr size_t LOOPBACK_MTU = 16384;
+    static constexpr size_t POOL_SIZE = 128;
+
     static RefPtr<NetworkAdapter> create();
 
     Type type() const override { return Loopback; }
 
-    void send(u8 const* data, size_t size) override;
-
 private:
     LoopbackAdapter();
+
+    void transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) override;
+
+    // Every thread that sends through the loopback is a producer of the receive queue, this serializes them
+    Mutex m_lock;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,474 @@
+#include <kernel/net/adapters/virtio/adapter.h>
+#include <kernel/net/ethernet.h>
+#include <kernel/net/checksum.h>
+#include <kernel/memory/manager.h>
+#include <kernel/arch/processor.h>
+#include <kernel/sync/lock.h>
+
+#include <std/format.h>
+
+namespace kernel::net {
+
+using namespace virtio;
+
+RefPtr<NetworkAdapter> VirtIONetworkAdapter::create(pci::Device device) {
+    if (!device.is_virtio_device()) {
+        return nullptr;
+    }
+
+    u16 id = device.device_id();
+    if (id != pci_device_type(DeviceType::NetworkCard) && id != TRANSITIONAL_NETWORK_CARD_ID) {
+        return nullptr;
+    }
+
+    auto* adapter = new VirtIONetworkAdapter(device);
+
+    auto result = adapter->initialize();
+    if (result.is_err()) {
+        dbgln("VirtIONetworkAdapter: Failed to initialize the device: {}", result.error().code());
+
+        adapter->disable_irq();
+        delete adapter;
+
+        return nullptr;
+    }
+
+    return RefPtr<NetworkAdapter>(adapter);
+}
+
+VirtIONetworkAdapter::VirtIONetworkAdapter(pci::Device device) : virtio::Device(device) {}
+
+ErrorOr<void> VirtIONetworkAdapter::initialize() {
+    m_device_config = get_config(Configuration::Device);
+
+    u64 features = this->features();
+    u64 accepted = 0;
+
+    if (std::has_flag(features, VIRTIO_NET_F_MAC)) {
+        accepted |= VIRTIO_NET_F_MAC;
+    }
+
+    if (std::has_flag(features, VIRTIO_NET_F_STATUS)) {
+        accepted |= VIRTIO_NET_F_STATUS;
+    }
+
+    // Lets us hand the device frames with a partial checksum and, on top of that, frames it segments itself
+    if (std::has_flag(features, VIRTIO_NET_F_CSUM)) {
+        accepted |= VIRTIO_NET_F_CSUM;
+        if (std::has_flag(features, VIRTIO_NET_F_HOST_TSO4)) {
+            accepted |= VIRTIO_NET_F_HOST_TSO4;
+        }
+    }
+
+    if (std::has_flag(features, VIRTIO_NET_F_MRG_RXBUF)) {
+        accepted |= VIRTIO_NET_F_MRG_RXBUF;
+    }
+
+    // Large receive segments only fit if they can be spread over several buffers and their checksum may be partial
+    if (std::has_flag(features, VIRTIO_NET_F_GUEST_CSUM)) {
+        accepted |= VIRTIO_NET_F_GUEST_CSUM;
+        if (std::has_flag(accepted, VIRTIO_NET_F_MRG_RXBUF) && std::has_flag(features, VIRTIO_NET_F_GUEST_TSO4)) {
+            accepted |= VIRTIO_NET_F_GUEST_TSO4;
+        }
+    }
+
+    u16 max_queue_pairs = 1;
+    if (std::has_flag(features, VIRTIO_NET_F_MQ) && std::has_flag(features, VIRTIO_NET_F_CTRL_VQ)) {
+        max_queue_pairs = m_device_config->read<u16>(to_underlying(NetDeviceConfig::MaxVirtqueuePairs));
+        if (max_queue_pairs > 1 && max_queue_pairs <= MAX_QUEUE_PAIRS) {
+            accepted |= VIRTIO_NET_F_MQ | VIRTIO_NET_F_CTRL_VQ;
+        } else {
+            max_queue_pairs = 1;
+        }
+    }
+
+    TRY(this->set_accepted_features(accepted));
+
+    accepted = this->accepted_features();
+    m_mergeable_buffers = std::has_flag(accepted, VIRTIO_NET_F_MRG_RXBUF);
+
+    if (!m_mergeable_buffers && !std::has_flag(accepted, VIRTIO_F_VERSION_1)) {
+        m_header_size = LEGACY_NET_HEADER_SIZE;
+    }
+
+    u32 offloads = 0;
+    if (std::has_flag(accepted, VIRTIO_NET_F_CSUM)) {
+        offloads |= ChecksumOffload;
+    }
+
+    if (std::has_flag(accepted, VIRTIO_NET_F_HOST_TSO4)) {
+        offloads |= SegmentationOffload;
+    }
+
+    this->set_offloads(offloads);
+
+    // The queues come in receive/transmit pairs and the control queue follows the last pair the device supports
+    m_has_control_queue = std::has_flag(accepted, VIRTIO_NET_F_CTRL_VQ);
+    m_control_queue_index = max_queue_pairs * 2;
+    m_queue_pairs = std::min<size_t>(max_queue_pairs, Processor::count());
+
+    TRY(this->setup_queues(max_queue_pairs * 2 + (m_has_control_queue ? 1 : 0)));
+
+    if (std::has_flag(accepted, VIRTIO_NET_F_MAC)) {
+        MACAddress mac;
+        for (size_t i = 0; i < 6; i++) {
+            mac[i] = m_device_config->read<u8>(to_underlying(NetDeviceConfig::MAC) + i);
+        }
+
+        this->set_mac_address(mac);
+    }
+
+    size_t rx_descriptors = 0;
+    size_t tx_descriptors = 0;
+
+    for (size_t i = 0; i < m_queue_pairs; i++) {
+        rx_descriptors += this->queue(receive_queue_index(i)).size();
+        tx_descriptors += this->queue(transmit_queue_index(i)).size();
+    }
+
+    // Enough to refill every receive queue even while the receive queue of the stack is full. Transmit buffers are
+    // held by exactly one descriptor each, so that pool never runs dry before the rings do.
+    this->set_receive_pool(TRY(PacketBufferPool::create(rx_descriptors + RECEIVE_QUEUE_SIZE + 64, RX_BUFFER_SIZE, true)));
+    m_transmit_pool = TRY(PacketBufferPool::create(tx_descriptors, TX_BUFFER_SIZE, true));
+
+    if (m_mergeable_buffers) {
+        m_merge_pool = TRY(PacketBufferPool::create(MERGE_POOL_SIZE, MERGED_BUFFER_SIZE, false));
+    }
+
+    // Reserved up front so that the IRQ handler never sees the vectors in the middle of growing
+    m_receive_queues.reserve(m_queue_pairs);
+    m_transmit_queues.reserve(m_queue_pairs);
+
+    for (size_t i = 0; i < m_queue_pairs; i++) {
+        auto& queue = this->queue(receive_queue_index(i));
+
+        ReceiveQueue rx { &queue, {} };
+        rx.buffers.resize(queue.size());
+
+        while (queue.free_descriptors()) {
+            this->post_buffer(rx, this->receive_pool()->allocate());
+        }
+
+        m_receive_queues.append(move(rx));
+
+        auto transmit = OwnPtr<TransmitQueue>(new TransmitQueue());
+        transmit->queue = &this->queue(transmit_queue_index(i));
+        transmit->buffers.resize(transmit->queue->size());
+
+        if (offloads & SegmentationOffload) {
+            transmit->gso_pool = TRY(PacketBufferPool::create(GSO_POOL_SIZE, GSO_BUFFER_SIZE, true));
+        }
+
+        // Finished transmissions are reclaimed by the next sender, we only want an interrupt when someone waits for room
+        transmit->queue->set_interrupts_enabled(false);
+
+        m_transmit_queues.append(move(transmit));
+    }
+
+    if (m_has_control_queue) {
+        m_control_buffer = reinterpret_cast<u8*>(TRY(MM->allocate_dma_region(PAGE_SIZE)));
+    }
+
+    this->post_init();
+
+    for (size_t i = 0; i < m_queue_pairs; i++) {
+        TRY(this->notify(receive_queue_index(i)));
+    }
+
+    if (m_queue_pairs > 1) {
+        TRY(this->set_queue_pairs(m_queue_pairs));
+    }
+
+    bool link_up = true;
+    if (std::has_flag(accepted, VIRTIO_NET_F_STATUS)) {
+        link_up = m_device_config->read<u16>(to_underlying(NetDeviceConfig::Status)) & NetLinkUp;
+    }
+
+    dbgln("VirtIONetworkAdapter:");
+    dbgln(" - MAC Address: {}", mac_address());
+    dbgln(" - Link up: {}", link_up);
+    dbgln(" - Queue pairs: {} (device supports {})", m_queue_pairs, max_queue_pairs);
+    dbgln(" - Mergeable receive buffers: {}", m_mergeable_buffers);
+    dbgln(" - Guest TSO: {}", std::has_flag(accepted, VIRTIO_NET_F_GUEST_TSO4));
+    dbgln(" - Host TSO: {}", std::has_flag(accepted, VIRTIO_NET_F_HOST_TSO4));
+    dbgln();
+
+    return {};
+}
+
+ErrorOr<void> VirtIONetworkAdapter::set_queue_pairs(u16 pairs) {
+    auto* header = reinterpret_cast<NetControlHeader*>(m_control_buffer);
+    header->control_class = to_underlying(NetControlClass::Multiqueue);
+    header->command = to_underlying(NetControlMultiqueue::SetQueuePairs);
+
+    auto* data = reinterpret_cast<u16*>(m_control_buffer + sizeof(NetControlHeader));
+    *data = pairs;
+
+    u8* ack = m_control_buffer + sizeof(NetControlHeader) + sizeof(u16);
+    *ack = to_underlying(NetControlAck::Error);
+
+    auto& queue = this->queue(m_control_queue_index);
+    auto chain = queue.create_chain();
+
+    PhysicalAddress address = MM->get_physical_address(m_control_buffer);
+
+    chain.add_buffer(address, sizeof(NetControlHeader) + sizeof(u16), false);
+    chain.add_buffer(address.offset(sizeof(NetControlHeader) + sizeof(u16)), sizeof(u8), true);
+
+    chain.submit();
+    TRY(this->notify(m_control_queue_index));
+
+    while (!queue.has_available_data()) {}
+    queue.drain();
+
+    if (*ack != to_underlying(NetControlAck::Ok)) {
+        return Error(EIO);
+    }
+
+    return {};
+}
+
+void VirtIONetworkAdapter::handle_config_change() {}
+
+void VirtIONetworkAdapter::handle_queue_irq(virtio::Queue& queue) {
+    // The control queue is polled and the queue pairs may not be set up yet
+    size_t pair = queue.index() / 2;
+    if (pair >= m_receive_queues.size() || pair >= m_transmit_queues.size()) {
+        return;
+    }
+
+    if (queue.index() % 2 == 0) {
+        this->receive(m_receive_queues[pair]);
+    } else {
+        m_transmit_queues[pair]->wait_queue.wake_all();
+    }
+}
+
+void VirtIONetworkAdapter::post_buffer(ReceiveQueue& rx, RefPtr<PacketBuffer> buffer) {
+    auto chain = rx.queue->create_chain();
+    chain.add_buffer(buffer->physical_address(), RX_BUFFER_SIZE, true);
+
+    rx.buffers[chain.start()] = move(buffer);
+    chain.submit();
+}
+
+void VirtIONetworkAdapter::receive(ReceiveQueue& rx) {
+    auto& queue = *rx.queue;
+    if (!queue.has_available_data()) {
+        return;
+    }
+
+    while (queue.has_available_data()) {
+        auto chain = queue.dequeue();
+
+        auto buffer = move(rx.buffers[chain.start()]);
+        size_t written = chain.written();
+
+        chain.release();
+
+        auto* header = reinterpret_cast<NetHeader*>(buffer->data());
+        size_t num_buffers = m_mergeable_buffers ? header->num_buffers : 1;
+
+        if (num_buffers <= 1) {
+            // The filled buffer goes up the stack as is and the descriptor gets a fresh one. If the pool ran dry,
+            // the frame is dropped and its buffer posted again instead.
+            auto replacement = this->receive_pool()->allocate();
+            if (!replacement || written <= m_header_size) {
+                this->drop_packet();
+                this->post_buffer(rx, replacement ? move(replacement) : move(buffer));
+
+                continue;
+            }
+
+            auto metadata = receive_metadata(*header);
+            on_packet_receive(move(buffer), written - m_header_size, m_header_size, metadata);
+            this->post_buffer(rx, move(replacement));
+
+            continue;
+        }
+
+        // The rest of the frame follows in the next `num_buffers - 1` buffers, without headers of their own. They are
+        // gathered into a single buffer and all of them go straight back to the device.
+        auto merged = m_merge_pool->allocate();
+
+        NetHeader merged_header = *header;
+        size_t size = 0;
+
+        auto append = [&](u8 const* data, size_t length) {
+            if (!merged || size + length > merged->capacity()) {
+                merged = nullptr;
+                return;
+            }
+
+            memcpy(merged->data() + size, data, length);
+            size += length;
+        };
+
+        append(buffer->data() + m_header_size, written > m_header_size ? written - m_header_size : 0);
+        this->post_buffer(rx, move(buffer));
+
+        for (size_t i = 1; i < num_buffers; i++) {
+            if (!queue.has_available_data()) {
+                merged = nullptr; // The device never hands out a partial frame, but don't trust it blindly
+                break;
+            }
+
+            auto next = queue.dequeue();
+            auto part = move(rx.buffers[next.start()]);
+
+            append(part->data(), next.written());
+
+            next.release();
+            this->post_buffer(rx, move(part));
+        }
+
+        if (!merged) {
+            this->drop_packet();
+            continue;
+        }
+
+        on_packet_receive(move(merged), size, 0, receive_metadata(merged_header));
+    }
+
+    if (queue.should_notify()) {
+        (void)this->notify(queue.index());
+    }
+}
+
+PacketMetadata VirtIONetworkAdapter::receive_metadata(NetHeader const& header) {
+    PacketMetadata metadata;
+    if (header.flags & (NetHeader::DataValid | NetHeader::NeedsChecksum)) {
+        metadata.flags = PacketMetadata::ChecksumValid;
+    }
+
+    return metadata;
+}
+
+VirtIONetworkAdapter::TransmitQueue& VirtIONetworkAdapter::transmit_queue() {
+    return *m_transmit_queues[Processor::instance().id() % m_queue_pairs];
+}
+
+void VirtIONetworkAdapter::begin_transmit_batch() {
+    auto& tx = this->transmit_queue();
+
+    tx.lock.lock();
+    tx.batch_depth++;
+}
+
+void VirtIONetworkAdapter::end_transmit_batch() {
+    auto& tx = this->transmit_queue();
+    if (!--tx.batch_depth) {
+        this->flush(tx);
+    }
+
+    tx.lock.unlock();
+}
+
+void VirtIONetworkAdapter::reclaim(TransmitQueue& tx) {
+    auto& queue = *tx.queue;
+    while (queue.has_available_data()) {
+        auto chain = queue.dequeue();
+
+        tx.buffers[chain.start()] = nullptr; // Hands the buffer back to the pool
+        chain.release();
+    }
+}
+
+RefPtr<PacketBuffer> VirtIONetworkAdapter::wait_for_room(TransmitQueue& tx, PacketBufferPool& pool) {
+    this->reclaim(tx);
+
+    RefPtr<PacketBuffer> buffer = tx.queue->free_descriptors() ? pool.allocate() : nullptr;
+    if (buffer) {
+        return buffer;
+    }
+
+    // The device won't get to anything we haven't told it about yet
+    this->flush(tx);
+
+    WaitQueueBlocker blocker;
+    tx.wait_queue.add(&blocker);
+
+    tx.queue->set_interrupts_enabled(true);
+    while (true) {
+        blocker.reset();
+
+        this->reclaim(tx);
+        if (tx.queue->free_descriptors()) {
+            buffer = pool.allocate();
+            if (buffer) {
+                break;
+            }
+        }
+
+        blocker.wait();
+    }
+
+    tx.queue->set_interrupts_enabled(false);
+    tx.wait_queue.remove(&blocker);
+
+    return buffer;
+}
+
+void VirtIONetworkAdapter::transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) {
+    auto& tx = this->transmit_queue();
+    ScopedLock lock(tx.lock);
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += fragments[i].size;
+    }
+
+    auto& pool = metadata.mss ? *tx.gso_pool : *m_transmit_pool;
+    if (!size || m_header_size + size > pool.buffer_size()) {
+        return;
+    }
+
+    auto buffer = this->wait_for_room(tx, pool);
+    u8* data = buffer->data();
+
+    auto* header = reinterpret_cast<NetHeader*>(data);
+    memset(header, 0, m_header_size);
+
+    if (metadata.flags & PacketMetadata::NeedsChecksum) {
+        header->flags = NetHeader::NeedsChecksum;
+        header->checksum_start = metadata.checksum_start;
+        header->checksum_offset = metadata.checksum_offset;
+    }
+
+    if (metadata.mss) {
+        header->gso_type = NetHeader::TCPv4;
+        header->gso_size = metadata.mss;
+        header->header_length = metadata.header_size;
+    }
+
+    data += m_header_size;
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(data, fragments[i].data, fragments[i].size);
+        data += fragments[i].size;
+    }
+
+    auto chain = tx.queue->create_chain();
+    chain.add_buffer(buffer->physical_address(), m_header_size + size, false);
+
+    tx.buffers[chain.start()] = move(buffer);
+    chain.submit();
+
+    tx.has_pending = true;
+    if (!tx.batch_depth) {
+        this->flush(tx);
+    }
+}
+
+void VirtIONetworkAdapter::flush(TransmitQueue& tx) {
+    if (!tx.has_pending) {
+        return;
+    }
+
+    tx.has_pending = false;
+    if (tx.queue->should_notify()) {
+        (void)this->notify(tx.queue->index());
+    }
+}
+
+}
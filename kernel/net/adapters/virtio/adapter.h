@@ -0,0 +1,111 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/virtio/device.h>
+#include <kernel/net/adapter.h>
+#include <kernel/net/ethernet.h>
+#include <kernel/net/adapters/virtio/virtio.h>
+#include <kernel/process/wait_queue.h>
+#include <kernel/sync/mutex.h>
+#include <kernel/pci/pci.h>
+
+#include <std/memory.h>
+#include <std/vector.h>
+
+namespace kernel::net {
+
+// https://docs.oasis-open.org/virtio/virtio/v1.2/virtio-v1.2.html (section 5.1)
+class VirtIONetworkAdapter : public NetworkAdapter, public virtio::Device {
+public:
+    // Every receive buffer holds a header followed by (a part of) a frame. With mergeable buffers a frame larger than
+    // this is spread over several of them and gathered into a buffer from `m_merge_pool`.
+    static constexpr size_t RX_BUFFER_SIZE = 2048;
+    static constexpr size_t TX_BUFFER_SIZE = 2048;
+
+    // Large enough for the biggest segment the host can hand us with GUEST_TSO
+    static constexpr size_t MERGED_BUFFER_SIZE = sizeof(EthernetFrame) + 0xFFFF;
+    static constexpr size_t MERGE_POOL_SIZE = 32;
+
+    // Frames the host segments for us (HOST_TSO4) are copied into these instead of the regular transmit buffers
+    static constexpr size_t GSO_BUFFER_SIZE = sizeof(virtio::NetHeader) + sizeof(EthernetFrame) + MAX_GSO_SIZE;
+    static constexpr size_t GSO_POOL_SIZE = 16;
+
+    // We don't set up more queues than this, even if the device offers them
+    static constexpr size_t MAX_QUEUE_PAIRS = 16;
+
+    static RefPtr<NetworkAdapter> create(pci::Device);
+
+    Type type() const override { return Type::Ethernet; }
+
+    void begin_transmit_batch() override;
+    void end_transmit_batch() override;
+
+private:
+    struct ReceiveQueue {
+        virtio::Queue* queue;
+        Vector<RefPtr<PacketBuffer>> buffers; // Indexed by the descriptor each buffer was posted with
+    };
+
+    // Only ever touched by senders holding `lock`, the IRQ handler merely wakes up whoever waits for room
+    struct TransmitQueue {
+        virtio::Queue* queue;
+        Vector<RefPtr<PacketBuffer>> buffers;
+
+        // Per queue so that a sender waiting for one only ever depends on its own queue's completions
+        OwnPtr<PacketBufferPool> gso_pool;
+
+        Mutex lock;
+        WaitQueue wait_queue;
+
+        size_t batch_depth = 0;
+        bool has_pending = false; // Chains were submitted since the device was last notified
+    };
+
+    VirtIONetworkAdapter(pci::Device);
+
+    ErrorOr<void> initialize();
+    ErrorOr<void> set_queue_pairs(u16 pairs);
+
+    void handle_queue_irq(virtio::Queue&) override;
+    void handle_config_change() override;
+
+    void transmit(PacketFragment const* fragments, size_t count, PacketMetadata const& metadata) override;
+
+    // Picks the queue pair of the processor we're running on
+    TransmitQueue& transmit_queue();
+
+    void reclaim(TransmitQueue&);
+    void flush(TransmitQueue&);
+
+    // Waits until there's both a free descriptor and a free buffer in `pool`, which is returned
+    RefPtr<PacketBuffer> wait_for_room(TransmitQueue&, PacketBufferPool& pool);
+
+    void receive(ReceiveQueue&);
+    void post_buffer(ReceiveQueue&, RefPtr<PacketBuffer>);
+
+    // Frames that are known to be intact (VIRTIO_NET_HDR_F_DATA_VALID) or that never left the host and only carry a
+    // partial checksum (VIRTIO_NET_HDR_F_NEEDS_CSUM) don't need to be verified again
+    static PacketMetadata receive_metadata(virtio::NetHeader const&);
+
+    u16 receive_queue_index(size_t pair) const { return pair * 2; }
+    u16 transmit_queue_index(size_t pair) const { return pair * 2 + 1; }
+
+    virtio::Configuration* m_device_config = nullptr;
+
+    size_t m_header_size = sizeof(virtio::NetHeader);
+    bool m_mergeable_buffers = false;
+
+    size_t m_queue_pairs = 1;
+    u16 m_control_queue_index = 0;
+    bool m_has_control_queue = false;
+
+    Vector<ReceiveQueue> m_receive_queues;
+    Vector<OwnPtr<TransmitQueue>> m_transmit_queues;
+
+    OwnPtr<PacketBufferPool> m_transmit_pool;
+    OwnPtr<PacketBufferPool> m_merge_pool;
+
+    u8* m_control_buffer = nullptr;
+};
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <kernel/virtio/virtio.h>
+
+namespace kernel::virtio {
+
+// Section 5.1.3
+#define VIRTIO_NET_F_CSUM         ((u64)1 << 0)
+#define VIRTIO_NET_F_GUEST_CSUM   ((u64)1 << 1)
+#define VIRTIO_NET_F_MTU          ((u64)1 << 3)
+#define VIRTIO_NET_F_MAC          ((u64)1 << 5)
+#define VIRTIO_NET_F_GUEST_TSO4   ((u64)1 << 7)
+#define VIRTIO_NET_F_GUEST_TSO6   ((u64)1 << 8)
+#define VIRTIO_NET_F_HOST_TSO4    ((u64)1 << 11)
+#define VIRTIO_NET_F_MRG_RXBUF    ((u64)1 << 15)
+#define VIRTIO_NET_F_STATUS       ((u64)1 << 16)
+#define VIRTIO_NET_F_CTRL_VQ      ((u64)1 << 17)
+#define VIRTIO_NET_F_MQ           ((u64)1 << 22)
+
+// Transitional devices keep the legacy device ID but still expose the modern interface
+constexpr u16 TRANSITIONAL_NETWORK_CARD_ID = 0x1000;
+
+// Section 5.1.4
+enum class NetDeviceConfig : u32 {
+    MAC = 0x00,
+    Status = 0x06,
+    MaxVirtqueuePairs = 0x08,
+    MTU = 0x0A,
+};
+
+enum NetStatus : u16 {
+    NetLinkUp = 1,
+    NetAnnounce = 2,
+};
+
+// Section 5.1.6, precedes every frame in both directions
+struct NetHeader {
+    enum Flags : u8 {
+        NeedsChecksum = 1,
+        DataValid = 2,
+        RSCInfo = 4,
+    };
+
+    enum GSOType : u8 {
+        None = 0,
+        TCPv4 = 1,
+        UDP = 3,
+        TCPv6 = 4,
+        ECN = 0x80,
+    };
+
+    u8 flags;
+    u8 gso_type;
+    u16 header_length;
+    u16 gso_size;
+    u16 checksum_start;
+    u16 checksum_offset;
+    u16 num_buffers; // Only present with VIRTIO_F_VERSION_1 or VIRTIO_NET_F_MRG_RXBUF
+} PACKED;
+
+// Without VIRTIO_F_VERSION_1 or VIRTIO_NET_F_MRG_RXBUF the header ends before `num_buffers`
+constexpr size_t LEGACY_NET_HEADER_SIZE = 10;
+
+// Section 5.1.6.5
+enum class NetControlClass : u8 {
+    Rx = 0,
+    MACTable = 1,
+    VLAN = 2,
+    GuestAnnounce = 3,
+    Multiqueue = 4,
+    GuestOffloads = 5,
+};
+
+enum class NetControlMultiqueue : u8 {
+    SetQueuePairs = 0,
+};
+
+enum class NetControlAck : u8 {
+    Ok = 0,
+    Error = 1,
+};
+
+struct NetControlHeader {
+    u8 control_class;
+    u8 command;
+} PACKED;
+
+constexpr u16 NET_MAX_QUEUE_PAIRS = 0x8000;
+
+}
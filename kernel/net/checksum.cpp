@@ -0,0 +1,110 @@
+#include <kernel/net/checksum.h>
+
+#include <std/endian.h>
+#include <std/cstring.h>
+
+namespace kernel::net {
+
+// The kernel can't touch the vector registers, so the data is summed 32 bits at a time into a 64-bit accumulator
+// instead, four 8-byte loads per iteration. The carries of the 32-bit halves pile up in the upper half of the
+// accumulator and are folded back in once at the end, which gives the same ones' complement sum as adding up
+// 16-bit words one by one (RFC 1071, section 2). Words are summed in host order and swapped once at the end.
+u32 checksum_add(u32 sum, void const* data, size_t size) {
+    auto* bytes = reinterpret_cast<u8 const*>(data);
+    u64 wide = 0;
+
+    while (size >= 32) {
+        u64 words[4];
+        memcpy(words, bytes, sizeof(words));
+
+        wide += (words[0] & 0xFFFFFFFF) + (words[0] >> 32);
+        wide += (words[1] & 0xFFFFFFFF) + (words[1] >> 32);
+        wide += (words[2] & 0xFFFFFFFF) + (words[2] >> 32);
+        wide += (words[3] & 0xFFFFFFFF) + (words[3] >> 32);
+
+        bytes += 32;
+        size -= 32;
+    }
+
+    while (size >= 4) {
+        u32 word;
+        memcpy(&word, bytes, sizeof(word));
+
+        wide += word;
+
+        bytes += 4;
+        size -= 4;
+    }
+
+    if (size >= 2) {
+        u16 word;
+        memcpy(&word, bytes, sizeof(word));
+
+        wide += word;
+
+        bytes += 2;
+        size -= 2;
+    }
+
+    // A trailing byte is padded with a zero byte after it
+    if (size) {
+        u8 word[2] = { bytes[0], 0 };
+        u16 value;
+
+        memcpy(&value, word, sizeof(value));
+        wide += value;
+    }
+
+    while (wide >> 16) {
+        wide = (wide & 0xFFFF) + (wide >> 16);
+    }
+
+    sum += std::from_big_endian(static_cast<u16>(wide));
+    if (sum & 0x80000000) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return sum;
+}
+
+u32 checksum_add(u32 sum, PacketFragment const* fragments, size_t count) {
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        u32 partial = checksum_add(0, fragments[i].data, fragments[i].size);
+        while (partial >> 16) {
+            partial = (partial & 0xFFFF) + (partial >> 16);
+        }
+
+        // A fragment starting at an odd offset pairs its bytes the other way around, which swaps the bytes of its sum (RFC 1071)
+        if (offset & 1) {
+            partial = ((partial & 0xFF) << 8) | (partial >> 8);
+        }
+
+        sum += partial;
+        if (sum & 0x80000000) {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+
+        offset += fragments[i].size;
+    }
+
+    return sum;
+}
+
+u16 checksum_fold(u32 sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return sum;
+}
+
+u16 checksum_finish(u32 sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return ~sum & 0xFFFF;
+}
+
+}
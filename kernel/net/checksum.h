@@ -0,0 +1,47 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/packet_buffer.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/net/ip/ipv6.h>
+
+namespace kernel::net {
+
+// Adds `size` bytes (interpreted as big-endian 16-bit words) to a running ones' complement sum
+u32 checksum_add(u32 sum, void const* data, size_t size);
+
+// Sums the fragments as if they were one contiguous buffer, fragments may have an odd size
+u32 checksum_add(u32 sum, PacketFragment const* fragments, size_t count);
+
+// Folds the carries back into the sum without complementing it, e.g. to seed a checksum the hardware finishes
+u16 checksum_fold(u32 sum);
+
+// Folds the carries back into the sum and returns its complement in host order
+u16 checksum_finish(u32 sum);
+
+inline u16 internet_checksum(void const* data, size_t size) {
+    return checksum_finish(checksum_add(0, data, size));
+}
+
+// Running sum of the IPv4 pseudo header that TCP and UDP checksums start out with
+inline u32 ipv4_pseudo_header_sum(IPv4Address source, IPv4Address destination, u8 protocol, u16 length) {
+    IPv4PseudoHeader pseudo;
+    pseudo.source = source;
+    pseudo.destination = destination;
+    pseudo.protocol = protocol;
+    pseudo.length = length;
+
+    return checksum_add(0, &pseudo, sizeof(IPv4PseudoHeader));
+}
+
+inline u32 ipv6_pseudo_header_sum(IPv6Address const& source, IPv6Address const& destination, u8 next_header, u32 length) {
+    IPv6PseudoHeader pseudo;
+    pseudo.source = source;
+    pseudo.destination = destination;
+    pseudo.next_header = next_header;
+    pseudo.length = length;
+
+    return checksum_add(0, &pseudo, sizeof(IPv6PseudoHeader));
+}
+
+}
@@ -0,0 +1,86 @@
+#include <kernel/net/flow.h>
+#include <kernel/net/ethernet.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/net/ip/ipv6.h>
+
+namespace kernel::net {
+
+// The key from Microsoft's RSS specification, which NICs default to as well
+static constexpr u8 TOEPLITZ_KEY[] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+// Addresses and ports, as they appear on the wire
+static constexpr size_t MAX_INPUT_SIZE = 36;
+static_assert(sizeof(TOEPLITZ_KEY) >= MAX_INPUT_SIZE + 4);
+
+static u32 toeplitz_hash(u8 const* input, size_t size) {
+    u32 hash = 0;
+    u32 window = (TOEPLITZ_KEY[0] << 24) | (TOEPLITZ_KEY[1] << 16) | (TOEPLITZ_KEY[2] << 8) | TOEPLITZ_KEY[3];
+
+    // Every set input bit XORs in the 32 key bits starting at its own position
+    for (size_t i = 0; i < size; i++) {
+        u8 next = TOEPLITZ_KEY[i + 4];
+        for (int bit = 7; bit >= 0; bit--) {
+            if (input[i] & (1 << bit)) {
+                hash ^= window;
+            }
+
+            window = (window << 1) | ((next >> bit) & 1);
+        }
+    }
+
+    return hash;
+}
+
+static u32 ipv6_flow_hash(EthernetFrame const* frame, size_t size) {
+    auto* ipv6 = reinterpret_cast<IPv6Packet const*>(frame->payload);
+
+    u8 input[MAX_INPUT_SIZE];
+    size_t input_size = 32;
+
+    memcpy(input, ipv6->source.bytes(), 16);
+    memcpy(input + 16, ipv6->destination.bytes(), 16);
+
+    // Ports are only looked for right after the fixed header, flows behind extension headers just hash their addresses
+    bool has_ports = ipv6->next_header == IPv6NextHeader::TCP || ipv6->next_header == IPv6NextHeader::UDP;
+    if (has_ports && size >= sizeof(EthernetFrame) + sizeof(IPv6Packet) + 4) {
+        memcpy(input + 32, ipv6->payload, 4);
+        input_size = 36;
+    }
+
+    return toeplitz_hash(input, input_size);
+}
+
+u32 flow_hash(u8 const* data, size_t size) {
+    auto* frame = reinterpret_cast<EthernetFrame const*>(data);
+    if (size >= sizeof(EthernetFrame) + sizeof(IPv6Packet) && frame->type == EtherType::IPv6) {
+        return ipv6_flow_hash(frame, size);
+    } else if (size < sizeof(EthernetFrame) + sizeof(IPv4Packet) || frame->type != EtherType::IPv4) {
+        return 0;
+    }
+
+    auto* ipv4 = reinterpret_cast<IPv4Packet const*>(frame->payload);
+    size_t header_size = ipv4->header_size();
+
+    u8 input[MAX_INPUT_SIZE];
+    size_t input_size = 8;
+
+    memcpy(input, &ipv4->source, 4);
+    memcpy(input + 4, &ipv4->destination, 4);
+
+    // More fragments (0x2000) or a fragment offset
+    bool is_fragment = ipv4->flags_and_fragment_offset & 0x3FFF;
+    bool has_ports = ipv4->protocol == IPProtocol::TCP || ipv4->protocol == IPProtocol::UDP;
+
+    if (has_ports && !is_fragment && size >= sizeof(EthernetFrame) + header_size + 4) {
+        memcpy(input + 8, frame->payload + header_size, 4);
+        input_size = 12;
+    }
+
+    return toeplitz_hash(input, input_size);
+}
+
+}
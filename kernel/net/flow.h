@@ -0,0 +1,12 @@
+#pragma once
+
+#include <kernel/common.h>
+
+namespace kernel::net {
+
+// Toeplitz hash (as used by receive side scaling) over the IP addresses and, for TCP and UDP, the ports of a frame
+// starting with its Ethernet header. Frames of the same flow always hash the same, anything that isn't IP hashes to 0.
+// Fragments only hash their addresses, as only the first one carries the ports.
+u32 flow_hash(u8 const* frame, size_t size);
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <std/endian.h>
+
+namespace kernel::net {
+
+struct ICMPType {
+    enum : u8 {
+        EchoReply = 0,
+        DestinationUnreachable = 3,
+        EchoRequest = 8,
+        TimeExceeded = 11,
+    };
+};
+
+struct ICMPUnreachableCode {
+    enum : u8 {
+        FragmentationNeeded = 4,
+    };
+};
+
+struct ICMPPacket {
+    u8 type;
+    u8 code;
+    std::NetworkOrder<u16> checksum;
+
+    // Depends on the type. For "fragmentation needed" the low half holds the MTU of the next hop (RFC 1191).
+    std::NetworkOrder<u32> rest;
+
+    // For errors, the IPv4 header of the offending datagram and the first 8 bytes of its payload
+    u8 data[];
+} PACKED;
+
+}
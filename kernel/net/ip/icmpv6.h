@@ -0,0 +1,68 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/mac.h>
+#include <kernel/net/ip/ipv6.h>
+
+#include <std/endian.h>
+
+namespace kernel::net {
+
+struct ICMPv6Type {
+    enum : u8 {
+        EchoRequest = 128,
+        EchoReply = 129,
+        NeighborSolicitation = 135,
+        NeighborAdvertisement = 136,
+    };
+};
+
+struct ICMPv6Packet {
+    u8 type;
+    u8 code;
+    std::NetworkOrder<u16> checksum;
+    u8 data[];
+} PACKED;
+
+// Neighbor solicitations and advertisements share their layout (RFC 4861 sections 4.3 and 4.4)
+struct NeighborMessage {
+    enum Flags : u32 {
+        Router = 1u << 31,
+        Solicited = 1u << 30,
+        Override = 1u << 29,
+    };
+
+    u8 type;
+    u8 code;
+    std::NetworkOrder<u16> checksum;
+    std::NetworkOrder<u32> flags; // Reserved for solicitations
+    IPv6Address target;
+    u8 options[0];
+} PACKED;
+
+struct NeighborOptionType {
+    enum : u8 {
+        SourceLinkLayerAddress = 1,
+        TargetLinkLayerAddress = 2,
+    };
+};
+
+// Options are counted in units of 8 bytes, which the Ethernet address option fills exactly
+struct LinkLayerAddressOption {
+    u8 type;
+    u8 length;
+    MACAddress address;
+} PACKED;
+
+static_assert(sizeof(LinkLayerAddressOption) == 8);
+
+// The only neighbor messages we send carry our own Ethernet address and nothing else. Both members are packed already,
+// so this needs no `PACKED` (which GCC ignores for non-POD members anyway).
+struct NeighborMessageWithAddress {
+    NeighborMessage message;
+    LinkLayerAddressOption option;
+};
+
+static_assert(sizeof(NeighborMessageWithAddress) == 32);
+
+}
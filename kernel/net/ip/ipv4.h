@@ -46,6 +46,14 @@ public:
         return m_value.m_address;
     }
 
+    bool is_zero() const { return m_value.m_address == 0; }
+    bool is_loopback() const { return m_value.m_bytes[0] == 127; }
+    bool is_broadcast() const { return m_value.m_address == 0xFFFFFFFF; }
+
+    IPv4Address operator&(const IPv4Address& other) const {
+        return IPv4Address(m_value.m_address & other.m_value.m_address);
+    }
+
     String to_string() const {
         return std::format(
             "{}.{}.{}.{}",
@@ -62,11 +70,12 @@ private:
     } PACKED m_value;
 };
 
+// Bitfields are allocated starting from the least significant bit so the low nibble/bits come first
 struct IPv4Packet {
-    u8 version : 4;
     u8 ihl : 4;
-    u8 dscp : 6;
+    u8 version : 4;
     u8 ecn : 2;
+    u8 dscp : 6;
     std::NetworkOrder<u16> length;
     std::NetworkOrder<u16> identification;
     std::NetworkOrder<u16> flags_and_fragment_offset;
@@ -76,10 +85,29 @@ struct IPv4Packet {
     IPv4Address source;
     IPv4Address destination;
     u8 payload[0];
+
+    size_t header_size() const { return ihl * 4; }
+    size_t payload_size() const { return length - header_size(); }
+} PACKED;
+
+// Prepended to the transport header when computing TCP and UDP checksums
+struct IPv4PseudoHeader {
+    IPv4Address source;
+    IPv4Address destination;
+    u8 zero = 0;
+    u8 protocol;
+    std::NetworkOrder<u16> length;
 } PACKED;
 
 }
 
+template<>
+struct std::traits::Hash<kernel::net::IPv4Address> {
+    static size_t hash(kernel::net::IPv4Address const& address) {
+        return Hash<u32>::hash(address.value());
+    }
+};
+
 template<>
 struct std::Formatter<kernel::net::IPv4Address> {
     static void format(FormatBuffer& buffer, const kernel::net::IPv4Address& value, const FormatStyle& style) {
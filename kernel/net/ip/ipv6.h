@@ -0,0 +1,188 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/mac.h>
+
+#include <std/format.h>
+#include <std/endian.h>
+
+namespace kernel::net {
+
+struct IPv6NextHeader {
+    enum : u8 {
+        HopByHopOptions = 0,
+        TCP = 6,
+        UDP = 17,
+        Routing = 43,
+        Fragment = 44,
+        ICMPv6 = 58,
+        NoNextHeader = 59,
+        DestinationOptions = 60,
+    };
+};
+
+class IPv6Address {
+public:
+    constexpr IPv6Address() = default;
+
+    explicit IPv6Address(u8 const* bytes) {
+        memcpy(m_bytes, bytes, 16);
+    }
+
+    static constexpr IPv6Address loopback() {
+        IPv6Address address;
+        address.m_bytes[15] = 1;
+
+        return address;
+    }
+
+    // ff02::1
+    static constexpr IPv6Address all_nodes() {
+        IPv6Address address;
+        address.m_bytes[0] = 0xFF;
+        address.m_bytes[1] = 0x02;
+        address.m_bytes[15] = 1;
+
+        return address;
+    }
+
+    // fe80::/64 with an interface identifier made from the MAC address (modified EUI-64, RFC 4291 appendix A)
+    static IPv6Address link_local(MACAddress const& mac) {
+        IPv6Address address;
+
+        address.m_bytes[0] = 0xFE;
+        address.m_bytes[1] = 0x80;
+
+        address.m_bytes[8] = mac[0] ^ 0x02; // Universal/local bit
+        address.m_bytes[9] = mac[1];
+        address.m_bytes[10] = mac[2];
+        address.m_bytes[11] = 0xFF;
+        address.m_bytes[12] = 0xFE;
+        address.m_bytes[13] = mac[3];
+        address.m_bytes[14] = mac[4];
+        address.m_bytes[15] = mac[5];
+
+        return address;
+    }
+
+    // ff02::1:ffXX:XXXX, which neighbor solicitations for this address are sent to (RFC 4291 section 2.7.1)
+    IPv6Address solicited_node() const {
+        IPv6Address address;
+
+        address.m_bytes[0] = 0xFF;
+        address.m_bytes[1] = 0x02;
+        address.m_bytes[11] = 0x01;
+        address.m_bytes[12] = 0xFF;
+        address.m_bytes[13] = m_bytes[13];
+        address.m_bytes[14] = m_bytes[14];
+        address.m_bytes[15] = m_bytes[15];
+
+        return address;
+    }
+
+    // Multicast addresses map onto 33:33 followed by their last 32 bits (RFC 2464 section 7)
+    MACAddress multicast_mac() const {
+        return { 0x33, 0x33, m_bytes[12], m_bytes[13], m_bytes[14], m_bytes[15] };
+    }
+
+    u8 operator[](size_t index) const { return m_bytes[index]; }
+    u8 const* bytes() const { return m_bytes; }
+
+    bool operator==(IPv6Address const& other) const { return memcmp(m_bytes, other.m_bytes, 16) == 0; }
+    bool operator!=(IPv6Address const& other) const { return !(*this == other); }
+
+    bool is_zero() const { return *this == IPv6Address(); }
+    bool is_loopback() const { return *this == loopback(); }
+    bool is_multicast() const { return m_bytes[0] == 0xFF; }
+    bool is_link_local() const { return m_bytes[0] == 0xFE && (m_bytes[1] & 0xC0) == 0x80; }
+
+    // The longest run of zero groups is shortened to "::" (RFC 5952)
+    String to_string() const {
+        u16 groups[8];
+        for (size_t i = 0; i < 8; i++) {
+            groups[i] = (m_bytes[i * 2] << 8) | m_bytes[i * 2 + 1];
+        }
+
+        size_t zeros_start = 8, zeros_length = 0;
+        for (size_t i = 0; i < 8;) {
+            size_t length = 0;
+            while (i + length < 8 && !groups[i + length]) {
+                length++;
+            }
+
+            if (length > zeros_length && length > 1) {
+                zeros_start = i;
+                zeros_length = length;
+            }
+
+            i += length ? length : 1;
+        }
+
+        String result;
+        for (size_t i = 0; i < 8; i++) {
+            if (i == zeros_start) {
+                result.append("::");
+                i += zeros_length - 1;
+
+                continue;
+            } else if (i && i != zeros_start + zeros_length) {
+                result.append(':');
+            }
+
+            result.append(std::format("{:x}", groups[i]));
+        }
+
+        return result;
+    }
+
+private:
+    u8 m_bytes[16] = {};
+} PACKED;
+
+struct IPv6Packet {
+    std::NetworkOrder<u32> version_class_and_flow; // 4 bits version, 8 bits traffic class, 20 bits flow label
+    std::NetworkOrder<u16> payload_length;
+    u8 next_header;
+    u8 hop_limit;
+    IPv6Address source;
+    IPv6Address destination;
+    u8 payload[0];
+
+    u8 version() const { return version_class_and_flow >> 28; }
+} PACKED;
+
+// Every extension header we skip over starts like this, the length is counted in units of 8 bytes not including the first
+struct IPv6ExtensionHeader {
+    u8 next_header;
+    u8 length;
+} PACKED;
+
+// Prepended to the upper layer message when computing ICMPv6, TCP and UDP checksums (RFC 8200 section 8.1)
+struct IPv6PseudoHeader {
+    IPv6Address source;
+    IPv6Address destination;
+    std::NetworkOrder<u32> length;
+    u8 zero[3] = {};
+    u8 next_header;
+} PACKED;
+
+}
+
+template<>
+struct std::traits::Hash<kernel::net::IPv6Address> {
+    static size_t hash(kernel::net::IPv6Address const& address) {
+        size_t hash = 0;
+        for (size_t i = 0; i < 16; i++) {
+            hash = hash * 31 + address[i];
+        }
+
+        return hash;
+    }
+};
+
+template<>
+struct std::Formatter<kernel::net::IPv6Address> {
+    static void format(FormatBuffer& buffer, const kernel::net::IPv6Address& value, const FormatStyle& style) {
+        Formatter<String>::format(buffer, value.to_string(), style);
+    }
+};
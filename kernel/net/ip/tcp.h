@@ -5,18 +5,47 @@
 
 namespace kernel::net {
 
+struct TCPFlags {
+    enum : u8 {
+        FIN = 1 << 0,
+        SYN = 1 << 1,
+        RST = 1 << 2,
+        PSH = 1 << 3,
+        ACK = 1 << 4,
+        URG = 1 << 5
+    };
+};
+
+struct TCPOption {
+    enum : u8 {
+        End = 0,
+        NOP = 1,
+        MSS = 2,
+        WindowScale = 3
+    };
+};
+
+// Bitfields are allocated starting from the least significant bit, so `data_offset` ends up in the high nibble
 struct TCPPacket {
     std::NetworkOrder<u16> source_port;
     std::NetworkOrder<u16> destination_port;
     std::NetworkOrder<u32> sequence_number;
     std::NetworkOrder<u32> ack_number;
-    std::NetworkOrder<u8> data_offset;
-    std::NetworkOrder<u8> flags;
-    // std::NetworkOrder<u16> flags_and_data_offset;
+    u8 reserved : 4;
+    u8 data_offset : 4;
+    u8 flags;
     std::NetworkOrder<u16> window_size;
     std::NetworkOrder<u16> checksum;
     std::NetworkOrder<u16> urgent_pointer;
     u8 data[];
+
+    size_t header_size() const { return data_offset * 4; }
+    bool has_flag(u8 flag) const { return flags & flag; }
+
+    u8 const* options() const { return data; }
+    size_t options_size() const { return this->header_size() - sizeof(TCPPacket); }
+
+    u8 const* payload() const { return reinterpret_cast<u8 const*>(this) + this->header_size(); }
 } PACKED;
 
-}
\ No newline at end of file
+}
@@ -1,15 +1,16 @@
 #pragma once
 
 #include <kernel/common.h>
+#include <std/endian.h>
 
 namespace kernel::net {
 
 struct UDPPacket {
-    u16 source_port;
-    u16 destination_port;
-    u16 length;
-    u16 checksum;
+    std::NetworkOrder<u16> source_port;
+    std::NetworkOrder<u16> destination_port;
+    std::NetworkOrder<u16> length;
+    std::NetworkOrder<u16> checksum;
     u8 data[];
 } PACKED;
 
-}
\ No newline at end of file
+}
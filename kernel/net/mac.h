@@ -21,6 +21,8 @@ public:
         m_data[5] = f;
     }
 
+    static constexpr MACAddress broadcast() { return { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }; }
+
     constexpr u8& operator[](size_t index) { return m_data[index]; }
     constexpr u8 const& operator[](size_t index) const { return m_data[index]; }
 
@@ -1,31 +1,45 @@
 #include <kernel/net/manager.h>
+#include <kernel/net/flow.h>
 
 #include <kernel/net/ip/tcp.h>
 #include <kernel/net/ip/udp.h>
+#include <kernel/net/ip/icmp.h>
+#include <kernel/net/ip/icmpv6.h>
+#include <kernel/net/checksum.h>
+
+#include <kernel/net/udp_socket.h>
+#include <kernel/net/tcp_socket.h>
 
 #include <kernel/net/adapters/e1000.h>
+#include <kernel/net/adapters/virtio/adapter.h>
 #include <kernel/net/adapters/loopback.h>
 
 #include <kernel/process/process.h>
 #include <kernel/process/scheduler.h>
+#include <kernel/time/manager.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/posix/sys/ioctl.h>
 
 namespace kernel {
 
 static constexpr bool NET_DEBUG = false;
 
-void handle_packet(net::NetworkAdapter& adapter, u8* data, size_t size);
+void handle_packet(net::NetworkAdapter& adapter, net::Packet& packet);
 
 void handle_arp_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size);
-void handle_ipv4_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size);
+void handle_ipv4_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size, net::PacketMetadata const& metadata);
+void dispatch_ipv4_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size, net::PacketMetadata const& metadata);
 void handle_ipv6_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size);
 
-void handle_tcp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size);
-void handle_udp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size);
+void handle_tcp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size, net::PacketMetadata const& metadata);
+void handle_udp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size, net::PacketMetadata const& metadata);
 void handle_icmp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size);
+void handle_icmpv6_packet(net::NetworkAdapter& adapter, net::IPv6Packet* packet, u8* data, size_t size);
 
 using NetworkAdapterInitializer = RefPtr<net::NetworkAdapter> (*)(pci::Device);
 
 static constexpr NetworkAdapterInitializer s_network_initializers[] = {
+    net::VirtIONetworkAdapter::create,
     net::E1000NetworkAdapter::create,
 };
 
@@ -68,6 +82,47 @@ void NetworkManager::spawn() {
 
     m_thread = process->get_main_thread();
     Scheduler::add_process(process);
+
+    for (size_t i = 0; i < INDIRECTION_TABLE_SIZE; i++) {
+        m_indirection_table[i] = i % WORKER_COUNT;
+    }
+
+    for (auto& worker : m_workers) {
+        worker.thread = process->spawn("Network Worker", worker_entry, &worker);
+    }
+}
+
+void NetworkManager::worker_entry(void* data) {
+    s_instance.run_worker(*reinterpret_cast<Worker*>(data));
+}
+
+void NetworkManager::run_worker(Worker& worker) {
+    while (true) {
+        worker.blocker.set_pending(false);
+
+        SteeredPacket steered;
+        while (worker.queue.try_dequeue(steered)) {
+            handle_packet(*steered.adapter, steered.packet);
+
+            // Hands the buffer back to its pool
+            steered.packet.buffer = nullptr;
+            steered.adapter = nullptr;
+        }
+
+        worker.blocker.wait();
+    }
+}
+
+void NetworkManager::steer(net::NetworkAdapter& adapter, net::Packet packet) {
+    u32 hash = net::flow_hash(packet.data(), packet.size);
+    auto& worker = m_workers[m_indirection_table[hash % INDIRECTION_TABLE_SIZE]];
+
+    if (!worker.queue.try_enqueue({ RefPtr<net::NetworkAdapter>(&adapter), move(packet) })) {
+        adapter.drop_packet();
+        return;
+    }
+
+    worker.blocker.set_pending(true);
 }
 
 void NetworkManager::initialize() {
@@ -76,35 +131,291 @@ void NetworkManager::initialize() {
     auto loopback = net::LoopbackAdapter::create();
     s_instance.m_loopback_adapter = loopback;
 
-    s_instance.m_adapters.append(loopback);   
+    s_instance.m_adapters.append(loopback);
+    MUST(s_instance.configure(*loopback, loopback->ipv4_address(), loopback->ipv4_netmask()));
 
     s_instance.spawn();
 }
 
 void NetworkManager::wakeup() {
-    s_instance.m_blocker.set_value(true);
+    s_instance.m_blocker.set_pending(true);
+
+    // Adapters wake us from their IRQ handlers, which then switch to us right away instead of on the next tick
+    Scheduler::invoke_async();
+}
+
+void NetworkManager::schedule_timer(Duration deadline) {
+    arch::InterruptDisabler disabler;
+
+    Duration current = m_blocker.deadline();
+    if (current != Duration::zero() && current <= deadline) {
+        return;
+    }
+
+    m_blocker.set_deadline(deadline);
+    TimeManager::schedule_wakeup(deadline, CLOCK_MONOTONIC);
+}
+
+bool NetworkManager::TaskBlocker::should_unblock() {
+    if (m_pending) {
+        return true;
+    }
+
+    return m_deadline != Duration::zero() && TimeManager::query_time(CLOCK_MONOTONIC) >= m_deadline;
 }
 
 void NetworkManager::add_adapter(RefPtr<net::NetworkAdapter> adapter) {
     m_adapters.append(move(adapter));
 }
 
+int NetworkManager::index_of(net::NetworkAdapter const& adapter) const {
+    for (size_t i = 0; i < m_adapters.size(); i++) {
+        if (m_adapters[i].ptr() == &adapter) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+RefPtr<net::NetworkAdapter> NetworkManager::route(net::IPv4Address destination) const {
+    auto route = m_routing_table.lookup(destination);
+    if (!route.has_value()) {
+        return nullptr;
+    }
+
+    return route->adapter;
+}
+
+ErrorOr<void> NetworkManager::configure(net::NetworkAdapter& adapter, net::IPv4Address address, net::IPv4Address netmask) {
+    u8 prefix_length = TRY(net::RoutingTable::prefix_length(netmask));
+    bool is_loopback = adapter.type() == net::NetworkAdapter::Loopback;
+
+    auto previous = adapter.ipv4_address();
+    if (!previous.is_zero()) {
+        auto previous_length = net::RoutingTable::prefix_length(adapter.ipv4_netmask());
+        if (!previous_length.is_err()) {
+            (void)m_routing_table.remove(previous, previous_length.value());
+        }
+
+        if (!is_loopback) {
+            (void)m_routing_table.remove(previous, 32);
+        }
+    }
+
+    // Whatever was learned with the old address may not be true anymore
+    m_arp_cache.flush(adapter);
+
+    adapter.set_ipv4_address(address);
+    adapter.set_ipv4_netmask(netmask);
+
+    if (address.is_zero()) {
+        return {};
+    }
+
+    TRY(m_routing_table.add({ address & netmask, prefix_length, {}, RefPtr<net::NetworkAdapter>(&adapter) }, true));
+
+    // Frames sent to our own address never leave the machine
+    if (!is_loopback) {
+        TRY(m_routing_table.add({ address, 32, {}, m_loopback_adapter }, true));
+    }
+
+    return {};
+}
+
+ErrorOr<RefPtr<net::NetworkAdapter>> NetworkManager::get_adapter(int index) const {
+    if (index < 0 || index >= static_cast<int>(m_adapters.size())) {
+        return Error(ENODEV);
+    }
+
+    return m_adapters[index];
+}
+
+ErrorOr<int> NetworkManager::ioctl(unsigned request, unsigned arg) {
+    auto* process = Process::current();
+    switch (request) {
+        case SIOCGIFCONF: {
+            auto* table = reinterpret_cast<net_table_request*>(arg);
+            process->validate_read(table, sizeof(net_table_request));
+
+            size_t count = std::min<size_t>(std::max(table->count, 0), m_adapters.size());
+            auto* out = reinterpret_cast<net_interface*>(table->entries);
+            process->validate_write(out, count * sizeof(net_interface));
+
+            for (size_t i = 0; i < count; i++) {
+                auto& adapter = m_adapters[i];
+
+                out[i].index = i;
+                out[i].type = adapter->type();
+                out[i].address = adapter->ipv4_address().value();
+                out[i].netmask = adapter->ipv4_netmask().value();
+                out[i].mtu = adapter->mtu();
+
+                for (size_t j = 0; j < 6; j++) {
+                    out[i].mac[j] = adapter->mac_address()[j];
+                }
+            }
+
+            return static_cast<int>(m_adapters.size());
+        }
+        case SIOCSIFADDR: {
+            auto* interface = reinterpret_cast<net_interface*>(arg);
+            process->validate_read(interface, sizeof(net_interface));
+
+            auto adapter = TRY(this->get_adapter(interface->index));
+            TRY(this->configure(*adapter, net::IPv4Address(interface->address), net::IPv4Address(interface->netmask)));
+
+            return 0;
+        }
+        case SIOCGRTABLE: {
+            auto* table = reinterpret_cast<net_table_request*>(arg);
+            process->validate_read(table, sizeof(net_table_request));
+
+            auto routes = m_routing_table.routes();
+
+            size_t count = std::min<size_t>(std::max(table->count, 0), routes.size());
+            auto* out = reinterpret_cast<net_route*>(table->entries);
+            process->validate_write(out, count * sizeof(net_route));
+
+            for (size_t i = 0; i < count; i++) {
+                auto& route = routes[i];
+
+                out[i].destination = route.destination.value();
+                out[i].netmask = std::to_big_endian(net::RoutingTable::netmask(route.prefix_length));
+                out[i].gateway = route.gateway.value();
+                out[i].interface = this->index_of(*route.adapter);
+            }
+
+            return static_cast<int>(routes.size());
+        }
+        case SIOCADDRT: {
+            auto* entry = reinterpret_cast<net_route*>(arg);
+            process->validate_read(entry, sizeof(net_route));
+
+            net::Route route;
+
+            route.destination = net::IPv4Address(entry->destination);
+            route.prefix_length = TRY(net::RoutingTable::prefix_length(net::IPv4Address(entry->netmask)));
+            route.gateway = net::IPv4Address(entry->gateway);
+
+            // Without an explicit interface the route goes through whichever one reaches the gateway
+            if (entry->interface >= 0) {
+                route.adapter = TRY(this->get_adapter(entry->interface));
+            } else if (!route.gateway.is_zero()) {
+                route.adapter = this->route(route.gateway);
+            }
+
+            if (!route.adapter) {
+                return Error(ENETUNREACH);
+            }
+
+            TRY(m_routing_table.add(move(route)));
+            return 0;
+        }
+        case SIOCDELRT: {
+            auto* entry = reinterpret_cast<net_route*>(arg);
+            process->validate_read(entry, sizeof(net_route));
+
+            u8 prefix_length = TRY(net::RoutingTable::prefix_length(net::IPv4Address(entry->netmask)));
+            TRY(m_routing_table.remove(net::IPv4Address(entry->destination), prefix_length));
+
+            return 0;
+        }
+        case SIOCGARPTABLE: {
+            auto* table = reinterpret_cast<net_table_request*>(arg);
+            process->validate_read(table, sizeof(net_table_request));
+
+            auto entries = m_arp_cache.entries();
+
+            size_t count = std::min<size_t>(std::max(table->count, 0), entries.size());
+            auto* out = reinterpret_cast<net_arp_entry*>(table->entries);
+            process->validate_write(out, count * sizeof(net_arp_entry));
+
+            for (size_t i = 0; i < count; i++) {
+                auto& entry = entries[i];
+
+                out[i].address = entry.address.value();
+                out[i].interface = this->index_of(*entry.adapter);
+                out[i].state = to_underlying(entry.state);
+
+                for (size_t j = 0; j < 6; j++) {
+                    out[i].mac[j] = entry.mac[j];
+                }
+            }
+
+            return static_cast<int>(entries.size());
+        }
+        case SIOCSARP: {
+            auto* entry = reinterpret_cast<net_arp_entry*>(arg);
+            process->validate_read(entry, sizeof(net_arp_entry));
+
+            auto adapter = TRY(this->get_adapter(entry->interface));
+            net::MACAddress mac(entry->mac[0], entry->mac[1], entry->mac[2], entry->mac[3], entry->mac[4], entry->mac[5]);
+
+            TRY(m_arp_cache.add_permanent(move(adapter), net::IPv4Address(entry->address), mac));
+            return 0;
+        }
+        case SIOCDARP: {
+            auto* entry = reinterpret_cast<net_arp_entry*>(arg);
+            process->validate_read(entry, sizeof(net_arp_entry));
+
+            TRY(m_arp_cache.remove(net::IPv4Address(entry->address)));
+            return 0;
+        }
+        default:
+            return Error(EINVAL);
+    }
+}
+
 void NetworkManager::task() {
     while (true) {
-        m_blocker.set_value(false);
-        m_blocker.wait();
+        // Cleared before draining the adapters so that packets arriving in the meantime wake us right back up
+        m_blocker.set_pending(false);
 
+        // Polling adapters only get one budget per pass so a single busy one can't starve the others (or the timers)
+        bool should_poll_again = false;
         for (auto& adapter : m_adapters) {
-            net::Packet packet = adapter->dequeue();
-            while (packet.data) {
-                handle_packet(*adapter, packet.data, packet.size);
-                packet = adapter->dequeue();
+            should_poll_again |= adapter->run_poll();
+
+            net::Packet packet;
+            while (adapter->dequeue(packet)) {
+                this->steer(*adapter, move(packet));
+            }
+        }
+
+        if (should_poll_again) {
+            m_blocker.set_pending(true);
+        }
+
+        // The timers re-arm themselves through `schedule_timer` so start over from the earliest remaining deadline
+        m_blocker.set_deadline(Duration::zero());
+
+        Duration now = TimeManager::query_time(CLOCK_MONOTONIC);
+
+        Duration deadlines[] = {
+            net::TCPSocket::process_timers(now),
+            m_arp_cache.process_timers(now),
+            m_nd_cache.process_timers(now),
+            m_reassembler.process_timers(now),
+        };
+
+        Duration deadline = Duration::zero();
+        for (auto& next : deadlines) {
+            if (deadline == Duration::zero() || (next != Duration::zero() && next < deadline)) {
+                deadline = next;
             }
         }
+
+        if (deadline != Duration::zero()) {
+            this->schedule_timer(deadline);
+        }
+
+        m_blocker.wait();
     }
 }
-void handle_packet(net::NetworkAdapter& adapter, u8* data, size_t size) {
-    auto* frame = reinterpret_cast<net::EthernetFrame*>(data);
+void handle_packet(net::NetworkAdapter& adapter, net::Packet& packet) {
+    auto* frame = reinterpret_cast<net::EthernetFrame*>(packet.data());
+    size_t size = packet.size;
 
 if constexpr (NET_DEBUG) {
     dbgln("Ethernet packet (size={}):", size);
@@ -117,7 +428,7 @@ if constexpr (NET_DEBUG) {
         case net::EtherType::ARP:
             handle_arp_packet(adapter, frame, size); break;
         case net::EtherType::IPv4:
-            handle_ipv4_packet(adapter, frame, size); break;
+            handle_ipv4_packet(adapter, frame, size, packet.metadata); break;
         case net::EtherType::IPv6:
             handle_ipv6_packet(adapter, frame, size); break;
         default:
@@ -126,14 +437,23 @@ if constexpr (NET_DEBUG) {
     }
 }
 
-void handle_arp_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t) {
+void handle_arp_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size) {
     auto* arp = reinterpret_cast<net::ARPPacket*>(frame->payload);
+    if (size < sizeof(net::EthernetFrame) + sizeof(net::ARPPacket)) {
+        return;
+    } else if (arp->hardware_type != net::ARPHardwareType::Ethernet || arp->protocol_type != net::EtherType::IPv4) {
+        return;
+    }
 
-    if (arp->operation == net::ARPOperation::Request) {
+    // RFC 826: The sender is recorded if we know it already or if it's talking to us, which likely means we're about to talk back
+    bool is_target = !adapter.ipv4_address().is_zero() && arp->target_protocol_address == adapter.ipv4_address();
+    NetworkManager::instance()->arp_cache().update(adapter, arp->sender_protocol_address, arp->sender_hardware_address, is_target);
+
+    if (is_target && arp->operation == net::ARPOperation::Request) {
         net::ARPPacket response;
 
         response.sender_hardware_address = adapter.mac_address();
-        response.sender_protocol_address = arp->target_protocol_address;
+        response.sender_protocol_address = adapter.ipv4_address();
 
         response.target_hardware_address = arp->sender_hardware_address;
         response.target_protocol_address = arp->sender_protocol_address;
@@ -143,7 +463,7 @@ void handle_arp_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame,
     }
 }
 
-void handle_ipv4_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size) {
+void handle_ipv4_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size, net::PacketMetadata const& metadata) {
     auto* ipv4 = reinterpret_cast<net::IPv4Packet*>(frame->payload);
 
 if constexpr (NET_DEBUG) {
@@ -162,11 +482,34 @@ if constexpr (NET_DEBUG) {
     dbgln(" - Destination: {}", ipv4->destination);
 }
 
+    size_t available = size - sizeof(net::EthernetFrame);
+    if (size < sizeof(net::EthernetFrame) + sizeof(net::IPv4Packet) || ipv4->version != 4) {
+        return;
+    } else if (ipv4->header_size() < sizeof(net::IPv4Packet) || ipv4->length < ipv4->header_size() || ipv4->length > available) {
+        return;
+    }
+
+    // More fragments or a fragment offset
+    if (!(ipv4->flags_and_fragment_offset & 0x3FFF)) {
+        return dispatch_ipv4_packet(adapter, ipv4, ipv4->length, metadata);
+    }
+
+    auto datagram = NetworkManager::instance()->reassembler().add(ipv4, ipv4->length);
+    if (!datagram.has_value()) {
+        return;
+    }
+
+    // Whatever the device checked only covered a single fragment
+    auto* whole = reinterpret_cast<net::IPv4Packet*>(datagram->data());
+    dispatch_ipv4_packet(adapter, whole, whole->length, {});
+}
+
+void dispatch_ipv4_packet(net::NetworkAdapter& adapter, net::IPv4Packet* ipv4, size_t size, net::PacketMetadata const& metadata) {
     switch (ipv4->protocol) {
         case net::IPProtocol::TCP:
-            handle_tcp_packet(adapter, ipv4, size); break;
+            handle_tcp_packet(adapter, ipv4, size, metadata); break;
         case net::IPProtocol::UDP:
-            handle_udp_packet(adapter, ipv4, size); break;
+            handle_udp_packet(adapter, ipv4, size, metadata); break;
         case net::IPProtocol::ICMP:
             handle_icmp_packet(adapter, ipv4, size); break;
         default:
@@ -175,10 +518,63 @@ if constexpr (NET_DEBUG) {
     }
 }
 
-void handle_ipv6_packet(net::NetworkAdapter&, net::EthernetFrame*, size_t) {}
+void handle_ipv6_packet(net::NetworkAdapter& adapter, net::EthernetFrame* frame, size_t size) {
+    auto* ipv6 = reinterpret_cast<net::IPv6Packet*>(frame->payload);
 
-void handle_tcp_packet(net::NetworkAdapter&, net::IPv4Packet* packet, size_t size) {
-    auto* tcp = reinterpret_cast<net::TCPPacket*>(packet);
+if constexpr (NET_DEBUG) {
+    dbgln("IPv6 packet (size={}):", size);
+    dbgln(" - Payload length: {}", ipv6->payload_length);
+    dbgln(" - Next header: {}", ipv6->next_header);
+    dbgln(" - Hop limit: {}", ipv6->hop_limit);
+    dbgln(" - Source: {}", ipv6->source);
+    dbgln(" - Destination: {}", ipv6->destination);
+}
+
+    if (size < sizeof(net::EthernetFrame) + sizeof(net::IPv6Packet) || ipv6->version() != 6) {
+        return;
+    } else if (ipv6->payload_length > size - sizeof(net::EthernetFrame) - sizeof(net::IPv6Packet)) {
+        return;
+    }
+
+    // Our own address, or one of the multicast groups every node joins
+    auto address = adapter.ipv6_address();
+    auto& destination = ipv6->destination;
+    if (destination != address && destination != net::IPv6Address::all_nodes() && destination != address.solicited_node()) {
+        return;
+    }
+
+    u8 next_header = ipv6->next_header;
+    size_t offset = 0;
+
+    // Options we don't know about can't require anything of us unless they say so, which nothing we talk to does
+    while (true) {
+        if (next_header == net::IPv6NextHeader::ICMPv6) {
+            return handle_icmpv6_packet(adapter, ipv6, ipv6->payload + offset, ipv6->payload_length - offset);
+        } else if (next_header == net::IPv6NextHeader::Fragment) {
+            return; // Not reassembled, the only upper layer we speak never needs to be fragmented
+        } else if (
+            next_header != net::IPv6NextHeader::HopByHopOptions && next_header != net::IPv6NextHeader::Routing &&
+            next_header != net::IPv6NextHeader::DestinationOptions
+        ) {
+            return;
+        }
+
+        if (offset + sizeof(net::IPv6ExtensionHeader) > ipv6->payload_length) {
+            return;
+        }
+
+        auto* extension = reinterpret_cast<net::IPv6ExtensionHeader*>(ipv6->payload + offset);
+        next_header = extension->next_header;
+        offset += (extension->length + 1) * 8;
+
+        if (offset > ipv6->payload_length) {
+            return;
+        }
+    }
+}
+
+void handle_tcp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size, net::PacketMetadata const& metadata) {
+    auto* tcp = reinterpret_cast<net::TCPPacket*>(packet->payload);
 
 if constexpr (NET_DEBUG) {
     dbgln("TCP Packet (size={})", size);
@@ -186,16 +582,18 @@ if constexpr (NET_DEBUG) {
     dbgln(" - Destination port: {}", tcp->destination_port);
     dbgln(" - Sequence number: {}", tcp->sequence_number);
     dbgln(" - Acknowledgment number: {}", tcp->ack_number);
-    dbgln(" - Data offset: {}", tcp->data_offset & 0xF0);
+    dbgln(" - Data offset: {}", tcp->data_offset);
     dbgln(" - Flags: {}", tcp->flags);
     dbgln(" - Window size: {}", tcp->window_size);
     dbgln(" - Checksum: {}", tcp->checksum);
     dbgln(" - Urgent pointer: {}", tcp->urgent_pointer);
 }
 
+    net::TCPSocket::handle_packet(adapter, packet, tcp, packet->payload_size(), metadata);
+
 }
 
-void handle_udp_packet(net::NetworkAdapter&, net::IPv4Packet* packet, size_t size) {
+void handle_udp_packet(net::NetworkAdapter& adapter, net::IPv4Packet* packet, size_t size, net::PacketMetadata const& metadata) {
     auto* udp = reinterpret_cast<net::UDPPacket*>(packet->payload);
 
 if constexpr (NET_DEBUG) {
@@ -206,8 +604,164 @@ if constexpr (NET_DEBUG) {
     dbgln(" - Checksum: {}", udp->checksum);
 }
 
+    net::UDPSocket::handle_packet(adapter, packet, udp, metadata);
 }
 
-void handle_icmp_packet(net::NetworkAdapter&, net::IPv4Packet*, size_t) {}
+// Whether `address` is assigned to one of our adapters
+static bool is_local_address(net::IPv4Address address) {
+    for (auto& adapter : NetworkManager::instance()->adapters()) {
+        if (adapter->ipv4_address() == address) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void handle_icmp_packet(net::NetworkAdapter&, net::IPv4Packet* packet, size_t) {
+    auto* icmp = reinterpret_cast<net::ICMPPacket*>(packet->payload);
+
+    size_t size = packet->payload_size();
+    if (size < sizeof(net::ICMPPacket) || net::internet_checksum(icmp, size) != 0) {
+        return;
+    }
+
+    // RFC 1191: A router on the way couldn't forward one of our datagrams as is, it quotes the header we sent it with
+    if (icmp->type == net::ICMPType::DestinationUnreachable && icmp->code == net::ICMPUnreachableCode::FragmentationNeeded) {
+        if (size < sizeof(net::ICMPPacket) + sizeof(net::IPv4Packet)) {
+            return;
+        }
+
+        // Anyone could claim to be a router, at least make sure that the datagram it quotes was one of ours
+        auto* original = reinterpret_cast<net::IPv4Packet*>(icmp->data);
+        if (!is_local_address(original->source)) {
+            return;
+        }
 
-}
\ No newline at end of file
+        size_t mtu = icmp->rest & 0xFFFF;
+
+        // Routers predating RFC 1191 leave the MTU out, the datagram was too large for them so assume the minimum
+        if (!mtu) {
+            mtu = net::PathMTUCache::MIN_MTU;
+        }
+
+        NetworkManager::instance()->path_mtu_cache().update(original->destination, mtu);
+    }
+}
+
+// Answers a neighbor solicitation for our own address (RFC 4861 section 7.2.4)
+static void send_neighbor_advertisement(net::NetworkAdapter& adapter, net::IPv6Address destination, bool solicited) {
+    net::NeighborMessageWithAddress advertisement = {};
+
+    auto source = adapter.ipv6_address();
+
+    advertisement.message.type = net::ICMPv6Type::NeighborAdvertisement;
+    advertisement.message.flags = net::NeighborMessage::Override | (solicited ? static_cast<u32>(net::NeighborMessage::Solicited) : 0);
+    advertisement.message.target = source;
+
+    advertisement.option.type = net::NeighborOptionType::TargetLinkLayerAddress;
+    advertisement.option.length = 1;
+    advertisement.option.address = adapter.mac_address();
+
+    u32 sum = net::ipv6_pseudo_header_sum(source, destination, net::IPv6NextHeader::ICMPv6, sizeof(advertisement));
+    advertisement.message.checksum = net::checksum_finish(net::checksum_add(sum, &advertisement, sizeof(advertisement)));
+
+    net::PacketFragment fragment { reinterpret_cast<u8 const*>(&advertisement), sizeof(advertisement) };
+    (void)adapter.send_ipv6(
+        destination, net::IPv6NextHeader::ICMPv6, &fragment, 1, net::NetworkAdapter::NEIGHBOR_DISCOVERY_HOP_LIMIT
+    );
+}
+
+// The link-layer address option of a neighbor message, if it has one of the given type
+static Optional<net::MACAddress> find_link_layer_address(net::NeighborMessage* message, size_t size, u8 type) {
+    size_t offset = sizeof(net::NeighborMessage);
+    while (offset + 2 <= size) {
+        u8 const* option = reinterpret_cast<u8 const*>(message) + offset;
+
+        size_t length = option[1] * 8;
+        if (!length || offset + length > size) {
+            return {}; // RFC 4861 section 4.6: Messages with zero length options are to be dropped altogether
+        }
+
+        if (option[0] == type && length >= sizeof(net::LinkLayerAddressOption)) {
+            return reinterpret_cast<net::LinkLayerAddressOption const*>(option)->address;
+        }
+
+        offset += length;
+    }
+
+    return {};
+}
+
+void handle_icmpv6_packet(net::NetworkAdapter& adapter, net::IPv6Packet* ipv6, u8* data, size_t size) {
+    auto* icmp = reinterpret_cast<net::ICMPv6Packet*>(data);
+    if (size < sizeof(net::ICMPv6Packet)) {
+        return;
+    }
+
+    u32 sum = net::ipv6_pseudo_header_sum(ipv6->source, ipv6->destination, net::IPv6NextHeader::ICMPv6, size);
+    if (net::checksum_finish(net::checksum_add(sum, data, size)) != 0) {
+        return;
+    }
+
+    auto* manager = NetworkManager::instance();
+    switch (icmp->type) {
+        case net::ICMPv6Type::EchoRequest: {
+            if (ipv6->destination.is_multicast()) {
+                return;
+            }
+
+            // Same identifier, sequence number and data, only the type and checksum change
+            icmp->type = net::ICMPv6Type::EchoReply;
+            icmp->checksum = 0;
+
+            u32 reply = net::ipv6_pseudo_header_sum(adapter.ipv6_address(), ipv6->source, net::IPv6NextHeader::ICMPv6, size);
+            icmp->checksum = net::checksum_finish(net::checksum_add(reply, data, size));
+
+            net::PacketFragment fragment { data, size };
+            (void)adapter.send_ipv6(ipv6->source, net::IPv6NextHeader::ICMPv6, &fragment, 1);
+            break;
+        }
+        case net::ICMPv6Type::NeighborSolicitation: {
+            auto* message = reinterpret_cast<net::NeighborMessage*>(data);
+            if (size < sizeof(net::NeighborMessage) || ipv6->hop_limit != net::NetworkAdapter::NEIGHBOR_DISCOVERY_HOP_LIMIT) {
+                return;
+            } else if (message->code != 0 || message->target.is_multicast() || message->target != adapter.ipv6_address()) {
+                return;
+            }
+
+            // Duplicate address detection of some other node, it doesn't have an address to answer to yet
+            if (ipv6->source.is_zero()) {
+                return send_neighbor_advertisement(adapter, net::IPv6Address::all_nodes(), false);
+            }
+
+            auto mac = find_link_layer_address(message, size, net::NeighborOptionType::SourceLinkLayerAddress);
+            if (mac.has_value()) {
+                manager->nd_cache().update(adapter, ipv6->source, mac.value(), true);
+            }
+
+            send_neighbor_advertisement(adapter, ipv6->source, true);
+            break;
+        }
+        case net::ICMPv6Type::NeighborAdvertisement: {
+            auto* message = reinterpret_cast<net::NeighborMessage*>(data);
+            if (size < sizeof(net::NeighborMessage) || ipv6->hop_limit != net::NetworkAdapter::NEIGHBOR_DISCOVERY_HOP_LIMIT) {
+                return;
+            } else if (message->code != 0 || message->target.is_multicast()) {
+                return;
+            }
+
+            // Unsolicited advertisements only refresh neighbors we already talk to
+            auto mac = find_link_layer_address(message, size, net::NeighborOptionType::TargetLinkLayerAddress);
+            if (mac.has_value()) {
+                manager->nd_cache().update(adapter, message->target, mac.value(), false);
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}
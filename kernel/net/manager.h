@@ -2,12 +2,18 @@
 
 #include <kernel/common.h>
 #include <kernel/net/adapter.h>
+#include <kernel/net/routing.h>
+#include <kernel/net/neighbor_cache.h>
+#include <kernel/net/reassembly.h>
+#include <kernel/net/path_mtu.h>
 #include <kernel/process/threads.h>
 #include <kernel/process/blocker.h>
 #include <kernel/pci/pci.h>
 
 #include <std/vector.h>
 #include <std/memory.h>
+#include <std/time.h>
+#include <std/spsc_queue.h>
 
 namespace kernel {
 
@@ -15,6 +21,13 @@ class NetworkManager {
 public:
     using AdapterList = Vector<RefPtr<net::NetworkAdapter>>;
 
+    // Received frames are handled by a pool of worker threads, frames of the same flow always by the same one
+    static constexpr size_t WORKER_COUNT = 4;
+    static constexpr size_t WORKER_QUEUE_SIZE = 256;
+
+    // Buckets of flow hashes, each one assigned to a worker (the RSS indirection table)
+    static constexpr size_t INDIRECTION_TABLE_SIZE = 128;
+
     static void initialize();
 
     static NetworkManager* instance();
@@ -23,21 +36,89 @@ public:
 
     static void wakeup();
 
+    // Makes the network task run the protocol timers (see `TCPSocket::process_timers`) once `deadline` is reached
+    void schedule_timer(Duration deadline);
+
     void add_adapter(RefPtr<net::NetworkAdapter> adapter);
 
+    // Index of the adapter in `adapters()`, which is how userland refers to it, or -1
+    int index_of(net::NetworkAdapter const& adapter) const;
+
+    // Picks the adapter that `destination` should be sent through from the routing table, null if there's no route
+    RefPtr<net::NetworkAdapter> route(net::IPv4Address destination) const;
+
+    net::RoutingTable& routing_table() { return m_routing_table; }
+    net::ARPCache& arp_cache() { return m_arp_cache; }
+    net::NDCache& nd_cache() { return m_nd_cache; }
+    net::IPv4Reassembler& reassembler() { return m_reassembler; }
+    net::PathMTUCache& path_mtu_cache() { return m_path_mtu_cache; }
+
+    // Changes the address of an adapter along with the routes to its network and to itself
+    ErrorOr<void> configure(net::NetworkAdapter& adapter, net::IPv4Address address, net::IPv4Address netmask);
+
+    // Network configuration requests (SIOC*) made on any socket
+    ErrorOr<int> ioctl(unsigned request, unsigned arg);
+
 private:
     RefPtr<net::NetworkAdapter> create_network_adapter(pci::Device);
 
+    ErrorOr<RefPtr<net::NetworkAdapter>> get_adapter(int index) const;
+
     void enumerate();
     void spawn();
 
+    // Polls the adapters, hands their frames to the workers and runs the protocol timers
     void task();
 
+    struct Worker;
+
+    static void worker_entry(void*);
+    void run_worker(Worker&);
+
+    // Queues a received frame on the worker its flow belongs to, frames are dropped if that worker is backed up
+    void steer(net::NetworkAdapter&, net::Packet);
+
     Vector<RefPtr<net::NetworkAdapter>> m_adapters;
     RefPtr<net::NetworkAdapter> m_loopback_adapter;
 
+    net::RoutingTable m_routing_table;
+    net::ARPCache m_arp_cache;
+    net::NDCache m_nd_cache;
+    net::IPv4Reassembler m_reassembler;
+    net::PathMTUCache m_path_mtu_cache;
+
+    class TaskBlocker : public Blocker {
+    public:
+        bool should_unblock() override;
+
+        void set_pending(bool value) { m_pending = value; }
+
+        void set_deadline(Duration deadline) { m_deadline = deadline; }
+        Duration deadline() const { return m_deadline; }
+
+    private:
+        bool m_pending = false;
+        Duration m_deadline; // Zero if no timer is pending
+    };
+
+    struct SteeredPacket {
+        RefPtr<net::NetworkAdapter> adapter;
+        net::Packet packet;
+    };
+
+    struct Worker {
+        // The network task is the only producer, the worker the only consumer
+        SPSCQueue<SteeredPacket, WORKER_QUEUE_SIZE> queue;
+
+        TaskBlocker blocker;
+        Thread* thread = nullptr;
+    };
+
     Thread* m_thread = nullptr;
-    BooleanBlocker m_blocker;
+    TaskBlocker m_blocker;
+
+    Worker m_workers[WORKER_COUNT];
+    u8 m_indirection_table[INDIRECTION_TABLE_SIZE];
 };
 
 }
\ No newline at end of file
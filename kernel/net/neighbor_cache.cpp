@@ -0,0 +1,349 @@
+#include <kernel/net/neighbor_cache.h>
+#include <kernel/net/manager.h>
+#include <kernel/net/ethernet.h>
+#include <kernel/net/checksum.h>
+#include <kernel/net/ip/arp.h>
+#include <kernel/net/ip/icmpv6.h>
+#include <kernel/time/manager.h>
+#include <kernel/sync/lock.h>
+
+namespace kernel::net {
+
+static Duration current_time() {
+    return TimeManager::query_time(CLOCK_MONOTONIC);
+}
+
+template<typename Address>
+static bool is_resolved(typename NeighborCache<Address>::State state) {
+    return state != NeighborCache<Address>::State::Incomplete;
+}
+
+template<typename Address>
+void NeighborCache<Address>::arm(Entry& entry, Duration timeout) {
+    entry.deadline = current_time() + timeout;
+    NetworkManager::instance()->schedule_timer(entry.deadline);
+}
+
+template<>
+void ARPCache::send_request(Request request) {
+    ARPPacket packet;
+
+    packet.operation = ARPOperation::Request;
+    packet.sender_hardware_address = request.adapter->mac_address();
+    packet.sender_protocol_address = request.adapter->ipv4_address();
+    packet.target_hardware_address = MACAddress(0, 0, 0, 0, 0, 0);
+    packet.target_protocol_address = request.address;
+
+    request.adapter->send(MACAddress::broadcast(), packet);
+}
+
+template<>
+void NDCache::send_request(Request request) {
+    NeighborMessageWithAddress solicitation = {};
+
+    auto& adapter = *request.adapter;
+    auto destination = request.address.solicited_node();
+
+    solicitation.message.type = ICMPv6Type::NeighborSolicitation;
+    solicitation.message.target = request.address;
+
+    solicitation.option.type = NeighborOptionType::SourceLinkLayerAddress;
+    solicitation.option.length = 1;
+    solicitation.option.address = adapter.mac_address();
+
+    u32 sum = ipv6_pseudo_header_sum(adapter.ipv6_address(), destination, IPv6NextHeader::ICMPv6, sizeof(solicitation));
+    solicitation.message.checksum = checksum_finish(checksum_add(sum, &solicitation, sizeof(solicitation)));
+
+    PacketFragment fragment { reinterpret_cast<u8 const*>(&solicitation), sizeof(solicitation) };
+    (void)adapter.send_ipv6(destination, IPv6NextHeader::ICMPv6, &fragment, 1, NetworkAdapter::NEIGHBOR_DISCOVERY_HOP_LIMIT);
+}
+
+template<typename Address>
+void NeighborCache<Address>::send_frame(NetworkAdapter& adapter, PendingFrame& frame, MACAddress const& mac) {
+    auto* header = reinterpret_cast<EthernetFrame*>(frame.data.data());
+    header->destination = mac;
+
+    PacketFragment fragment { frame.data.data(), frame.data.size() };
+    adapter.transmit_with_fallbacks(&fragment, 1, frame.metadata);
+}
+
+template<typename Address>
+bool NeighborCache<Address>::lookup(NetworkAdapter& adapter, Address next_hop, MACAddress& mac) {
+    Optional<Request> probe;
+    {
+        ScopedLock lock(m_lock);
+
+        auto iterator = m_entries.find(next_hop);
+        if (iterator == m_entries.end()) {
+            return false;
+        }
+
+        auto& entry = iterator->value;
+        if (!is_resolved<Address>(entry.state) || entry.adapter.ptr() != &adapter) {
+            return false;
+        }
+
+        mac = entry.mac;
+
+        // Keep using the old address while making sure it's still valid
+        if (entry.state == State::Stale) {
+            entry.state = State::Probe;
+            entry.probes = 1;
+
+            this->arm(entry, RETRANSMIT_TIME);
+            probe = Request { entry.adapter, entry.address };
+        }
+    }
+
+    if (probe.has_value()) {
+        send_request(probe.value());
+    }
+
+    return true;
+}
+
+template<typename Address>
+void NeighborCache<Address>::enqueue(NetworkAdapter& adapter, Address next_hop, PendingFrame frame) {
+    Optional<Request> request;
+    MACAddress mac;
+    bool resolved = false;
+    {
+        ScopedLock lock(m_lock);
+
+        auto iterator = m_entries.find(next_hop);
+        if (iterator == m_entries.end()) {
+            if (m_entries.size() >= MAX_ENTRIES) {
+                return;
+            }
+
+            Entry entry;
+            entry.address = next_hop;
+            entry.adapter = RefPtr<NetworkAdapter>(&adapter);
+            entry.probes = 1;
+
+            this->arm(entry, RETRANSMIT_TIME);
+            request = Request { entry.adapter, next_hop };
+
+            m_entries.set(next_hop, move(entry));
+            iterator = m_entries.find(next_hop);
+        }
+
+        auto& entry = iterator->value;
+        if (is_resolved<Address>(entry.state)) {
+            mac = entry.mac; // Resolved between `lookup` and here
+            resolved = true;
+        } else if (frame.data.size() <= MAX_PENDING_BYTES) {
+            while (entry.pending_bytes + frame.data.size() > MAX_PENDING_BYTES) {
+                entry.pending_bytes -= entry.pending.first().data.size();
+                entry.pending.remove_first();
+            }
+
+            entry.pending_bytes += frame.data.size();
+            entry.pending.append(move(frame));
+        }
+    }
+
+    if (resolved) {
+        send_frame(adapter, frame, mac);
+    } else if (request.has_value()) {
+        send_request(request.value());
+    }
+}
+
+template<typename Address>
+void NeighborCache<Address>::update(NetworkAdapter& adapter, Address address, MACAddress const& mac, bool create) {
+    if (address.is_zero()) {
+        return;
+    }
+
+    Vector<PendingFrame> pending;
+    RefPtr<NetworkAdapter> target;
+    {
+        ScopedLock lock(m_lock);
+
+        auto iterator = m_entries.find(address);
+        if (iterator == m_entries.end()) {
+            if (!create || m_entries.size() >= MAX_ENTRIES) {
+                return;
+            }
+
+            Entry entry;
+            entry.address = address;
+            entry.adapter = RefPtr<NetworkAdapter>(&adapter);
+
+            m_entries.set(address, move(entry));
+            iterator = m_entries.find(address);
+        }
+
+        auto& entry = iterator->value;
+        if (entry.state == State::Permanent) {
+            return;
+        }
+
+        entry.mac = mac;
+        entry.adapter = RefPtr<NetworkAdapter>(&adapter);
+        entry.state = State::Reachable;
+        entry.probes = 0;
+
+        this->arm(entry, REACHABLE_TIME);
+
+        pending = move(entry.pending);
+        entry.pending_bytes = 0;
+
+        target = entry.adapter;
+    }
+
+    for (auto& frame : pending) {
+        send_frame(*target, frame, mac);
+    }
+}
+
+template<typename Address>
+ErrorOr<void> NeighborCache<Address>::add_permanent(RefPtr<NetworkAdapter> adapter, Address address, MACAddress const& mac) {
+    if (address.is_zero()) {
+        return Error(EINVAL);
+    }
+
+    Vector<PendingFrame> pending;
+    {
+        ScopedLock lock(m_lock);
+
+        if (!m_entries.contains(address) && m_entries.size() >= MAX_ENTRIES) {
+            return Error(ENOSPC);
+        }
+
+        auto& entry = m_entries.ensure(address);
+
+        entry.address = address;
+        entry.mac = mac;
+        entry.adapter = adapter;
+        entry.state = State::Permanent;
+        entry.deadline = Duration::zero();
+        entry.probes = 0;
+
+        pending = move(entry.pending);
+        entry.pending_bytes = 0;
+    }
+
+    for (auto& frame : pending) {
+        send_frame(*adapter, frame, mac);
+    }
+
+    return {};
+}
+
+template<typename Address>
+ErrorOr<void> NeighborCache<Address>::remove(Address address) {
+    ScopedLock lock(m_lock);
+    if (!m_entries.contains(address)) {
+        return Error(ENXIO);
+    }
+
+    m_entries.remove(address);
+    return {};
+}
+
+template<typename Address>
+void NeighborCache<Address>::flush(NetworkAdapter const& adapter) {
+    ScopedLock lock(m_lock);
+
+    Vector<Address> stale;
+    for (auto& [key, entry] : m_entries) {
+        if (entry.adapter.ptr() == &adapter && entry.state != State::Permanent) {
+            stale.append(key);
+        }
+    }
+
+    for (auto& key : stale) {
+        m_entries.remove(key);
+    }
+}
+
+template<typename Address>
+Vector<typename NeighborCache<Address>::Entry> NeighborCache<Address>::entries() const {
+    ScopedLock lock(m_lock);
+
+    Vector<Entry> entries;
+    entries.reserve(m_entries.size());
+
+    for (auto& [key, entry] : m_entries) {
+        Entry copy;
+
+        copy.address = entry.address;
+        copy.mac = entry.mac;
+        copy.adapter = entry.adapter;
+        copy.state = entry.state;
+        copy.deadline = entry.deadline;
+        copy.probes = entry.probes;
+
+        entries.append(move(copy));
+    }
+
+    return entries;
+}
+
+template<typename Address>
+Duration NeighborCache<Address>::process_timers(Duration now) {
+    Vector<Request> requests;
+    Vector<Address> expired;
+
+    Duration next = Duration::zero();
+    {
+        ScopedLock lock(m_lock);
+
+        for (auto& [key, entry] : m_entries) {
+            if (entry.deadline == Duration::zero()) {
+                continue;
+            } else if (entry.deadline > now) {
+                if (next == Duration::zero() || entry.deadline < next) {
+                    next = entry.deadline;
+                }
+
+                continue;
+            }
+
+            switch (entry.state) {
+                case State::Incomplete:
+                case State::Probe:
+                    if (entry.probes >= MAX_PROBES) {
+                        expired.append(key); // Takes whatever was still waiting for it along
+                        continue;
+                    }
+
+                    entry.probes++;
+                    entry.deadline = now + RETRANSMIT_TIME;
+
+                    requests.append({ entry.adapter, entry.address });
+                    break;
+                case State::Reachable:
+                    entry.state = State::Stale;
+                    entry.deadline = now + STALE_TIME;
+                    break;
+                case State::Stale:
+                    expired.append(key);
+                    continue;
+                case State::Permanent:
+                    continue;
+            }
+
+            if (next == Duration::zero() || entry.deadline < next) {
+                next = entry.deadline;
+            }
+        }
+
+        for (auto& key : expired) {
+            m_entries.remove(key);
+        }
+    }
+
+    for (auto& request : requests) {
+        send_request(request);
+    }
+
+    return next;
+}
+
+template class NeighborCache<IPv4Address>;
+template class NeighborCache<IPv6Address>;
+
+}
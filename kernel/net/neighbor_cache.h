@@ -0,0 +1,106 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/mac.h>
+#include <kernel/net/adapter.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/net/ip/ipv6.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/hash_map.h>
+#include <std/vector.h>
+#include <std/memory.h>
+#include <std/time.h>
+
+namespace kernel::net {
+
+// A copy of a frame waiting for its next hop to be resolved, starting with its Ethernet header
+struct PendingFrame {
+    Vector<u8> data;
+    PacketMetadata metadata;
+};
+
+// Maps the addresses of neighbors on a link to their MAC addresses, through ARP (RFC 826) for IPv4 and neighbor
+// discovery (RFC 4861) for IPv6, with the reachability states of RFC 4861 (section 7.3.2) minus the delay state for
+// both. Frames sent to an address that isn't resolved yet are queued on its entry and go out as soon as the reply arrives.
+template<typename Address>
+class NeighborCache {
+public:
+    enum class State : u8 {
+        Incomplete, // Waiting for the first reply
+        Reachable,  // Confirmed within the last `REACHABLE_TIME`
+        Stale,      // Still used, but the next frame sent to it triggers a probe
+        Probe,      // Used while waiting for a reply to a probe
+        Permanent,  // Configured by hand, never ages
+    };
+
+    struct Entry {
+        Address address;
+        MACAddress mac;
+
+        RefPtr<NetworkAdapter> adapter;
+        State state = State::Incomplete;
+
+        Duration deadline; // When the state times out, zero for permanent entries
+        size_t probes = 0;
+
+        Vector<PendingFrame> pending;
+        size_t pending_bytes = 0;
+    };
+
+    static constexpr Duration REACHABLE_TIME = Duration::from_seconds(30);
+    static constexpr Duration RETRANSMIT_TIME = Duration::from_seconds(1);
+
+    // Stale entries that go unused for this long are dropped
+    static constexpr Duration STALE_TIME = Duration::from_seconds(300);
+
+    static constexpr size_t MAX_PROBES = 3;
+    static constexpr size_t MAX_ENTRIES = 1024;
+
+    // Enough for every fragment of the largest datagram
+    static constexpr size_t MAX_PENDING_BYTES = 2 * NetworkAdapter::MAX_GSO_SIZE;
+
+    // Returns false if `next_hop` isn't resolved yet, the frame then has to be handed to `enqueue`.
+    // Stale entries are still returned, but get probed.
+    bool lookup(NetworkAdapter&, Address next_hop, MACAddress& mac);
+
+    // Sends `frame` once `next_hop` is resolved (or straight away if that happened in the meantime), starting the
+    // resolution if needed. The oldest queued frames are dropped if too much is waiting already.
+    void enqueue(NetworkAdapter&, Address next_hop, PendingFrame frame);
+
+    // Called for every incoming ARP packet or neighbor message. Only addresses we already know about are updated,
+    // unless the message was meant for us (section "Packet Reception" of RFC 826, section 7.2.3 of RFC 4861).
+    void update(NetworkAdapter&, Address address, MACAddress const& mac, bool create);
+
+    ErrorOr<void> add_permanent(RefPtr<NetworkAdapter>, Address address, MACAddress const& mac);
+    ErrorOr<void> remove(Address address);
+
+    // Forgets everything learned through `adapter`, e.g. after its address changed
+    void flush(NetworkAdapter const& adapter);
+
+    Vector<Entry> entries() const;
+
+    // Retransmits requests, ages entries and gives up on unresolvable ones. Returns the earliest pending deadline or zero.
+    Duration process_timers(Duration now);
+
+private:
+    // Requests are only ever sent once the lock is dropped, the adapter may block while waiting for room
+    struct Request {
+        RefPtr<NetworkAdapter> adapter;
+        Address address;
+    };
+
+    // An ARP request or a neighbor solicitation
+    static void send_request(Request);
+    static void send_frame(NetworkAdapter&, PendingFrame&, MACAddress const&);
+
+    static void arm(Entry&, Duration timeout);
+
+    mutable Mutex m_lock;
+    HashMap<Address, Entry> m_entries;
+};
+
+using ARPCache = NeighborCache<IPv4Address>;
+using NDCache = NeighborCache<IPv6Address>;
+
+}
@@ -0,0 +1,90 @@
+#include <kernel/net/packet_buffer.h>
+#include <kernel/memory/manager.h>
+
+namespace kernel::net {
+
+size_t PacketBuffer::capacity() const {
+    return m_pool->buffer_size();
+}
+
+void PacketBuffer::operator delete(void* ptr) {
+    // Only the implicit destructor ran at this point, which leaves `m_pool` untouched
+    auto* buffer = reinterpret_cast<PacketBuffer*>(ptr);
+    buffer->m_pool->release(ptr);
+}
+
+ErrorOr<OwnPtr<PacketBufferPool>> PacketBufferPool::create(size_t count, size_t buffer_size, bool dma) {
+    auto pool = OwnPtr<PacketBufferPool>(new PacketBufferPool(count, buffer_size));
+    size_t size = std::align_up(count * buffer_size, PAGE_SIZE);
+
+    // Buffers spanning several pages have to be physically contiguous for a device to see them as one
+    if (dma && buffer_size > PAGE_SIZE) {
+        pool->m_memory = reinterpret_cast<u8*>(TRY(MM->allocate_contiguous_dma_region(size)));
+    } else if (dma) {
+        pool->m_memory = reinterpret_cast<u8*>(TRY(MM->allocate_dma_region(size)));
+    } else {
+        pool->m_memory = reinterpret_cast<u8*>(TRY(MM->allocate_kernel_region(size)));
+    }
+
+    pool->m_storage = new u8[count * sizeof(PacketBuffer)];
+    pool->m_physical_addresses = new PhysicalAddress[count];
+    pool->m_next = new u32[count];
+
+    for (size_t i = 0; i < count; i++) {
+        u8* data = pool->m_memory + i * buffer_size;
+        if (dma) {
+            pool->m_physical_addresses[i] = MM->get_physical_address(data);
+        }
+    }
+
+    // Pushed in reverse so that the first allocations hand out the lowest addresses
+    for (size_t i = count; i > 0; i--) {
+        pool->push(i - 1);
+    }
+
+    return pool;
+}
+
+RefPtr<PacketBuffer> PacketBufferPool::allocate() {
+    u32 index = this->pop();
+    if (index == EMPTY) {
+        return nullptr;
+    }
+
+    auto* buffer = new (this->slot(index)) PacketBuffer(this, m_memory + index * m_buffer_size, m_physical_addresses[index]);
+    return RefPtr<PacketBuffer>(buffer);
+}
+
+void PacketBufferPool::release(void* storage) {
+    size_t offset = reinterpret_cast<u8*>(storage) - m_storage;
+    this->push(offset / sizeof(PacketBuffer));
+}
+
+void PacketBufferPool::push(u32 index) {
+    u64 head = m_free_list.load(std::MemoryOrder::Relaxed);
+    while (true) {
+        m_next[index] = static_cast<u32>(head);
+
+        u64 tag = (head >> 32) + 1;
+        if (m_free_list.compare_exchange_strong(head, (tag << 32) | index, std::MemoryOrder::Release)) {
+            return;
+        }
+    }
+}
+
+u32 PacketBufferPool::pop() {
+    u64 head = m_free_list.load(std::MemoryOrder::Acquire);
+    while (true) {
+        u32 index = static_cast<u32>(head);
+        if (index == EMPTY) {
+            return EMPTY;
+        }
+
+        u64 tag = (head >> 32) + 1;
+        if (m_free_list.compare_exchange_strong(head, (tag << 32) | m_next[index], std::MemoryOrder::Acquire)) {
+            return index;
+        }
+    }
+}
+
+}
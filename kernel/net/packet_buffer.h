@@ -0,0 +1,85 @@
+#pragma once
+
+#include <kernel/common.h>
+
+#include <std/memory.h>
+#include <std/atomic.h>
+#include <std/result.h>
+
+namespace kernel::net {
+
+class PacketBufferPool;
+
+// A piece of an outgoing frame. Frames are handed down as a list of fragments so that headers built on the stack
+// and a payload living somewhere else never have to be gathered into one buffer before reaching the device.
+struct PacketFragment {
+    u8 const* data;
+    size_t size;
+};
+
+// A fixed size buffer holding a single frame, owned by a `PacketBufferPool`.
+// Dropping the last reference hands the buffer back to its pool instead of freeing it.
+class PacketBuffer : public std::RefCounted {
+public:
+    u8* data() { return m_data; }
+    u8 const* data() const { return m_data; }
+
+    PhysicalAddress physical_address() const { return m_physical_address; }
+
+    size_t capacity() const;
+
+    static void operator delete(void* ptr);
+
+private:
+    friend class PacketBufferPool;
+
+    PacketBuffer(PacketBufferPool* pool, u8* data, PhysicalAddress physical_address)
+        : m_pool(pool), m_data(data), m_physical_address(physical_address) {}
+
+    PacketBufferPool* m_pool;
+
+    u8* m_data;
+    PhysicalAddress m_physical_address;
+};
+
+// Preallocates all of its buffers up front, so that allocating and releasing them never touches the heap.
+// The free list is a lock-free stack, both operations are safe from IRQ context and from multiple threads.
+class PacketBufferPool {
+public:
+    // DMA pools are mapped uncached and every buffer has a known physical address, the others live in regular kernel memory
+    static ErrorOr<OwnPtr<PacketBufferPool>> create(size_t count, size_t buffer_size, bool dma);
+
+    // Returns null if all buffers are in use
+    RefPtr<PacketBuffer> allocate();
+
+    size_t count() const { return m_count; }
+    size_t buffer_size() const { return m_buffer_size; }
+
+private:
+    friend class PacketBuffer;
+
+    static constexpr u32 EMPTY = 0xFFFFFFFF;
+
+    PacketBufferPool(size_t count, size_t buffer_size) : m_count(count), m_buffer_size(buffer_size) {}
+
+    void release(void* storage);
+
+    void push(u32 index);
+    u32 pop();
+
+    PacketBuffer* slot(u32 index) { return reinterpret_cast<PacketBuffer*>(m_storage + index * sizeof(PacketBuffer)); }
+
+    size_t m_count;
+    size_t m_buffer_size;
+
+    u8* m_memory = nullptr;
+    u8* m_storage = nullptr; // Room for one `PacketBuffer` per buffer, constructed in place on allocation
+    PhysicalAddress* m_physical_addresses = nullptr;
+
+    u32* m_next = nullptr;
+
+    // The low half is the index of the first free buffer, the high half is bumped on every update to avoid ABA
+    std::Atomic<u64> m_free_list { EMPTY };
+};
+
+}
@@ -0,0 +1,68 @@
+#include <kernel/net/path_mtu.h>
+#include <kernel/time/manager.h>
+#include <kernel/sync/lock.h>
+
+namespace kernel::net {
+
+void PathMTUCache::update(IPv4Address destination, size_t mtu) {
+    if (mtu < MIN_MTU) {
+        return;
+    }
+
+    Duration now = TimeManager::query_time(CLOCK_MONOTONIC);
+    ScopedLock lock(m_lock);
+
+    auto iterator = m_entries.find(destination.value());
+    if (iterator != m_entries.end()) {
+        auto& entry = iterator->value;
+
+        // Only ever shrinks until it expires, a larger value may be a stale report from before
+        if (entry.expiry > now && entry.mtu <= mtu) {
+            return;
+        }
+
+        entry = { mtu, now + TIMEOUT };
+        return;
+    }
+
+    if (m_entries.size() >= MAX_ENTRIES) {
+        Vector<u32> expired;
+        for (auto& [key, entry] : m_entries) {
+            if (entry.expiry <= now) {
+                expired.append(key);
+            }
+        }
+
+        for (auto key : expired) {
+            m_entries.remove(key);
+        }
+
+        if (m_entries.size() >= MAX_ENTRIES) {
+            return;
+        }
+    }
+
+    m_entries.set(destination.value(), { mtu, now + TIMEOUT });
+}
+
+size_t PathMTUCache::lookup(IPv4Address destination, size_t link_mtu) {
+    ScopedLock lock(m_lock);
+    if (m_entries.size() == 0) {
+        return link_mtu;
+    }
+
+    auto iterator = m_entries.find(destination.value());
+    if (iterator == m_entries.end()) {
+        return link_mtu;
+    }
+
+    auto& entry = iterator->value;
+    if (entry.expiry <= TimeManager::query_time(CLOCK_MONOTONIC)) {
+        m_entries.remove(destination.value());
+        return link_mtu;
+    }
+
+    return std::min(entry.mtu, link_mtu);
+}
+
+}
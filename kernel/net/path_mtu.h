@@ -0,0 +1,39 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/hash_map.h>
+#include <std/time.h>
+
+namespace kernel::net {
+
+// Remembers the MTUs routers reported (ICMP "fragmentation needed") for destinations behind links smaller than
+// our own, so that datagrams to them are fragmented before they are sent (RFC 1191)
+class PathMTUCache {
+public:
+    // Reported MTUs are forgotten after a while, in case the path changed. RFC 1191 suggests 10 minutes.
+    static constexpr Duration TIMEOUT = Duration::from_seconds(10 * 60);
+
+    // Every IPv4 link has to carry at least this much (RFC 791)
+    static constexpr size_t MIN_MTU = 68;
+
+    static constexpr size_t MAX_ENTRIES = 256;
+
+    void update(IPv4Address destination, size_t mtu);
+
+    // The MTU to use towards `destination`, `link_mtu` unless a smaller one was reported
+    size_t lookup(IPv4Address destination, size_t link_mtu);
+
+private:
+    struct Entry {
+        size_t mtu;
+        Duration expiry;
+    };
+
+    Mutex m_lock;
+    HashMap<u32, Entry> m_entries;
+};
+
+}
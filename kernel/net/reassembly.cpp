@@ -0,0 +1,145 @@
+#include <kernel/net/reassembly.h>
+#include <kernel/net/manager.h>
+#include <kernel/net/checksum.h>
+#include <kernel/time/manager.h>
+#include <kernel/sync/lock.h>
+
+namespace kernel::net {
+
+// The whole datagram (header included) still has to fit in the IPv4 length field
+static constexpr size_t MAX_PAYLOAD_SIZE = 0xFFFF - sizeof(IPv4Packet);
+
+Optional<Vector<u8>> IPv4Reassembler::add(IPv4Packet const* ipv4, size_t size) {
+    size_t header_size = ipv4->header_size();
+    size_t length = size - header_size;
+
+    u16 flags = ipv4->flags_and_fragment_offset;
+    bool more_fragments = flags & 0x2000;
+
+    size_t first = (flags & 0x1FFF) * 8;
+    size_t last = first + length - 1;
+
+    // Every fragment but the last one carries a multiple of 8 bytes
+    if (!length || (more_fragments && length % 8) || last >= MAX_PAYLOAD_SIZE) {
+        return {};
+    }
+
+    FragmentKey key = { ipv4->source, ipv4->destination, ipv4->identification, ipv4->protocol };
+    Duration now = TimeManager::query_time(CLOCK_MONOTONIC);
+
+    ScopedLock lock(m_lock);
+
+    auto iterator = m_datagrams.find(key);
+    if (iterator == m_datagrams.end()) {
+        if (m_datagrams.size() >= MAX_DATAGRAMS || m_memory + last + 1 > MAX_MEMORY) {
+            return {};
+        }
+
+        Datagram datagram;
+        datagram.holes.append({ 0, Datagram::UNKNOWN_END });
+        datagram.deadline = now + TIMEOUT;
+
+        NetworkManager::instance()->schedule_timer(datagram.deadline);
+
+        m_datagrams.set(key, move(datagram));
+        iterator = m_datagrams.find(key);
+    }
+
+    auto& datagram = iterator->value;
+
+    // A fragment running past the end of the datagram (or a second, different end) means something's off, give up on it
+    bool is_past_end = datagram.end != Datagram::UNKNOWN_END && last > datagram.end;
+    bool is_other_end = !more_fragments && (datagram.payload.size() > last + 1 || (datagram.end != Datagram::UNKNOWN_END && datagram.end != last));
+
+    if (is_past_end || is_other_end) {
+        m_memory -= datagram.payload.size();
+        m_datagrams.remove(key);
+
+        return {};
+    }
+
+    if (!more_fragments) {
+        datagram.end = last;
+    }
+
+    if (datagram.payload.size() < last + 1) {
+        if (m_memory + last + 1 - datagram.payload.size() > MAX_MEMORY) {
+            return {};
+        }
+
+        m_memory += last + 1 - datagram.payload.size();
+        datagram.payload.resize(last + 1);
+    }
+
+    memcpy(datagram.payload.data() + first, ipv4->payload, length);
+    if (!first) {
+        datagram.header.resize(header_size);
+        memcpy(datagram.header.data(), ipv4, header_size);
+    }
+
+    // Whatever part of a hole the fragment doesn't cover stays a hole, the last fragment removes the open end
+    Vector<Hole> holes;
+    for (auto& hole : datagram.holes) {
+        if (first > hole.last || last < hole.first) {
+            holes.append(hole);
+            continue;
+        }
+
+        if (first > hole.first) {
+            holes.append({ hole.first, first - 1 });
+        }
+
+        if (last < hole.last && (more_fragments || hole.last != Datagram::UNKNOWN_END)) {
+            holes.append({ last + 1, hole.last });
+        }
+    }
+
+    datagram.holes = move(holes);
+    if (datagram.holes.size()) {
+        return {};
+    }
+
+    Vector<u8> result;
+    result.resize(datagram.header.size() + datagram.payload.size());
+
+    memcpy(result.data(), datagram.header.data(), datagram.header.size());
+    memcpy(result.data() + datagram.header.size(), datagram.payload.data(), datagram.payload.size());
+
+    auto* whole = reinterpret_cast<IPv4Packet*>(result.data());
+
+    whole->length = result.size();
+    whole->flags_and_fragment_offset = 0;
+    whole->checksum = 0;
+    whole->checksum = internet_checksum(whole, whole->header_size());
+
+    m_memory -= datagram.payload.size();
+    m_datagrams.remove(key);
+
+    return result;
+}
+
+Duration IPv4Reassembler::process_timers(Duration now) {
+    ScopedLock lock(m_lock);
+
+    Vector<FragmentKey> expired;
+    Duration next = Duration::zero();
+
+    for (auto& [key, datagram] : m_datagrams) {
+        if (datagram.deadline <= now) {
+            expired.append(key);
+        } else if (next == Duration::zero() || datagram.deadline < next) {
+            next = datagram.deadline;
+        }
+    }
+
+    for (auto& key : expired) {
+        auto iterator = m_datagrams.find(key);
+
+        m_memory -= iterator->value.payload.size();
+        m_datagrams.remove(key);
+    }
+
+    return next;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/hash_map.h>
+#include <std/optional.h>
+#include <std/vector.h>
+#include <std/time.h>
+
+namespace kernel::net {
+
+// Fragments belong to the same datagram if all of these match (RFC 791)
+struct FragmentKey {
+    IPv4Address source;
+    IPv4Address destination;
+    u16 identification;
+    u8 protocol;
+
+    bool operator==(FragmentKey const& other) const {
+        return source == other.source && destination == other.destination &&
+            identification == other.identification && protocol == other.protocol;
+    }
+};
+
+}
+
+template<>
+struct std::traits::Hash<kernel::net::FragmentKey> {
+    static size_t hash(kernel::net::FragmentKey const& key) {
+        u64 addresses = (static_cast<u64>(key.source.value()) << 32) | key.destination.value();
+        return Hash<u64>::hash(addresses) ^ (static_cast<size_t>(key.identification) << 8) ^ key.protocol;
+    }
+};
+
+namespace kernel::net {
+
+// Puts fragmented IPv4 datagrams back together, keeping track of what's still missing with the hole list of RFC 815
+class IPv4Reassembler {
+public:
+    // Datagrams that are still missing fragments after this long are dropped
+    static constexpr Duration TIMEOUT = Duration::from_seconds(30);
+
+    // Fragments starting a new datagram are dropped while the partial ones take up this much
+    static constexpr size_t MAX_MEMORY = 4 * MB;
+    static constexpr size_t MAX_DATAGRAMS = 64;
+
+    // Takes a fragment, `size` being its total length. Returns the whole datagram, with a fresh IPv4 header in front of
+    // it, once the fragment filled its last hole.
+    Optional<Vector<u8>> add(IPv4Packet const*, size_t size);
+
+    // Drops datagrams that timed out. Returns the earliest pending deadline or zero.
+    Duration process_timers(Duration now);
+
+private:
+    // Payload bytes `first` to `last` (inclusive) are missing
+    struct Hole {
+        size_t first;
+        size_t last;
+    };
+
+    struct Datagram {
+        static constexpr size_t UNKNOWN_END = ~0ul;
+
+        Vector<u8> header; // Of the fragment at offset zero, once it arrived
+        Vector<u8> payload;
+
+        size_t end = UNKNOWN_END; // Last payload byte, known once the last fragment arrived
+
+        Vector<Hole> holes;
+        Duration deadline;
+    };
+
+    mutable Mutex m_lock;
+
+    HashMap<FragmentKey, Datagram> m_datagrams;
+    size_t m_memory = 0;
+};
+
+}
@@ -0,0 +1,200 @@
+#include <kernel/net/routing.h>
+#include <kernel/net/adapter.h>
+#include <kernel/sync/lock.h>
+
+#include <std/endian.h>
+
+namespace kernel::net {
+
+static u32 host_order(IPv4Address address) {
+    return std::from_big_endian(address.value());
+}
+
+// Bit `index` counting from the most significant one, which picks the child a longer prefix belongs to
+static u8 bit_at(u32 value, u8 index) {
+    return (value >> (31 - index)) & 1;
+}
+
+static u8 common_prefix_length(u32 a, u32 b, u8 limit) {
+    u32 difference = a ^ b;
+    u8 length = difference ? __builtin_clz(difference) : 32;
+
+    return std::min(length, limit);
+}
+
+ErrorOr<u8> RoutingTable::prefix_length(IPv4Address netmask) {
+    u32 mask = host_order(netmask);
+    if (mask == 0xFFFFFFFF) {
+        return 32; // __builtin_clz(0) is undefined
+    }
+
+    u8 length = mask ? __builtin_clz(~mask) : 0;
+    if (RoutingTable::netmask(length) != mask) {
+        return Error(EINVAL);
+    }
+
+    return length;
+}
+
+ErrorOr<void> RoutingTable::add(Route route, bool replace) {
+    if (route.prefix_length > 32) {
+        return Error(EINVAL);
+    }
+
+    u8 length = route.prefix_length;
+    u32 prefix = host_order(route.destination) & netmask(length);
+
+    route.destination = IPv4Address(std::to_big_endian(prefix));
+
+    ScopedLock lock(m_lock);
+    OwnPtr<Node>* slot = &m_root;
+
+    while (true) {
+        Node* node = slot->ptr();
+        if (!node) {
+            *slot = OwnPtr<Node>(new Node { prefix, length, move(route), {} });
+            return {};
+        }
+
+        u8 common = common_prefix_length(node->prefix, prefix, std::min(node->length, length));
+        if (common == node->length && common == length) {
+            if (node->route.has_value() && !replace) {
+                return Error(EEXIST);
+            }
+
+            node->route = move(route);
+            return {};
+        } else if (common == node->length) {
+            slot = &node->children[bit_at(prefix, common)];
+            continue;
+        }
+
+        // The new prefix diverges from `node` (or is shorter than it), so both end up below a node for what they share
+        auto parent = OwnPtr<Node>(new Node { prefix & netmask(common), common, {}, {} });
+        u8 existing = bit_at(node->prefix, common);
+
+        parent->children[existing] = move(*slot);
+        if (common == length) {
+            parent->route = move(route);
+        } else {
+            parent->children[bit_at(prefix, common)] = OwnPtr<Node>(new Node { prefix, length, move(route), {} });
+        }
+
+        *slot = move(parent);
+        return {};
+    }
+}
+
+ErrorOr<void> RoutingTable::remove(IPv4Address destination, u8 prefix_length) {
+    if (prefix_length > 32) {
+        return Error(EINVAL);
+    }
+
+    ScopedLock lock(m_lock);
+    if (!remove(m_root, host_order(destination) & netmask(prefix_length), prefix_length)) {
+        return Error(ESRCH);
+    }
+
+    return {};
+}
+
+bool RoutingTable::remove(OwnPtr<Node>& slot, u32 prefix, u8 length) {
+    Node* node = slot.ptr();
+    if (!node || node->length > length || common_prefix_length(node->prefix, prefix, node->length) != node->length) {
+        return false;
+    }
+
+    bool removed = false;
+    if (node->length == length) {
+        removed = node->route.has_value();
+        node->route.reset();
+    } else {
+        removed = remove(node->children[bit_at(prefix, node->length)], prefix, length);
+    }
+
+    compact(slot);
+    return removed;
+}
+
+void RoutingTable::remove_all(NetworkAdapter const& adapter) {
+    ScopedLock lock(m_lock);
+    remove_all(m_root, adapter);
+}
+
+void RoutingTable::remove_all(OwnPtr<Node>& slot, NetworkAdapter const& adapter) {
+    Node* node = slot.ptr();
+    if (!node) {
+        return;
+    }
+
+    if (node->route.has_value() && node->route->adapter.ptr() == &adapter) {
+        node->route.reset();
+    }
+
+    remove_all(node->children[0], adapter);
+    remove_all(node->children[1], adapter);
+
+    compact(slot);
+}
+
+void RoutingTable::compact(OwnPtr<Node>& slot) {
+    Node* node = slot.ptr();
+    if (node->route.has_value() || (node->children[0] && node->children[1])) {
+        return;
+    }
+
+    // The child (if any) moves up, its own prefix already says everything the removed node did
+    auto child = move(node->children[0] ? node->children[0] : node->children[1]);
+    slot = move(child);
+}
+
+Optional<Route> RoutingTable::lookup(IPv4Address destination) const {
+    u32 address = host_order(destination);
+
+    ScopedLock lock(m_lock);
+
+    Node const* node = m_root.ptr();
+    Node const* best = nullptr;
+
+    while (node && common_prefix_length(node->prefix, address, node->length) == node->length) {
+        if (node->route.has_value()) {
+            best = node;
+        }
+
+        if (node->length == 32) {
+            break;
+        }
+
+        node = node->children[bit_at(address, node->length)].ptr();
+    }
+
+    if (!best) {
+        return {};
+    }
+
+    return best->route.value();
+}
+
+Vector<Route> RoutingTable::routes() const {
+    ScopedLock lock(m_lock);
+
+    Vector<Route> routes;
+    collect(m_root.ptr(), routes);
+
+    return routes;
+}
+
+void RoutingTable::collect(Node const* node, Vector<Route>& routes) {
+    if (!node) {
+        return;
+    }
+
+    collect(node->children[0].ptr(), routes);
+    collect(node->children[1].ptr(), routes);
+
+    if (node->route.has_value()) {
+        routes.append(node->route.value());
+    }
+}
+
+}
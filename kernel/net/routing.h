@@ -0,0 +1,69 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/memory.h>
+#include <std/optional.h>
+#include <std/vector.h>
+#include <std/result.h>
+
+namespace kernel::net {
+
+class NetworkAdapter;
+
+struct Route {
+    IPv4Address destination; // Network address, every bit past `prefix_length` is zero
+    u8 prefix_length = 0;
+
+    IPv4Address gateway; // Zero for networks the adapter is directly attached to
+    RefPtr<NetworkAdapter> adapter;
+
+    // Where frames for `address` have to go on the link
+    IPv4Address next_hop(IPv4Address address) const { return gateway.is_zero() ? address : gateway; }
+};
+
+// Longest prefix match over IPv4 routes, kept in a path compressed binary trie (PATRICIA). Every node stands for a
+// prefix and only exists if it holds a route or branches, so a lookup visits at most one node per bit of the address
+// no matter how many routes there are.
+class RoutingTable {
+public:
+    static u32 netmask(u8 prefix_length) { return prefix_length ? ~0u << (32 - prefix_length) : 0; }
+
+    // Number of leading one bits, fails if the netmask isn't contiguous
+    static ErrorOr<u8> prefix_length(IPv4Address netmask);
+
+    // Fails with EEXIST if there already is a route for the same prefix, unless `replace` is set
+    ErrorOr<void> add(Route, bool replace = false);
+    ErrorOr<void> remove(IPv4Address destination, u8 prefix_length);
+
+    // Drops every route that goes through `adapter`
+    void remove_all(NetworkAdapter const& adapter);
+
+    Optional<Route> lookup(IPv4Address destination) const;
+
+    // All routes, most specific first within each branch of the trie
+    Vector<Route> routes() const;
+
+private:
+    struct Node {
+        u32 prefix; // Host byte order
+        u8 length;
+
+        Optional<Route> route;
+        OwnPtr<Node> children[2];
+    };
+
+    // Removes the route at `slot` or below, pruning nodes that neither hold a route nor branch anymore
+    static bool remove(OwnPtr<Node>& slot, u32 prefix, u8 length);
+    static void remove_all(OwnPtr<Node>& slot, NetworkAdapter const& adapter);
+
+    static void compact(OwnPtr<Node>& slot);
+    static void collect(Node const*, Vector<Route>&);
+
+    mutable Mutex m_lock;
+    OwnPtr<Node> m_root;
+};
+
+}
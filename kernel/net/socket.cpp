@@ -0,0 +1,72 @@
+#include <kernel/net/socket.h>
+#include <kernel/net/udp_socket.h>
+#include <kernel/net/tcp_socket.h>
+#include <kernel/net/manager.h>
+
+#include <std/endian.h>
+
+namespace kernel::net {
+
+ErrorOr<RefPtr<Socket>> Socket::create(int domain, int type, int protocol) {
+    if (domain != AF_INET) {
+        return Error(EAFNOSUPPORT);
+    }
+
+    bool nonblocking = type & SOCK_NONBLOCK;
+    type &= SOCK_TYPE_MASK;
+
+    RefPtr<Socket> socket = nullptr;
+    switch (type) {
+        case SOCK_DGRAM:
+            if (protocol != 0 && protocol != IPPROTO_UDP) {
+                return Error(EPROTONOSUPPORT);
+            }
+
+            socket = UDPSocket::create();
+            break;
+        case SOCK_STREAM:
+            if (protocol != 0 && protocol != IPPROTO_TCP) {
+                return Error(EPROTONOSUPPORT);
+            }
+
+            socket = TCPSocket::create();
+            break;
+        default:
+            return Error(ESOCKTNOSUPPORT);
+    }
+
+    socket->set_nonblocking(nonblocking);
+    return socket;
+}
+
+ErrorOr<int> Socket::ioctl(unsigned request, unsigned arg) {
+    return NetworkManager::instance()->ioctl(request, arg);
+}
+
+ErrorOr<SocketAddress> Socket::parse_address(const sockaddr* address, socklen_t length) {
+    if (length < sizeof(sockaddr_in)) {
+        return Error(EINVAL);
+    }
+
+    auto* in = reinterpret_cast<const sockaddr_in*>(address);
+    if (in->sin_family != AF_INET) {
+        return Error(EAFNOSUPPORT);
+    }
+
+    return SocketAddress { IPv4Address(in->sin_addr.s_addr), std::from_big_endian(in->sin_port) };
+}
+
+void Socket::write_address(SocketAddress const& address, sockaddr* out, socklen_t* length) {
+    sockaddr_in in = {};
+
+    in.sin_family = AF_INET;
+    in.sin_port = std::to_big_endian(address.port);
+    in.sin_addr.s_addr = address.address.value();
+
+    size_t size = std::min<size_t>(*length, sizeof(sockaddr_in));
+    memcpy(out, &in, size);
+
+    *length = sizeof(sockaddr_in);
+}
+
+}
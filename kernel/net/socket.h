@@ -0,0 +1,104 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/fs/file.h>
+#include <kernel/net/ip/ipv4.h>
+#include <kernel/posix/sys/socket.h>
+#include <kernel/posix/netinet/in.h>
+#include <kernel/process/wait_queue.h>
+
+#include <std/memory.h>
+#include <std/result.h>
+
+namespace kernel::net {
+
+// Only IPv4 for now. IPv6 is handled by the kernel itself (neighbor discovery and echo) but can't be used by sockets,
+// AF_INET6 is refused with EAFNOSUPPORT until TCP and UDP learn to speak it.
+struct SocketAddress {
+    IPv4Address address;
+    u16 port = 0; // Host byte order
+};
+
+class Socket : public fs::File {
+public:
+    static ErrorOr<RefPtr<Socket>> create(int domain, int type, int protocol);
+
+    virtual ~Socket() = default;
+
+    int domain() const { return m_domain; }
+    int type() const { return m_type; }
+    int protocol() const { return m_protocol; }
+
+    bool is_nonblocking() const { return m_nonblocking; }
+    void set_nonblocking(bool value) { m_nonblocking = value; }
+
+    bool is_socket() const final override { return true; }
+
+    virtual ErrorOr<void> bind(SocketAddress const&) = 0;
+    virtual ErrorOr<void> connect(SocketAddress const&) = 0;
+
+    virtual ErrorOr<void> listen(int) { return Error(EOPNOTSUPP); }
+    virtual ErrorOr<RefPtr<Socket>> accept(SocketAddress*) { return Error(EOPNOTSUPP); }
+
+    // A null destination means the connected peer
+    virtual ErrorOr<size_t> sendto(const void* buffer, size_t size, int flags, SocketAddress const* destination) = 0;
+    virtual ErrorOr<size_t> recvfrom(void* buffer, size_t size, int flags, SocketAddress* source) = 0;
+
+    ErrorOr<size_t> read(void* buffer, size_t size, size_t) override {
+        return this->recvfrom(buffer, size, 0, nullptr);
+    }
+
+    ErrorOr<size_t> write(const void* buffer, size_t size, size_t) override {
+        return this->sendto(buffer, size, 0, nullptr);
+    }
+
+    size_t size() const override { return 0; }
+
+    // Interfaces, routes and the ARP cache are configured through any socket (SIOC* requests)
+    ErrorOr<int> ioctl(unsigned request, unsigned arg) override;
+
+    static ErrorOr<SocketAddress> parse_address(const sockaddr*, socklen_t);
+    static void write_address(SocketAddress const&, sockaddr*, socklen_t*);
+
+protected:
+    Socket(int domain, int type, int protocol) : m_domain(domain), m_type(type), m_protocol(protocol) {}
+
+    bool should_block(int flags) const {
+        return !m_nonblocking && !(flags & MSG_DONTWAIT);
+    }
+
+    // Blocks until `condition` holds, fails with EAGAIN instead if the socket (or this call) is non-blocking.
+    // Whoever changes the outcome of `condition` has to call `notify_readiness()`.
+    template<typename Condition>
+    ErrorOr<void> block_until(int flags, Condition&& condition) {
+        if (condition()) {
+            return {};
+        } else if (!this->should_block(flags)) {
+            return Error(EAGAIN);
+        }
+
+        WaitQueueBlocker blocker;
+        this->wait_queue().add(&blocker);
+
+        while (true) {
+            blocker.reset();
+            if (condition()) {
+                break;
+            }
+
+            blocker.wait();
+        }
+
+        this->wait_queue().remove(&blocker);
+        return {};
+    }
+
+private:
+    int m_domain;
+    int m_type;
+    int m_protocol;
+
+    bool m_nonblocking = false;
+};
+
+}
@@ -0,0 +1,1335 @@
+#include <kernel/net/tcp_socket.h>
+#include <kernel/net/manager.h>
+#include <kernel/net/checksum.h>
+#include <kernel/time/manager.h>
+#include <kernel/sync/lock.h>
+
+#include <std/hash_map.h>
+
+namespace kernel::net {
+
+static HashMap<u16, TCPSocket*> s_ports;
+static HashMap<u16, TCPSocket*> s_listeners;
+
+// Connections hold a reference to themselves through this table until they reach CLOSED, so they outlive their file descriptor
+static HashMap<u64, RefPtr<TCPSocket>> s_connections;
+
+// Never acquired while holding a socket lock of a different socket than the one that's being (un)registered
+static Mutex s_sockets_lock;
+
+static u16 s_next_ephemeral_port = TCPSocket::EPHEMERAL_PORT_START;
+
+static inline bool seq_lt(u32 a, u32 b) { return static_cast<i32>(a - b) < 0; }
+static inline bool seq_le(u32 a, u32 b) { return static_cast<i32>(a - b) <= 0; }
+static inline bool seq_gt(u32 a, u32 b) { return static_cast<i32>(a - b) > 0; }
+static inline bool seq_ge(u32 a, u32 b) { return static_cast<i32>(a - b) >= 0; }
+
+static Duration current_time() {
+    return TimeManager::query_time(CLOCK_MONOTONIC);
+}
+
+static Duration scale(Duration duration, u64 numerator, u64 denominator) {
+    return Duration::from_nanoseconds(duration.to_nanoseconds() * numerator / denominator);
+}
+
+// Clock driven ISN (RFC 793 suggests a 4µs tick) mixed with the connection key so that simultaneous connections don't line up
+static u32 generate_isn(u64 key) {
+    u64 clock = current_time().to_microseconds() / 4;
+    return static_cast<u32>(clock + key * 2654435761u);
+}
+
+RefPtr<TCPSocket> TCPSocket::create() {
+    return RefPtr<TCPSocket>(new TCPSocket());
+}
+
+TCPSocket::~TCPSocket() {
+    ScopedLock lock(s_sockets_lock);
+
+    auto owner = s_ports.get(m_local.port);
+    if (m_is_bound && owner.has_value() && owner.value() == this) {
+        s_ports.remove(m_local.port);
+    }
+
+    auto listener = s_listeners.get(m_local.port);
+    if (listener.has_value() && listener.value() == this) {
+        s_listeners.remove(m_local.port);
+    }
+}
+
+u64 TCPSocket::connection_key(u16 local_port, SocketAddress const& peer) {
+    return (static_cast<u64>(peer.address.value()) << 32) | (static_cast<u64>(peer.port) << 16) | local_port;
+}
+
+ErrorOr<void> TCPSocket::bind(SocketAddress const& address) {
+    ScopedLock lock(m_lock);
+    if (m_is_bound || m_state != State::Closed) {
+        return Error(EINVAL);
+    } else if (address.port == 0) {
+        m_local.address = address.address;
+        return this->bind_ephemeral();
+    }
+
+    ScopedLock sockets(s_sockets_lock);
+    if (s_ports.contains(address.port)) {
+        return Error(EADDRINUSE);
+    }
+
+    s_ports.set(address.port, this);
+
+    m_local = address;
+    m_is_bound = true;
+
+    return {};
+}
+
+ErrorOr<void> TCPSocket::bind_ephemeral() {
+    ScopedLock lock(s_sockets_lock);
+
+    size_t count = EPHEMERAL_PORT_END - EPHEMERAL_PORT_START + 1;
+    for (size_t i = 0; i < count; i++) {
+        u16 port = s_next_ephemeral_port;
+        s_next_ephemeral_port = port == EPHEMERAL_PORT_END ? EPHEMERAL_PORT_START : port + 1;
+
+        if (s_ports.contains(port)) {
+            continue;
+        }
+
+        s_ports.set(port, this);
+
+        m_local.port = port;
+        m_is_bound = true;
+
+        return {};
+    }
+
+    return Error(EADDRINUSE);
+}
+
+void TCPSocket::register_connection() {
+    ScopedLock lock(s_sockets_lock);
+
+    s_connections.set(connection_key(m_local.port, m_peer), RefPtr<TCPSocket>(this));
+    m_is_registered = true;
+}
+
+void TCPSocket::unregister_connection() {
+    ScopedLock lock(s_sockets_lock);
+
+    auto listener = s_listeners.get(m_local.port);
+    if (listener.has_value() && listener.value() == this) {
+        s_listeners.remove(m_local.port);
+    }
+
+    if (m_is_registered) {
+        m_is_registered = false;
+        s_connections.remove(connection_key(m_local.port, m_peer));
+    }
+}
+
+ErrorOr<void> TCPSocket::connect(SocketAddress const& address) {
+    {
+        ScopedLock lock(m_lock);
+        switch (m_state) {
+            case State::Closed:
+                break;
+            case State::Listen:
+                return Error(EINVAL);
+            case State::SynSent:
+            case State::SynReceived:
+                return Error(EALREADY);
+            default:
+                return Error(EISCONN);
+        }
+
+        m_adapter = NetworkManager::instance()->route(address.address);
+        if (!m_adapter) {
+            return Error(ENETUNREACH);
+        }
+
+        if (!m_is_bound) {
+            TRY(this->bind_ephemeral());
+        }
+
+        if (m_local.address.is_zero()) {
+            m_local.address = m_adapter->ipv4_address();
+        }
+
+        m_peer = address;
+        m_error = 0;
+
+        m_mss = m_adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+        m_cwnd = INITIAL_WINDOW_SEGMENTS * m_mss;
+
+        m_iss = generate_isn(connection_key(m_local.port, m_peer));
+        m_snd_una = m_iss;
+        m_snd_nxt = m_iss + 1;
+        m_snd_max = m_iss + 1;
+        m_recover = m_iss;
+
+        this->register_connection();
+        this->set_state(State::SynSent);
+
+        this->send_segment(TCPFlags::SYN, m_iss, 0, 0);
+
+        m_rtt_pending = true;
+        m_rtt_sequence = m_iss;
+        m_rtt_start = current_time();
+
+        this->arm_timer(m_retransmit_deadline, m_rto);
+    }
+
+    if (this->is_nonblocking()) {
+        return Error(EINPROGRESS);
+    }
+
+    TRY(this->block_until(0, [this]() { return m_state != State::SynSent && m_state != State::SynReceived; }));
+
+    ScopedLock lock(m_lock);
+    if (m_state == State::Established || m_state == State::CloseWait) {
+        return {};
+    }
+
+    return Error(m_error ? m_error : ECONNREFUSED);
+}
+
+ErrorOr<void> TCPSocket::listen(int backlog) {
+    ScopedLock lock(m_lock);
+
+    size_t size = std::max(std::min<int>(backlog, MAX_BACKLOG), 1);
+    if (m_state == State::Listen) {
+        m_backlog = size;
+        return {};
+    } else if (m_state != State::Closed) {
+        return Error(EINVAL);
+    }
+
+    if (!m_is_bound) {
+        TRY(this->bind_ephemeral());
+    }
+
+    {
+        ScopedLock sockets(s_sockets_lock);
+        if (s_listeners.contains(m_local.port)) {
+            return Error(EADDRINUSE);
+        }
+
+        s_listeners.set(m_local.port, this);
+    }
+
+    m_backlog = size;
+    this->set_state(State::Listen);
+
+    return {};
+}
+
+ErrorOr<RefPtr<Socket>> TCPSocket::accept(SocketAddress* address) {
+    RefPtr<TCPSocket> connection = nullptr;
+    while (true) {
+        TRY(this->block_until(0, [this]() { return !m_accept_queue.empty() || m_state != State::Listen; }));
+
+        ScopedLock lock(m_lock);
+        if (m_state != State::Listen) {
+            return Error(EINVAL);
+        } else if (m_accept_queue.empty()) {
+            continue; // Another thread got to it first
+        }
+
+        connection = m_accept_queue.dequeue();
+        break;
+    }
+
+    if (address) {
+        *address = connection->m_peer;
+    }
+
+    return RefPtr<Socket>(connection);
+}
+
+ErrorOr<size_t> TCPSocket::sendto(const void* buffer, size_t size, int flags, SocketAddress const*) {
+    auto* data = reinterpret_cast<u8 const*>(buffer);
+
+    size_t total = 0;
+    while (total < size) {
+        auto result = this->block_until(flags, [this]() {
+            bool connecting = m_state == State::SynSent || m_state == State::SynReceived;
+            return m_error || (!connecting && (!m_send_buffer.full() || (m_state != State::Established && m_state != State::CloseWait)));
+        });
+
+        if (result.is_err()) {
+            if (total) {
+                return total;
+            }
+
+            return result.error();
+        }
+
+        ScopedLock lock(m_lock);
+        if (m_error) {
+            if (total) {
+                return total;
+            }
+
+            return Error(m_error);
+        } else if (m_state == State::SynSent || m_state == State::SynReceived) {
+            continue;
+        } else if (m_state != State::Established && m_state != State::CloseWait) {
+            if (total) {
+                return total;
+            }
+
+            return Error(m_fin_queued ? EPIPE : ENOTCONN);
+        }
+
+        total += m_send_buffer.write(data + total, size - total);
+        this->transmit();
+    }
+
+    return total;
+}
+
+ErrorOr<size_t> TCPSocket::recvfrom(void* buffer, size_t size, int flags, SocketAddress* source) {
+    if (m_state == State::Listen) {
+        return Error(ENOTCONN);
+    }
+
+    while (true) {
+        TRY(this->block_until(flags, [this]() {
+            return !m_receive_buffer.empty() || m_peer_closed || m_error || m_state == State::Closed;
+        }));
+
+        ScopedLock lock(m_lock);
+        if (!m_receive_buffer.empty()) {
+            size_t nread = (flags & MSG_PEEK) ? m_receive_buffer.peek(buffer, size) : m_receive_buffer.read(buffer, size);
+
+            // Let the sender know once the window opened up by a meaningful amount (receiver side SWS avoidance, RFC 1122)
+            u32 right_edge = m_rcv_nxt + (static_cast<u32>(this->advertised_window()) << m_rcv_wscale);
+            if (this->is_synchronized() && !m_peer_closed && seq_ge(right_edge, m_rcv_adv + 2 * m_mss)) {
+                this->send_ack();
+            }
+
+            if (source) {
+                *source = m_peer;
+            }
+
+            return nread;
+        } else if (m_error) {
+            return Error(m_error);
+        } else if (m_peer_closed) {
+            return 0;
+        } else if (m_state == State::Closed) {
+            return Error(ENOTCONN);
+        }
+    }
+}
+
+void TCPSocket::close() {
+    Vector<RefPtr<TCPSocket>> pending;
+    {
+        ScopedLock lock(m_lock);
+        switch (m_state) {
+            case State::Listen:
+                while (!m_accept_queue.empty()) {
+                    pending.append(m_accept_queue.dequeue());
+                }
+
+                this->set_state(State::Closed);
+                break;
+            case State::SynSent:
+                this->set_state(State::Closed);
+                break;
+            case State::SynReceived:
+            case State::Established:
+                // Unread data is lost, so tell the peer instead of pretending to close gracefully (RFC 2525)
+                if (!m_receive_buffer.empty()) {
+                    this->abort(0);
+                    break;
+                }
+
+                m_fin_queued = true;
+                this->set_state(State::FinWait1);
+                this->transmit();
+                break;
+            case State::CloseWait:
+                m_fin_queued = true;
+                this->set_state(State::LastAck);
+                this->transmit();
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Connections that were never accepted are reset, they don't have anyone to read from them
+    for (auto& connection : pending) {
+        ScopedLock lock(connection->m_lock);
+        connection->abort(0);
+    }
+}
+
+bool TCPSocket::can_read(fs::FileDescriptor const&) const {
+    if (m_state == State::Listen) {
+        return !m_accept_queue.empty();
+    }
+
+    return !m_receive_buffer.empty() || m_peer_closed || m_error;
+}
+
+bool TCPSocket::can_write(fs::FileDescriptor const&) const {
+    if (m_error) {
+        return true;
+    }
+
+    return (m_state == State::Established || m_state == State::CloseWait) && !m_send_buffer.full();
+}
+
+bool TCPSocket::is_synchronized() const {
+    switch (m_state) {
+        case State::Closed:
+        case State::Listen:
+        case State::SynSent:
+        case State::SynReceived:
+            return false;
+        default:
+            return true;
+    }
+}
+
+u16 TCPSocket::advertised_window() const {
+    return std::min<u32>(this->receive_window() >> m_rcv_wscale, 0xFFFF);
+}
+
+void TCPSocket::arm_timer(Duration& deadline, Duration timeout) {
+    deadline = current_time() + timeout;
+    NetworkManager::instance()->schedule_timer(deadline);
+}
+
+void TCPSocket::set_state(State state) {
+    if (m_state == state) {
+        return;
+    }
+
+    State previous = m_state;
+    m_state = state;
+
+    if (state == State::Closed) {
+        m_retransmit_deadline = Duration::zero();
+        m_delayed_ack_deadline = Duration::zero();
+        m_time_wait_deadline = Duration::zero();
+
+        if (m_listener) {
+            if (previous == State::SynReceived) {
+                m_listener->m_pending_connections.fetch_sub(1);
+            }
+
+            m_listener = nullptr;
+        }
+
+        this->unregister_connection();
+    } else if (state == State::Established) {
+        // Listeners and handshakes that never complete don't need any buffer space
+        if (!m_receive_buffer.capacity()) {
+            m_send_buffer.allocate(SEND_BUFFER_SIZE);
+            m_receive_buffer.allocate(RECEIVE_BUFFER_SIZE);
+        }
+    } else if (state == State::FinWait2) {
+        // Nobody can read from us anymore, so don't wait forever for a peer that never closes its side
+        this->arm_timer(m_time_wait_deadline, TIME_WAIT_TIMEOUT);
+    } else if (state == State::TimeWait) {
+        m_retransmit_deadline = Duration::zero();
+        m_delayed_ack_deadline = Duration::zero();
+
+        this->arm_timer(m_time_wait_deadline, TIME_WAIT_TIMEOUT);
+    }
+
+    this->notify_readiness();
+}
+
+void TCPSocket::abort(int error) {
+    if (m_state == State::Closed) {
+        return;
+    } else if (m_state != State::Listen && m_state != State::SynSent) {
+        this->send_reset();
+    }
+
+    m_error = error;
+    this->set_state(State::Closed);
+}
+
+void TCPSocket::parse_options(TCPPacket const* tcp) {
+    u8 const* options = tcp->options();
+    size_t size = tcp->options_size();
+
+    bool has_mss = false;
+    bool has_window_scale = false;
+
+    size_t i = 0;
+    while (i < size) {
+        u8 kind = options[i];
+        if (kind == TCPOption::End) {
+            break;
+        } else if (kind == TCPOption::NOP) {
+            i++;
+            continue;
+        } else if (i + 1 >= size || options[i + 1] < 2 || i + options[i + 1] > size) {
+            break; // Malformed
+        }
+
+        u8 length = options[i + 1];
+        if (kind == TCPOption::MSS && length == 4) {
+            u16 mss = (options[i + 2] << 8) | options[i + 3];
+            m_mss = std::min(m_mss, std::max<u16>(mss, 64));
+
+            has_mss = true;
+        } else if (kind == TCPOption::WindowScale && length == 3) {
+            m_snd_wscale = std::min<u8>(options[i + 2], 14);
+            has_window_scale = true;
+        }
+
+        i += length;
+    }
+
+    if (!has_mss) {
+        m_mss = std::min(m_mss, DEFAULT_MSS);
+    }
+
+    // Window scaling is only in effect if both sides sent the option in their SYN (RFC 7323)
+    if (has_window_scale) {
+        m_rcv_wscale = WINDOW_SCALE;
+    } else {
+        m_snd_wscale = 0;
+        m_rcv_wscale = 0;
+    }
+}
+
+void TCPSocket::send_segment(u8 flags, u32 sequence, size_t offset, size_t size) {
+    if (!m_adapter) {
+        return;
+    }
+
+    bool syn = flags & TCPFlags::SYN;
+
+    // MSS, NOP and window scale, padded to a multiple of 4 bytes
+    bool window_scale = syn && (m_state == State::SynSent || m_rcv_wscale);
+    size_t options_size = syn ? (window_scale ? 8 : 4) : 0;
+
+    // The header is built on the stack, the payload goes out straight from the send buffer
+    u8 header[sizeof(TCPPacket) + 8];
+    auto* tcp = reinterpret_cast<TCPPacket*>(header);
+
+    tcp->source_port = m_local.port;
+    tcp->destination_port = m_peer.port;
+    tcp->sequence_number = sequence;
+    tcp->ack_number = (flags & TCPFlags::ACK) ? m_rcv_nxt : 0;
+    tcp->reserved = 0;
+    tcp->data_offset = (sizeof(TCPPacket) + options_size) / 4;
+    tcp->flags = flags;
+    tcp->checksum = 0;
+    tcp->urgent_pointer = 0;
+
+    // The window field of SYN segments is never scaled
+    tcp->window_size = syn ? std::min<u32>(this->receive_window(), 0xFFFF) : this->advertised_window();
+
+    if (syn) {
+        u16 mss = m_adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+
+        tcp->data[0] = TCPOption::MSS;
+        tcp->data[1] = 4;
+        tcp->data[2] = mss >> 8;
+        tcp->data[3] = mss & 0xFF;
+
+        if (window_scale) {
+            tcp->data[4] = TCPOption::NOP;
+            tcp->data[5] = TCPOption::WindowScale;
+            tcp->data[6] = 3;
+            tcp->data[7] = WINDOW_SCALE;
+        }
+    }
+
+    PacketFragment fragments[3];
+    fragments[0] = { header, sizeof(TCPPacket) + options_size };
+
+    RingBuffer::Region regions[2];
+    size_t count = m_send_buffer.regions(regions, size, offset);
+
+    for (size_t i = 0; i < count; i++) {
+        fragments[i + 1] = { regions[i].data, regions[i].size };
+    }
+
+    // The checksum is finished by the adapter, or by the segmentation that splits a send larger than the MSS
+    PacketMetadata metadata;
+    metadata.flags = PacketMetadata::NeedsChecksum;
+    metadata.checksum_offset = 16;
+    metadata.header_size = sizeof(TCPPacket) + options_size;
+    metadata.mss = size > m_mss ? m_mss : 0;
+
+    size_t length = sizeof(TCPPacket) + options_size + size;
+    tcp->checksum = checksum_fold(ipv4_pseudo_header_sum(m_adapter->ipv4_address(), m_peer.address, IPProtocol::TCP, length));
+
+    if (flags & TCPFlags::ACK) {
+        m_rcv_adv = m_rcv_nxt + (static_cast<u32>(tcp->window_size) << (syn ? 0 : m_rcv_wscale));
+
+        // Every ACK we send covers whatever the delayed ACK was waiting for
+        m_unacked_segments = 0;
+        m_delayed_ack_deadline = Duration::zero();
+    }
+
+    (void)m_adapter->send_ipv4(m_peer.address, IPProtocol::TCP, fragments, count + 1, metadata);
+}
+
+void TCPSocket::send_ack() {
+    this->send_segment(TCPFlags::ACK, m_snd_nxt, 0, 0);
+}
+
+void TCPSocket::send_reset() {
+    this->send_segment(TCPFlags::RST | TCPFlags::ACK, m_snd_nxt, 0, 0);
+}
+
+void TCPSocket::send_reset(NetworkAdapter& receiver, IPv4Packet const* ipv4, TCPPacket const* tcp, size_t size) {
+    // Without a route back, answer through wherever the segment came from
+    auto adapter = NetworkManager::instance()->route(ipv4->source);
+    if (!adapter) {
+        adapter = RefPtr<NetworkAdapter>(&receiver);
+    }
+
+    TCPPacket reset = {};
+
+    reset.source_port = tcp->destination_port;
+    reset.destination_port = tcp->source_port;
+    reset.data_offset = sizeof(TCPPacket) / 4;
+
+    // RFC 793: If the incoming segment has an ACK field, the reset takes its sequence number from it,
+    // otherwise the reset has sequence number zero and acknowledges everything the segment occupied.
+    if (tcp->has_flag(TCPFlags::ACK)) {
+        reset.sequence_number = tcp->ack_number;
+        reset.flags = TCPFlags::RST;
+    } else {
+        u32 length = size - tcp->header_size();
+        if (tcp->has_flag(TCPFlags::SYN)) length++;
+        if (tcp->has_flag(TCPFlags::FIN)) length++;
+
+        reset.sequence_number = 0;
+        reset.ack_number = tcp->sequence_number + length;
+        reset.flags = TCPFlags::RST | TCPFlags::ACK;
+    }
+
+    IPv4PseudoHeader pseudo;
+    pseudo.source = adapter->ipv4_address();
+    pseudo.destination = ipv4->source;
+    pseudo.protocol = IPProtocol::TCP;
+    pseudo.length = sizeof(TCPPacket);
+
+    u32 sum = checksum_add(0, &pseudo, sizeof(IPv4PseudoHeader));
+    reset.checksum = checksum_finish(checksum_add(sum, &reset, sizeof(TCPPacket)));
+
+    (void)adapter->send_ipv4(ipv4->source, IPProtocol::TCP, reinterpret_cast<u8 const*>(&reset), sizeof(TCPPacket));
+}
+
+void TCPSocket::transmit() {
+    switch (m_state) {
+        case State::Established:
+        case State::CloseWait:
+        case State::FinWait1:
+        case State::Closing:
+        case State::LastAck:
+            break;
+        default:
+            return;
+    }
+
+    // Everything sent in one go reaches the device with a single doorbell write
+    TransmitBatch batch(*m_adapter);
+
+    // Data goes down in as few frames as possible, each one is only cut into MSS sized segments right before (or by)
+    // the device. Keeping it a multiple of the MSS leaves only the very last segment short.
+    size_t header_size = sizeof(IPv4Packet) + sizeof(TCPPacket);
+    size_t max_size = std::max(((NetworkAdapter::MAX_GSO_SIZE - header_size) / m_mss) * m_mss, static_cast<size_t>(m_mss));
+
+    while (true) {
+        if (m_fin_sent && seq_gt(m_snd_nxt, m_fin_sequence)) {
+            break;
+        }
+
+        u32 flight = this->bytes_in_flight();
+        u32 window = std::min(m_snd_wnd, m_cwnd);
+
+        size_t available = m_send_buffer.size() > flight ? m_send_buffer.size() - flight : 0;
+        size_t usable = window > flight ? window - flight : 0;
+
+        size_t size = std::min(std::min(available, usable), max_size);
+        if (!size) {
+            if (!available && m_fin_queued && (!m_fin_sent || m_snd_nxt == m_fin_sequence)) {
+                m_fin_sequence = m_snd_nxt;
+                m_fin_sent = true;
+
+                this->send_segment(TCPFlags::FIN | TCPFlags::ACK, m_snd_nxt, 0, 0);
+
+                m_snd_nxt++;
+                if (seq_gt(m_snd_nxt, m_snd_max)) {
+                    m_snd_max = m_snd_nxt;
+                }
+
+                if (m_retransmit_deadline == Duration::zero()) {
+                    this->arm_timer(m_retransmit_deadline, m_rto);
+                }
+            } else if (available && !m_snd_wnd && !flight && m_retransmit_deadline == Duration::zero()) {
+                // The peer closed its window, the retransmission timer doubles as the persist timer and probes it
+                this->arm_timer(m_retransmit_deadline, m_rto);
+            }
+
+            break;
+        }
+
+        u8 flags = TCPFlags::ACK;
+        if (size == available) {
+            flags |= TCPFlags::PSH;
+        }
+
+        this->send_segment(flags, m_snd_nxt, flight, size);
+
+        // Only new data is timed, retransmissions are ambiguous (Karn's algorithm)
+        if (!m_rtt_pending && m_snd_nxt == m_snd_max) {
+            m_rtt_pending = true;
+            m_rtt_sequence = m_snd_nxt;
+            m_rtt_start = current_time();
+        }
+
+        m_snd_nxt += size;
+        if (seq_gt(m_snd_nxt, m_snd_max)) {
+            m_snd_max = m_snd_nxt;
+        }
+
+        if (m_retransmit_deadline == Duration::zero()) {
+            this->arm_timer(m_retransmit_deadline, m_rto);
+        }
+    }
+}
+
+void TCPSocket::retransmit() {
+    size_t size = std::min(m_send_buffer.size(), static_cast<size_t>(m_mss));
+
+    u8 flags = TCPFlags::ACK;
+    if (m_fin_sent && size == m_send_buffer.size()) {
+        flags |= TCPFlags::FIN;
+    }
+
+    if (size || (flags & TCPFlags::FIN)) {
+        this->send_segment(flags, m_snd_una, 0, size);
+    }
+}
+
+void TCPSocket::update_rtt(Duration sample) {
+    if (!m_has_rtt_sample) {
+        m_srtt = sample;
+        m_rttvar = scale(sample, 1, 2);
+        m_has_rtt_sample = true;
+    } else {
+        Duration delta = m_srtt > sample ? m_srtt - sample : sample - m_srtt;
+
+        m_rttvar = scale(m_rttvar, 3, 4) + scale(delta, 1, 4);
+        m_srtt = scale(m_srtt, 7, 8) + scale(sample, 1, 8);
+    }
+
+    Duration variance = scale(m_rttvar, 4, 1);
+    Duration rto = m_srtt + std::max(variance, Duration::from_milliseconds(1));
+
+    m_rto = std::min(std::max(rto, MIN_RTO), MAX_RTO);
+}
+
+void TCPSocket::handle_packet(
+    NetworkAdapter& adapter, IPv4Packet const* ipv4, TCPPacket const* tcp, size_t size, PacketMetadata const& metadata
+) {
+    if (size < sizeof(TCPPacket) || tcp->header_size() < sizeof(TCPPacket) || tcp->header_size() > size) {
+        return;
+    }
+
+    if (!(metadata.flags & PacketMetadata::ChecksumValid)) {
+        u32 sum = ipv4_pseudo_header_sum(ipv4->source, ipv4->destination, IPProtocol::TCP, size);
+        if (checksum_finish(checksum_add(sum, tcp, size)) != 0) {
+            return;
+        }
+    }
+
+    SocketAddress peer = { ipv4->source, tcp->source_port };
+    u16 port = tcp->destination_port;
+
+    RefPtr<TCPSocket> socket = nullptr;
+    {
+        ScopedLock lock(s_sockets_lock);
+
+        auto connection = s_connections.get(connection_key(port, peer));
+        if (connection.has_value()) {
+            socket = connection.value();
+        } else {
+            auto listener = s_listeners.get(port);
+            if (listener.has_value()) {
+                socket = RefPtr<TCPSocket>(listener.value());
+            }
+        }
+    }
+
+    if (!socket) {
+        if (!tcp->has_flag(TCPFlags::RST)) {
+            send_reset(adapter, ipv4, tcp, size);
+        }
+
+        return;
+    }
+
+    RefPtr<TCPSocket> listener = nullptr;
+    {
+        ScopedLock lock(socket->m_lock);
+        switch (socket->m_state) {
+            case State::Listen:
+                socket->handle_listen(adapter, ipv4, tcp); break;
+            case State::SynSent:
+                socket->handle_syn_sent(tcp); break;
+            case State::Closed:
+                if (!tcp->has_flag(TCPFlags::RST)) {
+                    send_reset(adapter, ipv4, tcp, size);
+                }
+
+                break;
+            default:
+                socket->handle_segment(tcp, size); break;
+        }
+
+        if (socket->m_listener && socket->is_synchronized()) {
+            listener = move(socket->m_listener);
+        }
+    }
+
+    if (!listener) {
+        return;
+    }
+
+    // The connection completed its handshake, hand it to the listener without holding both locks at once
+    bool accepted = false;
+    {
+        ScopedLock lock(listener->m_lock);
+        listener->m_pending_connections.fetch_sub(1);
+
+        if (listener->m_state == State::Listen) {
+            listener->m_accept_queue.enqueue(socket);
+            listener->notify_readiness();
+
+            accepted = true;
+        }
+    }
+
+    if (!accepted) {
+        ScopedLock lock(socket->m_lock);
+        socket->abort(0);
+    }
+}
+
+void TCPSocket::handle_listen(NetworkAdapter& adapter, IPv4Packet const* ipv4, TCPPacket const* tcp) {
+    if (tcp->has_flag(TCPFlags::RST)) {
+        return;
+    } else if (tcp->has_flag(TCPFlags::ACK)) {
+        send_reset(adapter, ipv4, tcp, tcp->header_size());
+        return;
+    } else if (!tcp->has_flag(TCPFlags::SYN)) {
+        return;
+    }
+
+    // The peer retransmits its SYN if we drop it here, by then the application might have accepted some connections
+    if (m_pending_connections.load() + m_accept_queue.size() >= m_backlog) {
+        return;
+    }
+
+    auto connection = TCPSocket::create();
+
+    connection->m_local = { ipv4->destination, m_local.port };
+    connection->m_peer = { ipv4->source, tcp->source_port };
+
+    connection->m_adapter = NetworkManager::instance()->route(ipv4->source);
+    if (!connection->m_adapter) {
+        connection->m_adapter = RefPtr<NetworkAdapter>(&adapter);
+    }
+
+    // The connection isn't reachable by anyone but the network task until it's registered, so it doesn't need to be locked
+    connection->m_listener = RefPtr<TCPSocket>(this);
+    connection->set_nonblocking(this->is_nonblocking());
+
+    connection->m_irs = tcp->sequence_number;
+    connection->m_rcv_nxt = connection->m_irs + 1;
+
+    connection->m_mss = connection->m_adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+    connection->parse_options(tcp);
+
+    connection->m_snd_wnd = tcp->window_size;
+    connection->m_snd_wl1 = connection->m_irs;
+    connection->m_cwnd = INITIAL_WINDOW_SEGMENTS * connection->m_mss;
+
+    connection->m_iss = generate_isn(connection_key(m_local.port, connection->m_peer));
+    connection->m_snd_una = connection->m_iss;
+    connection->m_snd_nxt = connection->m_iss + 1;
+    connection->m_snd_max = connection->m_iss + 1;
+    connection->m_recover = connection->m_iss;
+
+    m_pending_connections.fetch_add(1);
+
+    connection->register_connection();
+    connection->m_state = State::SynReceived;
+
+    connection->send_segment(TCPFlags::SYN | TCPFlags::ACK, connection->m_iss, 0, 0);
+
+    connection->m_rtt_pending = true;
+    connection->m_rtt_sequence = connection->m_iss;
+    connection->m_rtt_start = current_time();
+
+    connection->arm_timer(connection->m_retransmit_deadline, connection->m_rto);
+}
+
+void TCPSocket::handle_syn_sent(TCPPacket const* tcp) {
+    bool has_ack = tcp->has_flag(TCPFlags::ACK);
+    u32 ack = tcp->ack_number;
+
+    if (has_ack && (seq_le(ack, m_iss) || seq_gt(ack, m_snd_max))) {
+        if (!tcp->has_flag(TCPFlags::RST)) {
+            this->send_segment(TCPFlags::RST, ack, 0, 0);
+        }
+
+        return;
+    }
+
+    if (tcp->has_flag(TCPFlags::RST)) {
+        if (has_ack) {
+            m_error = ECONNREFUSED;
+            this->set_state(State::Closed);
+        }
+
+        return;
+    } else if (!tcp->has_flag(TCPFlags::SYN)) {
+        return;
+    }
+
+    m_irs = tcp->sequence_number;
+    m_rcv_nxt = m_irs + 1;
+
+    this->parse_options(tcp);
+    m_cwnd = INITIAL_WINDOW_SEGMENTS * m_mss;
+
+    if (!has_ack) {
+        // Simultaneous open
+        this->set_state(State::SynReceived);
+        this->send_segment(TCPFlags::SYN | TCPFlags::ACK, m_iss, 0, 0);
+
+        return;
+    }
+
+    m_snd_una = ack;
+    m_snd_wnd = tcp->window_size;
+    m_snd_wl1 = m_irs;
+    m_snd_wl2 = ack;
+
+    if (m_rtt_pending) {
+        this->update_rtt(current_time() - m_rtt_start);
+        m_rtt_pending = false;
+    }
+
+    m_retransmits = 0;
+    m_retransmit_deadline = Duration::zero();
+
+    this->set_state(State::Established);
+    this->send_ack();
+}
+
+void TCPSocket::handle_segment(TCPPacket const* tcp, size_t size) {
+    u32 sequence = tcp->sequence_number;
+    size_t length = size - tcp->header_size();
+
+    bool syn = tcp->has_flag(TCPFlags::SYN);
+    bool fin = tcp->has_flag(TCPFlags::FIN);
+
+    u32 segment_length = length + syn + fin;
+    u32 window = this->receive_window();
+
+    // RFC 793: Check whether any part of the segment falls into the receive window
+    bool acceptable = false;
+    if (!segment_length) {
+        acceptable = window ? seq_ge(sequence, m_rcv_nxt) && seq_lt(sequence, m_rcv_nxt + window) : sequence == m_rcv_nxt;
+    } else if (window) {
+        u32 last = sequence + segment_length - 1;
+        acceptable = (seq_ge(sequence, m_rcv_nxt) && seq_lt(sequence, m_rcv_nxt + window)) ||
+                     (seq_ge(last, m_rcv_nxt) && seq_lt(last, m_rcv_nxt + window));
+    }
+
+    if (!acceptable) {
+        if (!tcp->has_flag(TCPFlags::RST)) {
+            this->send_ack();
+        }
+
+        return;
+    }
+
+    if (tcp->has_flag(TCPFlags::RST)) {
+        switch (m_state) {
+            case State::SynReceived:
+            case State::Closing:
+            case State::LastAck:
+            case State::TimeWait:
+                this->set_state(State::Closed);
+                break;
+            default:
+                m_error = ECONNRESET;
+                this->set_state(State::Closed);
+                break;
+        }
+
+        return;
+    }
+
+    // A SYN in the window is most likely forged or stale, answer with a challenge ACK instead of resetting (RFC 5961)
+    if (syn) {
+        this->send_ack();
+        return;
+    } else if (!tcp->has_flag(TCPFlags::ACK)) {
+        return;
+    }
+
+    if (!this->process_ack(tcp, segment_length)) {
+        return;
+    }
+
+    switch (m_state) {
+        case State::Established:
+        case State::FinWait1:
+        case State::FinWait2:
+            if (length || fin) {
+                this->process_data(sequence, tcp->payload(), length, fin);
+            }
+
+            break;
+        default:
+            break;
+    }
+}
+
+bool TCPSocket::process_ack(TCPPacket const* tcp, size_t segment_length) {
+    u32 sequence = tcp->sequence_number;
+    u32 ack = tcp->ack_number;
+
+    if (m_state == State::SynReceived) {
+        if (seq_le(ack, m_snd_una) || seq_gt(ack, m_snd_max)) {
+            this->send_segment(TCPFlags::RST, ack, 0, 0);
+            return false;
+        }
+
+        m_snd_wnd = static_cast<u32>(tcp->window_size) << m_snd_wscale;
+        m_snd_wl1 = sequence;
+        m_snd_wl2 = ack;
+
+        this->set_state(State::Established);
+    }
+
+    if (seq_gt(ack, m_snd_max)) {
+        this->send_ack();
+        return false;
+    } else if (seq_lt(ack, m_snd_una)) {
+        return true; // Old duplicate, the data in it may still be new
+    }
+
+    u32 window = static_cast<u32>(tcp->window_size) << m_snd_wscale;
+    if (seq_gt(ack, m_snd_una)) {
+        u32 acked = ack - m_snd_una;
+
+        bool fin_acked = m_fin_sent && seq_gt(ack, m_fin_sequence);
+        m_send_buffer.discard(std::min<size_t>(acked - fin_acked, m_send_buffer.size()));
+
+        m_snd_una = ack;
+        if (seq_lt(m_snd_nxt, ack)) {
+            m_snd_nxt = ack;
+        }
+
+        if (m_rtt_pending && seq_gt(ack, m_rtt_sequence)) {
+            this->update_rtt(current_time() - m_rtt_start);
+            m_rtt_pending = false;
+        }
+
+        if (m_in_fast_recovery) {
+            if (seq_ge(ack, m_recover)) {
+                m_in_fast_recovery = false;
+                m_cwnd = m_ssthresh;
+            } else {
+                // NewReno partial ACK: the next hole is lost as well, retransmit it right away and deflate the window
+                this->retransmit();
+                m_cwnd = m_cwnd > acked ? m_cwnd - acked + m_mss : m_mss;
+            }
+        } else if (m_cwnd < m_ssthresh) {
+            m_cwnd += std::min(acked, static_cast<u32>(m_mss));
+        } else {
+            m_cwnd += std::max(static_cast<u32>(m_mss) * m_mss / m_cwnd, 1u);
+        }
+
+        m_duplicate_acks = 0;
+        m_retransmits = 0;
+
+        if (m_snd_una == m_snd_max) {
+            m_retransmit_deadline = Duration::zero();
+        } else {
+            this->arm_timer(m_retransmit_deadline, m_rto);
+        }
+
+        this->notify_readiness();
+
+        if (fin_acked) {
+            switch (m_state) {
+                case State::FinWait1:
+                    this->set_state(State::FinWait2);
+                    break;
+                case State::Closing:
+                    this->set_state(State::TimeWait);
+                    break;
+                case State::LastAck:
+                    this->set_state(State::Closed);
+                    return false;
+                default:
+                    break;
+            }
+        }
+    } else if (!segment_length && window == m_snd_wnd && m_snd_una != m_snd_max) {
+        m_duplicate_acks++;
+
+        if (m_duplicate_acks == DUPLICATE_ACK_THRESHOLD && !m_in_fast_recovery && seq_gt(ack, m_recover)) {
+            // Fast retransmit (RFC 5681), `m_recover` keeps us from reducing the window twice for the same loss event
+            m_ssthresh = std::max(this->bytes_in_flight() / 2, 2u * m_mss);
+            m_recover = m_snd_max;
+            m_in_fast_recovery = true;
+            m_rtt_pending = false;
+
+            this->retransmit();
+            m_cwnd = m_ssthresh + DUPLICATE_ACK_THRESHOLD * m_mss;
+        } else if (m_in_fast_recovery) {
+            // Every duplicate ACK means a segment left the network
+            m_cwnd += m_mss;
+        }
+    }
+
+    if (seq_lt(m_snd_wl1, sequence) || (m_snd_wl1 == sequence && seq_le(m_snd_wl2, ack))) {
+        m_snd_wnd = window;
+        m_snd_wl1 = sequence;
+        m_snd_wl2 = ack;
+    }
+
+    this->transmit();
+    return true;
+}
+
+void TCPSocket::process_data(u32 sequence, u8 const* data, size_t size, bool fin) {
+    // Drop whatever we already received
+    if (seq_lt(sequence, m_rcv_nxt)) {
+        u32 skip = m_rcv_nxt - sequence;
+        if (skip > size) {
+            this->send_ack();
+            return;
+        }
+
+        data += skip;
+        size -= skip;
+        sequence = m_rcv_nxt;
+    }
+
+    u32 window = this->receive_window();
+    u32 offset = sequence - m_rcv_nxt;
+
+    if (offset + size > window) {
+        size = offset < window ? window - offset : 0;
+        fin = false;
+    }
+
+    if (offset) {
+        // Out of order: keep it around and send a duplicate ACK right away so the sender can fast retransmit
+        bool duplicate = false;
+        for (auto& segment : m_out_of_order) {
+            duplicate |= segment.sequence == sequence;
+        }
+
+        if (size && !duplicate && m_out_of_order.size() < MAX_OUT_OF_ORDER_SEGMENTS) {
+            OutOfOrderSegment segment { sequence, {}, fin };
+            segment.data.append(data, size);
+
+            m_out_of_order.append(move(segment));
+        }
+
+        this->send_ack();
+        return;
+    }
+
+    bool filled_hole = !m_out_of_order.empty();
+    if (size) {
+        m_receive_buffer.write(data, size);
+        m_rcv_nxt += size;
+    }
+
+    // Pull in everything that became contiguous
+    bool progress = true;
+    while (progress && !fin) {
+        progress = false;
+
+        for (size_t i = 0; i < m_out_of_order.size(); i++) {
+            auto& segment = m_out_of_order[i];
+            if (seq_gt(segment.sequence, m_rcv_nxt)) {
+                continue;
+            }
+
+            u32 end = segment.sequence + segment.data.size();
+            if (seq_gt(end, m_rcv_nxt)) {
+                u32 skip = m_rcv_nxt - segment.sequence;
+                size_t count = m_receive_buffer.write(segment.data.data() + skip, segment.data.size() - skip);
+
+                m_rcv_nxt += count;
+                size += count;
+            }
+
+            fin = segment.fin && end == m_rcv_nxt;
+
+            // Order doesn't matter, so fill the gap with the last segment instead of shifting everything down
+            if (i != m_out_of_order.size() - 1) {
+                m_out_of_order[i] = move(m_out_of_order.last());
+            }
+
+            m_out_of_order.remove_last();
+            progress = true;
+
+            break;
+        }
+    }
+
+    if (size) {
+        this->notify_readiness();
+    }
+
+    if (fin) {
+        this->process_fin();
+    }
+
+    // Delayed ACK (RFC 1122): acknowledge at least every second segment, or once the timer runs out
+    if (filled_hole || fin) {
+        this->send_ack();
+    } else if (++m_unacked_segments >= 2) {
+        this->send_ack();
+    } else if (m_delayed_ack_deadline == Duration::zero()) {
+        this->arm_timer(m_delayed_ack_deadline, DELAYED_ACK_TIMEOUT);
+    }
+}
+
+void TCPSocket::process_fin() {
+    m_rcv_nxt++;
+    m_peer_closed = true;
+
+    m_out_of_order.clear();
+
+    switch (m_state) {
+        case State::Established:
+            this->set_state(State::CloseWait);
+            break;
+        case State::FinWait1:
+            this->set_state(State::Closing);
+            break;
+        case State::FinWait2:
+            this->set_state(State::TimeWait);
+            break;
+        default:
+            break;
+    }
+
+    this->notify_readiness();
+}
+
+void TCPSocket::on_timer(Duration now) {
+    if (m_delayed_ack_deadline != Duration::zero() && now >= m_delayed_ack_deadline) {
+        this->send_ack();
+    }
+
+    if (m_time_wait_deadline != Duration::zero() && now >= m_time_wait_deadline) {
+        this->set_state(State::Closed);
+        return;
+    }
+
+    if (m_retransmit_deadline == Duration::zero() || now < m_retransmit_deadline) {
+        return;
+    }
+
+    m_retransmit_deadline = Duration::zero();
+
+    // Zero window probe, it's answered with an ACK that carries the current window
+    if (!this->bytes_in_flight() && !m_snd_wnd && !m_send_buffer.empty()) {
+        this->send_segment(TCPFlags::ACK, m_snd_nxt, 0, 1);
+        if (seq_gt(m_snd_nxt + 1, m_snd_max)) {
+            m_snd_max = m_snd_nxt + 1;
+        }
+
+        m_retransmits = 0;
+        m_rto = std::min(scale(m_rto, 2, 1), MAX_RTO);
+
+        this->arm_timer(m_retransmit_deadline, m_rto);
+        return;
+    }
+
+    if (++m_retransmits > MAX_RETRANSMITS) {
+        this->abort(ETIMEDOUT);
+        return;
+    }
+
+    // Exponential backoff (RFC 6298), the sample that was in flight is useless now
+    m_rto = std::min(scale(m_rto, 2, 1), MAX_RTO);
+    m_rtt_pending = false;
+
+    switch (m_state) {
+        case State::SynSent:
+            this->send_segment(TCPFlags::SYN, m_iss, 0, 0);
+            break;
+        case State::SynReceived:
+            this->send_segment(TCPFlags::SYN | TCPFlags::ACK, m_iss, 0, 0);
+            break;
+        default:
+            // Assume everything in flight is lost and go back to slow start from the first unacknowledged byte
+            m_ssthresh = std::max(this->bytes_in_flight() / 2, 2u * m_mss);
+            m_cwnd = m_mss;
+            m_recover = m_snd_max;
+            m_in_fast_recovery = false;
+            m_duplicate_acks = 0;
+
+            m_snd_nxt = m_snd_una;
+            this->transmit();
+
+            break;
+    }
+
+    if (m_retransmit_deadline == Duration::zero()) {
+        this->arm_timer(m_retransmit_deadline, m_rto);
+    }
+}
+
+Duration TCPSocket::process_timers(Duration now) {
+    Vector<RefPtr<TCPSocket>> connections;
+    {
+        ScopedLock lock(s_sockets_lock);
+
+        connections.reserve(s_connections.size());
+        for (auto& entry : s_connections) {
+            connections.append(entry.value);
+        }
+    }
+
+    Duration next = Duration::zero();
+    auto update = [&next](Duration deadline) {
+        if (deadline != Duration::zero() && (next == Duration::zero() || deadline < next)) {
+            next = deadline;
+        }
+    };
+
+    for (auto& connection : connections) {
+        ScopedLock lock(connection->m_lock);
+        connection->on_timer(now);
+
+        update(connection->m_retransmit_deadline);
+        update(connection->m_delayed_ack_deadline);
+        update(connection->m_time_wait_deadline);
+    }
+
+    return next;
+}
+
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/socket.h>
+#include <kernel/net/adapter.h>
+#include <kernel/net/ip/tcp.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/ring_buffer.h>
+#include <std/queue.h>
+#include <std/vector.h>
+#include <std/time.h>
+#include <std/atomic.h>
+
+namespace kernel::net {
+
+class TCPSocket : public Socket {
+public:
+    enum class State : u8 {
+        Closed,
+        Listen,
+        SynSent,
+        SynReceived,
+        Established,
+        FinWait1,
+        FinWait2,
+        CloseWait,
+        Closing,
+        LastAck,
+        TimeWait
+    };
+
+    static constexpr size_t SEND_BUFFER_SIZE = 256 * KB;
+    static constexpr size_t RECEIVE_BUFFER_SIZE = 256 * KB;
+
+    // Smallest shift that lets us advertise the whole receive buffer in the 16-bit window field
+    static constexpr u8 WINDOW_SCALE = [] {
+        u8 shift = 0;
+        while ((RECEIVE_BUFFER_SIZE >> shift) > 0xFFFF) {
+            shift++;
+        }
+
+        return shift;
+    }();
+
+    static constexpr u16 DEFAULT_MSS = 536;
+    static constexpr size_t INITIAL_WINDOW_SEGMENTS = 10;
+
+    static constexpr size_t MAX_BACKLOG = SOMAXCONN;
+    static constexpr size_t MAX_RETRANSMITS = 12;
+    static constexpr size_t DUPLICATE_ACK_THRESHOLD = 3;
+    static constexpr size_t MAX_OUT_OF_ORDER_SEGMENTS = 64;
+
+    static constexpr Duration INITIAL_RTO = Duration::from_seconds(1);
+    static constexpr Duration MIN_RTO = Duration::from_milliseconds(200);
+    static constexpr Duration MAX_RTO = Duration::from_seconds(60);
+
+    static constexpr Duration DELAYED_ACK_TIMEOUT = Duration::from_milliseconds(40);
+    static constexpr Duration TIME_WAIT_TIMEOUT = Duration::from_seconds(60);
+
+    static constexpr u16 EPHEMERAL_PORT_START = 49152;
+    static constexpr u16 EPHEMERAL_PORT_END = 65535;
+
+    static RefPtr<TCPSocket> create();
+
+    ~TCPSocket() override;
+
+    // Called by the network task for every incoming TCP segment
+    static void handle_packet(NetworkAdapter&, IPv4Packet const*, TCPPacket const*, size_t size, PacketMetadata const&);
+
+    // Fires every expired retransmission, delayed ACK and TIME-WAIT timer. Returns the earliest pending deadline or zero.
+    static Duration process_timers(Duration now);
+
+    State state() const { return m_state; }
+
+    ErrorOr<void> bind(SocketAddress const&) override;
+    ErrorOr<void> connect(SocketAddress const&) override;
+
+    ErrorOr<void> listen(int backlog) override;
+    ErrorOr<RefPtr<Socket>> accept(SocketAddress*) override;
+
+    ErrorOr<size_t> sendto(const void* buffer, size_t size, int flags, SocketAddress const* destination) override;
+    ErrorOr<size_t> recvfrom(void* buffer, size_t size, int flags, SocketAddress* source) override;
+
+    void close() override;
+
+    bool can_read(fs::FileDescriptor const&) const override;
+    bool can_write(fs::FileDescriptor const&) const override;
+
+private:
+    // A segment that arrived ahead of `m_rcv_nxt` and is kept until the hole before it is filled
+    struct OutOfOrderSegment {
+        u32 sequence;
+        Vector<u8> data;
+        bool fin;
+    };
+
+    TCPSocket() : Socket(AF_INET, SOCK_STREAM, IPPROTO_TCP) {}
+
+    static u64 connection_key(u16 local_port, SocketAddress const& peer);
+
+    ErrorOr<void> bind_ephemeral();
+    void register_connection();
+    void unregister_connection();
+
+    void handle_listen(NetworkAdapter&, IPv4Packet const*, TCPPacket const*);
+    void handle_syn_sent(TCPPacket const*);
+    void handle_segment(TCPPacket const*, size_t size);
+
+    bool process_ack(TCPPacket const*, size_t length);
+    void process_data(u32 sequence, u8 const* data, size_t size, bool fin);
+    void process_fin();
+
+    void parse_options(TCPPacket const*);
+
+    void transmit();
+    void retransmit();
+    void send_segment(u8 flags, u32 sequence, size_t offset, size_t size);
+    void send_ack();
+    void send_reset();
+
+    static void send_reset(NetworkAdapter&, IPv4Packet const*, TCPPacket const*, size_t size);
+
+    void update_rtt(Duration sample);
+    void on_timer(Duration now);
+
+    void arm_timer(Duration& deadline, Duration timeout);
+
+    void set_state(State);
+    void abort(int error);
+
+    u16 advertised_window() const;
+
+    // The buffers are only allocated once the connection is established, the handshake already offers all of it
+    u32 receive_window() const {
+        return m_receive_buffer.capacity() ? m_receive_buffer.free_space() : RECEIVE_BUFFER_SIZE;
+    }
+
+    u32 bytes_in_flight() const { return m_snd_nxt - m_snd_una; }
+    u16 mss() const { return m_mss; }
+
+    bool is_synchronized() const;
+
+    Mutex m_lock;
+    State m_state = State::Closed;
+
+    int m_error = 0;
+
+    SocketAddress m_local;
+    SocketAddress m_peer;
+
+    bool m_is_bound = false;
+    bool m_is_registered = false;
+
+    RefPtr<NetworkAdapter> m_adapter;
+
+    // Listening sockets
+    size_t m_backlog = 0;
+    std::Atomic<size_t> m_pending_connections = 0; // Handshakes in progress, updated by the connections themselves
+    Queue<RefPtr<TCPSocket>> m_accept_queue;
+
+    // Connections that haven't been accepted yet keep their listener alive
+    RefPtr<TCPSocket> m_listener;
+
+    // Send sequence space (RFC 793). `m_send_buffer` holds the bytes from `m_snd_una` onwards.
+    u32 m_iss = 0;
+    u32 m_snd_una = 0;
+    u32 m_snd_nxt = 0;
+    u32 m_snd_max = 0;
+    u32 m_snd_wnd = 0;
+    u32 m_snd_wl1 = 0;
+    u32 m_snd_wl2 = 0;
+
+    // Receive sequence space
+    u32 m_irs = 0;
+    u32 m_rcv_nxt = 0;
+    u32 m_rcv_adv = 0; // Right edge of the last window we advertised
+
+    u8 m_snd_wscale = 0;
+    u8 m_rcv_wscale = 0;
+    u16 m_mss = DEFAULT_MSS;
+
+    bool m_fin_queued = false;
+    bool m_fin_sent = false;
+    u32 m_fin_sequence = 0;
+    bool m_peer_closed = false;
+
+    RingBuffer m_send_buffer;
+    RingBuffer m_receive_buffer;
+    Vector<OutOfOrderSegment> m_out_of_order;
+
+    // Congestion control (NewReno)
+    u32 m_cwnd = 0;
+    u32 m_ssthresh = 0xFFFFFFFF;
+    u32 m_recover = 0;
+    size_t m_duplicate_acks = 0;
+    bool m_in_fast_recovery = false;
+
+    // RTT estimation (RFC 6298), one segment is timed at a time and retransmitted segments are never sampled
+    Duration m_srtt;
+    Duration m_rttvar;
+    Duration m_rto = INITIAL_RTO;
+    bool m_has_rtt_sample = false;
+
+    bool m_rtt_pending = false;
+    u32 m_rtt_sequence = 0;
+    Duration m_rtt_start;
+
+    size_t m_retransmits = 0;
+    size_t m_unacked_segments = 0;
+
+    // Zero means the timer is not armed
+    Duration m_retransmit_deadline;
+    Duration m_delayed_ack_deadline;
+    Duration m_time_wait_deadline;
+};
+
+}
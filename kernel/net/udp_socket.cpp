@@ -0,0 +1,206 @@
+#include <kernel/net/udp_socket.h>
+#include <kernel/net/manager.h>
+#include <kernel/net/checksum.h>
+#include <kernel/sync/lock.h>
+
+#include <std/hash_map.h>
+
+namespace kernel::net {
+
+static HashMap<u16, UDPSocket*> s_ports;
+static Mutex s_ports_lock;
+
+static u16 s_next_ephemeral_port = UDPSocket::EPHEMERAL_PORT_START;
+
+RefPtr<UDPSocket> UDPSocket::create() {
+    return RefPtr<UDPSocket>(new UDPSocket());
+}
+
+UDPSocket::~UDPSocket() {
+    if (!m_is_bound) {
+        return;
+    }
+
+    ScopedLock lock(s_ports_lock);
+    s_ports.remove(m_local.port);
+}
+
+ErrorOr<void> UDPSocket::bind(SocketAddress const& address) {
+    if (m_is_bound) {
+        return Error(EINVAL);
+    } else if (address.port == 0) {
+        return this->bind_ephemeral();
+    }
+
+    ScopedLock lock(s_ports_lock);
+    if (s_ports.contains(address.port)) {
+        return Error(EADDRINUSE);
+    }
+
+    s_ports.set(address.port, this);
+
+    m_local = address;
+    m_is_bound = true;
+
+    return {};
+}
+
+ErrorOr<void> UDPSocket::bind_ephemeral() {
+    ScopedLock lock(s_ports_lock);
+
+    size_t count = EPHEMERAL_PORT_END - EPHEMERAL_PORT_START + 1;
+    for (size_t i = 0; i < count; i++) {
+        u16 port = s_next_ephemeral_port;
+        s_next_ephemeral_port = port == EPHEMERAL_PORT_END ? EPHEMERAL_PORT_START : port + 1;
+
+        if (s_ports.contains(port)) {
+            continue;
+        }
+
+        s_ports.set(port, this);
+
+        m_local.port = port;
+        m_is_bound = true;
+
+        return {};
+    }
+
+    return Error(EADDRINUSE);
+}
+
+ErrorOr<void> UDPSocket::connect(SocketAddress const& address) {
+    if (!m_is_bound) {
+        TRY(this->bind_ephemeral());
+    }
+
+    m_peer = address;
+    m_is_connected = true;
+
+    return {};
+}
+
+ErrorOr<size_t> UDPSocket::sendto(const void* buffer, size_t size, int, SocketAddress const* destination) {
+    if (!destination) {
+        if (!m_is_connected) {
+            return Error(EDESTADDRREQ);
+        }
+
+        destination = &m_peer;
+    }
+
+    if (!m_is_bound) {
+        TRY(this->bind_ephemeral());
+    }
+
+    auto adapter = NetworkManager::instance()->route(destination->address);
+    if (!adapter) {
+        return Error(ENETUNREACH);
+    }
+
+    // Anything larger than the MTU gets fragmented
+    if (sizeof(IPv4Packet) + sizeof(UDPPacket) + size > NetworkAdapter::MAX_GSO_SIZE) {
+        return Error(EMSGSIZE);
+    }
+
+    UDPPacket udp;
+
+    udp.source_port = m_local.port;
+    udp.destination_port = destination->port;
+    udp.length = sizeof(UDPPacket) + size;
+    udp.checksum = 0;
+
+    PacketFragment fragments[] = {
+        { reinterpret_cast<u8 const*>(&udp), sizeof(UDPPacket) },
+        { reinterpret_cast<u8 const*>(buffer), size }
+    };
+
+    // Left to the adapter, which also takes care of transmitting a zero checksum as all ones
+    PacketMetadata metadata;
+    metadata.flags = PacketMetadata::NeedsChecksum;
+    metadata.checksum_offset = 6;
+
+    u32 sum = ipv4_pseudo_header_sum(adapter->ipv4_address(), destination->address, IPProtocol::UDP, sizeof(UDPPacket) + size);
+    udp.checksum = checksum_fold(sum);
+
+    TRY(adapter->send_ipv4(destination->address, IPProtocol::UDP, fragments, 2, metadata));
+    return size;
+}
+
+ErrorOr<size_t> UDPSocket::recvfrom(void* buffer, size_t size, int flags, SocketAddress* source) {
+    Datagram datagram;
+    while (true) {
+        TRY(this->block_until(flags, [this]() { return !m_receive_queue.empty(); }));
+
+        ScopedLock lock(m_lock);
+        if (m_receive_queue.empty()) {
+            continue; // Another thread got to it first
+        }
+
+        datagram = (flags & MSG_PEEK) ? m_receive_queue.front() : m_receive_queue.dequeue();
+        break;
+    }
+
+    // Like on other systems, whatever doesn't fit in the buffer is discarded
+    size = std::min(size, datagram.data.size());
+    memcpy(buffer, datagram.data.data(), size);
+
+    if (source) {
+        *source = datagram.source;
+    }
+
+    return size;
+}
+
+void UDPSocket::enqueue(Datagram datagram) {
+    {
+        ScopedLock lock(m_lock);
+        if (m_receive_queue.size() >= MAX_QUEUED_DATAGRAMS) {
+            return;
+        }
+
+        m_receive_queue.enqueue(move(datagram));
+    }
+
+    this->notify_readiness();
+}
+
+void UDPSocket::handle_packet(NetworkAdapter&, IPv4Packet const* ipv4, UDPPacket const* udp, PacketMetadata const& metadata) {
+    size_t length = udp->length;
+    if (length < sizeof(UDPPacket) || length > ipv4->payload_size()) {
+        return;
+    }
+
+    // A zero checksum means the sender didn't compute one
+    if (udp->checksum != 0 && !(metadata.flags & PacketMetadata::ChecksumValid)) {
+        u32 sum = ipv4_pseudo_header_sum(ipv4->source, ipv4->destination, IPProtocol::UDP, length);
+        if (checksum_finish(checksum_add(sum, udp, length)) != 0) {
+            return;
+        }
+    }
+
+    ScopedLock lock(s_ports_lock);
+
+    auto socket = s_ports.get(udp->destination_port);
+    if (!socket.has_value()) {
+        return;
+    }
+
+    auto* receiver = socket.value();
+    auto& local = receiver->m_local;
+
+    if (!local.address.is_zero() && local.address != ipv4->destination) {
+        return;
+    }
+
+    SocketAddress source = { ipv4->source, udp->source_port };
+    if (receiver->m_is_connected && (receiver->m_peer.address != source.address || receiver->m_peer.port != source.port)) {
+        return;
+    }
+
+    Datagram datagram { source, {} };
+    datagram.data.append(udp->data, length - sizeof(UDPPacket));
+
+    receiver->enqueue(move(datagram));
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/net/socket.h>
+#include <kernel/net/adapter.h>
+#include <kernel/net/ip/udp.h>
+#include <kernel/sync/mutex.h>
+
+#include <std/queue.h>
+#include <std/vector.h>
+
+namespace kernel::net {
+
+class UDPSocket : public Socket {
+public:
+    // Datagrams arriving while the receive queue is full are dropped
+    static constexpr size_t MAX_QUEUED_DATAGRAMS = 128;
+
+    static constexpr u16 EPHEMERAL_PORT_START = 49152;
+    static constexpr u16 EPHEMERAL_PORT_END = 65535;
+
+    static RefPtr<UDPSocket> create();
+
+    ~UDPSocket() override;
+
+    // Called by the network task for every incoming UDP datagram
+    static void handle_packet(NetworkAdapter&, IPv4Packet const*, UDPPacket const*, PacketMetadata const&);
+
+    ErrorOr<void> bind(SocketAddress const&) override;
+    ErrorOr<void> connect(SocketAddress const&) override;
+
+    ErrorOr<size_t> sendto(const void* buffer, size_t size, int flags, SocketAddress const* destination) override;
+    ErrorOr<size_t> recvfrom(void* buffer, size_t size, int flags, SocketAddress* source) override;
+
+    bool can_read(fs::FileDescriptor const&) const override { return !m_receive_queue.empty(); }
+    bool can_write(fs::FileDescriptor const&) const override { return true; }
+
+private:
+    struct Datagram {
+        SocketAddress source;
+        Vector<u8> data;
+    };
+
+    UDPSocket() : Socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) {}
+
+    ErrorOr<void> bind_ephemeral();
+    void enqueue(Datagram datagram);
+
+    SocketAddress m_local;
+    SocketAddress m_peer;
+
+    bool m_is_bound = false;
+    bool m_is_connected = false;
+
+    Mutex m_lock;
+    Queue<Datagram> m_receive_queue;
+};
+
+}
@@ -1,6 +1,7 @@
 #include <kernel/panic.h>
 #include <kernel/symbols.h>
 #include <kernel/serial.h>
+#include <kernel/log.h>
 #include <kernel/memory/manager.h>
 
 
@@ -61,6 +62,10 @@ void print_stack_trace(StackFrame* frame) {
 }
 
 [[noreturn]] void panic(StringView message, const char* file, u32 line) {
+    asm volatile("cli");
+
+    // Nothing will drain the log asynchronously anymore
+    log::enter_panic_mode();
     dbgln();
 
     if (message.empty()) {
@@ -75,7 +80,6 @@ void print_stack_trace(StackFrame* frame) {
     dbgln("Stack trace:");
     print_stack_trace();
 
-    asm volatile("cli");
     asm volatile("hlt");
 
     __builtin_unreachable();
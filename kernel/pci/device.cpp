@@ -35,6 +35,15 @@ u16 Device::subsystem_id() const {
     return m_address.read<u16>(Address::SubsystemID);
 }
 
+PhysicalAddress Device::bar_address(u8 index) const {
+    u64 address = m_address.bar(index) & ~0xFull;
+    if (m_address.bar_type(index) == BARType::Memory64 && index < 5) {
+        address |= static_cast<u64>(m_address.bar(index + 1)) << 32;
+    }
+
+    return PhysicalAddress { static_cast<FlatPtr>(address) };
+}
+
 void Device::enable_interrupts() {
     m_address.set_interrupt_line(true);
 }
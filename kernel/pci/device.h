@@ -2,6 +2,7 @@
 
 #include <kernel/pci/address.h>
 #include <kernel/pci/defs.h>
+#include <kernel/memory/physical_address.h>
 
 #include <std/vector.h>
 
@@ -40,6 +41,9 @@ public:
 
     u32 bar(u8 index) const { return m_address.bar(index); }
 
+    // Base of a memory BAR without the flag bits, 64-bit BARs take their upper half from the following one
+    PhysicalAddress bar_address(u8 index) const;
+
     BARType bar_type(u8 index) const { return m_address.bar_type(index); }
     size_t bar_size(u8 index) { return m_address.bar_size(index); }
 
@@ -0,0 +1,74 @@
+#include <kernel/pci/msix.h>
+#include <kernel/memory/manager.h>
+#include <kernel/arch/apic.h>
+
+namespace kernel::pci {
+
+// Messages written to this range end up at the local APIC whose ID is in bits 12-19
+static constexpr u32 MSI_ADDRESS_BASE = 0xFEE00000;
+
+ErrorOr<OwnPtr<MSIX>> MSIX::create(Device device) {
+    for (auto& capability : device.capabilities()) {
+        if (capability.id() != CAPABILITY_ID) {
+            continue;
+        }
+
+        u16 control = capability.read<u16>(0x2);
+        u32 table = capability.read<u32>(0x4);
+
+        u16 vectors = (control & TableSizeMask) + 1;
+
+        u8 bar = table & 0x7;
+        PhysicalAddress address = device.bar_address(bar).offset(table & ~0x7);
+
+        size_t offset = address.offset_in_page();
+        auto* region = reinterpret_cast<u8*>(TRY(MM->map_physical_region(address.page_base(), offset + vectors * sizeof(TableEntry))));
+
+        auto* entries = reinterpret_cast<TableEntry volatile*>(region + offset);
+        for (u16 i = 0; i < vectors; i++) {
+            entries[i].vector_control = 1;
+        }
+
+        return OwnPtr<MSIX>(new MSIX(device, capability.cap(), entries, vectors));
+    }
+
+    return Error(ENODEV);
+}
+
+void MSIX::set_vector(u16 index, u8 irq) {
+    ASSERT(index < m_vectors, "MSI-X vector out of range");
+    auto& entry = m_table[index];
+
+    entry.vector_control = 1;
+
+    entry.address_low = MSI_ADDRESS_BASE | (apic::id() << 12);
+    entry.address_high = 0;
+    entry.data = 32 + irq; // Fixed delivery, edge triggered
+
+    entry.vector_control = 0;
+}
+
+void MSIX::mask(u16 index) {
+    ASSERT(index < m_vectors, "MSI-X vector out of range");
+    m_table[index].vector_control = 1;
+}
+
+void MSIX::enable() {
+    Capability capability { m_capability, CAPABILITY_ID, m_device.address() };
+
+    u16 control = capability.read<u16>(0x2);
+    capability.write<u16>(0x2, (control | Enable) & ~FunctionMask);
+
+    m_device.address().set_interrupt_line(false);
+}
+
+void MSIX::disable() {
+    Capability capability { m_capability, CAPABILITY_ID, m_device.address() };
+
+    u16 control = capability.read<u16>(0x2);
+    capability.write<u16>(0x2, control & ~Enable);
+
+    m_device.address().set_interrupt_line(true);
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/pci/device.h>
+
+#include <std/memory.h>
+#include <std/result.h>
+
+namespace kernel::pci {
+
+// PCI Local Bus Specification 3.0 (section 6.8.2). Every vector gets its own entry in a table the device keeps in
+// one of its BARs, telling it which message to write where.
+class MSIX {
+public:
+    static constexpr u8 CAPABILITY_ID = 0x11;
+
+    // Fails with ENODEV if the device doesn't have the capability
+    static ErrorOr<OwnPtr<MSIX>> create(Device);
+
+    u16 vectors() const { return m_vectors; }
+
+    // Delivers `index` to the current processor as `irq`, which has to come from `allocate_msi_irq`
+    void set_vector(u16 index, u8 irq);
+    void mask(u16 index);
+
+    // Once enabled the device stops using its interrupt pin
+    void enable();
+    void disable();
+
+private:
+    enum Control : u16 {
+        TableSizeMask = 0x7FF,
+        FunctionMask = 1 << 14,
+        Enable = 1 << 15,
+    };
+
+    struct TableEntry {
+        u32 address_low;
+        u32 address_high;
+        u32 data;
+        u32 vector_control; // Bit 0 masks the vector
+    } PACKED;
+
+    MSIX(Device device, u8 capability, TableEntry volatile* table, u16 vectors)
+        : m_device(device), m_capability(capability), m_table(table), m_vectors(vectors) {}
+
+    Device m_device;
+    u8 m_capability;
+
+    TableEntry volatile* m_table;
+    u16 m_vectors;
+};
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <kernel/posix/sys/socket.h>
+#include <stdint.h>
+
+#define IPPROTO_IP   0
+#define IPPROTO_ICMP 1
+#define IPPROTO_TCP  6
+#define IPPROTO_UDP  17
+
+#define INADDR_ANY       ((in_addr_t)0x00000000)
+#define INADDR_LOOPBACK  ((in_addr_t)0x7F000001)
+#define INADDR_BROADCAST ((in_addr_t)0xFFFFFFFF)
+
+typedef uint16_t in_port_t;
+typedef uint32_t in_addr_t;
+
+// Both the address and the port are stored in network byte order
+struct in_addr {
+    in_addr_t s_addr;
+};
+
+struct sockaddr_in {
+    sa_family_t sin_family;
+    in_port_t sin_port;
+    struct in_addr sin_addr;
+    char sin_zero[8];
+};
@@ -6,16 +6,58 @@ enum {
 
     GPU_CONNECTOR_MAP_FB,
     GPU_CONNECTOR_FLUSH,
+    GPU_CONNECTOR_MAP_BUFFERS, // struct gpu_connector_map_buffers
+    GPU_CONNECTOR_PAGE_FLIP,   // struct gpu_connector_page_flip
 
     SOUNDCARD_GET_SAMPLE_RATE,
     SOUNDCARD_SET_SAMPLE_RATE,
     SOUNDCARD_GET_CHANNELS,
     SOUNDCARD_GET_VOLUME,
     SOUNDCARD_SET_VOLUME,
+    SOUNDCARD_GET_LATENCY,  // int, the period of the device in milliseconds
+    SOUNDCARD_SET_LATENCY,  // In milliseconds, affects every stream of the device
+    SOUNDCARD_MAP_RING,     // struct soundcard_ring*, maps the ring of the stream
+    SOUNDCARD_GET_POSITION, // struct soundcard_position
 
     STORAGE_GET_SIZE,
+    STORAGE_FLUSH,   // Waits until everything written so far is on stable storage
+    STORAGE_DISCARD, // struct storage_discard
 
-    TIOCGPTN
+    TIOCGPTN,
+
+    // Network configuration, accepted by every socket
+    SIOCGIFCONF,   // struct net_table_request of struct net_interface
+    SIOCSIFADDR,   // struct net_interface, sets `address` and `netmask` of the interface at `index`
+    SIOCGRTABLE,   // struct net_table_request of struct net_route
+    SIOCADDRT,     // struct net_route
+    SIOCDELRT,     // struct net_route, only `destination` and `netmask` are used
+    SIOCGARPTABLE, // struct net_table_request of struct net_arp_entry
+    SIOCSARP,      // struct net_arp_entry, adds a permanent entry
+    SIOCDARP,      // struct net_arp_entry, only `address` is used
+};
+
+// Both in blocks of the device
+struct storage_discard {
+    unsigned long long block;
+    unsigned long long count;
+};
+
+// Every open of a sound card is a stream of its own that gets mixed with the others, converted from the sample rate
+// set on it to the one of the device. The stream plays from a ring of 16-bit stereo frames which can be written into
+// directly after mapping it, the positions are in frames since the stream was opened and only ever grow.
+struct soundcard_ring {
+    volatile unsigned long long write_position; // Advanced by the client after filling in the frames before it
+    volatile unsigned long long read_position;  // Advanced by the mixer as it consumes frames
+    unsigned int frame_count;                   // Frame `n` is at index `n % frame_count` of `frames`
+    unsigned int reserved;
+    short frames[][2];
+};
+
+struct soundcard_position {
+    unsigned long long stream_frames; // Frames of the stream consumed by the mixer
+    unsigned long long device_frames; // Frames the device played since it started playing
+    unsigned int delay;               // Frames (at the device rate) mixed but not yet played
+    unsigned int period;              // Frames (at the device rate) the device plays between two mixer passes
 };
 
 struct gpu_connector_map_fb {
@@ -23,8 +65,38 @@ struct gpu_connector_map_fb {
     void* framebuffer;
 };
 
+struct gpu_rect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+#define GPU_CONNECTOR_MAX_RECTS 256
+
+// Only the regions in `rects` are pushed to the display, a `count` of zero flushes the whole framebuffer
 struct gpu_connector_flush {
     int id;
+    struct gpu_rect* rects;
+    int count;
+};
+
+#define GPU_CONNECTOR_MAX_BUFFERS 4
+
+// Maps `count` buffers of the connector, the first one being the framebuffer that is on screen to begin with
+struct gpu_connector_map_buffers {
+    int id;
+    int count;
+    void* buffers[GPU_CONNECTOR_MAX_BUFFERS];
+};
+
+// Shows `buffer` instead of whatever buffer is on screen. `rects` are what changed in it since it was last shown,
+// a `count` of zero meaning all of it. Returns once the buffer shown before can be drawn into again.
+struct gpu_connector_page_flip {
+    int id;
+    int buffer;
+    struct gpu_rect* rects;
+    int count;
 };
 
 struct gpu_connector {
@@ -35,3 +107,46 @@ struct gpu_connector {
     int pitch;
     int bpp;
 };
+
+// Fills in up to `count` entries and returns how many there are in total
+struct net_table_request {
+    void* entries;
+    int count;
+};
+
+enum {
+    NET_INTERFACE_LOOPBACK,
+    NET_INTERFACE_ETHERNET
+};
+
+// Addresses are in network byte order
+struct net_interface {
+    int index;
+    int type;
+    unsigned char mac[6];
+    unsigned int address;
+    unsigned int netmask;
+    unsigned int mtu;
+};
+
+struct net_route {
+    unsigned int destination;
+    unsigned int netmask;
+    unsigned int gateway; // Zero for directly connected networks
+    int interface;        // -1 picks the interface that reaches the gateway
+};
+
+enum {
+    NET_ARP_INCOMPLETE,
+    NET_ARP_REACHABLE,
+    NET_ARP_STALE,
+    NET_ARP_PROBE,
+    NET_ARP_PERMANENT
+};
+
+struct net_arp_entry {
+    unsigned int address;
+    unsigned char mac[6];
+    int interface;
+    int state;
+};
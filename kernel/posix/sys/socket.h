@@ -0,0 +1,49 @@
+#pragma once
+
+#include <sys/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AF_UNSPEC 0
+#define AF_INET   2
+
+#define PF_UNSPEC AF_UNSPEC
+#define PF_INET   AF_INET
+
+#define SOCK_STREAM 1
+#define SOCK_DGRAM  2
+
+// Can be or'ed into the type passed to `socket`
+#define SOCK_NONBLOCK (1 << 8)
+#define SOCK_TYPE_MASK 0xFF
+
+#define MSG_PEEK     0x02
+#define MSG_DONTWAIT 0x40
+
+#define SOMAXCONN 128
+
+typedef uint32_t socklen_t;
+typedef uint16_t sa_family_t;
+
+struct sockaddr {
+    sa_family_t sa_family;
+    char sa_data[14];
+};
+
+struct sendto_args {
+    int fd;
+    const void* buffer;
+    size_t length;
+    int flags;
+    const struct sockaddr* addr;
+    socklen_t addrlen;
+};
+
+struct recvfrom_args {
+    int fd;
+    void* buffer;
+    size_t length;
+    int flags;
+    struct sockaddr* addr;
+    socklen_t* addrlen;
+};
@@ -20,6 +20,8 @@ SleepBlocker::SleepBlocker(Duration duration, clockid_t clock_id, bool is_absolu
     } else {
         m_deadline = TimeManager::query_time(clock_id) + duration;
     }
+
+    TimeManager::schedule_wakeup(m_deadline, clock_id);
 }
 
 bool SleepBlocker::should_unblock() {
@@ -67,6 +67,8 @@ Process::Process(
             { VirtualAddress { PAGE_SIZE }, static_cast<size_t>(g_boot_info->kernel_virtual_base - PAGE_SIZE) },
             m_page_directory
         );
+
+        this->map_time_page();
     } else {
         m_page_directory = arch::PageDirectory::kernel_page_directory();
 
@@ -137,6 +139,20 @@ ErrorOr<void> Process::create_user_entry(ELF elf) {
     return {};
 }
 
+void Process::map_time_page() {
+    auto* region = m_allocator->allocate_at(VirtualAddress { TIME_PAGE_ADDRESS }, PAGE_SIZE, PROT_READ);
+    if (!region) {
+        return;
+    }
+
+    region->set_name("Time Page");
+    region->set_shared(true);
+    region->set_kernel_managed(true);
+
+    PhysicalAddress frame = TimeManager::instance()->time_page_frame();
+    m_page_directory->map(region->base(), frame, PageFlags::User);
+}
+
 void Process::add_thread(Thread* thread) {
     m_threads.set(thread->id(), thread);
 }
@@ -204,6 +220,34 @@ ErrorOr<void*> Process::allocate_from_kernel_region(VirtualAddress address, size
     return region->base().to_ptr();
 }
 
+ErrorOr<void*> Process::share_kernel_region(VirtualAddress address, size_t size, int prot) {
+    ASSERT(address % PAGE_SIZE == 0, "address must be page aligned.");
+    auto* region = m_allocator->allocate(size, prot);
+    if (!region) {
+        return Error(ENOMEM);
+    }
+
+    PageFlags pflags = PageFlags::User;
+    if (prot & PROT_WRITE) {
+        pflags |= PageFlags::Write;
+    }
+
+    for (size_t i = 0; i < size; i += PAGE_SIZE) {
+        PhysicalAddress pa = MM->get_physical_address(reinterpret_cast<void*>(address + i));
+
+        PhysicalPage* page = MM->get_physical_page(pa);
+        if (page) {
+            page->ref_count++;
+        }
+
+        m_page_directory->map(region->offset_by(i), pa, pflags);
+    }
+
+    // Unmapping drops the reference like it would for any other page, and a fork shares the pages instead of copying
+    region->set_shared(true);
+    return region->base().to_ptr();
+}
+
 ErrorOr<void*> Process::allocate_with_physical_region(PhysicalAddress address, size_t size, int prot) {
     ASSERT(address % PAGE_SIZE == 0, "address must be page aligned.");
     auto* region = m_allocator->allocate(size, prot);
@@ -3,6 +3,9 @@
 #include <kernel/common.h>
 #include <kernel/memory/region.h>
 #include <kernel/posix/sys/types.h>
+#include <kernel/posix/sys/epoll.h>
+#include <kernel/posix/poll.h>
+#include <kernel/posix/sys/socket.h>
 #include <kernel/process/elf.h>
 #include <kernel/arch/page_directory.h>
 #include <kernel/tty/tty.h>
@@ -94,11 +97,16 @@ public:
     void handle_general_protection_fault(arch::InterruptRegisters*);
 
     FlatPtr handle_syscall(arch::Registers*);
+    FlatPtr handle_syscall(FlatPtr syscall, FlatPtr arg1, FlatPtr arg2, FlatPtr arg3, FlatPtr arg4);
 
     ErrorOr<void*> allocate(size_t size, PageFlags flags, String name = {});
     ErrorOr<void*> allocate_at(VirtualAddress address, size_t size, PageFlags flags, String name = {});
 
     ErrorOr<void*> allocate_from_kernel_region(VirtualAddress, size_t size, int prot);
+
+    // Like `allocate_from_kernel_region` but the mapping holds a reference to the pages of its own, they stay around
+    // until both the kernel has freed its region and the process has unmapped it (or exited)
+    ErrorOr<void*> share_kernel_region(VirtualAddress, size_t size, int prot);
     ErrorOr<void*> allocate_with_physical_region(PhysicalAddress, size_t size, int prot);
     ErrorOr<void*> allocate_file_backed_region(fs::File* file, size_t size);
 
@@ -118,6 +126,10 @@ public:
     ErrorOr<FlatPtr> sys$read(int fd, void* buffer, size_t size);
     ErrorOr<FlatPtr> sys$write(int fd, const void* buffer, size_t size);
     ErrorOr<FlatPtr> sys$lseek(int fd, off_t offset, int whence);
+    ErrorOr<FlatPtr> sys$readv(int fd, const iovec* iov, int iovcnt);
+    ErrorOr<FlatPtr> sys$writev(int fd, const iovec* iov, int iovcnt);
+    ErrorOr<FlatPtr> sys$pread(int fd, void* buffer, size_t size, off_t offset);
+    ErrorOr<FlatPtr> sys$pwrite(int fd, const void* buffer, size_t size, off_t offset);
     ErrorOr<FlatPtr> sys$readdir(int fd, void* buffer, size_t size);
     ErrorOr<FlatPtr> sys$stat(const char* path, size_t path_length, stat* buffer);
     ErrorOr<FlatPtr> sys$fstat(int fd, stat* buffer);
@@ -125,6 +137,19 @@ public:
     ErrorOr<FlatPtr> sys$dup2(int old_fd, int new_fd);
     ErrorOr<FlatPtr> sys$ioctl(int fd, unsigned request, unsigned arg);
 
+    ErrorOr<FlatPtr> sys$poll(pollfd* fds, nfds_t nfds, int timeout);
+    ErrorOr<FlatPtr> sys$epoll_create(int flags);
+    ErrorOr<FlatPtr> sys$epoll_ctl(int epfd, int op, int fd, epoll_event* event);
+    ErrorOr<FlatPtr> sys$epoll_wait(int epfd, epoll_event* events, int max_events, int timeout);
+
+    ErrorOr<FlatPtr> sys$socket(int domain, int type, int protocol);
+    ErrorOr<FlatPtr> sys$bind(int fd, const sockaddr* addr, socklen_t addrlen);
+    ErrorOr<FlatPtr> sys$connect(int fd, const sockaddr* addr, socklen_t addrlen);
+    ErrorOr<FlatPtr> sys$sendto(sendto_args*);
+    ErrorOr<FlatPtr> sys$recvfrom(recvfrom_args*);
+    ErrorOr<FlatPtr> sys$listen(int fd, int backlog);
+    ErrorOr<FlatPtr> sys$accept(int fd, sockaddr* addr, socklen_t* addrlen);
+
     ErrorOr<FlatPtr> sys$mmap(mmap_args*);
     ErrorOr<FlatPtr> sys$munmap(FlatPtr address, size_t size);
     ErrorOr<FlatPtr> sys$mmap_set_name(FlatPtr address, const char* name, size_t length);
@@ -145,6 +170,7 @@ private:
     friend class Thread;
 
     ErrorOr<void> create_user_entry(ELF);
+    void map_time_page();
 
     Process(
         pid_t id, 
@@ -5,6 +5,7 @@
 #include <kernel/arch/cpu.h>
 #include <kernel/arch/processor.h>
 #include <kernel/arch/interrupts.h>
+#include <kernel/time/manager.h>
 
 #include <std/format.h>
 
@@ -43,7 +44,14 @@ Process* Scheduler::get_process(pid_t id) {
 void _idle() {
     Scheduler::yield();
     while (true) {
-        asm volatile("hlt");
+        // Program the timer for the next sleeping thread instead of waking up on every tick. Interrupts are
+        // disabled until `hlt` so that we can't miss a wakeup in between.
+        Processor::disable_interrupts();
+        TimeManager::enter_idle();
+
+        asm volatile("sti; hlt");
+
+        TimeManager::exit_idle();
         Scheduler::yield();
     }
 }
@@ -2,41 +2,97 @@
 #include <kernel/process/syscalls.h>
 #include <kernel/process/threads.h>
 
+#include <std/type_traits.h>
+#include <std/utility.h>
+
 namespace kernel {
 
-using SyscallHandler = ErrorOr<FlatPtr>(Process::*)(FlatPtr, FlatPtr, FlatPtr, FlatPtr);
+// Keep in sync with the constants in kernel/arch/x86_64/asm/syscalls.asm
+enum class SyscallFlags : u8 {
+    None      = 0,
+    Blocking  = 1 << 0,
+    FullFrame = 1 << 1,
+};
+
+using SyscallHandler = ErrorOr<FlatPtr>(*)(Process*, FlatPtr const*);
+
+template<typename T>
+static inline T syscall_argument(FlatPtr value) {
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(value);
+    } else {
+        return static_cast<T>(value);
+    }
+}
+
+// Unpacks the raw argument registers into the handler's real parameter types at compile time.
+template<auto Handler>
+struct SyscallThunk;
+
+template<typename R, typename... Args, R(Process::*Handler)(Args...)>
+struct SyscallThunk<Handler> {
+    static_assert(sizeof...(Args) <= 4, "Syscalls can take at most 4 arguments");
+
+    static ErrorOr<FlatPtr> call(Process* process, FlatPtr const* arguments) {
+        return invoke(process, arguments, std::make_index_sequence<sizeof...(Args)>());
+    }
+
+private:
+    template<size_t... Indices>
+    static ErrorOr<FlatPtr> invoke(Process* process, FlatPtr const* arguments, std::index_sequence<Indices...>) {
+        if constexpr (std::is_same_v<R, void>) {
+            (process->*Handler)(syscall_argument<Args>(arguments[Indices])...);
+            return FlatPtr(0);
+        } else {
+            return (process->*Handler)(syscall_argument<Args>(arguments[Indices])...);
+        }
+    }
+};
 
-static const SyscallHandler SYSCALL_HANDLERS[] = {
-#define Op(name) reinterpret_cast<SyscallHandler>(&Process::sys$##name),
+// Syscalls that need the full register frame are dispatched by `handle_syscall(arch::Registers*)` instead.
+static constexpr SyscallHandler SYSCALL_HANDLERS[] = {
+#define Op(name, flags) \
+    SyscallFlags::flags == SyscallFlags::FullFrame ? nullptr : &SyscallThunk<&Process::sys$##name>::call,
     __SYSCALL_LIST(Op)
 #undef Op
 };
 
 static constexpr size_t SYSCALL_COUNT = sizeof(SYSCALL_HANDLERS) / sizeof(SyscallHandler);
 
+// Read by the syscall entry stub to pick the entry path before any C++ code runs.
+extern "C" const u8 _syscall_flags[] = {
+#define Op(name, flags) static_cast<u8>(SyscallFlags::flags),
+    __SYSCALL_LIST(Op)
+#undef Op
+};
+
+extern "C" const FlatPtr _syscall_count = SYSCALL_COUNT;
+
 FlatPtr Process::handle_syscall(arch::Registers* registers) {
     FlatPtr syscall, arg1, arg2, arg3, arg4;
-
     registers->capture_syscall_arguments(syscall, arg1, arg2, arg3, arg4);
-    ErrorOr<FlatPtr> result = { FlatPtr(nullptr) };
 
     if (syscall == SYS_fork) {
-        result = this->sys$fork(registers);
-    } else if (syscall == SYS_exit) {
-        this->sys$exit(arg1); // sys$exit never returns so it needs special handling
-    } else {
-        if (syscall >= SYSCALL_COUNT || syscall < 0) {
-            return -ENOSYS;
-        }
+        auto result = this->sys$fork(registers);
+        return result.is_err() ? -result.error().code() : result.value();
+    }
 
-        auto handler = SYSCALL_HANDLERS[syscall];
-        if (!handler) {
-            return -ENOSYS;
-        }
+    return this->handle_syscall(syscall, arg1, arg2, arg3, arg4);
+}
 
-        result = (this->*handler)(arg1, arg2, arg3, arg4);
+FlatPtr Process::handle_syscall(FlatPtr syscall, FlatPtr arg1, FlatPtr arg2, FlatPtr arg3, FlatPtr arg4) {
+    if (syscall >= SYSCALL_COUNT) {
+        return -ENOSYS;
     }
 
+    auto handler = SYSCALL_HANDLERS[syscall];
+    if (!handler) {
+        return -ENOSYS;
+    }
+
+    FlatPtr arguments[] = { arg1, arg2, arg3, arg4 };
+    auto result = handler(this, arguments);
+
     if (result.is_err()) {
         return -result.error().code();
     } else {
@@ -44,4 +100,4 @@ FlatPtr Process::handle_syscall(arch::Registers* registers) {
     }
 }
 
-}
\ No newline at end of file
+}
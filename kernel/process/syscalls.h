@@ -1,34 +1,54 @@
 #pragma once
 
-#define __SYSCALL_LIST(Op)      \
-    Op(exit)                    \
-    Op(open)                    \
-    Op(close)                   \
-    Op(read)                    \
-    Op(write)                   \
-    Op(lseek)                   \
-    Op(readdir)                 \
-    Op(stat)                    \
-    Op(fstat)                   \
-    Op(mmap)                    \
-    Op(mmap_set_name)           \
-    Op(munmap)                  \
-    Op(getpid)                  \
-    Op(getppid)                 \
-    Op(gettid)                  \
-    Op(dup)                     \
-    Op(dup2)                    \
-    Op(getcwd)                  \
-    Op(chdir)                   \
-    Op(ioctl)                   \
-    Op(fork)                    \
-    Op(execve)                  \
-    Op(waitpid)                 \
-    Op(clock_gettime)           \
-    Op(clock_nanosleep)
+// Each syscall is listed with how the kernel needs to enter it:
+//   None      - runs with interrupts disabled and only the caller-saved registers spilled. Nothing that can take a
+//               `Mutex` belongs here, its owner may have been preempted and the caller would spin on it forever.
+//   Blocking  - may sleep or touch the disk so interrupts get re-enabled before the handler runs.
+//   FullFrame - needs the complete register frame (e.g. fork copies it into the child thread).
+#define __SYSCALL_LIST(Op)                  \
+    Op(exit, Blocking)                      \
+    Op(open, Blocking)                      \
+    Op(close, Blocking)                     \
+    Op(read, Blocking)                      \
+    Op(write, Blocking)                     \
+    Op(lseek, Blocking)                     \
+    Op(readdir, Blocking)                   \
+    Op(stat, Blocking)                      \
+    Op(fstat, Blocking)                     \
+    Op(mmap, Blocking)                      \
+    Op(mmap_set_name, Blocking)             \
+    Op(munmap, Blocking)                    \
+    Op(getpid, None)                        \
+    Op(getppid, None)                       \
+    Op(gettid, None)                        \
+    Op(dup, Blocking)                       \
+    Op(dup2, Blocking)                      \
+    Op(getcwd, Blocking)                    \
+    Op(chdir, Blocking)                     \
+    Op(ioctl, Blocking)                     \
+    Op(fork, FullFrame)                     \
+    Op(execve, Blocking)                    \
+    Op(waitpid, Blocking)                   \
+    Op(clock_gettime, None)                 \
+    Op(clock_nanosleep, Blocking)           \
+    Op(readv, Blocking)                     \
+    Op(writev, Blocking)                    \
+    Op(pread, Blocking)                     \
+    Op(pwrite, Blocking)                    \
+    Op(poll, Blocking)                      \
+    Op(epoll_create, Blocking)              \
+    Op(epoll_ctl, Blocking)                 \
+    Op(epoll_wait, Blocking)                \
+    Op(socket, Blocking)                    \
+    Op(bind, Blocking)                      \
+    Op(connect, Blocking)                   \
+    Op(sendto, Blocking)                    \
+    Op(recvfrom, Blocking)                  \
+    Op(listen, Blocking)                    \
+    Op(accept, Blocking)
 
 enum {
-#define Op(name) SYS_##name,
+#define Op(name, flags) SYS_##name,
     __SYSCALL_LIST(Op)
 #undef Op
-};
\ No newline at end of file
+};
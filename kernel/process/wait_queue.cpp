@@ -0,0 +1,40 @@
+#include <kernel/process/wait_queue.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/time/manager.h>
+
+namespace kernel {
+
+void WaitQueue::add(Entry* entry) {
+    arch::InterruptDisabler disabler;
+    m_entries.append(entry);
+}
+
+void WaitQueue::remove(Entry* entry) {
+    arch::InterruptDisabler disabler;
+    m_entries.remove(entry);
+}
+
+void WaitQueue::wake_all() {
+    for (auto* entry : m_entries) {
+        entry->wake();
+    }
+}
+
+WaitQueueBlocker::WaitQueueBlocker(Duration timeout, clockid_t clock_id) : m_has_deadline(true), m_clock_id(clock_id) {
+    m_deadline = TimeManager::query_time(clock_id) + timeout;
+    TimeManager::schedule_wakeup(m_deadline, clock_id);
+}
+
+bool WaitQueueBlocker::should_unblock() {
+    return m_woken || this->has_timed_out();
+}
+
+bool WaitQueueBlocker::has_timed_out() const {
+    if (!m_has_deadline) {
+        return false;
+    }
+
+    return TimeManager::query_time(m_clock_id) >= m_deadline;
+}
+
+}
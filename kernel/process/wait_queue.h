@@ -0,0 +1,61 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/process/blocker.h>
+#include <kernel/posix/time.h>
+
+#include <std/vector.h>
+#include <std/time.h>
+
+namespace kernel {
+
+// A list of waiters that get notified whenever the owner of the queue changes state (e.g. a file becomes readable).
+// Waking is safe from IRQ context, adding and removing entries is not.
+class WaitQueue {
+public:
+    class Entry {
+    public:
+        virtual ~Entry() = default;
+        virtual void wake() = 0;
+    };
+
+    WaitQueue() = default;
+
+    WaitQueue(const WaitQueue&) = delete;
+    WaitQueue& operator=(const WaitQueue&) = delete;
+
+    bool empty() const { return m_entries.empty(); }
+
+    void add(Entry*);
+    void remove(Entry*);
+
+    void wake_all();
+
+private:
+    Vector<Entry*> m_entries;
+};
+
+// Blocks until any of the wait queues it was added to gets woken up or the optional timeout expires.
+class WaitQueueBlocker : public Blocker, public WaitQueue::Entry {
+public:
+    WaitQueueBlocker() = default;
+    WaitQueueBlocker(Duration timeout, clockid_t clock_id = CLOCK_MONOTONIC);
+
+    bool should_unblock() override;
+    void wake() override { m_woken = true; }
+
+    bool was_woken() const { return m_woken; }
+    bool has_timed_out() const;
+
+    // Should be called before re-checking the condition so that a wake up racing with the check isn't lost
+    void reset() { m_woken = false; }
+
+private:
+    bool m_woken = false;
+
+    bool m_has_deadline = false;
+    Duration m_deadline;
+    clockid_t m_clock_id = CLOCK_MONOTONIC;
+};
+
+}
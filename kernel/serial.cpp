@@ -5,6 +5,7 @@
 #include <kernel/arch/processor.h>
 
 #include <std/cstring.h>
+#include <std/utility.h>
 
 namespace kernel::serial {
 
@@ -54,6 +55,19 @@ void COMPort::write(const char* str, size_t len) {
         this->write(*str++);
 }
 
+size_t COMPort::try_write(const char* str, size_t len) {
+    if (!this->is_transmit_empty()) {
+        return 0;
+    }
+
+    len = std::min(len, FIFO_SIZE);
+    for (size_t i = 0; i < len; i++) {
+        m_port.write<u8>(Data, str[i]);
+    }
+
+    return len;
+}
+
 char COMPort::read() {
     while (!this->is_data_ready()) {}
     return m_port.read<u8>(Data);
@@ -88,4 +102,8 @@ void write(const char* str) {
     s_com1.write(str, std::strlen(str));
 }
 
+size_t try_write(const char* str, size_t len) {
+    return s_com1.try_write(str, len);
+}
+
 }
\ No newline at end of file
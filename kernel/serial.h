@@ -14,6 +14,9 @@ enum COMPortNumber {
 
 class COMPort {
 public:
+    // A 16550 takes this many bytes at once once the transmitter is empty
+    static constexpr size_t FIFO_SIZE = 16;
+
     enum Register {
         Data = 0,            // with DLAB = 0
         InterruptEnable = 1, // with DLAB = 0
@@ -39,6 +42,9 @@ public:
     void write(char c);
     void write(const char* str, size_t len);
 
+    // Fills the transmit FIFO with as much of `str` as fits right now without waiting, returns how much that was
+    size_t try_write(const char* str, size_t len);
+
     char read();
 
     bool is_transmit_empty();
@@ -56,4 +62,6 @@ void putc(char c);
 void write(const char* str, size_t len);
 void write(const char* str);
 
+size_t try_write(const char* str, size_t len);
+
 }
\ No newline at end of file
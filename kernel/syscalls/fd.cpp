@@ -2,6 +2,38 @@
 
 namespace kernel {
 
+// Copies the iovec array into the kernel so other threads can't change it under us and validates every buffer in it
+static ErrorOr<Vector<iovec>> copy_iovec_from_user(Process& process, const iovec* iov, int iovcnt, bool write) {
+    if (iovcnt <= 0 || iovcnt > IOV_MAX) {
+        return Error(EINVAL);
+    }
+
+    process.validate_read(iov, sizeof(iovec) * iovcnt);
+
+    Vector<iovec> vectors;
+    vectors.reserve(iovcnt);
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        // The total has to fit in the (signed) return value
+        iovec vector = iov[i];
+        if (vector.iov_len > (SIZE_MAX >> 1) - total) {
+            return Error(EINVAL);
+        }
+
+        total += vector.iov_len;
+        if (write) {
+            process.validate_write(vector.iov_base, vector.iov_len);
+        } else {
+            process.validate_read(vector.iov_base, vector.iov_len);
+        }
+
+        vectors.append(vector);
+    }
+
+    return vectors;
+}
+
 ErrorOr<FlatPtr> Process::sys$open(const char* pathname, size_t pathname_length, int flags, mode_t mode) {
     StringView path = this->validate_string(pathname, pathname_length);
     auto vfs = fs::vfs();
@@ -46,6 +78,50 @@ ErrorOr<FlatPtr> Process::sys$write(int fd, const void* buffer, size_t size) {
     return file->write(buffer, size);
 }
 
+ErrorOr<FlatPtr> Process::sys$readv(int fd, const iovec* iov, int iovcnt) {
+    auto file = this->get_file_descriptor(fd);
+    if (!file) {
+        return Error(EBADF);
+    }
+
+    auto vectors = TRY(copy_iovec_from_user(*this, iov, iovcnt, true));
+    return file->readv(vectors.data(), vectors.size());
+}
+
+ErrorOr<FlatPtr> Process::sys$writev(int fd, const iovec* iov, int iovcnt) {
+    auto file = this->get_file_descriptor(fd);
+    if (!file) {
+        return Error(EBADF);
+    }
+
+    auto vectors = TRY(copy_iovec_from_user(*this, iov, iovcnt, false));
+    return file->writev(vectors.data(), vectors.size());
+}
+
+ErrorOr<FlatPtr> Process::sys$pread(int fd, void* buffer, size_t size, off_t offset) {
+    auto file = this->get_file_descriptor(fd);
+    if (!file) {
+        return Error(EBADF);
+    } else if (offset < 0) {
+        return Error(EINVAL);
+    }
+
+    this->validate_write(buffer, size);
+    return file->pread(buffer, size, offset);
+}
+
+ErrorOr<FlatPtr> Process::sys$pwrite(int fd, const void* buffer, size_t size, off_t offset) {
+    auto file = this->get_file_descriptor(fd);
+    if (!file) {
+        return Error(EBADF);
+    } else if (offset < 0) {
+        return Error(EINVAL);
+    }
+
+    this->validate_read(buffer, size);
+    return file->pwrite(buffer, size, offset);
+}
+
 ErrorOr<FlatPtr> Process::sys$stat(const char* path, size_t path_length, stat* buffer) {
     StringView pathname = this->validate_string(path, path_length);
     auto vfs = fs::vfs();
@@ -0,0 +1,126 @@
+#include <kernel/process/process.h>
+#include <kernel/process/wait_queue.h>
+#include <kernel/fs/epoll.h>
+
+namespace kernel {
+
+static constexpr nfds_t MAX_POLL_FDS = 1024;
+
+ErrorOr<FlatPtr> Process::sys$poll(pollfd* fds, nfds_t nfds, int timeout) {
+    if (nfds > MAX_POLL_FDS) {
+        return Error(EINVAL);
+    }
+
+    this->validate_write(fds, sizeof(pollfd) * nfds);
+
+    Vector<RefPtr<fs::FileDescriptor>> descriptors;
+    descriptors.reserve(nfds);
+
+    for (nfds_t i = 0; i < nfds; i++) {
+        descriptors.append(fds[i].fd < 0 ? nullptr : this->get_file_descriptor(fds[i].fd));
+    }
+
+    WaitQueueBlocker blocker = timeout > 0 ? WaitQueueBlocker(Duration::from_milliseconds(timeout)) : WaitQueueBlocker();
+    for (auto& descriptor : descriptors) {
+        if (descriptor) {
+            descriptor->file()->wait_queue().add(&blocker);
+        }
+    }
+
+    size_t ready = 0;
+    while (true) {
+        blocker.reset();
+
+        for (nfds_t i = 0; i < nfds; i++) {
+            auto& descriptor = descriptors[i];
+            if (fds[i].fd < 0) {
+                fds[i].revents = 0;
+                continue;
+            } else if (!descriptor) {
+                fds[i].revents = POLLNVAL;
+            } else {
+                fds[i].revents = descriptor->poll(fds[i].events);
+            }
+
+            if (fds[i].revents) {
+                ready++;
+            }
+        }
+
+        if (ready || timeout == 0 || blocker.has_timed_out()) {
+            break;
+        }
+
+        blocker.wait();
+    }
+
+    for (auto& descriptor : descriptors) {
+        if (descriptor) {
+            descriptor->file()->wait_queue().remove(&blocker);
+        }
+    }
+
+    return ready;
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_create(int) {
+    auto epoll = fs::EPoll::create();
+    auto fd = fs::FileDescriptor::create(move(epoll), O_RDONLY);
+
+    m_file_descriptors.append(move(fd));
+    return m_file_descriptors.size() - 1;
+}
+
+static ErrorOr<fs::EPoll*> get_epoll(RefPtr<fs::FileDescriptor>& descriptor) {
+    if (!descriptor) {
+        return Error(EBADF);
+    } else if (!descriptor->file()->is_epoll()) {
+        return Error(EINVAL);
+    }
+
+    return static_cast<fs::EPoll*>(descriptor->file());
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_ctl(int epfd, int op, int fd, epoll_event* event) {
+    auto epoll_descriptor = this->get_file_descriptor(epfd);
+    auto* epoll = TRY(get_epoll(epoll_descriptor));
+
+    auto descriptor = this->get_file_descriptor(fd);
+    if (!descriptor) {
+        return Error(EBADF);
+    }
+
+    if (op != EPOLL_CTL_DEL) {
+        this->validate_read(event, sizeof(epoll_event));
+    }
+
+    switch (op) {
+        case EPOLL_CTL_ADD:
+            TRY(epoll->add(fd, move(descriptor), *event));
+            break;
+        case EPOLL_CTL_MOD:
+            TRY(epoll->modify(fd, *event));
+            break;
+        case EPOLL_CTL_DEL:
+            TRY(epoll->remove(fd));
+            break;
+        default:
+            return Error(EINVAL);
+    }
+
+    return 0;
+}
+
+ErrorOr<FlatPtr> Process::sys$epoll_wait(int epfd, epoll_event* events, int max_events, int timeout) {
+    auto epoll_descriptor = this->get_file_descriptor(epfd);
+    auto* epoll = TRY(get_epoll(epoll_descriptor));
+
+    if (max_events <= 0) {
+        return Error(EINVAL);
+    }
+
+    this->validate_write(events, sizeof(epoll_event) * max_events);
+    return TRY(epoll->wait(events, max_events, timeout));
+}
+
+}
@@ -0,0 +1,115 @@
+#include <kernel/process/process.h>
+#include <kernel/net/socket.h>
+
+namespace kernel {
+
+static ErrorOr<net::Socket*> get_socket(RefPtr<fs::FileDescriptor>& descriptor) {
+    if (!descriptor) {
+        return Error(EBADF);
+    } else if (!descriptor->file()->is_socket()) {
+        return Error(ENOTSOCK);
+    }
+
+    return static_cast<net::Socket*>(descriptor->file());
+}
+
+ErrorOr<FlatPtr> Process::sys$socket(int domain, int type, int protocol) {
+    auto socket = TRY(net::Socket::create(domain, type, protocol));
+    auto fd = fs::FileDescriptor::create(move(socket), O_RDWR);
+
+    m_file_descriptors.append(move(fd));
+    return m_file_descriptors.size() - 1;
+}
+
+ErrorOr<FlatPtr> Process::sys$bind(int fd, const sockaddr* addr, socklen_t addrlen) {
+    this->validate_read(addr, addrlen);
+
+    auto descriptor = this->get_file_descriptor(fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    auto address = TRY(net::Socket::parse_address(addr, addrlen));
+    TRY(socket->bind(address));
+
+    return 0;
+}
+
+ErrorOr<FlatPtr> Process::sys$connect(int fd, const sockaddr* addr, socklen_t addrlen) {
+    this->validate_read(addr, addrlen);
+
+    auto descriptor = this->get_file_descriptor(fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    auto address = TRY(net::Socket::parse_address(addr, addrlen));
+    TRY(socket->connect(address));
+
+    return 0;
+}
+
+ErrorOr<FlatPtr> Process::sys$sendto(sendto_args* args) {
+    this->validate_read(args, sizeof(sendto_args));
+    this->validate_read(args->buffer, args->length);
+
+    auto descriptor = this->get_file_descriptor(args->fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    if (!args->addr) {
+        return socket->sendto(args->buffer, args->length, args->flags, nullptr);
+    }
+
+    this->validate_read(args->addr, args->addrlen);
+    auto destination = TRY(net::Socket::parse_address(args->addr, args->addrlen));
+
+    return socket->sendto(args->buffer, args->length, args->flags, &destination);
+}
+
+ErrorOr<FlatPtr> Process::sys$recvfrom(recvfrom_args* args) {
+    this->validate_read(args, sizeof(recvfrom_args));
+    this->validate_write(args->buffer, args->length);
+
+    auto descriptor = this->get_file_descriptor(args->fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    net::SocketAddress source;
+    size_t nread = TRY(socket->recvfrom(args->buffer, args->length, args->flags, &source));
+
+    if (args->addr && args->addrlen) {
+        this->validate_write(args->addrlen, sizeof(socklen_t));
+        this->validate_write(args->addr, *args->addrlen);
+
+        net::Socket::write_address(source, args->addr, args->addrlen);
+    }
+
+    return nread;
+}
+
+ErrorOr<FlatPtr> Process::sys$listen(int fd, int backlog) {
+    auto descriptor = this->get_file_descriptor(fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    TRY(socket->listen(backlog));
+    return 0;
+}
+
+ErrorOr<FlatPtr> Process::sys$accept(int fd, sockaddr* addr, socklen_t* addrlen) {
+    auto descriptor = this->get_file_descriptor(fd);
+    auto* socket = TRY(get_socket(descriptor));
+
+    if (addr && addrlen) {
+        this->validate_write(addrlen, sizeof(socklen_t));
+        this->validate_write(addr, *addrlen);
+    }
+
+    net::SocketAddress peer;
+    auto connection = TRY(socket->accept(&peer));
+
+    if (addr && addrlen) {
+        net::Socket::write_address(peer, addr, addrlen);
+    }
+
+    auto file = fs::FileDescriptor::create(move(connection), O_RDWR);
+
+    m_file_descriptors.append(move(file));
+    return m_file_descriptors.size() - 1;
+}
+
+}
@@ -0,0 +1,116 @@
+#include <kernel/time/apic_timer.h>
+#include <kernel/time/hpet/hpet.h>
+#include <kernel/time/tsc.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/arch/processor.h>
+#include <kernel/arch/cpu.h>
+
+#include <std/format.h>
+
+namespace kernel {
+
+extern "C" void* _irq_stub_table[];
+
+static constexpr u8 TIMER_VECTOR = 32 + apic::TIMER_IRQ;
+
+// We calibrate over 10ms worth of HPET ticks
+static constexpr u64 CALIBRATION_DIVISOR = 100;
+
+// Longer timeouts are split up into multiple interrupts so that the tick calculations can't overflow
+static constexpr u64 MAX_ARM_NS = 1'000'000'000;
+
+RefPtr<APICTimer> APICTimer::create() {
+    auto& processor = Processor::instance();
+    if (!processor.has_feature(arch::CPUFeatures::APIC) || !HPET::instance()) {
+        return nullptr;
+    }
+
+    apic::init_local();
+
+    auto timer = RefPtr<APICTimer>(new APICTimer());
+    if (!timer->calibrate()) {
+        return nullptr;
+    }
+
+    if (processor.has_feature(arch::CPUFeatures::TSC_DEADLINE) && TSC::instance()) {
+        timer->m_mode = Mode::TSCDeadline;
+    }
+
+    arch::set_interrupt_handler(TIMER_VECTOR, reinterpret_cast<uintptr_t>(_irq_stub_table[apic::TIMER_IRQ]), arch::INTERRUPT_GATE);
+    timer->register_interrupt_handler();
+
+    auto mode = timer->m_mode == Mode::TSCDeadline ? apic::TimerMode::TSCDeadline : apic::TimerMode::OneShot;
+    apic::write_reg(apic::APICRegisters::LVTTimer, to_underlying(mode) | TIMER_VECTOR);
+
+    dbgln("APIC Timer:");
+    dbgln(" - Mode: {}", timer->m_mode == Mode::TSCDeadline ? "TSC-deadline" : "one-shot");
+    dbgln(" - Frequency: {} Hz", timer->m_frequency);
+    dbgln();
+
+    return timer;
+}
+
+bool APICTimer::calibrate() {
+    auto* hpet = HPET::instance();
+
+    apic::write_reg(apic::APICRegisters::DivideConfiguration, to_underlying(apic::TimerDivide::By16));
+    apic::write_reg(apic::APICRegisters::LVTTimer, apic::LVT_MASKED | to_underlying(apic::TimerMode::OneShot) | TIMER_VECTOR);
+
+    u64 hpet_ticks = hpet->frequency() / CALIBRATION_DIVISOR;
+
+    u64 start = hpet->counter();
+
+    apic::write_reg(apic::APICRegisters::InitialCount, 0xFFFFFFFF);
+    while (hpet->counter() - start < hpet_ticks) {
+        asm volatile("pause");
+    }
+
+    u32 remaining = apic::read_reg(apic::APICRegisters::CurrentCount);
+    u64 elapsed = hpet->counter() - start;
+
+    apic::write_reg(apic::APICRegisters::InitialCount, 0);
+    if (!elapsed || remaining == 0) {
+        return false;
+    }
+
+    m_frequency = (static_cast<u64>(0xFFFFFFFF - remaining) * hpet->frequency()) / elapsed;
+
+    return m_frequency != 0;
+}
+
+void APICTimer::arm(Duration duration) {
+    u64 ns = std::min(duration.to_nanoseconds(), MAX_ARM_NS);
+
+    if (m_mode == Mode::TSCDeadline) {
+        u64 ticks = std::max<u64>(TSC::instance()->ns_to_ticks(ns), 1);
+        arch::wmsr(arch::MSR_TSC_DEADLINE, TSC::read() + ticks);
+    } else {
+        u64 count = (ns * m_frequency) / 1'000'000'000;
+        count = std::min<u64>(std::max<u64>(count, 1), 0xFFFFFFFF);
+
+        apic::write_reg(apic::APICRegisters::InitialCount, count);
+    }
+
+    m_armed = true;
+}
+
+void APICTimer::disarm() {
+    if (m_mode == Mode::TSCDeadline) {
+        arch::wmsr(arch::MSR_TSC_DEADLINE, 0);
+    } else {
+        apic::write_reg(apic::APICRegisters::InitialCount, 0);
+    }
+
+    m_armed = false;
+}
+
+void APICTimer::handle_irq() {
+    m_armed = false;
+    Timer::handle_irq();
+}
+
+void APICTimer::eoi() {
+    apic::eoi();
+}
+
+}
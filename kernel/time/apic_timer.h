@@ -0,0 +1,49 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/time/timer.h>
+#include <kernel/arch/apic.h>
+
+#include <std/memory.h>
+#include <std/time.h>
+
+namespace kernel {
+
+// The local APIC timer of a single processor. It is only ever used in one-shot or TSC-deadline mode,
+// so that the next interrupt can be programmed for exactly when something needs to happen.
+class APICTimer : public Timer {
+public:
+    enum class Mode : u8 {
+        OneShot,
+        TSCDeadline
+    };
+
+    // Calibrates the timer of the current processor against the HPET. Returns nullptr if that isn't possible.
+    static RefPtr<APICTimer> create();
+
+    Mode mode() const { return m_mode; }
+
+    u64 frequency() const { return m_frequency; } // Timer ticks per second (after the divider)
+
+    bool is_armed() const { return m_armed; }
+
+    // Fire the timer once after `duration` has passed
+    void arm(Duration duration);
+    void disarm();
+
+    void handle_irq() override;
+    void eoi() override;
+
+private:
+    APICTimer() : Timer(apic::TIMER_IRQ) {}
+
+    bool calibrate();
+
+    Mode m_mode = Mode::OneShot;
+
+    u64 m_frequency = 0;
+
+    bool m_armed = false;
+};
+
+}
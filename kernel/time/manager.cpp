@@ -1,9 +1,14 @@
 #include <kernel/time/manager.h>
+#include <kernel/time/apic_timer.h>
 #include <kernel/time/hpet/hpet.h>
+#include <kernel/time/tsc.h>
 #include <kernel/time/rtc.h>
 #include <kernel/time/pit.h>
 #include <kernel/process/scheduler.h>
+#include <kernel/arch/interrupts.h>
+#include <kernel/arch/processor.h>
 #include <kernel/acpi/acpi.h>
+#include <kernel/memory/manager.h>
 
 namespace kernel {
 
@@ -33,12 +38,36 @@ void TimeManager::initialize() {
     } else {
         this->initialize_with_hpet();
     }
+
+    this->initialize_time_page();
 }
 
 void TimeManager::initialize_with_hpet() {
     auto* hpet = HPET::instance();
     m_ticks_per_second = hpet->frequency();
 
+    // An invariant TSC is much cheaper to read than the HPET and can also be read directly by userspace
+    if (TSC::init() && TSC::instance()->is_invariant()) {
+        m_use_tsc = true;
+        m_tsc_base = TSC::read();
+    }
+
+    auto apic_timer = APICTimer::create();
+    if (apic_timer) {
+        // The HPET stays our clock source, but all timer interrupts now come from the local APIC and are only raised when needed.
+        hpet->timer(0)->disable();
+
+        apic_timer->set_callback([this]() {
+            this->timer_tick();
+        });
+
+        Processor::instance().set_apic_timer(apic_timer.ptr());
+        m_system_timer = apic_timer;
+
+        this->program_next_event(*apic_timer, false);
+        return;
+    }
+
     m_system_timer = hpet->timer(0);
     m_system_timer->set_callback([this]() {
         this->timer_tick();
@@ -54,6 +83,22 @@ void TimeManager::initialize_with_pit() {
     });
 }
 
+void TimeManager::initialize_time_page() {
+    m_time_page_frame = PhysicalAddress { MUST(MM->allocate_page_frame()) };
+    m_time_page = reinterpret_cast<time_page*>(MUST(MM->map_physical_region(m_time_page_frame, PAGE_SIZE)));
+
+    memset(m_time_page, 0, PAGE_SIZE);
+    if (m_use_tsc) {
+        auto* tsc = TSC::instance();
+
+        m_time_page->clock_source = TIME_PAGE_CLOCK_TSC;
+        m_time_page->tsc_mult = tsc->mult();
+        m_time_page->tsc_shift = TSC::SHIFT;
+    }
+
+    this->update_time_page();
+}
+
 Duration TimeManager::query_time(clockid_t clock_id) {
     if (clock_id == CLOCK_REALTIME) {
         return s_instance->epoch_time();
@@ -68,8 +113,71 @@ time_t TimeManager::boot_time() {
     return rtc::boot_time();
 }
 
+void TimeManager::schedule_wakeup(Duration deadline, clockid_t clock_id) {
+    auto* timer = Processor::instance().apic_timer();
+    if (!timer) {
+        // Sleeping threads get checked on every periodic tick anyway
+        return;
+    }
+
+    arch::InterruptDisabler disabler;
+    if (clock_id == CLOCK_REALTIME) {
+        deadline = deadline - (s_instance->epoch_time() - s_instance->monotonic_time());
+    }
+
+    auto& wakeups = s_instance->m_wakeups;
+    wakeups.append(deadline);
+
+    for (size_t i = wakeups.size() - 1; i > 0 && wakeups[i - 1] < wakeups[i]; i--) {
+        std::swap(wakeups[i - 1], wakeups[i]);
+    }
+
+    if (!timer->is_armed() || deadline < s_instance->m_next_event) {
+        s_instance->program_next_event(*timer, false);
+    }
+}
+
+void TimeManager::enter_idle() {
+    auto* timer = Processor::instance().apic_timer();
+    if (!timer) {
+        return;
+    }
+
+    s_instance->program_next_event(*timer, true);
+}
+
+void TimeManager::exit_idle() {
+    auto* timer = Processor::instance().apic_timer();
+    if (!timer) {
+        return;
+    }
+
+    arch::InterruptDisabler disabler;
+    s_instance->program_next_event(*timer, false);
+}
+
+void TimeManager::program_next_event(APICTimer& timer, bool idle) {
+    Duration now = this->monotonic_time();
+    while (!m_wakeups.empty() && m_wakeups.last() <= now) {
+        m_wakeups.remove_last();
+    }
+
+    Duration timeout = idle ? MAX_IDLE_INTERVAL : SCHEDULER_QUANTUM;
+    if (!m_wakeups.empty()) {
+        timeout = std::min(timeout, m_wakeups.last() - now);
+    }
+
+    m_next_event = now + timeout;
+    timer.arm(timeout);
+}
+
 void TimeManager::timer_tick() {
     this->update_time();
+
+    if (auto* timer = Processor::instance().apic_timer()) {
+        this->program_next_event(*timer, false);
+    }
+
     Scheduler::invoke_async();
 }
 
@@ -78,33 +186,72 @@ void TimeManager::update_time() {
         return;
     }
 
-    auto* hpet = HPET::instance();
+    m_sequence.fetch_add(1, std::MemoryOrder::Relaxed);
+    std::atomic_thread_fence(std::MemoryOrder::Release);
 
-    u64 seconds_since_boot = m_seconds_since_boot;
-    u64 ticks = m_ticks;
-    u64 delta = hpet->deltatime_ns(seconds_since_boot, ticks);
+    u64 delta = 0;
+    if (m_use_tsc) {
+        u64 tsc = TSC::read();
+        u64 scaled = (tsc - m_tsc_base) * TSC::instance()->mult() + m_tsc_fraction;
 
-    u32 iteration = m_timer_update2.fetch_add(1, std::MemoryOrder::Acquire);
+        delta = scaled >> TSC::SHIFT;
 
-    m_ticks = ticks;
-    m_seconds_since_boot = seconds_since_boot;
+        m_tsc_fraction = scaled & ((1ull << TSC::SHIFT) - 1);
+        m_tsc_base = tsc;
+        m_monotonic_ns += delta;
+    } else {
+        delta = HPET::instance()->deltatime_ns(m_seconds_since_boot, m_ticks);
+    }
 
     m_epoch_time += Duration::from_nanoseconds(delta);
+    this->update_time_page();
 
-    m_timer_update1.store(iteration + 1, std::MemoryOrder::Release);
+    m_sequence.fetch_add(1, std::MemoryOrder::Release);
+}
+
+void TimeManager::update_time_page() {
+    if (!m_time_page || !m_use_tsc) {
+        return;
+    }
+
+    auto* page = m_time_page;
+    __atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELAXED);
+
+    // Keeps the stores below from becoming visible before the sequence turns odd
+    std::atomic_thread_fence(std::MemoryOrder::Release);
+
+    page->tsc_base = m_tsc_base;
+    page->monotonic_ns = m_monotonic_ns;
+    page->realtime_ns = m_epoch_time.to_nanoseconds();
+
+    __atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELEASE);
+}
+
+u64 TimeManager::pending_time_ns() {
+    if (m_use_tsc) {
+        return TSC::instance()->ticks_to_ns(TSC::read() - m_tsc_base);
+    }
+
+    u64 seconds = 0, ticks = 0;
+    return HPET::instance()->deltatime_ns(seconds, ticks, false);
 }
 
 Duration TimeManager::epoch_time() {
+    if (!HPET::instance()) {
+        return m_epoch_time;
+    }
+
     Duration time;
-    u32 iteration;
+    u32 sequence;
 
-    // We do this in order to avoid reading the time while it is being updated.
-    // So we wait until the update is done before returning the time. The same applies to monotonic_time().
-    // Took from SerenityOS. https://github.com/SerenityOS/serenity/blob/80f586503daf0ecd0eac858e8b8e7e53b43065ae/Kernel/Time/TimeManagement.cpp#L178
+    // We do this in order to avoid reading the time while it is being updated, so we retry until we got a consistent snapshot.
+    // The pending time is added on top since the next timer interrupt might be a long way off when the system is idle.
     do {
-        iteration = m_timer_update1.load(std::MemoryOrder::Acquire);
-        time = m_epoch_time;
-    } while (iteration != m_timer_update2.load(std::MemoryOrder::Acquire));
+        sequence = m_sequence.load(std::MemoryOrder::Acquire);
+        time = m_epoch_time + Duration::from_nanoseconds(this->pending_time_ns());
+
+        std::atomic_thread_fence(std::MemoryOrder::Acquire);
+    } while ((sequence & 1) || sequence != m_sequence.load(std::MemoryOrder::Relaxed));
 
     return time;
 }
@@ -114,19 +261,30 @@ Duration TimeManager::monotonic_time() {
         return Duration::zero();
     }
 
-    u32 ticks;
-    u64 seconds;
+    u64 seconds = 0, ticks = 0, ns = 0;
+    u32 sequence;
 
-    u32 iteration;
     do {
-        iteration = m_timer_update1.load(std::MemoryOrder::Acquire);
+        sequence = m_sequence.load(std::MemoryOrder::Acquire);
+
+        if (m_use_tsc) {
+            ns = m_monotonic_ns + this->pending_time_ns();
+        } else {
+            seconds = m_seconds_since_boot;
+            ticks = m_ticks;
 
-        seconds = m_seconds_since_boot;
-        ticks = m_ticks;
-    } while (iteration != m_timer_update2.load(std::MemoryOrder::Acquire));
+            HPET::instance()->deltatime_ns(seconds, ticks, false);
+        }
 
-    u64 ns = ((u64)ticks * 1'000'000'000ull) / m_ticks_per_second;
+        std::atomic_thread_fence(std::MemoryOrder::Acquire);
+    } while ((sequence & 1) || sequence != m_sequence.load(std::MemoryOrder::Relaxed));
+
+    if (m_use_tsc) {
+        return Duration::from_nanoseconds(ns);
+    }
+
+    ns = (ticks * 1'000'000'000ull) / m_ticks_per_second;
     return Duration(seconds, static_cast<u32>(ns));
 }
 
-}
\ No newline at end of file
+}
@@ -4,16 +4,26 @@
 #include <kernel/posix/sys/types.h>
 #include <kernel/posix/time.h>
 #include <kernel/time/timer.h>
+#include <kernel/time/time_page.h>
 #include <kernel/sync/spinlock.h>
 
 #include <std/atomic.h>
 #include <std/time.h>
 #include <std/memory.h>
+#include <std/vector.h>
 
 namespace kernel {
 
+class APICTimer;
+
 class TimeManager {
 public:
+    // How long a thread gets to run before we preempt it when the timer is programmed on demand
+    static constexpr Duration SCHEDULER_QUANTUM = Duration::from_milliseconds(1);
+
+    // Upper bound for how long an idle processor sleeps without a timer interrupt, so the clock source can't wrap around unnoticed
+    static constexpr Duration MAX_IDLE_INTERVAL = Duration::from_seconds(1);
+
     static void init();
     static TimeManager* instance();
 
@@ -26,9 +36,18 @@ public:
     static time_t boot_time();
     static void tick();
 
+    // Makes sure that a timer interrupt is raised once `deadline` is reached
+    static void schedule_wakeup(Duration deadline, clockid_t);
+
+    // Called by the idle thread around `hlt`. While idle, the timer is only programmed for the next pending wakeup.
+    static void enter_idle();
+    static void exit_idle();
+
     Duration epoch_time();
     Duration monotonic_time();
 
+    PhysicalAddress time_page_frame() const { return m_time_page_frame; }
+
 private:
     TimeManager() = default;
 
@@ -37,22 +56,43 @@ private:
     void initialize_with_pit();
     void initialize_with_hpet();
 
+    void initialize_time_page();
+
     void timer_tick();
     void update_time();
+    void update_time_page();
+
+    // Returns the nanoseconds that passed since the last update without advancing the clock source
+    u64 pending_time_ns();
+
+    void program_next_event(APICTimer&, bool idle);
 
     RefPtr<Timer> m_system_timer;
 
     u64 m_ticks_per_second = 0;
     
+    // Used when the HPET is the clock source
     u64 m_seconds_since_boot = 0;
     u64 m_ticks = 0;
 
+    // Used when we have an invariant TSC. `m_tsc_fraction` carries the sub-nanosecond remainder between updates.
+    bool m_use_tsc = false;
+    u64 m_tsc_base = 0;
+    u64 m_tsc_fraction = 0;
+    u64 m_monotonic_ns = 0;
+
     Duration m_epoch_time;
 
-    // TODO: Maybe use a lock instead in epoch_time() and monotonic_time(), but for some reason adding a lock
-    // makes the kernel go insane and crash.
-    std::Atomic<u32> m_timer_update1;
-    std::Atomic<u32> m_timer_update2;
+    PhysicalAddress m_time_page_frame;
+    time_page* m_time_page = nullptr;
+
+    // Monotonic deadlines of sleeping threads, sorted so that the earliest one is last
+    Vector<Duration> m_wakeups;
+    Duration m_next_event;
+
+    // Seqlock protecting the clock state above: odd while update_time() is running. Readers retry instead of taking a lock,
+    // because they can be interrupted by the timer at any point.
+    std::Atomic<u32> m_sequence;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+// A read-only page that the kernel maps into every user process at `TIME_PAGE_ADDRESS`. It allows clock_gettime()
+// to be computed entirely in userspace by reading the TSC and scaling it relative to the last kernel update.
+#ifdef __x86_64__
+    #define TIME_PAGE_ADDRESS 0x00007FFFFFFFE000
+#else
+    #define TIME_PAGE_ADDRESS 0xBFFFE000
+#endif
+
+enum {
+    TIME_PAGE_CLOCK_NONE, // No usable clock source, userspace has to fall back to the syscall
+    TIME_PAGE_CLOCK_TSC
+};
+
+struct time_page {
+    // Odd while the kernel is updating the page. Readers have to retry if the value changed while they were reading.
+    uint32_t sequence;
+    uint32_t clock_source;
+
+    // ns = base + (((tsc - tsc_base) * tsc_mult) >> tsc_shift)
+    uint64_t tsc_base;
+    uint64_t tsc_mult;
+    uint32_t tsc_shift;
+
+    uint64_t monotonic_ns;
+    uint64_t realtime_ns;
+};
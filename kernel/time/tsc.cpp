@@ -0,0 +1,75 @@
+#include <kernel/time/tsc.h>
+#include <kernel/time/hpet/hpet.h>
+#include <kernel/arch/processor.h>
+
+#include <std/format.h>
+
+namespace kernel {
+
+static TSC* s_instance = nullptr;
+
+// We calibrate over 10ms worth of HPET ticks
+static constexpr u64 CALIBRATION_DIVISOR = 100;
+
+TSC* TSC::instance() {
+    return s_instance;
+}
+
+bool TSC::init() {
+    if (s_instance) {
+        return false;
+    }
+
+    if (!Processor::instance().has_feature(arch::CPUFeatures::TSC) || !HPET::instance()) {
+        return false;
+    }
+
+    auto* tsc = new TSC;
+    if (!tsc->calibrate()) {
+        delete tsc;
+        return false;
+    }
+
+    s_instance = tsc;
+    return true;
+}
+
+bool TSC::calibrate() {
+    auto* hpet = HPET::instance();
+
+    u32 eax, ebx, ecx, edx;
+    arch::cpuid(0x80000000, eax, ebx, ecx, edx);
+
+    if (eax >= 0x80000007) {
+        arch::cpuid(0x80000007, eax, ebx, ecx, edx);
+        m_invariant = edx & (1 << 8);
+    }
+
+    u64 hpet_ticks = hpet->frequency() / CALIBRATION_DIVISOR;
+
+    u64 start = hpet->counter();
+    u64 tsc_start = TSC::read();
+
+    while (hpet->counter() - start < hpet_ticks) {
+        asm volatile("pause");
+    }
+
+    u64 tsc_end = TSC::read();
+    u64 elapsed = hpet->counter() - start;
+
+    if (!elapsed || tsc_end <= tsc_start) {
+        return false;
+    }
+
+    m_frequency = ((tsc_end - tsc_start) * hpet->frequency()) / elapsed;
+    m_mult = (1'000'000'000ull << SHIFT) / m_frequency;
+
+    dbgln("TSC:");
+    dbgln(" - Frequency: {} Hz ({} MHz)", m_frequency, m_frequency / 1'000'000);
+    dbgln(" - Invariant: {}", m_invariant ? "yes" : "no");
+    dbgln();
+
+    return true;
+}
+
+}
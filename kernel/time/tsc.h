@@ -0,0 +1,40 @@
+#pragma once
+
+#include <kernel/common.h>
+#include <kernel/arch/cpu.h>
+
+namespace kernel {
+
+class TSC {
+public:
+    // Fixed point shift used to convert ticks into nanoseconds: ns = (ticks * mult) >> SHIFT.
+    // 24 bits keep the conversion precise while still leaving ~1000s of headroom before the multiplication overflows.
+    static constexpr u32 SHIFT = 24;
+
+    // Calibrates the TSC against the HPET
+    static bool init();
+    static TSC* instance();
+
+    static u64 read() { return arch::rdtsc(); }
+
+    // An invariant TSC runs at a constant rate regardless of power states, which makes it usable as a clock source
+    bool is_invariant() const { return m_invariant; }
+
+    u64 frequency() const { return m_frequency; }
+    u64 mult() const { return m_mult; }
+
+    u64 ticks_to_ns(u64 ticks) const { return (ticks * m_mult) >> SHIFT; }
+    u64 ns_to_ticks(u64 ns) const { return (ns * m_frequency) / 1'000'000'000; }
+
+private:
+    TSC() = default;
+
+    bool calibrate();
+
+    bool m_invariant = false;
+
+    u64 m_frequency = 0;
+    u64 m_mult = 0;
+};
+
+}
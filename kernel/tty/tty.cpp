@@ -28,6 +28,8 @@ ErrorOr<size_t> TTY::write(const void* buffer, size_t size, size_t) {
 void TTY::emit(u8 byte) {
     m_input_buffer.push(byte);
     this->echo(byte);
+
+    this->notify_readiness();
 }
 
 }
\ No newline at end of file
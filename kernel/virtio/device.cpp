@@ -113,10 +113,13 @@ u64 Device::features() {
 ErrorOr<void> Device::set_accepted_features(u64 accepted) {
     u64 features = this->features();
     
-    if (std::has_flag(features, VIRTIO_F_VERSION_1)) {
-        accepted |= VIRTIO_F_VERSION_1;
+    // Transport features every driver benefits from, whatever the device type
+    for (u64 feature : { VIRTIO_F_VERSION_1, VIRTIO_RING_F_EVENT_IDX, VIRTIO_RING_F_INDIRECT_DESC }) {
+        if (std::has_flag(features, feature)) {
+            accepted |= feature;
+        }
     }
-    
+
     this->set_features(accepted);
     
     auto* config = m_common_config;
@@ -128,9 +131,18 @@ ErrorOr<void> Device::set_accepted_features(u64 accepted) {
     }
 
     m_accepted_features = accepted;
+    for (auto& queue : m_queues) {
+        this->apply_ring_features(*queue);
+    }
+
     return {};
 }
 
+void Device::apply_ring_features(Queue& queue) {
+    queue.set_event_index_enabled(std::has_flag(m_accepted_features, VIRTIO_RING_F_EVENT_IDX));
+    queue.set_indirect_enabled(std::has_flag(m_accepted_features, VIRTIO_RING_F_INDIRECT_DESC));
+}
+
 void Device::set_features(u64 features) {
     auto* config = m_common_config;
 
@@ -187,8 +199,9 @@ ErrorOr<void> Device::setup_queue(u16 index) {
     }
 
     u16 notify_offset = config->read<u16>(CommonConfig::QueueNotifyOffset);    
-    auto queue = Queue::create(size, notify_offset);
-    
+    auto queue = Queue::create(index, size, notify_offset);
+    this->apply_ring_features(*queue);
+
     config->write<u64>(CommonConfig::QueueDescriptorAddress, queue->get_physical_address(queue->descriptors()));
     config->write<u64>(CommonConfig::QueueDriverAddress, queue->get_physical_address(queue->driver()));
     config->write<u64>(CommonConfig::QueueDeviceAddress, queue->get_physical_address(queue->device()));
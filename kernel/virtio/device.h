@@ -71,6 +71,9 @@ private:
     ErrorOr<void> setup_queue(u16 index);
     void set_features(u64 features);
 
+    // Queues may be set up before or after the features are negotiated
+    void apply_ring_features(Queue&);
+
     pci::Device m_pci_device;
 
     Vector<Configuration> m_configurations;
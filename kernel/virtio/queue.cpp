@@ -1,16 +1,19 @@
 #include <kernel/virtio/queue.h>
 #include <kernel/memory/manager.h>
 
+#include <std/atomic.h>
+
 namespace kernel::virtio {
 
-OwnPtr<Queue> Queue::create(u16 size, u16 notify_offset) {
-    return OwnPtr<Queue>(new Queue(size, notify_offset));
+OwnPtr<Queue> Queue::create(u16 index, u16 size, u16 notify_offset) {
+    return OwnPtr<Queue>(new Queue(index, size, notify_offset));
 }
 
-Queue::Queue(u16 size, u16 notify_offset) : m_size(size), m_notify_offset(notify_offset) {
+Queue::Queue(u16 index, u16 size, u16 notify_offset) : m_index(index), m_size(size), m_notify_offset(notify_offset) {
+    // Both rings end with the event index of the other side, the device ring has to be 4 byte aligned
     size_t descriptor_size = sizeof(QueueDescriptor) * size;
-    size_t driver_size = sizeof(QueueDriver) + sizeof(u16) * size;
-    size_t device_size = sizeof(QueueDevice) + sizeof(QueueDeviceElement) * size;
+    size_t driver_size = std::align_up(sizeof(QueueDriver) + sizeof(u16) * size + sizeof(u16), 4);
+    size_t device_size = sizeof(QueueDevice) + sizeof(QueueDeviceElement) * size + sizeof(u16);
 
     size_t total_size = std::align_up(descriptor_size + driver_size + device_size, PAGE_SIZE);
 
@@ -21,16 +24,66 @@ Queue::Queue(u16 size, u16 notify_offset) : m_size(size), m_notify_offset(notify
     m_driver = reinterpret_cast<QueueDriver*>(m_buffer + descriptor_size);
     m_device = reinterpret_cast<QueueDevice*>(m_buffer + descriptor_size + driver_size);
 
+    m_indirect_tables.resize(size);
+    for (auto& table : m_indirect_tables) {
+        table = nullptr;
+    }
+
     for (size_t i = 0; i < size; ++i) {
         m_descriptors[i].next = (i + 1) % size;
-        m_free_descriptors.push(size - i - 1);
     }
 
+    m_free_head = 0;
+    m_num_free = size;
+
     m_driver->flags = 0;
 }
 
 bool Queue::has_available_data() const {
-    return m_used_index != m_device->index;
+    return m_used_index != *const_cast<volatile u16*>(&m_device->index);
+}
+
+// Whether moving an index from `old` to `current` went past `event` (vring_need_event in the specification)
+static bool needs_event(u16 event, u16 current, u16 old) {
+    return static_cast<u16>(current - event - 1) < static_cast<u16>(current - old);
+}
+
+bool Queue::should_notify() {
+    // The new driver index has to be visible before we look at what the device wants
+    std::atomic_thread_fence(std::MemoryOrder::SeqCst);
+
+    u16 old = m_notified_index;
+    m_notified_index = m_driver_index;
+
+    if (m_event_index) {
+        return needs_event(this->avail_event(), m_driver_index, old);
+    }
+
+    return !(*const_cast<volatile u16*>(&m_device->flags) & QueueDevice::NoNotify);
+}
+
+void Queue::set_interrupts_enabled(bool enabled) {
+    m_interrupts_enabled = enabled;
+
+    // With event indices the flag is ignored, asking for an entry we've already seen means waiting for a full wrap
+    if (m_event_index) {
+        this->used_event() = enabled ? m_used_index : static_cast<u16>(m_used_index - 1);
+    } else if (enabled) {
+        m_driver->flags &= ~QueueDriver::NoInterrupt;
+    } else {
+        m_driver->flags |= QueueDriver::NoInterrupt;
+    }
+
+    std::atomic_thread_fence(std::MemoryOrder::SeqCst);
+}
+
+QueueDescriptor* Queue::indirect_table(u16 head) {
+    auto& table = m_indirect_tables[head];
+    if (!table) {
+        table = reinterpret_cast<QueueDescriptor*>(MUST(MM->allocate_kernel_region(PAGE_SIZE)));
+    }
+
+    return table;
 }
 
 void Queue::drain() {
@@ -49,11 +102,16 @@ PhysicalAddress Queue::get_physical_address(void* ptr) {
 }
 
 u16 Queue::find_free_descriptor() {
-    if (m_free_descriptors.empty()) {
+    if (!m_num_free) {
         return -1; // TODO: Return an Optional
     }
 
-    return m_free_descriptors.pop();
+    u16 index = m_free_head;
+
+    m_free_head = m_descriptors[index].next;
+    m_num_free--;
+
+    return index;
 }
 
 Queue::Chain Queue::dequeue() {
@@ -61,7 +119,9 @@ Queue::Chain Queue::dequeue() {
         return Chain(this, 0, 0, 0);
     }
 
-    QueueDeviceElement item = m_device->ring[m_used_index];
+    // Don't read the used element before we saw the index that covers it
+    std::atomic_thread_fence(std::MemoryOrder::Acquire);
+    QueueDeviceElement item = m_device->ring[m_used_index % m_size];
 
     u16 start = item.id;
     u16 end = item.id;
@@ -78,27 +138,69 @@ Queue::Chain Queue::dequeue() {
         length++;
     }
 
-    m_used_index = (m_used_index + 1) % m_size;
-    return Chain(this, start, end, length);
+    m_used_index++;
+
+    // Interrupts stay enabled by asking for the entry after this one. Callers check for more after every dequeue,
+    // which catches entries the device added before it could see the new index.
+    if (m_event_index && m_interrupts_enabled) {
+        this->used_event() = m_used_index;
+        std::atomic_thread_fence(std::MemoryOrder::SeqCst);
+    }
+
+    return Chain(this, start, end, length, item.len);
 }
 
-void Queue::reclaim(u16 start, u16, size_t length) {
-    u16 index = start;
-    for (size_t i = 0; i < length; i++) {
-        auto& descriptor = m_descriptors[index];
+void Queue::reclaim(u16 start, u16 end, size_t length) {
+    // The chain is already linked through `next`, so it's spliced onto the free list as a whole
+    m_descriptors[end].next = m_free_head;
+    m_free_head = start;
 
-        m_free_descriptors.push(index);
-        index = descriptor.next;
-    }
+    m_num_free += length;
 }
 
 void Queue::Chain::reset() {
     m_start = {};
     m_end = {};
     m_length = 0;
+    m_indirect_count = 0;
 }
 
 void Queue::Chain::add_buffer(PhysicalAddress address, size_t length, bool writable) {
+    if (m_indirect) {
+        if (!m_start.has_value()) {
+            u16 head = m_queue->find_free_descriptor();
+            auto& descriptor = m_queue->descriptors()[head];
+
+            descriptor.address = MM->get_physical_address(m_queue->indirect_table(head));
+            descriptor.flags = QueueDescriptor::Indirect;
+            descriptor.length = 0;
+
+            m_start = head;
+            m_end = head;
+            m_length = 1;
+        }
+
+        ASSERT(m_indirect_count < MAX_INDIRECT_DESCRIPTORS, "Too many buffers in an indirect chain");
+
+        auto& head = m_queue->descriptors()[m_start.value()];
+        auto* table = m_queue->indirect_table(m_start.value());
+
+        if (m_indirect_count) {
+            table[m_indirect_count - 1].flags |= QueueDescriptor::Next;
+            table[m_indirect_count - 1].next = m_indirect_count;
+        }
+
+        auto& descriptor = table[m_indirect_count++];
+
+        descriptor.address = address;
+        descriptor.length = length;
+        descriptor.flags = writable ? QueueDescriptor::Write : 0;
+        descriptor.next = 0;
+
+        head.length = m_indirect_count * sizeof(QueueDescriptor);
+        return;
+    }
+
     u16 index = m_queue->find_free_descriptor();
     if (!m_start.has_value()) {
         m_start = index;
@@ -125,9 +227,12 @@ void Queue::Chain::submit() {
     }
 
     u16 next = m_queue->m_driver_index;
-    m_queue->m_driver->ring[next] = m_start.value();
+    m_queue->m_driver->ring[next % m_queue->m_size] = m_start.value();
+
+    // The device may look at the ring entry as soon as the index moves past it
+    std::atomic_thread_fence(std::MemoryOrder::Release);
 
-    m_queue->m_driver_index = (m_queue->m_driver_index + 1) % m_queue->m_size;
+    m_queue->m_driver_index++;
     m_queue->m_driver->index = m_queue->m_driver_index;
 
     this->reset();
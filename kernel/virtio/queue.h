@@ -4,7 +4,7 @@
 
 #include <std/memory.h>
 #include <std/optional.h>
-#include <std/stack.h>
+#include <std/vector.h>
 
 namespace kernel::virtio {
 
@@ -12,11 +12,18 @@ class Queue {
 public:
     class Chain {
     public:
-        Chain(Queue* queue) : m_queue(queue) {};
-        Chain(Queue* queue, u16 start, u16 end, size_t length) : m_queue(queue), m_start(start), m_end(end), m_length(length) {};
+        Chain(Queue* queue, bool indirect = false) : m_queue(queue), m_indirect(indirect) {};
+        Chain(Queue* queue, u16 start, u16 end, size_t length, size_t written = 0)
+            : m_queue(queue), m_start(start), m_end(end), m_length(length), m_written(written) {};
 
         size_t length() const { return m_length; }
 
+        // Index of the first descriptor, identifies the chain until it's released
+        u16 start() const { return m_start.value_or(0); }
+
+        // How many bytes the device wrote into the writable buffers of a used chain
+        size_t written() const { return m_written; }
+
         void reset();
 
         void add_buffer(PhysicalAddress address, size_t length, bool writable = false);
@@ -30,14 +37,23 @@ public:
                 return;
             }
 
+            auto* descriptors = m_queue->m_descriptors;
             u16 index = m_start.value();
-            for (size_t i = 0; i < m_length; i++) {
-                auto& descriptor = m_queue->m_descriptors[index];
+            size_t length = m_length;
+
+            // An indirect chain takes up a single descriptor in the ring that points at the actual ones
+            if (descriptors[index].flags & QueueDescriptor::Indirect) {
+                length = descriptors[index].length / sizeof(QueueDescriptor);
+                descriptors = m_queue->indirect_table(index);
+                index = 0;
+            }
+
+            for (size_t i = 0; i < length; i++) {
+                auto& descriptor = descriptors[index];
                 callback(descriptor.address, descriptor.length);
 
                 index = descriptor.next;
             }
-
         }
 
     private:
@@ -46,10 +62,19 @@ public:
         Optional<u16> m_start = {};
         u16 m_end = 0;
         size_t m_length = 0;
+        size_t m_written = 0;
+
+        // Buffers go into the indirect table of the first descriptor instead of the ring
+        bool m_indirect = false;
+        size_t m_indirect_count = 0;
     };
 
-    static OwnPtr<Queue> create(u16 size, u16 notify_offset);
+    // Most buffers a single indirect chain can be made of, its table takes up a page
+    static constexpr size_t MAX_INDIRECT_DESCRIPTORS = PAGE_SIZE / sizeof(QueueDescriptor);
 
+    static OwnPtr<Queue> create(u16 index, u16 size, u16 notify_offset);
+
+    u16 index() const { return m_index; }
     u16 size() const { return m_size; }
     u16 notify_offset() const { return m_notify_offset; }
 
@@ -57,8 +82,25 @@ public:
     void drain();
 
     u16 find_free_descriptor();
+    size_t free_descriptors() const { return m_num_free; }
+
+    // Whether the device asked to be notified about the chains submitted since the last call
+    bool should_notify();
 
-    Chain create_chain() { return Chain(this); }
+    // Asks the device to (not) interrupt us when it's done with a chain. Only a hint, the device may interrupt anyway.
+    void set_interrupts_enabled(bool);
+
+    // Set once VIRTIO_RING_F_EVENT_IDX is negotiated. Notifications and interrupts are then suppressed by telling the
+    // other side which ring index we want to hear about next, rather than through the flags.
+    void set_event_index_enabled(bool enabled) { m_event_index = enabled; }
+
+    // Set once VIRTIO_RING_F_INDIRECT_DESC is negotiated
+    void set_indirect_enabled(bool enabled) { m_indirect = enabled; }
+    bool has_indirect_descriptors() const { return m_indirect; }
+
+    // Chains of more than a couple of buffers should be indirect whenever possible, they only use up one descriptor
+    // of the ring no matter how long they are
+    Chain create_chain(bool indirect = false) { return Chain(this, indirect && m_indirect); }
     void reclaim(u16 start, u16 end, size_t length);
 
     Chain dequeue();
@@ -70,15 +112,34 @@ public:
     PhysicalAddress get_physical_address(void* ptr);
 
 private:
-    Queue(u16 size, u16 notify_offset);
+    Queue(u16 index, u16 size, u16 notify_offset);
+
+    // The table of indirect descriptors used by the chain starting at `head`, allocated on first use
+    QueueDescriptor* indirect_table(u16 head);
 
+    volatile u16& used_event() { return *const_cast<volatile u16*>(&m_driver->ring[m_size]); }
+    volatile u16& avail_event() { return *reinterpret_cast<volatile u16*>(&m_device->ring[m_size]); }
+
+    u16 m_index;
     u16 m_size;
     u16 m_notify_offset;
 
-    u16 m_driver_index;
-    u16 m_used_index;
+    // Both run freely and wrap around at 2^16 like the indices in the rings themselves
+    u16 m_driver_index = 0;
+    u16 m_used_index = 0;
+
+    // Free descriptors are linked through their `next` field, so that releasing a chain never allocates
+    u16 m_free_head = 0;
+    size_t m_num_free = 0;
+
+    bool m_event_index = false;
+    bool m_indirect = false;
+    bool m_interrupts_enabled = true;
+
+    // The driver index as of the last `should_notify`
+    u16 m_notified_index = 0;
 
-    std::Stack<u16> m_free_descriptors;
+    Vector<QueueDescriptor*> m_indirect_tables;
 
     u8* m_buffer;
 
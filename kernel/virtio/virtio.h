@@ -4,7 +4,9 @@
 
 namespace kernel::virtio {
 
-#define VIRTIO_F_VERSION_1 ((u64)1 << 32)
+#define VIRTIO_RING_F_INDIRECT_DESC ((u64)1 << 28)
+#define VIRTIO_RING_F_EVENT_IDX     ((u64)1 << 29)
+#define VIRTIO_F_VERSION_1          ((u64)1 << 32)
 
 enum class DeviceType : u8 {
     Reserved = 0,
@@ -61,9 +63,13 @@ struct QueueDescriptor {
 } PACKED;
 
 struct QueueDriver {
+    enum {
+        NoInterrupt = 0x1,
+    };
+
     u16 flags;
     u16 index;
-    u16 ring[];
+    u16 ring[]; // Followed by `used_event` if VIRTIO_RING_F_EVENT_IDX was negotiated
 } PACKED;
 
 struct QueueDeviceElement {
@@ -72,9 +78,13 @@ struct QueueDeviceElement {
 } PACKED;
 
 struct QueueDevice {
+    enum {
+        NoNotify = 0x1,
+    };
+
     u16 flags;
     u16 index;
-    QueueDeviceElement ring[];
+    QueueDeviceElement ring[]; // Followed by `avail_event` if VIRTIO_RING_F_EVENT_IDX was negotiated
 } PACKED;
 
 enum CommonConfig {
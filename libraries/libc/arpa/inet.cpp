@@ -0,0 +1,34 @@
+#include <arpa/inet.h>
+
+extern "C" {
+
+in_addr_t inet_addr(const char* cp) {
+    uint32_t address = 0;
+    for (int i = 0; i < 4; i++) {
+        if (*cp < '0' || *cp > '9') {
+            return INADDR_BROADCAST;
+        }
+
+        uint32_t octet = 0;
+        while (*cp >= '0' && *cp <= '9') {
+            octet = octet * 10 + (*cp++ - '0');
+            if (octet > 255) {
+                return INADDR_BROADCAST;
+            }
+        }
+
+        if (i < 3 && *cp++ != '.') {
+            return INADDR_BROADCAST;
+        }
+
+        address = (address << 8) | octet;
+    }
+
+    if (*cp) {
+        return INADDR_BROADCAST;
+    }
+
+    return htonl(address);
+}
+
+}
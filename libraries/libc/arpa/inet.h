@@ -0,0 +1,18 @@
+#pragma once
+
+#include <sys/cdefs.h>
+#include <netinet/in.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+static inline uint16_t htons(uint16_t value) { return __builtin_bswap16(value); }
+static inline uint32_t htonl(uint32_t value) { return __builtin_bswap32(value); }
+
+static inline uint16_t ntohs(uint16_t value) { return __builtin_bswap16(value); }
+static inline uint32_t ntohl(uint32_t value) { return __builtin_bswap32(value); }
+
+// Parses a dotted-decimal IPv4 address, returns INADDR_BROADCAST (-1) if the string is malformed
+in_addr_t inet_addr(const char* cp);
+
+__END_DECLS
@@ -0,0 +1,12 @@
+#include <poll.h>
+#include <sys/syscall.hpp>
+#include <errno.h>
+
+extern "C" {
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout) {
+    int ret = syscall(SYS_poll, fds, nfds, timeout);
+    __set_errno_return(ret, ret, -1);
+}
+
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <sys/cdefs.h>
+#include <kernel/posix/poll.h>
+
+__BEGIN_DECLS
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout);
+
+__END_DECLS
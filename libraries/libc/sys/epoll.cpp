@@ -0,0 +1,22 @@
+#include <sys/epoll.h>
+#include <sys/syscall.hpp>
+#include <errno.h>
+
+extern "C" {
+
+int epoll_create(int flags) {
+    int ret = syscall(SYS_epoll_create, flags);
+    __set_errno_return(ret, ret, -1);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    int ret = syscall(SYS_epoll_ctl, epfd, op, fd, event);
+    __set_errno_return(ret, 0, -1);
+}
+
+int epoll_wait(int epfd, struct epoll_event* events, int max_events, int timeout) {
+    int ret = syscall(SYS_epoll_wait, epfd, events, max_events, timeout);
+    __set_errno_return(ret, ret, -1);
+}
+
+}
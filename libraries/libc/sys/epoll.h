@@ -0,0 +1,12 @@
+#pragma once
+
+#include <sys/cdefs.h>
+#include <kernel/posix/sys/epoll.h>
+
+__BEGIN_DECLS
+
+int epoll_create(int flags);
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event);
+int epoll_wait(int epfd, struct epoll_event* events, int max_events, int timeout);
+
+__END_DECLS
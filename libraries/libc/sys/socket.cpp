@@ -0,0 +1,54 @@
+#include <sys/socket.h>
+#include <sys/syscall.hpp>
+#include <errno.h>
+
+extern "C" {
+
+int socket(int domain, int type, int protocol) {
+    int ret = syscall(SYS_socket, domain, type, protocol);
+    __set_errno_return(ret, ret, -1);
+}
+
+int bind(int fd, const struct sockaddr* addr, socklen_t addrlen) {
+    int ret = syscall(SYS_bind, fd, addr, addrlen);
+    __set_errno_return(ret, 0, -1);
+}
+
+int connect(int fd, const struct sockaddr* addr, socklen_t addrlen) {
+    int ret = syscall(SYS_connect, fd, addr, addrlen);
+    __set_errno_return(ret, 0, -1);
+}
+
+int listen(int fd, int backlog) {
+    int ret = syscall(SYS_listen, fd, backlog);
+    __set_errno_return(ret, 0, -1);
+}
+
+int accept(int fd, struct sockaddr* addr, socklen_t* addrlen) {
+    int ret = syscall(SYS_accept, fd, addr, addrlen);
+    __set_errno_return(ret, ret, -1);
+}
+
+ssize_t send(int fd, const void* buffer, size_t length, int flags) {
+    return sendto(fd, buffer, length, flags, nullptr, 0);
+}
+
+ssize_t sendto(int fd, const void* buffer, size_t length, int flags, const struct sockaddr* addr, socklen_t addrlen) {
+    sendto_args args = { fd, buffer, length, flags, addr, addrlen };
+    ssize_t ret = syscall(SYS_sendto, &args);
+
+    __set_errno_return(ret, ret, -1);
+}
+
+ssize_t recv(int fd, void* buffer, size_t length, int flags) {
+    return recvfrom(fd, buffer, length, flags, nullptr, nullptr);
+}
+
+ssize_t recvfrom(int fd, void* buffer, size_t length, int flags, struct sockaddr* addr, socklen_t* addrlen) {
+    recvfrom_args args = { fd, buffer, length, flags, addr, addrlen };
+    ssize_t ret = syscall(SYS_recvfrom, &args);
+
+    __set_errno_return(ret, ret, -1);
+}
+
+}
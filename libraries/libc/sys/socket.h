@@ -0,0 +1,22 @@
+#pragma once
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <kernel/posix/sys/socket.h>
+
+__BEGIN_DECLS
+
+int socket(int domain, int type, int protocol);
+int bind(int fd, const struct sockaddr* addr, socklen_t addrlen);
+int connect(int fd, const struct sockaddr* addr, socklen_t addrlen);
+
+int listen(int fd, int backlog);
+int accept(int fd, struct sockaddr* addr, socklen_t* addrlen);
+
+ssize_t send(int fd, const void* buffer, size_t length, int flags);
+ssize_t sendto(int fd, const void* buffer, size_t length, int flags, const struct sockaddr* addr, socklen_t addrlen);
+
+ssize_t recv(int fd, void* buffer, size_t length, int flags);
+ssize_t recvfrom(int fd, void* buffer, size_t length, int flags, struct sockaddr* addr, socklen_t* addrlen);
+
+__END_DECLS
@@ -0,0 +1,17 @@
+#include <sys/uio.h>
+#include <sys/syscall.hpp>
+#include <errno.h>
+
+extern "C" {
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+    ssize_t n = syscall(SYS_readv, fd, iov, iovcnt);
+    __set_errno_return(n, n, -1);
+}
+
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+    ssize_t n = syscall(SYS_writev, fd, iov, iovcnt);
+    __set_errno_return(n, n, -1);
+}
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <kernel/posix/sys/uio.h>
+
+__BEGIN_DECLS
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+
+__END_DECLS
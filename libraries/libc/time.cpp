@@ -2,13 +2,70 @@
 #include <errno.h>
 #include <sys/syscall.hpp>
 
+#include <kernel/time/time_page.h>
+
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+    return ((uint64_t)high << 32) | low;
+}
+
+// Computes the time from the kernel's shared time page, returns false if the kernel doesn't provide a usable clock source.
+static bool time_page_gettime(clockid_t clock_id, struct timespec* ts) {
+    auto* page = reinterpret_cast<const volatile time_page*>(TIME_PAGE_ADDRESS);
+
+    uint32_t sequence;
+    uint64_t ns;
+
+    do {
+        sequence = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+        if (page->clock_source != TIME_PAGE_CLOCK_TSC) {
+            return false;
+        }
+
+        uint64_t base = clock_id == CLOCK_REALTIME ? page->realtime_ns : page->monotonic_ns;
+        uint64_t tsc = rdtsc();
+        uint64_t tsc_base = page->tsc_base;
+
+        ns = base;
+        if (tsc > tsc_base) {
+            ns += ((tsc - tsc_base) * page->tsc_mult) >> page->tsc_shift;
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) || sequence != __atomic_load_n(&page->sequence, __ATOMIC_RELAXED));
+
+    ts->tv_sec = ns / 1'000'000'000;
+    ts->tv_nsec = ns % 1'000'000'000;
+
+    return true;
+}
+
 extern "C" {
 
 int clock_gettime(clockid_t clock_id, struct timespec* ts) {
+    if ((clock_id == CLOCK_REALTIME || clock_id == CLOCK_MONOTONIC) && time_page_gettime(clock_id, ts)) {
+        return 0;
+    }
+
     int ret = syscall(SYS_clock_gettime, clock_id, ts);
     __set_errno_return(ret, 0, -1);
 }
 
+time_t time(time_t* tloc) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
+        return -1;
+    }
+
+    if (tloc) {
+        *tloc = ts.tv_sec;
+    }
+
+    return ts.tv_sec;
+}
+
 int clock_nanosleep(clockid_t clock_id, int flags, const struct timespec* req, struct timespec* rem) {
     int ret = syscall(SYS_clock_nanosleep, clock_id, flags, req, rem);
     __set_errno_return(ret, 0, -1);
@@ -6,6 +6,7 @@
 __BEGIN_DECLS
 
 int clock_gettime(clockid_t clock_id, struct timespec* ts);
+time_t time(time_t* tloc);
 int clock_nanosleep(clockid_t clock_id, int flags, const struct timespec* req, struct timespec* rem);
 
 int nanosleep(const struct timespec* req, struct timespec* rem);
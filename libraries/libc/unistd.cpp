@@ -36,6 +36,16 @@ off_t lseek(int fd, off_t offset, int whence) {
     __set_errno_return(ret, ret, -1);
 }
 
+ssize_t pread(int fd, void* buffer, size_t count, off_t offset) {
+    ssize_t n = syscall(SYS_pread, fd, buffer, count, offset);
+    __set_errno_return(n, n, -1);
+}
+
+ssize_t pwrite(int fd, const void* buffer, size_t count, off_t offset) {
+    ssize_t n = syscall(SYS_pwrite, fd, buffer, count, offset);
+    __set_errno_return(n, n, -1);
+}
+
 pid_t getpid(void) {
     return syscall(SYS_getpid);
 }
@@ -22,6 +22,9 @@ ssize_t read(int fd, void* buffer, size_t count);
 ssize_t write(int fd, const void* buffer, size_t count);
 off_t lseek(int fd, off_t offset, int whence);
 
+ssize_t pread(int fd, void* buffer, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void* buffer, size_t count, off_t offset);
+
 pid_t getpid(void);
 pid_t getppid(void);
 pid_t gettid(void);
@@ -1,7 +1,9 @@
 #include <libgfx/framebuffer.h>
+#include <libgfx/raster.h>
 #include <std/kmalloc.h>
 #include <stdlib.h>
 #include <string.h>
+#include <std/utility.h>
 
 namespace gfx {
 
@@ -15,7 +17,7 @@ void FrameBuffer::set_pixel(u32 x, u32 y, u32 color) {
         return;
     }
 
-    m_buffer[y * m_width + x] = color;
+    this->scanline(y)[x] = color;
 }
 
 u32 FrameBuffer::get_pixel(u32 x, u32 y) const {
@@ -23,11 +25,87 @@ u32 FrameBuffer::get_pixel(u32 x, u32 y) const {
         return 0;
     }
 
-    return m_buffer[y * m_width + x];
+    return this->scanline(y)[x];
 }
 
 void FrameBuffer::clear(u32 color) {
-    memset(m_buffer, color, this->size());
+    raster::fill(m_buffer, m_pitch, m_width, m_height, color);
+}
+
+// Clips the rectangle to the framebuffer, returns false if nothing is left of it
+static bool clip(i32& x, i32& y, i32& width, i32& height, u32 max_width, u32 max_height) {
+    i32 right = std::min<i64>(static_cast<i64>(x) + width, max_width);
+    i32 bottom = std::min<i64>(static_cast<i64>(y) + height, max_height);
+
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+
+    width = right - x;
+    height = bottom - y;
+
+    return width > 0 && height > 0;
+}
+
+void FrameBuffer::fill_rect(i32 x, i32 y, i32 width, i32 height, u32 color) {
+    if (!clip(x, y, width, height, m_width, m_height)) {
+        return;
+    }
+
+    raster::fill(this->scanline(y) + x, m_pitch, width, height, color);
+}
+
+void FrameBuffer::move_rect(i32 x, i32 y, i32 width, i32 height, i32 dst_x, i32 dst_y) {
+    i32 dx = dst_x - x;
+    i32 dy = dst_y - y;
+
+    // Both the source and the destination have to be within the framebuffer
+    if (!clip(x, y, width, height, m_width, m_height)) {
+        return;
+    }
+
+    dst_x = x + dx;
+    dst_y = y + dy;
+
+    if (!clip(dst_x, dst_y, width, height, m_width, m_height)) {
+        return;
+    }
+
+    x = dst_x - dx;
+    y = dst_y - dy;
+
+    raster::copy(this->scanline(dst_y) + dst_x, m_pitch, this->scanline(y) + x, m_pitch, width, height);
+}
+
+void FrameBuffer::blit(i32 x, i32 y, const u32* src, i32 width, i32 height, size_t src_pitch, bool blend) {
+    i32 left = x, top = y;
+    if (!clip(x, y, width, height, m_width, m_height)) {
+        return;
+    }
+
+    src = reinterpret_cast<const u32*>(reinterpret_cast<const u8*>(src) + (y - top) * src_pitch) + (x - left);
+    if (blend) {
+        raster::blend(this->scanline(y) + x, m_pitch, src, src_pitch, width, height);
+    } else {
+        raster::copy(this->scanline(y) + x, m_pitch, src, src_pitch, width, height);
+    }
+}
+
+void FrameBuffer::draw_glyph(i32 x, i32 y, const u8* glyph, i32 width, i32 height, u32 fg, u32 bg) {
+    if (x >= 0 && y >= 0 && x + width <= static_cast<i32>(m_width) && y + height <= static_cast<i32>(m_height)) {
+        raster::draw_glyph(this->scanline(y) + x, m_pitch, glyph, width, height, fg, bg);
+        return;
+    }
+
+    // Glyphs hanging off the edge are rare enough to not bother shifting bits around for them
+    size_t stride = (width + 7) / 8;
+    for (i32 dy = 0; dy < height; dy++) {
+        for (i32 dx = 0; dx < width; dx++) {
+            bool set = glyph[dy * stride + dx / 8] & (0x80 >> (dx % 8));
+            if (x + dx >= 0 && y + dy >= 0) {
+                this->set_pixel(x + dx, y + dy, set ? fg : bg);
+            }
+        }
+    }
 }
 
 }
\ No newline at end of file
@@ -30,10 +30,25 @@ public:
     u32* buffer() { return m_buffer; }
     const u32* buffer() const { return m_buffer; }
     
+    u32* scanline(u32 y) { return reinterpret_cast<u32*>(reinterpret_cast<u8*>(m_buffer) + y * m_pitch); }
+    const u32* scanline(u32 y) const { return reinterpret_cast<const u32*>(reinterpret_cast<const u8*>(m_buffer) + y * m_pitch); }
+
     void set_pixel(u32 x, u32 y, u32 color);
     u32 get_pixel(u32 x, u32 y) const;
 
     void clear(u32 color);
+
+    // Everything below is clipped to the framebuffer
+    void fill_rect(i32 x, i32 y, i32 width, i32 height, u32 color);
+
+    // Moves a region within the framebuffer to (`dst_x`, `dst_y`), the two may overlap
+    void move_rect(i32 x, i32 y, i32 width, i32 height, i32 dst_x, i32 dst_y);
+
+    // Copies (or blends, using the alpha channel of `src`) `width` x `height` pixels of `src` to (`x`, `y`)
+    void blit(i32 x, i32 y, const u32* src, i32 width, i32 height, size_t src_pitch, bool blend = false);
+
+    // A 1 bpp glyph as fonts store them, most significant bit first and every row padded to a whole byte
+    void draw_glyph(i32 x, i32 y, const u8* glyph, i32 width, i32 height, u32 fg, u32 bg);
     
 private:
     u32* m_buffer;
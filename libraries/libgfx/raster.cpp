@@ -0,0 +1,363 @@
+#include <libgfx/raster.h>
+
+#include <string.h>
+#include <cpuid.h>
+#include <immintrin.h>
+
+namespace gfx::raster {
+
+// Everything operates on single rows, the loops over rows are shared by all backends
+struct Kernels {
+    Backend backend;
+
+    void (*fill_row)(u32* dst, size_t width, u32 color);
+    void (*copy_row)(u32* dst, u32 const* src, size_t width);
+    void (*blend_row)(u32* dst, u32 const* src, size_t width);
+    void (*glyph_row)(u32* dst, u8 const* bits, size_t width, u32 fg, u32 bg);
+};
+
+static u32* row(u32* base, size_t pitch, size_t y) {
+    return reinterpret_cast<u32*>(reinterpret_cast<u8*>(base) + y * pitch);
+}
+
+static u32 const* row(u32 const* base, size_t pitch, size_t y) {
+    return reinterpret_cast<u32 const*>(reinterpret_cast<u8 const*>(base) + y * pitch);
+}
+
+// Blends two channels at once (bits 0-7 and 16-23), dividing by 255 with the usual (x + (x >> 8)) >> 8 trick
+static u32 mix_channels(u32 src, u32 dst, u32 alpha) {
+    u32 x = src * alpha + dst * (255 - alpha) + 0x00800080;
+    return ((x + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+}
+
+static u32 blend_pixel(u32 dst, u32 src) {
+    u32 alpha = src >> 24;
+    if (alpha == 0xFF) {
+        return src;
+    } else if (!alpha) {
+        return dst;
+    }
+
+    // The source alpha counts as opaque for the alpha channel itself, which leaves a + da * (1 - a) in there
+    u32 rb = mix_channels(src & 0x00FF00FF, dst & 0x00FF00FF, alpha);
+    u32 ag = mix_channels(((src >> 8) & 0x00FF00FF) | 0x00FF0000, (dst >> 8) & 0x00FF00FF, alpha);
+
+    return rb | (ag << 8);
+}
+
+static void fill_row_scalar(u32* dst, size_t width, u32 color) {
+    for (size_t i = 0; i < width; i++) {
+        dst[i] = color;
+    }
+}
+
+static void copy_row_scalar(u32* dst, u32 const* src, size_t width) {
+    memcpy(dst, src, width * sizeof(u32));
+}
+
+static void blend_row_scalar(u32* dst, u32 const* src, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        dst[i] = blend_pixel(dst[i], src[i]);
+    }
+}
+
+static void glyph_row_scalar(u32* dst, u8 const* bits, size_t width, u32 fg, u32 bg) {
+    for (size_t i = 0; i < width; i++) {
+        dst[i] = (bits[i / 8] & (0x80 >> (i % 8))) ? fg : bg;
+    }
+}
+
+__attribute__((target("sse2")))
+static void fill_row_sse2(u32* dst, size_t width, u32 color) {
+    __m128i value = _mm_set1_epi32(color);
+
+    size_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), value);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), value);
+    }
+
+    for (; i + 4 <= width; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+
+    fill_row_scalar(dst + i, width - i, color);
+}
+
+__attribute__((target("sse2")))
+static void copy_row_sse2(u32* dst, u32 const* src, size_t width) {
+    size_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+
+    copy_row_scalar(dst + i, src + i, width - i);
+}
+
+// Blends the two pixels in the low or high half of `src` and `dst` after they've been widened to 16 bits per channel
+__attribute__((target("sse2")))
+static __m128i blend_half_sse2(__m128i src, __m128i dst, __m128i alpha) {
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverse));
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("sse2")))
+static __m128i broadcast_alpha_sse2(__m128i pixels) {
+    pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("sse2")))
+static void blend_row_sse2(u32* dst, u32 const* src, size_t width) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+
+    size_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+        // Text and UI elements are mostly made up of fully opaque and fully transparent runs
+        int opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask));
+        int transparent = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), zero));
+
+        if (opaque == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        } else if (transparent == 0xFFFF) {
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + i));
+        __m128i so = _mm_or_si128(s, alpha_mask);
+
+        __m128i alpha_low = broadcast_alpha_sse2(_mm_unpacklo_epi8(s, zero));
+        __m128i alpha_high = broadcast_alpha_sse2(_mm_unpackhi_epi8(s, zero));
+
+        __m128i low = blend_half_sse2(_mm_unpacklo_epi8(so, zero), _mm_unpacklo_epi8(d, zero), alpha_low);
+        __m128i high = blend_half_sse2(_mm_unpackhi_epi8(so, zero), _mm_unpackhi_epi8(d, zero), alpha_high);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+
+    blend_row_scalar(dst + i, src + i, width - i);
+}
+
+__attribute__((target("sse2")))
+static void glyph_row_sse2(u32* dst, u8 const* bits, size_t width, u32 fg, u32 bg) {
+    // Every lane tests one bit of the glyph byte, the resulting mask picks between the two colors
+    __m128i background = _mm_set1_epi32(bg);
+    __m128i difference = _mm_set1_epi32(fg ^ bg);
+
+    __m128i high_bits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+    __m128i low_bits = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m128i byte = _mm_set1_epi32(bits[i / 8]);
+
+        __m128i high = _mm_cmpeq_epi32(_mm_and_si128(byte, high_bits), high_bits);
+        __m128i low = _mm_cmpeq_epi32(_mm_and_si128(byte, low_bits), low_bits);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(background, _mm_and_si128(difference, high)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_xor_si128(background, _mm_and_si128(difference, low)));
+    }
+
+    glyph_row_scalar(dst + i, bits + i / 8, width - i, fg, bg);
+}
+
+__attribute__((target("avx2")))
+static void fill_row_avx2(u32* dst, size_t width, u32 color) {
+    __m256i value = _mm256_set1_epi32(color);
+
+    size_t i = 0;
+    for (; i + 32 <= width; i += 32) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), value);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), value);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 24), value);
+    }
+
+    for (; i + 8 <= width; i += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+
+    fill_row_scalar(dst + i, width - i, color);
+}
+
+__attribute__((target("avx2")))
+static void copy_row_avx2(u32* dst, u32 const* src, size_t width) {
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+
+    copy_row_scalar(dst + i, src + i, width - i);
+}
+
+__attribute__((target("avx2")))
+static __m256i blend_half_avx2(__m256i src, __m256i dst, __m256i alpha) {
+    __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(src, alpha), _mm256_mullo_epi16(dst, inverse));
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static __m256i broadcast_alpha_avx2(__m256i pixels) {
+    pixels = _mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__attribute__((target("avx2")))
+static void blend_row_avx2(u32* dst, u32 const* src, size_t width) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+
+    // Unpacking and packing both work within 128-bit lanes, so the pixels come back out in the order they went in
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+
+        u32 opaque = _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), alpha_mask));
+        u32 transparent = _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), zero));
+
+        if (opaque == 0xFFFFFFFF) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        } else if (transparent == 0xFFFFFFFF) {
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+        __m256i so = _mm256_or_si256(s, alpha_mask);
+
+        __m256i alpha_low = broadcast_alpha_avx2(_mm256_unpacklo_epi8(s, zero));
+        __m256i alpha_high = broadcast_alpha_avx2(_mm256_unpackhi_epi8(s, zero));
+
+        __m256i low = blend_half_avx2(_mm256_unpacklo_epi8(so, zero), _mm256_unpacklo_epi8(d, zero), alpha_low);
+        __m256i high = blend_half_avx2(_mm256_unpackhi_epi8(so, zero), _mm256_unpackhi_epi8(d, zero), alpha_high);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(low, high));
+    }
+
+    blend_row_sse2(dst + i, src + i, width - i);
+}
+
+__attribute__((target("avx2")))
+static void glyph_row_avx2(u32* dst, u8 const* bits, size_t width, u32 fg, u32 bg) {
+    __m256i background = _mm256_set1_epi32(bg);
+    __m256i difference = _mm256_set1_epi32(fg ^ bg);
+    __m256i masks = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+    // A whole glyph byte per store, which is a whole row for 8 pixel wide fonts
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i byte = _mm256_set1_epi32(bits[i / 8]);
+        __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(byte, masks), masks);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(background, _mm256_and_si256(difference, set)));
+    }
+
+    glyph_row_scalar(dst + i, bits + i / 8, width - i, fg, bg);
+}
+
+static Backend detect_backend() {
+    u32 eax, ebx, ecx, edx;
+
+    // The same leaf the kernel builds `Processor::features()` from
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return Backend::Scalar;
+    }
+
+    bool sse2 = edx & bit_SSE2;
+    bool avx = (ecx & bit_AVX) && (ecx & bit_OSXSAVE);
+
+    // The AVX registers are only usable if the kernel enabled them in XCR0 (and therefore saves them on context switches)
+    if (avx) {
+        u32 xcr0_low, xcr0_high;
+        asm volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+
+        bool enabled = (xcr0_low & 0x6) == 0x6; // SSE and AVX state
+        if (enabled && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2)) {
+            return Backend::AVX2;
+        }
+    }
+
+    return sse2 ? Backend::SSE2 : Backend::Scalar;
+}
+
+static Kernels select_kernels() {
+    switch (detect_backend()) {
+        case Backend::AVX2:
+            return { Backend::AVX2, fill_row_avx2, copy_row_avx2, blend_row_avx2, glyph_row_avx2 };
+        case Backend::SSE2:
+            return { Backend::SSE2, fill_row_sse2, copy_row_sse2, blend_row_sse2, glyph_row_sse2 };
+        case Backend::Scalar:
+            break;
+    }
+
+    return { Backend::Scalar, fill_row_scalar, copy_row_scalar, blend_row_scalar, glyph_row_scalar };
+}
+
+static Kernels const& kernels() {
+    static Kernels kernels = select_kernels();
+    return kernels;
+}
+
+Backend backend() {
+    return kernels().backend;
+}
+
+void fill(u32* dst, size_t pitch, size_t width, size_t height, u32 color) {
+    auto& k = kernels();
+    for (size_t y = 0; y < height; y++) {
+        k.fill_row(row(dst, pitch, y), width, color);
+    }
+}
+
+void copy(u32* dst, size_t dst_pitch, u32 const* src, size_t src_pitch, size_t width, size_t height) {
+    auto& k = kernels();
+
+    // Going bottom up when the destination is below the source makes sure no row is overwritten before it's read
+    bool backwards = dst > src;
+    for (size_t i = 0; i < height; i++) {
+        size_t y = backwards ? height - i - 1 : i;
+
+        u32* d = row(dst, dst_pitch, y);
+        u32 const* s = row(src, src_pitch, y);
+
+        if (d < s + width && s < d + width) {
+            memmove(d, s, width * sizeof(u32));
+        } else {
+            k.copy_row(d, s, width);
+        }
+    }
+}
+
+void blend(u32* dst, size_t dst_pitch, u32 const* src, size_t src_pitch, size_t width, size_t height) {
+    auto& k = kernels();
+    for (size_t y = 0; y < height; y++) {
+        k.blend_row(row(dst, dst_pitch, y), row(src, src_pitch, y), width);
+    }
+}
+
+void draw_glyph(u32* dst, size_t pitch, u8 const* glyph, size_t width, size_t height, u32 fg, u32 bg) {
+    auto& k = kernels();
+
+    size_t stride = (width + 7) / 8;
+    for (size_t y = 0; y < height; y++) {
+        k.glyph_row(row(dst, pitch, y), glyph + y * stride, width, fg, bg);
+    }
+}
+
+}
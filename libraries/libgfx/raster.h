@@ -0,0 +1,28 @@
+#pragma once
+
+#include <std/types.h>
+
+// Raw pixel loops over 32-bit XRGB/ARGB buffers. Every pitch is in bytes and nothing is clipped, that's up to the
+// caller (see `FrameBuffer`). The fastest implementation the CPU supports is picked the first time any of these is used.
+namespace gfx::raster {
+
+enum class Backend {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+Backend backend();
+
+void fill(u32* dst, size_t pitch, size_t width, size_t height, u32 color);
+
+// The regions may overlap, e.g. when scrolling within the same buffer
+void copy(u32* dst, size_t dst_pitch, u32 const* src, size_t src_pitch, size_t width, size_t height);
+
+// Draws `src` over `dst` using the alpha channel (the top byte) of `src`
+void blend(u32* dst, size_t dst_pitch, u32 const* src, size_t src_pitch, size_t width, size_t height);
+
+// Expands a 1 bpp glyph, most significant bit first with every row padded to a whole byte, into `fg` and `bg` pixels
+void draw_glyph(u32* dst, size_t pitch, u8 const* glyph, size_t width, size_t height, u32 fg, u32 bg);
+
+}
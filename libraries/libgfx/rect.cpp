@@ -21,12 +21,7 @@ void Rect::draw(RenderContext& context, u32 color, bool fill) const {
         return;
     }
 
-    auto& framebuffer = context.framebuffer();
-    for (int y = top(); y < bottom(); y++) {
-        for (int x = left(); x < right(); x++) {
-            framebuffer.set_pixel(x, y, color);
-        }
-    }
+    context.framebuffer().fill_rect(x(), y(), width(), height(), color);
 }
 
 }
\ No newline at end of file
@@ -13,6 +13,10 @@ enum class MemoryOrder {
     SeqCst   = __ATOMIC_SEQ_CST
 };
 
+inline void atomic_thread_fence(MemoryOrder order) {
+    __atomic_thread_fence(to_underlying(order));
+}
+
 template<typename T>
 class Atomic {
 public:
@@ -2,7 +2,7 @@
 #include <std/cstring.h>
 
 #ifdef __KERNEL__
-    #include <kernel/serial.h>
+    #include <kernel/log.h>
     #include <kernel/process/scheduler.h>
     #include <kernel/process/threads.h>
     #include <kernel/process/process.h>
@@ -143,7 +143,7 @@ void _dbg_impl(const char* fmt, FormatParameters& params, bool newline) {
     StringView value = buffer.view();
 
 #ifdef __KERNEL__
-    kernel::serial::write(value.data(), value.size());
+    kernel::log::write(value.data(), value.size());
 #else
     write(1, value.data(), value.size());
 #endif
@@ -151,7 +151,7 @@ void _dbg_impl(const char* fmt, FormatParameters& params, bool newline) {
 
 void dbgln() {
 #ifdef __KERNEL__
-    kernel::serial::putc('\n');
+    kernel::log::write("\n", 1);
 #else
     write(1, "\n", 1);
 #endif
@@ -159,8 +159,8 @@ void dbgln() {
 
 void dbgln(StringView str) {
 #ifdef __KERNEL__
-    kernel::serial::write(str.data(), str.size());
-    kernel::serial::putc('\n');
+    kernel::log::write(str.data(), str.size());
+    kernel::log::write("\n", 1);
 #else
     write(1, str.data(), str.size());
     write(1, "\n", 1);
@@ -241,14 +241,14 @@ public:
             return *this;
         }
 
-        if (m_ptr) {
-            m_ptr->unref();
+        // Take the new reference first, `other` might only be kept alive by the object we're about to release
+        T* ptr = other.m_ptr;
+        if (ptr) {
+            ptr->ref();
         }
 
-        m_ptr = other.m_ptr;
-        if (m_ptr) {
-            m_ptr->ref();
-        }
+        release(m_ptr);
+        m_ptr = ptr;
         
         return *this;
     }
@@ -258,13 +258,12 @@ public:
             return *this;
         }
 
-        if (m_ptr) {
-            m_ptr->unref();
-        }
-
-        m_ptr = other.m_ptr;
+        T* ptr = other.m_ptr;
         other.m_ptr = nullptr;
 
+        release(m_ptr);
+        m_ptr = ptr;
+
         return *this;
     }
 
@@ -287,6 +286,15 @@ public:
     operator bool() const { return m_ptr; }
 
 private:
+    static void release(T* ptr) {
+        if (!ptr) return;
+
+        ptr->unref();
+        if (ptr->ref_count() == 0) {
+            delete ptr;
+        }
+    }
+
     T* m_ptr = nullptr;
 };
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <std/types.h>
+#include <std/cstring.h>
+#include <std/utility.h>
+
+namespace std {
+
+// A fixed capacity FIFO of bytes. Reads and writes are split into at most two memcpy calls around the wrap point.
+class RingBuffer {
+public:
+    struct Region {
+        u8 const* data;
+        size_t size;
+    };
+
+    RingBuffer() = default;
+    explicit RingBuffer(size_t capacity) : m_data(new u8[capacity]), m_capacity(capacity) {}
+
+    ~RingBuffer() { delete[] m_data; }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Replaces the storage of an empty buffer, for owners that only know whether they need it later on
+    void allocate(size_t capacity) {
+        delete[] m_data;
+
+        m_data = new u8[capacity];
+        m_capacity = capacity;
+
+        this->clear();
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t size() const { return m_size; }
+    size_t free_space() const { return m_capacity - m_size; }
+
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == m_capacity; }
+
+    // Appends as much of `data` as fits and returns how many bytes were written
+    size_t write(const void* data, size_t size) {
+        size = std::min(size, this->free_space());
+
+        size_t tail = (m_head + m_size) % m_capacity;
+        size_t first = std::min(size, m_capacity - tail);
+
+        memcpy(m_data + tail, data, first);
+        memcpy(m_data, reinterpret_cast<const u8*>(data) + first, size - first);
+
+        m_size += size;
+        return size;
+    }
+
+    // Copies up to `size` bytes starting `offset` bytes past the head without consuming them
+    size_t peek(void* data, size_t size, size_t offset = 0) const {
+        if (offset >= m_size) {
+            return 0;
+        }
+
+        size = std::min(size, m_size - offset);
+
+        size_t start = (m_head + offset) % m_capacity;
+        size_t first = std::min(size, m_capacity - start);
+
+        memcpy(data, m_data + start, first);
+        memcpy(reinterpret_cast<u8*>(data) + first, m_data, size - first);
+
+        return size;
+    }
+
+    // Like `peek` but points `regions` at the stored bytes instead of copying them. Returns how many regions were used.
+    size_t regions(Region (&regions)[2], size_t size, size_t offset = 0) const {
+        if (offset >= m_size || !size) {
+            return 0;
+        }
+
+        size = std::min(size, m_size - offset);
+
+        size_t start = (m_head + offset) % m_capacity;
+        size_t first = std::min(size, m_capacity - start);
+
+        regions[0] = { m_data + start, first };
+        if (first == size) {
+            return 1;
+        }
+
+        regions[1] = { m_data, size - first };
+        return 2;
+    }
+
+    size_t read(void* data, size_t size) {
+        size = this->peek(data, size);
+        this->discard(size);
+
+        return size;
+    }
+
+    void discard(size_t size) {
+        size = std::min(size, m_size);
+
+        m_head = (m_head + size) % m_capacity;
+        m_size -= size;
+    }
+
+    void clear() {
+        m_head = 0;
+        m_size = 0;
+    }
+
+private:
+    u8* m_data = nullptr;
+    size_t m_capacity = 0;
+
+    size_t m_head = 0;
+    size_t m_size = 0;
+};
+
+}
+
+using std::RingBuffer;
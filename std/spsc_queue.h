@@ -0,0 +1,61 @@
+#pragma once
+
+#include <std/types.h>
+#include <std/utility.h>
+#include <std/atomic.h>
+
+namespace std {
+
+// A bounded wait-free queue for exactly one producer and one consumer (e.g. an IRQ handler and a kernel thread).
+// Each side only ever writes its own index, so neither needs a lock nor has to disable interrupts.
+template<typename T, size_t N>
+class SPSCQueue {
+    static_assert(N && (N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+    SPSCQueue() = default;
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    static constexpr size_t capacity() { return N; }
+
+    size_t size() const { return m_head.load(MemoryOrder::Acquire) - m_tail.load(MemoryOrder::Acquire); }
+    bool empty() const { return this->size() == 0; }
+
+    // Producer side. Returns false (and leaves `value` alone) if the queue is full.
+    bool try_enqueue(T&& value) {
+        size_t head = m_head.load(MemoryOrder::Relaxed);
+        if (head - m_tail.load(MemoryOrder::Acquire) == N) {
+            return false;
+        }
+
+        m_slots[head & (N - 1)] = move(value);
+        m_head.store(head + 1, MemoryOrder::Release);
+
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool try_dequeue(T& value) {
+        size_t tail = m_tail.load(MemoryOrder::Relaxed);
+        if (tail == m_head.load(MemoryOrder::Acquire)) {
+            return false;
+        }
+
+        value = move(m_slots[tail & (N - 1)]);
+        m_tail.store(tail + 1, MemoryOrder::Release);
+
+        return true;
+    }
+
+private:
+    T m_slots[N];
+
+    Atomic<size_t> m_head { 0 }; // Only written by the producer
+    Atomic<size_t> m_tail { 0 }; // Only written by the consumer
+};
+
+}
+
+using std::SPSCQueue;
@@ -109,6 +109,14 @@ public:
         return m_nanoseconds;
     }
 
+    constexpr u64 to_nanoseconds() const {
+        return static_cast<u64>(m_seconds) * 1'000'000'000 + m_nanoseconds;
+    }
+
+    constexpr u64 to_microseconds() const {
+        return static_cast<u64>(m_seconds) * 1'000'000 + m_nanoseconds / 1'000;
+    }
+
 private:
     i64 m_seconds = 0;
     u32 m_nanoseconds = 0;
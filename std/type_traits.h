@@ -52,6 +52,15 @@ struct is_same<T, T> {
 template<typename T, typename U>
 inline constexpr bool is_same_v = is_same<T, U>::value;
 
+template<typename T> struct is_pointer : false_type {};
+template<typename T> struct is_pointer<T*> : true_type {};
+template<typename T> struct is_pointer<T* const> : true_type {};
+template<typename T> struct is_pointer<T* volatile> : true_type {};
+template<typename T> struct is_pointer<T* const volatile> : true_type {};
+
+template<typename T>
+inline constexpr bool is_pointer_v = is_pointer<T>::value;
+
 template<bool B, typename T = void>
 struct enable_if {};
  
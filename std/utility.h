@@ -67,6 +67,24 @@ constexpr T&& forward(std::remove_reference_t<T>&& value) {
     return static_cast<T&&>(value);
 }
 
+template<size_t... Indices>
+struct index_sequence {};
+
+namespace detail {
+
+template<size_t N, size_t... Indices>
+struct make_index_sequence : make_index_sequence<N - 1, N - 1, Indices...> {};
+
+template<size_t... Indices>
+struct make_index_sequence<0, Indices...> {
+    using type = index_sequence<Indices...>;
+};
+
+}
+
+template<size_t N>
+using make_index_sequence = typename detail::make_index_sequence<N>::type;
+
 template<typename T>
 void swap(T& a, T& b) {
     T temp = move(a);
@@ -2,16 +2,19 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <time.h>
 
 #include <std/format.h>
+#include <std/utility.h>
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        dbgln("Usage: {} <file>", argv[0]);
+        dbgln("Usage: {} <file> [sample rate]", argv[0]);
         return 1;
     }
 
@@ -21,13 +24,29 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    int sample_rate, channels;
+    if (argc > 2) {
+        int rate = atoi(argv[2]);
+        if (ioctl(fd, SOUNDCARD_SET_SAMPLE_RATE, rate) < 0) {
+            dbgln("Failed to set the sample rate to {}: {}", rate, strerror(errno));
+            return 1;
+        }
+    }
+
+    int sample_rate, channels, latency;
 
     ioctl(fd, SOUNDCARD_GET_SAMPLE_RATE, &sample_rate);
     ioctl(fd, SOUNDCARD_GET_CHANNELS, &channels);
+    ioctl(fd, SOUNDCARD_GET_LATENCY, &latency);
 
     dbgln("Sample rate: {}", sample_rate);
     dbgln("Channels: {}", channels);
+    dbgln("Latency: {}ms", latency);
+
+    soundcard_ring* ring = nullptr;
+    if (ioctl(fd, SOUNDCARD_MAP_RING, &ring) < 0) {
+        dbgln("Failed to map the ring: {}", strerror(errno));
+        return 1;
+    }
 
     int audio = open(argv[1], O_RDONLY);
     if (audio < 0) {
@@ -41,7 +60,45 @@ int main(int argc, char** argv) {
     char* buffer = new char[st.st_size];
     read(audio, buffer, st.st_size);
 
-    write(fd, buffer, st.st_size);
+    auto* frames = reinterpret_cast<short(*)[2]>(buffer);
+    size_t count = st.st_size / sizeof(*frames);
+
+    // Fill the ring in place whenever there's room, the mixer picks the frames up without any copy or syscall
+    size_t written = 0;
+    pollfd pfd = { fd, POLLOUT, 0 };
+
+    while (written < count) {
+        unsigned long long position = ring->write_position;
+        size_t space = ring->frame_count - (position - ring->read_position);
+
+        if (!space) {
+            poll(&pfd, 1, -1);
+            continue;
+        }
+
+        size_t chunk = std::min(space, count - written);
+        for (size_t i = 0; i < chunk; i++) {
+            auto& frame = ring->frames[(position + i) % ring->frame_count];
+
+            frame[0] = frames[written + i][0];
+            frame[1] = frames[written + i][1];
+        }
+
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        ring->write_position = position + chunk;
+
+        written += chunk;
+    }
+
+    // There's always room now, so wait for the mixer to drain the ring a period at a time
+    while (ring->read_position < ring->write_position) {
+        usleep(latency * 1000);
+    }
+
+    soundcard_position position;
+    ioctl(fd, SOUNDCARD_GET_POSITION, &position);
+
+    dbgln("Played {} frames, {} frames still queued in the device", static_cast<u64>(position.stream_frames), static_cast<u32>(position.delay));
 
     close(audio);
     close(fd);
@@ -49,4 +106,4 @@ int main(int argc, char** argv) {
     delete[] buffer;
 
     return 0;
-}
\ No newline at end of file
+}
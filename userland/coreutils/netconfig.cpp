@@ -0,0 +1,199 @@
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <std/format.h>
+#include <std/string.h>
+
+static constexpr int MAX_ENTRIES = 64;
+
+static String format_address(unsigned address) {
+    auto* bytes = reinterpret_cast<u8*>(&address);
+    return std::format("{}.{}.{}.{}", bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+static String format_mac(unsigned char const* mac) {
+    return std::format("{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static bool parse_mac(const char* text, unsigned char* mac) {
+    for (size_t i = 0; i < 6; i++) {
+        unsigned value = 0;
+        for (size_t j = 0; j < 2; j++) {
+            char ch = *text++;
+            if (ch >= '0' && ch <= '9') {
+                value = value * 16 + (ch - '0');
+            } else if (ch >= 'a' && ch <= 'f') {
+                value = value * 16 + (ch - 'a' + 10);
+            } else if (ch >= 'A' && ch <= 'F') {
+                value = value * 16 + (ch - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+
+        if (*text != (i == 5 ? '\0' : ':')) {
+            return false;
+        }
+
+        mac[i] = value;
+        text++;
+    }
+
+    return true;
+}
+
+static int request(int fd, unsigned request, void* arg) {
+    int result = ioctl(fd, request, arg);
+    if (result < 0) {
+        dbgln("netconfig: {}", strerror(errno));
+    }
+
+    return result;
+}
+
+static int list_interfaces(int fd) {
+    net_interface interfaces[MAX_ENTRIES];
+    net_table_request table = { interfaces, MAX_ENTRIES };
+
+    int count = request(fd, SIOCGIFCONF, &table);
+    if (count < 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < std::min(count, MAX_ENTRIES); i++) {
+        auto& interface = interfaces[i];
+        const char* type = interface.type == NET_INTERFACE_LOOPBACK ? "loopback" : "ethernet";
+
+        dbgln(
+            "{}: {} {} inet {} netmask {} mtu {}",
+            interface.index, type, format_mac(interface.mac),
+            format_address(interface.address), format_address(interface.netmask), interface.mtu
+        );
+    }
+
+    return 0;
+}
+
+static int list_routes(int fd) {
+    net_route routes[MAX_ENTRIES];
+    net_table_request table = { routes, MAX_ENTRIES };
+
+    int count = request(fd, SIOCGRTABLE, &table);
+    if (count < 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < std::min(count, MAX_ENTRIES); i++) {
+        auto& route = routes[i];
+        dbgln(
+            "{}/{} via {} dev {}",
+            format_address(route.destination), format_address(route.netmask), format_address(route.gateway), route.interface
+        );
+    }
+
+    return 0;
+}
+
+static int list_arp_entries(int fd) {
+    static constexpr const char* states[] = { "incomplete", "reachable", "stale", "probe", "permanent" };
+
+    net_arp_entry entries[MAX_ENTRIES];
+    net_table_request table = { entries, MAX_ENTRIES };
+
+    int count = request(fd, SIOCGARPTABLE, &table);
+    if (count < 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < std::min(count, MAX_ENTRIES); i++) {
+        auto& entry = entries[i];
+        dbgln("{} lladdr {} dev {} {}", format_address(entry.address), format_mac(entry.mac), entry.interface, states[entry.state]);
+    }
+
+    return 0;
+}
+
+static int usage(const char* name) {
+    dbgln("Usage: {}", name);
+    dbgln("       {} addr <interface> <address> <netmask>", name);
+    dbgln("       {} route [add <destination> <netmask> <gateway> [interface] | del <destination> <netmask>]", name);
+    dbgln("       {} arp [add <interface> <address> <mac> | del <address>]", name);
+
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        dbgln("socket: {}", strerror(errno));
+        return 1;
+    }
+
+    if (argc < 2) {
+        return list_interfaces(fd);
+    }
+
+    if (!strcmp(argv[1], "addr")) {
+        if (argc != 5) {
+            return usage(argv[0]);
+        }
+
+        net_interface interface = {};
+        interface.index = atoi(argv[2]);
+        interface.address = inet_addr(argv[3]);
+        interface.netmask = inet_addr(argv[4]);
+
+        return request(fd, SIOCSIFADDR, &interface) < 0;
+    } else if (!strcmp(argv[1], "route")) {
+        if (argc == 2) {
+            return list_routes(fd);
+        }
+
+        net_route route = {};
+        if (!strcmp(argv[2], "add") && (argc == 6 || argc == 7)) {
+            route.destination = inet_addr(argv[3]);
+            route.netmask = inet_addr(argv[4]);
+            route.gateway = inet_addr(argv[5]);
+            route.interface = argc == 7 ? atoi(argv[6]) : -1;
+
+            return request(fd, SIOCADDRT, &route) < 0;
+        } else if (!strcmp(argv[2], "del") && argc == 5) {
+            route.destination = inet_addr(argv[3]);
+            route.netmask = inet_addr(argv[4]);
+
+            return request(fd, SIOCDELRT, &route) < 0;
+        }
+
+        return usage(argv[0]);
+    } else if (!strcmp(argv[1], "arp")) {
+        if (argc == 2) {
+            return list_arp_entries(fd);
+        }
+
+        net_arp_entry entry = {};
+        if (!strcmp(argv[2], "add") && argc == 6) {
+            entry.interface = atoi(argv[3]);
+            entry.address = inet_addr(argv[4]);
+
+            if (!parse_mac(argv[5], entry.mac)) {
+                dbgln("netconfig: Invalid MAC address '{}'", argv[5]);
+                return 1;
+            }
+
+            return request(fd, SIOCSARP, &entry) < 0;
+        } else if (!strcmp(argv[2], "del") && argc == 4) {
+            entry.address = inet_addr(argv[3]);
+            return request(fd, SIOCDARP, &entry) < 0;
+        }
+
+        return usage(argv[0]);
+    }
+
+    return usage(argv[0]);
+}
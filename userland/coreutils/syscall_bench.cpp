@@ -0,0 +1,40 @@
+#include <unistd.h>
+#include <stdlib.h>
+
+#include <std/format.h>
+
+static inline u64 rdtsc() {
+    u32 low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+    return (static_cast<u64>(high) << 32) | low;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = 100000;
+    if (argc > 1) {
+        int value = atoi(argv[1]);
+        if (value <= 0) {
+            dbgln("Usage: {} [iterations]", argv[0]);
+            return 1;
+        }
+
+        iterations = value;
+    }
+
+    // Warm up the caches and TLB before measuring
+    for (size_t i = 0; i < 1000; i++) {
+        getpid();
+    }
+
+    u64 start = rdtsc();
+    for (size_t i = 0; i < iterations; i++) {
+        getpid();
+    }
+    u64 end = rdtsc();
+
+    u64 cycles = end - start;
+    dbgln("getpid: {} iterations, {} cycles total, {} cycles/syscall", iterations, cycles, cycles / iterations);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <std/format.h>
+#include <std/time.h>
+
+static constexpr u16 DEFAULT_PORT = 5001;
+static constexpr size_t DEFAULT_MEGABYTES = 64;
+static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+static u8 s_buffer[CHUNK_SIZE];
+
+static Duration now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return Duration::from_timespec(ts);
+}
+
+static bool read_exact(int fd, void* buffer, size_t size) {
+    auto* data = reinterpret_cast<u8*>(buffer);
+    while (size) {
+        ssize_t nread = recv(fd, data, size, 0);
+        if (nread <= 0) {
+            return false;
+        }
+
+        data += nread;
+        size -= nread;
+    }
+
+    return true;
+}
+
+static void report(const char* role, u64 bytes, Duration elapsed) {
+    u64 us = std::max<u64>(elapsed.to_microseconds(), 1);
+    u64 kbps = bytes * 1'000'000 / us / 1024;
+
+    dbgln("{}: {} bytes in {}.{:06} seconds ({} KiB/s)", role, bytes, elapsed.seconds(), us % 1'000'000, kbps);
+}
+
+// The client announces how many bytes it's going to send, the server acknowledges with a single byte once it got all of them
+static int run_server(u16 port) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        dbgln("socket: {}", strerror(errno));
+        return 1;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        dbgln("bind: {}", strerror(errno));
+        return 1;
+    }
+
+    if (listen(listener, 1) < 0) {
+        dbgln("listen: {}", strerror(errno));
+        return 1;
+    }
+
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+        dbgln("accept: {}", strerror(errno));
+        return 1;
+    }
+
+    u64 total = 0;
+    if (!read_exact(fd, &total, sizeof(total))) {
+        dbgln("Failed to read the transfer size");
+        return 1;
+    }
+
+    Duration start = now();
+
+    u64 received = 0;
+    while (received < total) {
+        ssize_t nread = recv(fd, s_buffer, std::min<u64>(CHUNK_SIZE, total - received), 0);
+        if (nread <= 0) {
+            dbgln("recv: {}", nread < 0 ? strerror(errno) : "connection closed early");
+            return 1;
+        }
+
+        received += nread;
+    }
+
+    report("server", received, now() - start);
+
+    u8 done = 1;
+    send(fd, &done, sizeof(done), 0);
+
+    close(fd);
+    close(listener);
+
+    return 0;
+}
+
+static int run_client(in_addr_t host, u16 port, size_t megabytes) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        dbgln("socket: {}", strerror(errno));
+        return 1;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = host;
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        dbgln("connect: {}", strerror(errno));
+        return 1;
+    }
+
+    u64 total = static_cast<u64>(megabytes) * 1024 * 1024;
+    if (send(fd, &total, sizeof(total), 0) != sizeof(total)) {
+        dbgln("send: {}", strerror(errno));
+        return 1;
+    }
+
+    memset(s_buffer, 0xAA, sizeof(s_buffer));
+    Duration start = now();
+
+    u64 sent = 0;
+    while (sent < total) {
+        ssize_t nwritten = send(fd, s_buffer, std::min<u64>(CHUNK_SIZE, total - sent), 0);
+        if (nwritten < 0) {
+            dbgln("send: {}", strerror(errno));
+            return 1;
+        }
+
+        sent += nwritten;
+    }
+
+    u8 done = 0;
+    if (!read_exact(fd, &done, sizeof(done))) {
+        dbgln("The server didn't acknowledge the transfer");
+        return 1;
+    }
+
+    report("client", sent, now() - start);
+
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "server")) {
+        u16 port = argc > 2 ? atoi(argv[2]) : DEFAULT_PORT;
+        return run_server(port);
+    } else if (argc > 2 && !strcmp(argv[1], "client")) {
+        u16 port = argc > 3 ? atoi(argv[3]) : DEFAULT_PORT;
+        size_t megabytes = argc > 4 ? atoi(argv[4]) : DEFAULT_MEGABYTES;
+
+        return run_client(inet_addr(argv[2]), port, megabytes);
+    } else if (argc > 1) {
+        dbgln("Usage: {} [server [port] | client <address> [port] [megabytes]]", argv[0]);
+        return 1;
+    }
+
+    // Without arguments both ends run over the loopback adapter
+    pid_t pid = fork();
+    if (!pid) {
+        return run_server(DEFAULT_PORT);
+    }
+
+    // Give the server a moment to start listening
+    struct timespec delay = { 0, 100'000'000 };
+    nanosleep(&delay, nullptr);
+
+    int result = run_client(htonl(INADDR_LOOPBACK), DEFAULT_PORT, DEFAULT_MEGABYTES);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    return result;
+}
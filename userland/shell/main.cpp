@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/wait.h>
+#include <poll.h>
 
 #include <std/format.h>
 #include <std/types.h>
@@ -80,11 +81,17 @@ static void spawn(shell::Terminal& terminal, shell::Command const& command, char
 
     char buffer[4096];
     int status = 0;
+
+    // A full buffer means more output is right behind it, so only draw once a burst of output is over
+    terminal.begin_batch();
     
     while (true) {
         ssize_t n = read(fd, buffer, sizeof(buffer));
         if (n > 0) {
             terminal.write(StringView { buffer, static_cast<size_t>(n) });
+            if (static_cast<size_t>(n) < sizeof(buffer)) {
+                terminal.flush_batch();
+            }
         } else if (n < 0) {
             break;
         }
@@ -100,6 +107,7 @@ static void spawn(shell::Terminal& terminal, shell::Command const& command, char
         n = read(fd, buffer, sizeof(buffer));
     }
 
+    terminal.end_batch();
     close(fd);
 }
 
@@ -186,6 +194,31 @@ int main() {
     auto iterator = history.begin();
 
     shell::Terminal terminal(context, font);
+
+    // Only what was drawn since the last render goes to the display
+    terminal.on_render = [&]() {
+        Vector<gpu_rect> rects;
+        for (auto& rect : terminal.take_damage()) {
+            rects.append({ rect.x(), rect.y(), rect.width(), rect.height() });
+        }
+
+        if (rects.empty()) {
+            return;
+        }
+
+        struct gpu_connector_flush flush;
+        flush.id = connector.id;
+        flush.rects = rects.data();
+        flush.count = rects.size();
+
+        // The kernel refuses to take that many, flushing the whole screen ends up being the same thing
+        if (rects.size() > GPU_CONNECTOR_MAX_RECTS) {
+            flush.count = 0;
+        }
+
+        ioctl(gpu, GPU_CONNECTOR_FLUSH, &flush);
+    };
+
     terminal.on_line_flush = [&](String text) {
         if (text.empty()) {
             return;
@@ -202,8 +235,11 @@ int main() {
         run_command(terminal, text);
     };
 
+    struct pollfd kb_poll = { kb, POLLIN, 0 };
     while (true) {
         if (read(kb, &event, sizeof(KeyEvent)) <= 0) {
+            // Sleep until the keyboard has something for us instead of spinning on read()
+            poll(&kb_poll, 1, -1);
             continue;
         }
 
@@ -228,11 +264,6 @@ int main() {
         }
 
         terminal.on_char(event.ascii);
-
-        struct gpu_connector_flush flush;
-        flush.id = connector.id;
-
-        ioctl(gpu, GPU_CONNECTOR_FLUSH, &flush);
     }
 
     close(gpu);
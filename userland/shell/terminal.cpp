@@ -8,7 +8,7 @@ namespace shell {
 
 Terminal::Terminal(
     gfx::RenderContext& context, RefPtr<gfx::PSFFont> font
-) : on_line_flush(nullptr), m_render_context(context), m_font(move(font)) {
+) : on_line_flush(nullptr), on_render(nullptr), m_render_context(context), m_font(move(font)) {
     auto& fb = m_render_context.framebuffer();
     
     m_height = fb.height();
@@ -112,25 +112,72 @@ void Terminal::render_cell(size_t row, size_t col, const Cell& cell) {
         glyph = m_font->glyph(0);
     }
 
-    u32* framebuffer = m_render_context.framebuffer().buffer();
-
     size_t y = row * m_font->height();
     size_t x = col * m_font->width();
 
-    for (size_t dy = 0; dy < m_font->height(); dy++) {
-        u8 byte = glyph[dy];
+    m_render_context.framebuffer().draw_glyph(x, y, glyph, m_font->width(), m_font->height(), cell.fg, cell.bg);
+}
 
-        for (size_t dx = 0; dx < m_font->width(); dx++) {
-            u32 color = (byte & (1 << (7 - dx))) ? cell.fg : cell.bg;
-            size_t index = (y + dy) * m_pitch / 4 + (x + dx);
-            
-            framebuffer[index] = color;
-        }
+void Terminal::begin_batch() {
+    m_batch_depth++;
+}
+
+void Terminal::end_batch() {
+    if (m_batch_depth > 0) {
+        m_batch_depth--;
+    }
+
+    if (!m_batch_depth) {
+        this->flush_batch();
     }
 }
 
+void Terminal::flush_batch() {
+    if (!m_render_pending) {
+        return;
+    }
+
+    size_t depth = m_batch_depth;
+    m_batch_depth = 0;
+
+    this->render();
+    m_batch_depth = depth;
+}
+
+void Terminal::apply_scroll() {
+    int width = m_cols * m_font->width();
+    int height = m_font->height();
+
+    auto& framebuffer = m_render_context.framebuffer();
+    int lines = m_pending_scroll;
+
+    // Everything that stayed on screen is still drawn correctly, just too far down
+    if (lines < static_cast<int>(m_rows)) {
+        framebuffer.move_rect(0, lines * height, width, (m_rows - lines) * height, 0, 0);
+    }
+
+    framebuffer.fill_rect(0, (m_rows - lines) * height, width, lines * height, DEFAULT_BG);
+    m_damage.append(gfx::Rect(0, 0, width, m_rows * height));
+
+    m_pending_scroll = 0;
+}
+
 void Terminal::render() {
+    if (m_batch_depth) {
+        m_render_pending = true;
+        return;
+    }
+
+    m_render_pending = false;
+    if (m_pending_scroll) {
+        this->apply_scroll();
+    }
+
+    int width = m_font->width();
+    int height = m_font->height();
+
     for (size_t row = 0; row < m_rows; row++) {
+        size_t first = m_cols, last = 0;
         for (size_t col = 0; col < m_cols; col++) {
             size_t index = col + row * m_cols;
             auto& cell = m_cells[index];
@@ -138,11 +185,19 @@ void Terminal::render() {
             if (cell.dirty) {
                 this->render_cell(row, col, m_cells[index]);
                 cell.dirty = false;
+
+                first = std::min(first, col);
+                last = col;
             }
         }
+
+        if (first <= last) {
+            m_damage.append(gfx::Rect(first * width, row * height, (last - first + 1) * width, height));
+        }
     }
 
     this->render_cursor();
+    this->on_render();
 }
 
 void Terminal::render_cursor(u32 color) {
@@ -156,26 +211,21 @@ void Terminal::render_cursor(u32 color) {
     cell.dirty = true;
 
     this->fill(x, y, height, width, color);
+    m_damage.append(gfx::Rect(x, y, width, height));
 }
 
 void Terminal::fill(size_t x, size_t y, size_t height, size_t width, u32 color) {
-    u32* framebuffer = m_render_context.framebuffer().buffer();
-
-    for (size_t dy = 0; dy < height; dy++) {
-        for (size_t dx = 0; dx < width; dx++) {
-            size_t index = (y + dy) * m_pitch / 4 + (x + dx);
-            framebuffer[index] = color;
-        }
-    }
+    m_render_context.framebuffer().fill_rect(x, y, width, height, color);
 }
 
 void Terminal::scroll() {
-    // We don't have to re-render everything here, since we know what ever calls push() will call render() later.
+    // Cells keep their dirty flag as they move, the pixels they were drawn with move along in `apply_scroll`. The
+    // new row starts out blank, which is what `apply_scroll` fills it with.
     memmove(m_cells.data(), m_cells.data() + m_cols, (m_rows - 1) * m_cols * sizeof(Cell));
     memset(m_cells.data() + (m_rows - 1) * m_cols, 0, m_cols * sizeof(Cell));
 
-    for (auto& cell : m_cells) {
-        cell.dirty = true;
+    if (m_pending_scroll < m_rows) {
+        m_pending_scroll++;
     }
 }
 
@@ -7,6 +7,7 @@
 #include <std/format.h>
 
 #include <libgfx/render_context.h>
+#include <libgfx/rect.h>
 #include <libgfx/fonts/psf.h>
 #include <libgfx/font.h>
 
@@ -32,6 +33,9 @@ public:
     
     Function<void(String)> on_line_flush;
 
+    // Called whenever a render produced damage that should be pushed to the display
+    Function<void()> on_render;
+
     void fetch_cwd();
 
     Line& current_line();
@@ -48,8 +52,20 @@ public:
 
     void render_cell(size_t row, size_t col, Cell const& cell);
     void render_cursor(u32 color = DEFAULT_FG);
+
+    // Redraws the cells that changed since the last call, their regions are added to the damage
     void render();
 
+    // The regions of the framebuffer drawn to since the last call, for flushing to the display
+    Vector<gfx::Rect> take_damage() { return move(m_damage); }
+
+    // While batching, render() only remembers that something changed. Whatever piled up is drawn by `flush_batch`
+    // (e.g. once a burst of output is over) or when the last batch ends.
+    void begin_batch();
+    void end_batch();
+    void flush_batch();
+
+    // Moves the cells up by a row, the pixels follow with a single block move on the next render
     void scroll();
 
     void push(StringView text);
@@ -57,6 +73,7 @@ public:
 
 private:
     void fill(size_t x, size_t y, size_t height, size_t width, u32 color);
+    void apply_scroll();
 
     gfx::RenderContext& m_render_context;
     RefPtr<gfx::PSFFont> m_font;
@@ -64,8 +81,17 @@ private:
     Vector<Line> m_lines;
     Vector<Cell> m_cells;
 
+    // One rectangle per row that had dirty cells plus one for the cursor, the kernel merges them
+    Vector<gfx::Rect> m_damage;
+
     u32 m_current_line = 0;
 
+    // Rows the cells have scrolled by since the framebuffer was last brought up to date
+    size_t m_pending_scroll = 0;
+
+    size_t m_batch_depth = 0;
+    bool m_render_pending = false;
+
     u32 m_width;
     u32 m_height;
     u32 m_pitch;